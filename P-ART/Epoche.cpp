@@ -7,6 +7,7 @@
 #include <assert.h>
 #include <iostream>
 #include "Epoche.h"
+#include "Pool.h"
 using namespace ART;
 
 
@@ -91,7 +92,7 @@ inline void Epoche::exitEpocheAndCleanup(ThreadInfo &epocheInfo) {
 
         uint64_t oldestEpoche = std::numeric_limits<uint64_t>::max();
         for (auto &epoche : deletionLists) {
-            auto e = epoche.localEpoche.load();
+            auto e = std::min(epoche.localEpoche.load(), epoche.pinnedEpoche.load());
             if (e < oldestEpoche) {
                 oldestEpoche = e;
             }
@@ -103,7 +104,7 @@ inline void Epoche::exitEpocheAndCleanup(ThreadInfo &epocheInfo) {
 
             if (cur->epoche < oldestEpoche) {
                 for (std::size_t i = 0; i < cur->nodesCount; ++i) {
-                    operator delete(cur->nodes[i]);
+                    Pool::deallocate(pool, cur->nodes[i]);
                 }
                 deletionList.remove(cur, prev);
             } else {
@@ -115,6 +116,28 @@ inline void Epoche::exitEpocheAndCleanup(ThreadInfo &epocheInfo) {
     }
 }
 
+inline void Epoche::pin(ThreadInfo &epocheInfo) {
+    DeletionList &deletionList = epocheInfo.getDeletionList();
+    if (deletionList.pinCount++ == 0) {
+        deletionList.pinnedEpoche.store(currentEpoche.load());
+    }
+}
+
+inline void Epoche::unpin(ThreadInfo &epocheInfo) {
+    DeletionList &deletionList = epocheInfo.getDeletionList();
+    if (--deletionList.pinCount == 0) {
+        deletionList.pinnedEpoche.store(std::numeric_limits<uint64_t>::max());
+    }
+}
+
+inline void Epoche::setPool(Pool *pool) {
+    this->pool = pool;
+}
+
+inline Pool *Epoche::getPool() const {
+    return pool;
+}
+
 inline Epoche::~Epoche() {
     uint64_t oldestEpoche = std::numeric_limits<uint64_t>::max();
     for (auto &epoche : deletionLists) {
@@ -130,7 +153,7 @@ inline Epoche::~Epoche() {
 
             assert(cur->epoche < oldestEpoche);
             for (std::size_t i = 0; i < cur->nodesCount; ++i) {
-                operator delete(cur->nodes[i]);
+                Pool::deallocate(pool, cur->nodes[i]);
             }
             d.remove(cur, prev);
             cur = next;
@@ -155,4 +178,15 @@ inline Epoche &ThreadInfo::getEpoche() const {
     return epoche;
 }
 
+inline Pool *ThreadInfo::getPool() const {
+    return epoche.getPool();
+}
+
+inline uint64_t *ThreadInfo::getValueBuffer(std::size_t count) {
+    if (values.size() < count) {
+        values.resize(count);
+    }
+    return values.data();
+}
+
 #endif //EPOCHE_CPP
\ No newline at end of file
@@ -3,6 +3,8 @@
 
 #include <atomic>
 #include <array>
+#include <limits>
+#include <vector>
 #include "tbb/enumerable_thread_specific.h"
 #include "tbb/combinable.h"
 
@@ -24,6 +26,10 @@ namespace ART {
         std::atomic<uint64_t> localEpoche;
         size_t thresholdCounter{0};
 
+        // epoche of the oldest pin of the thread, see Epoche::pin
+        std::atomic<uint64_t> pinnedEpoche{std::numeric_limits<uint64_t>::max()};
+        std::size_t pinCount{0};
+
         ~DeletionList();
         LabelDelete *head();
 
@@ -39,12 +45,14 @@ namespace ART {
 
     class Epoche;
     class EpocheGuard;
+    class Pool;
 
     class ThreadInfo {
         friend class Epoche;
         friend class EpocheGuard;
         Epoche &epoche;
         DeletionList &deletionList;
+        std::vector<uint64_t> values;
 
 
         DeletionList & getDeletionList() const;
@@ -58,6 +66,13 @@ namespace ART {
         ~ThreadInfo();
 
         Epoche & getEpoche() const;
+
+        Pool *getPool() const;
+
+        /**
+         * storage for count values that lookups copy out of the tree, it is reused by the next call
+         */
+        uint64_t *getValueBuffer(std::size_t count);
     };
 
     class Epoche {
@@ -68,18 +83,32 @@ namespace ART {
 
         size_t startGCThreshhold;
 
+        // pool the nodes of the tree are allocated from, nullptr for the general-purpose allocator
+        Pool *pool = nullptr;
 
     public:
         Epoche(size_t startGCThreshhold) : startGCThreshhold(startGCThreshhold) { }
 
         ~Epoche();
 
+        void setPool(Pool *pool);
+
+        Pool *getPool() const;
+
         void enterEpoche(ThreadInfo &epocheInfo);
 
         void markNodeForDeletion(void *n, ThreadInfo &epocheInfo);
 
         void exitEpocheAndCleanup(ThreadInfo &info);
 
+        /**
+         * keeps all nodes reachable from now on from being freed until the matching unpin, independent of
+         * the operations the thread runs in between
+         */
+        void pin(ThreadInfo &epocheInfo);
+
+        void unpin(ThreadInfo &epocheInfo);
+
         void showDeleteRatio();
 
     };
@@ -170,18 +170,18 @@ namespace ART_ROWEX {
     }
 
     template<typename curN, typename biggerN>
-    void N::insertGrow(curN *n, N *parentNode, uint8_t keyParent, uint8_t key, N *val, ThreadInfo &threadInfo, bool &needRestart) {
-        if (n->insert(key, val, true)) {
+    void N::insertGrow(curN *n, N *parentNode, uint8_t keyParent, uint8_t key, N *val, uint64_t value, ThreadInfo &threadInfo, bool &needRestart) {
+        if (n->insert(key, val, value, true)) {
             n->writeUnlock();
             return;
         }
-        auto nBig = new biggerN(n->getLevel(), n->getPrefi());
+        auto nBig = new (threadInfo.getPool()) biggerN(n->getLevel(), n->getPrefi());
         n->copyTo(nBig);
-        nBig->insert(key, val, false);
+        nBig->insert(key, val, value, false);
 
         parentNode->writeLockOrRestart(needRestart);
         if (needRestart) {
-            delete nBig;
+            deleteNode(nBig, threadInfo.getPool());
             n->writeUnlock();
             return;
         }
@@ -195,17 +195,17 @@ namespace ART_ROWEX {
     }
 
     template<typename curN>
-    bool N::insertCompact(curN *n, N *parentNode, uint8_t keyParent, uint8_t key, N *val, ThreadInfo &threadInfo, bool &needRestart) {
-        auto nNew = new curN(n->getLevel(), n->getPrefi());
+    bool N::insertCompact(curN *n, N *parentNode, uint8_t keyParent, uint8_t key, N *val, uint64_t value, ThreadInfo &threadInfo, bool &needRestart) {
+        auto nNew = new (threadInfo.getPool()) curN(n->getLevel(), n->getPrefi());
         n->copyTo(nNew);
-        if (!nNew->insert(key, val, false)) {
-            delete nNew;
+        if (!nNew->insert(key, val, value, false)) {
+            deleteNode(nNew, threadInfo.getPool());
             return false;
         }
 
         parentNode->writeLockOrRestart(needRestart);
         if (needRestart) {
-            delete nNew;
+            deleteNode(nNew, threadInfo.getPool());
             n->writeUnlock();
             return true;
         }
@@ -219,45 +219,45 @@ namespace ART_ROWEX {
         return true;
     }
 
-    void N::insertAndUnlock(N *node, N *parentNode, uint8_t keyParent, uint8_t key, N *val, ThreadInfo &threadInfo, bool &needRestart) {
+    void N::insertAndUnlock(N *node, N *parentNode, uint8_t keyParent, uint8_t key, N *val, uint64_t value, ThreadInfo &threadInfo, bool &needRestart) {
         switch (node->getType()) {
             case NTypes::N4: {
                 auto n = static_cast<N4 *>(node);
                 if (n->compactCount.load(std::memory_order_acquire) == 4 && n->count.load(std::memory_order_acquire) <= 3) {
-                    if (!insertCompact<N4>(n, parentNode, keyParent, key, val, threadInfo, needRestart))
-                        insertGrow<N4, N16>(n, parentNode, keyParent, key, val, threadInfo, needRestart);
+                    if (!insertCompact<N4>(n, parentNode, keyParent, key, val, value, threadInfo, needRestart))
+                        insertGrow<N4, N16>(n, parentNode, keyParent, key, val, value, threadInfo, needRestart);
                     break;
                 }
-                insertGrow<N4, N16>(n, parentNode, keyParent, key, val, threadInfo, needRestart);
+                insertGrow<N4, N16>(n, parentNode, keyParent, key, val, value, threadInfo, needRestart);
                 break;
             }
             case NTypes::N16: {
                 auto n = static_cast<N16 *>(node);
                 if (n->compactCount.load(std::memory_order_acquire) == 16 && n->count.load(std::memory_order_acquire) <= 14) {
-                    if (!insertCompact<N16>(n, parentNode, keyParent, key, val, threadInfo, needRestart))
-                        insertGrow<N16, N48>(n, parentNode, keyParent, key, val, threadInfo, needRestart);
+                    if (!insertCompact<N16>(n, parentNode, keyParent, key, val, value, threadInfo, needRestart))
+                        insertGrow<N16, N48>(n, parentNode, keyParent, key, val, value, threadInfo, needRestart);
                     break;
                 }
-                insertGrow<N16, N48>(n, parentNode, keyParent, key, val, threadInfo, needRestart);
+                insertGrow<N16, N48>(n, parentNode, keyParent, key, val, value, threadInfo, needRestart);
                 break;
             }
             case NTypes::N48: {
                 auto n = static_cast<N48 *>(node);
                 if (n->compactCount.load(std::memory_order_acquire) == 48 && n->count.load(std::memory_order_acquire) != 48) {
-                    if (!insertCompact<N48>(n, parentNode, keyParent, key, val, threadInfo, needRestart))
-                        insertGrow<N48, N256>(n, parentNode, keyParent, key, val, threadInfo, needRestart);
+                    if (!insertCompact<N48>(n, parentNode, keyParent, key, val, value, threadInfo, needRestart))
+                        insertGrow<N48, N256>(n, parentNode, keyParent, key, val, value, threadInfo, needRestart);
                     break;
                 }
-                insertGrow<N48, N256>(n, parentNode, keyParent, key, val, threadInfo, needRestart);
+                insertGrow<N48, N256>(n, parentNode, keyParent, key, val, value, threadInfo, needRestart);
                 break;
             }
             case NTypes::N256: {
                 auto n = static_cast<N256 *>(node);
-                if (n->insert(key, val, true)) {
+                if (n->insert(key, val, value, true)) {
                     node->writeUnlock();
                     break;
                 }
-                insertCompact<N256>(n, parentNode, keyParent, key, val, threadInfo, needRestart);
+                insertCompact<N256>(n, parentNode, keyParent, key, val, value, threadInfo, needRestart);
                 break;
             }
         }
@@ -286,6 +286,64 @@ namespace ART_ROWEX {
         __builtin_unreachable();
     }
 
+    std::atomic<uint64_t> *N::getValuePos([[maybe_unused]] const uint8_t k, [[maybe_unused]] N *node) {
+#ifdef ART_INLINE_LEAVES
+        switch (node->getType()) {
+            case NTypes::N4: {
+                auto n = static_cast<N4 *>(node);
+                return n->getValuePos(k);
+            }
+            case NTypes::N16: {
+                auto n = static_cast<N16 *>(node);
+                return n->getValuePos(k);
+            }
+            case NTypes::N48: {
+                auto n = static_cast<N48 *>(node);
+                return n->getValuePos(k);
+            }
+            case NTypes::N256: {
+                auto n = static_cast<N256 *>(node);
+                return n->getValuePos(k);
+            }
+        }
+        assert(false);
+        __builtin_unreachable();
+#else
+        return nullptr;
+#endif
+    }
+
+    void N::setValue(N *node, uint8_t key, uint64_t value) {
+        std::atomic<uint64_t> *valuePos = getValuePos(key, node);
+        assert(valuePos != nullptr);
+        movnt64((uint64_t *)valuePos, value, false, true);
+    }
+
+    void N::prefetchChild(const uint8_t k, const N *node) {
+        switch (node->getType()) {
+            case NTypes::N4: {
+                auto n = static_cast<const N4 *>(node);
+                n->prefetchChild(k);
+                return;
+            }
+            case NTypes::N16: {
+                auto n = static_cast<const N16 *>(node);
+                n->prefetchChild(k);
+                return;
+            }
+            case NTypes::N48: {
+                auto n = static_cast<const N48 *>(node);
+                n->prefetchChild(k);
+                return;
+            }
+            case NTypes::N256: {
+                auto n = static_cast<const N256 *>(node);
+                n->prefetchChild(k);
+                return;
+            }
+        }
+    }
+
     void N::deleteChildren(N *node) {
         if (N::isLeaf(node)) {
             return;
@@ -323,11 +381,11 @@ namespace ART_ROWEX {
             return;
         }
 
-        auto nSmall = new smallerN(n->getLevel(), n->getPrefi());
+        auto nSmall = new (threadInfo.getPool()) smallerN(n->getLevel(), n->getPrefi());
 
         parentNode->writeLockOrRestart(needRestart);
         if (needRestart) {
-            delete nSmall;
+            deleteNode(nSmall, threadInfo.getPool());
             n->writeUnlock();
             return;
         }
@@ -456,9 +514,57 @@ namespace ART_ROWEX {
     }
 
     Key *N::getLeaf(const N *n) {
+        assert(!isInlineLeaf(n));
         return reinterpret_cast<Key *>(reinterpret_cast<void *>((reinterpret_cast<uintptr_t>(n) & ~(1ULL << 0))));
     }
 
+    bool N::fitsInline([[maybe_unused]] const Key *k) {
+#ifdef ART_INLINE_LEAVES
+        return k->getKeyLen() <= maxInlineKeyLength;
+#else
+        return false;
+#endif
+    }
+
+    bool N::isInlineLeaf(const N *n) {
+        return (reinterpret_cast<uintptr_t>(n) & 0b11) == 0b11;
+    }
+
+    N *N::setInlineLeaf(const Key *k) {
+        assert(fitsInline(k) && k->getKeyLen() > 0);
+        // bits 63..8 key bytes 1 to 7, bits 5..2 key length
+        uint64_t slot;
+        if (k->getKeyLen() == maxInlineKeyLength) {
+            slot = __builtin_bswap64(*reinterpret_cast<const uint64_t *>(k->fkey)) << 8;
+        } else {
+            slot = 0;
+            for (uint32_t i = 1; i < k->getKeyLen(); ++i) {
+                slot |= static_cast<uint64_t>(k->fkey[i]) << (64 - 8 * i);
+            }
+        }
+        return reinterpret_cast<N *>(slot | (k->getKeyLen() << 2) | 0b11);
+    }
+
+    N *N::makeLeaf(const Key *k) {
+        return fitsInline(k) ? setInlineLeaf(k) : setLeaf(k);
+    }
+
+    const Key *N::getInlineLeaf(const N *n, uint8_t firstByte, InlineKey &key) {
+        assert(isInlineLeaf(n));
+        uint64_t slot = reinterpret_cast<uintptr_t>(n);
+        key.key_len = (slot >> 2) & 0b1111;
+        *reinterpret_cast<uint64_t *>(key.fkey) = __builtin_bswap64(slot >> 8);
+        key.fkey[0] = firstByte;
+        return key.get();
+    }
+
+    const Key *N::getLeafKey(const N *n, uint8_t firstByte, InlineKey &key) {
+        if (isInlineLeaf(n)) {
+            return getInlineLeaf(n, firstByte, key);
+        }
+        return getLeaf(n);
+    }
+
     std::tuple<N *, uint8_t> N::getSecondChild(N *node, const uint8_t key) {
         switch (node->getType()) {
             case NTypes::N4: {
@@ -472,36 +578,86 @@ namespace ART_ROWEX {
         }
     }
 
-    void N::deleteNode(N *node) {
+    N *N::getNextChild(const N *node, const uint8_t start, uint8_t &key) {
+        switch (node->getType()) {
+            case NTypes::N4: {
+                auto n = static_cast<const N4 *>(node);
+                return n->getNextChild(start, key);
+            }
+            case NTypes::N16: {
+                auto n = static_cast<const N16 *>(node);
+                return n->getNextChild(start, key);
+            }
+            case NTypes::N48: {
+                auto n = static_cast<const N48 *>(node);
+                return n->getNextChild(start, key);
+            }
+            case NTypes::N256: {
+                auto n = static_cast<const N256 *>(node);
+                return n->getNextChild(start, key);
+            }
+        }
+        assert(false);
+        __builtin_unreachable();
+    }
+
+    N *N::getPrevChild(const N *node, const uint8_t end, uint8_t &key) {
+        switch (node->getType()) {
+            case NTypes::N4: {
+                auto n = static_cast<const N4 *>(node);
+                return n->getPrevChild(end, key);
+            }
+            case NTypes::N16: {
+                auto n = static_cast<const N16 *>(node);
+                return n->getPrevChild(end, key);
+            }
+            case NTypes::N48: {
+                auto n = static_cast<const N48 *>(node);
+                return n->getPrevChild(end, key);
+            }
+            case NTypes::N256: {
+                auto n = static_cast<const N256 *>(node);
+                return n->getPrevChild(end, key);
+            }
+        }
+        assert(false);
+        __builtin_unreachable();
+    }
+
+    void N::deleteNode(N *node, Pool *pool) {
         if (N::isLeaf(node)) {
             return;
         }
         switch (node->getType()) {
             case NTypes::N4: {
                 auto n = static_cast<N4 *>(node);
-                delete n;
+                n->~N4();
+                Pool::deallocate(pool, n);
                 return;
             }
             case NTypes::N16: {
                 auto n = static_cast<N16 *>(node);
-                delete n;
+                n->~N16();
+                Pool::deallocate(pool, n);
                 return;
             }
             case NTypes::N48: {
                 auto n = static_cast<N48 *>(node);
-                delete n;
+                n->~N48();
+                Pool::deallocate(pool, n);
                 return;
             }
             case NTypes::N256: {
                 auto n = static_cast<N256 *>(node);
-                delete n;
+                n->~N256();
+                Pool::deallocate(pool, n);
                 return;
             }
         }
-        delete node;
+        Pool::deallocate(pool, node);
     }
 
-    Key *N::getAnyChildTid(const N *n) {
+    const Key *N::getAnyChildTid(const N *n, InlineKey &key) {
         const N *nextNode = n;
 
         while (true) {
@@ -510,7 +666,7 @@ namespace ART_ROWEX {
 
             assert(nextNode != nullptr);
             if (isLeaf(nextNode)) {
-                return getLeaf(nextNode);
+                return getLeafKey(nextNode, 0, key);
             }
         }
     }
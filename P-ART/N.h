@@ -11,6 +11,7 @@
 #include <string.h>
 #include "../Key.h"
 #include "Epoche.h"
+#include "Pool.h"
 #ifdef LOCK_INIT
 #include "tbb/concurrent_vector.h"
 #endif
@@ -39,6 +40,29 @@ namespace ART_ROWEX {
         uint8_t prefix[maxStoredPrefixLength];
     };
     static_assert(sizeof(Prefix) == 8, "Prefix should be 64 bit long");
+
+    static constexpr uint32_t maxInlineKeyLength = 8;
+    /**
+     * key of an inline leaf, laid out like Key so that it can be compared and read as one
+     */
+    struct InlineKey {
+        uint64_t value;
+        size_t key_len;
+        uint8_t fkey[maxInlineKeyLength];
+
+        InlineKey() = default;
+
+        /**
+         * an integer key, in the byte order of Key::make_leaf
+         */
+        InlineKey(uint64_t key, uint64_t value) : value(value), key_len(sizeof(uint64_t)) {
+            *reinterpret_cast<uint64_t *>(fkey) = __builtin_bswap64(key);
+        }
+
+        const Key *get() const {
+            return reinterpret_cast<const Key *>(this);
+        }
+    };
 #ifdef LOCK_INIT
     class N;
     static tbb::concurrent_vector<N *> lock_initializer;
@@ -81,6 +105,26 @@ namespace ART_ROWEX {
 
     public:
 
+        /**
+         * nodes are allocated from the pool of their tree (new (pool) N4(...)), nullptr stands for
+         * the general-purpose allocator; deleteNode frees them from the same pool
+         */
+        static void *operator new(std::size_t size, Pool *pool) {
+            return Pool::allocate(pool, size);
+        }
+
+        static void operator delete(void *p, Pool *pool) {
+            Pool::deallocate(pool, p);
+        }
+
+        static void *operator new(std::size_t size) {
+            return Pool::allocate(nullptr, size);
+        }
+
+        static void operator delete(void *p) {
+            Pool::deallocate(nullptr, p);
+        }
+
         NTypes getType() const;
 
         uint32_t getLevel() const;
@@ -114,7 +158,23 @@ namespace ART_ROWEX {
 
         static N *getChild(const uint8_t k, N *node);
 
-        static void insertAndUnlock(N *node, N *parentNode, uint8_t keyParent, uint8_t key, N *val,
+        /**
+         * returns the value slot of the child of k, it holds the value if the child is an inline leaf
+         */
+        static std::atomic<uint64_t> *getValuePos(const uint8_t k, N *node);
+
+        /**
+         * can only be called when node is locked, stores the value of the child of k before the
+         * child is changed to an inline leaf (or in place if it already is the inline leaf of the key)
+         */
+        static void setValue(N *node, uint8_t key, uint64_t value);
+
+        /**
+         * prefetches the child slot of k without waiting for it, getChild(k, node) reads it later
+         */
+        static void prefetchChild(const uint8_t k, const N *node);
+
+        static void insertAndUnlock(N *node, N *parentNode, uint8_t keyParent, uint8_t key, N *val, uint64_t value,
                                     ThreadInfo &threadInfo, bool &needRestart);
 
         static void change(N *node, uint8_t key, N *val);
@@ -133,21 +193,63 @@ namespace ART_ROWEX {
 
         static N *setLeaf(const Key *k);
 
+        /**
+         * Keys of up to maxInlineKeyLength bytes are not stored in a Key leaf but inline: the child slot
+         * holds key bytes 1 to 7 (byte 0 is the key of the root's child) and the key length, the value
+         * is stored in the node next to the slot. Key leaves are at least 4 byte aligned, so the two
+         * low bits tell the kinds apart, isLeaf is true for both. Only with ART_INLINE_LEAVES, which adds
+         * the value slots to every node, otherwise no key fits.
+         */
+        static bool fitsInline(const Key *k);
+
+        static bool isInlineLeaf(const N *n);
+
+        static N *setInlineLeaf(const Key *k);
+
+        /**
+         * the leaf for k, inline if k fits into the slot
+         */
+        static N *makeLeaf(const Key *k);
+
+        /**
+         * expands an inline leaf into key, byte 0 is taken from firstByte
+         */
+        static const Key *getInlineLeaf(const N *n, uint8_t firstByte, InlineKey &key);
+
+        /**
+         * returns the key of the leaf n, an inline leaf is expanded into key (see getInlineLeaf)
+         */
+        static const Key *getLeafKey(const N *n, uint8_t firstByte, InlineKey &key);
+
         static N *getAnyChild(const N *n);
 
-        static Key *getAnyChildTid(const N *n);
+        /**
+         * returns the key of any leaf below n, inline leaves are expanded into key
+         * (byte 0 is not known there, callers only look at the bytes below the root)
+         */
+        static const Key *getAnyChildTid(const N *n, InlineKey &key);
 
         static void deleteChildren(N *node);
 
-        static void deleteNode(N *node);
+        static void deleteNode(N *node, Pool *pool = nullptr);
 
         static std::tuple<N *, uint8_t> getSecondChild(N *node, const uint8_t k);
 
+        /**
+         * returns the child with the smallest key not smaller than start and stores its key, or nullptr
+         */
+        static N *getNextChild(const N *node, const uint8_t start, uint8_t &key);
+
+        /**
+         * returns the child with the largest key not larger than end and stores its key, or nullptr
+         */
+        static N *getPrevChild(const N *node, const uint8_t end, uint8_t &key);
+
         template<typename curN, typename biggerN>
-        static void insertGrow(curN *n, N *parentNode, uint8_t keyParent, uint8_t key, N *val, ThreadInfo &threadInfo, bool &needRestart);
+        static void insertGrow(curN *n, N *parentNode, uint8_t keyParent, uint8_t key, N *val, uint64_t value, ThreadInfo &threadInfo, bool &needRestart);
 
         template<typename curN>
-        static bool insertCompact(curN *n, N *parentNode, uint8_t keyParent, uint8_t key, N *val, ThreadInfo &threadInfo, bool &needRestart);
+        static bool insertCompact(curN *n, N *parentNode, uint8_t keyParent, uint8_t key, N *val, uint64_t value, ThreadInfo &threadInfo, bool &needRestart);
 
         template<typename curN, typename smallerN>
         static void removeAndShrink(curN *n, N *parentNode, uint8_t keyParent, uint8_t key, ThreadInfo &threadInfo, bool &needRestart);
@@ -167,6 +269,9 @@ namespace ART_ROWEX {
 
         std::atomic<uint8_t> keys[4];
         std::atomic<N *> children[4];
+#ifdef ART_INLINE_LEAVES
+        std::atomic<uint64_t> values[4];
+#endif
 
     public:
         N4(uint32_t level, const uint8_t *prefix, uint32_t prefixLength) : N(NTypes::N4, level, prefix,
@@ -180,7 +285,7 @@ namespace ART_ROWEX {
             memset(children, 0, sizeof(children));
         }
 
-        inline bool insert(uint8_t key, N *n, bool flush) __attribute__((always_inline));
+        inline bool insert(uint8_t key, N *n, uint64_t value, bool flush) __attribute__((always_inline));
 
         template<class NODE>
         void copyTo(NODE *n) const;
@@ -189,6 +294,12 @@ namespace ART_ROWEX {
 
         N *getChild(const uint8_t k) const;
 
+        void prefetchChild(const uint8_t k) const;
+
+#ifdef ART_INLINE_LEAVES
+        std::atomic<uint64_t> *getValuePos(const uint8_t k);
+#endif
+
         bool remove(uint8_t k, bool force, bool flush);
 
         N *getAnyChild() const;
@@ -200,6 +311,10 @@ namespace ART_ROWEX {
         void getChildren(uint8_t start, uint8_t end, std::tuple<uint8_t, N *> *&children,
                          uint32_t &childrenCount) const;
 
+        N *getNextChild(const uint8_t start, uint8_t &key) const;
+
+        N *getPrevChild(const uint8_t end, uint8_t &key) const;
+
         uint32_t getCount() const;
     };
 
@@ -207,6 +322,9 @@ namespace ART_ROWEX {
     public:
         std::atomic<uint8_t> keys[16];
         std::atomic<N *> children[16];
+#ifdef ART_INLINE_LEAVES
+        std::atomic<uint64_t> values[16];
+#endif
 
         static uint8_t flipSign(uint8_t keyByte) {
             // Flip the sign bit, enables signed SSE comparison of unsigned values, used by Node16
@@ -241,7 +359,7 @@ namespace ART_ROWEX {
             memset(children, 0, sizeof(children));
         }
 
-        inline bool insert(uint8_t key, N *n, bool flush) __attribute__((always_inline));
+        inline bool insert(uint8_t key, N *n, uint64_t value, bool flush) __attribute__((always_inline));
 
         template<class NODE>
         void copyTo(NODE *n) const;
@@ -250,6 +368,12 @@ namespace ART_ROWEX {
 
         N *getChild(const uint8_t k) const;
 
+        void prefetchChild(const uint8_t k) const;
+
+#ifdef ART_INLINE_LEAVES
+        std::atomic<uint64_t> *getValuePos(const uint8_t k);
+#endif
+
         bool remove(uint8_t k, bool force, bool flush);
 
         N *getAnyChild() const;
@@ -259,12 +383,19 @@ namespace ART_ROWEX {
         void getChildren(uint8_t start, uint8_t end, std::tuple<uint8_t, N *> *&children,
                          uint32_t &childrenCount) const;
 
+        N *getNextChild(const uint8_t start, uint8_t &key) const;
+
+        N *getPrevChild(const uint8_t end, uint8_t &key) const;
+
         uint32_t getCount() const;
     };
 
     class N48 : public N {
         std::atomic<uint8_t> childIndex[256];
         std::atomic<N *> children[48];
+#ifdef ART_INLINE_LEAVES
+        std::atomic<uint64_t> values[48];
+#endif
     public:
         static const uint8_t emptyMarker = 48;
 
@@ -279,7 +410,7 @@ namespace ART_ROWEX {
             memset(children, 0, sizeof(children));
         }
 
-        inline bool insert(uint8_t key, N *n, bool flush) __attribute__((always_inline));
+        inline bool insert(uint8_t key, N *n, uint64_t value, bool flush) __attribute__((always_inline));
 
         template<class NODE>
         void copyTo(NODE *n) const;
@@ -288,6 +419,12 @@ namespace ART_ROWEX {
 
         N *getChild(const uint8_t k) const;
 
+        void prefetchChild(const uint8_t k) const;
+
+#ifdef ART_INLINE_LEAVES
+        std::atomic<uint64_t> *getValuePos(const uint8_t k);
+#endif
+
         bool remove(uint8_t k, bool force, bool flush);
 
         N *getAnyChild() const;
@@ -297,11 +434,18 @@ namespace ART_ROWEX {
         void getChildren(uint8_t start, uint8_t end, std::tuple<uint8_t, N *> *&children,
                          uint32_t &childrenCount) const;
 
+        N *getNextChild(const uint8_t start, uint8_t &key) const;
+
+        N *getPrevChild(const uint8_t end, uint8_t &key) const;
+
         uint32_t getCount() const;
     };
 
     class N256 : public N {
         std::atomic<N *> children[256];
+#ifdef ART_INLINE_LEAVES
+        std::atomic<uint64_t> values[256];
+#endif
 
     public:
         N256(uint32_t level, const uint8_t *prefix, uint32_t prefixLength) : N(NTypes::N256, level, prefix,
@@ -313,7 +457,7 @@ namespace ART_ROWEX {
             memset(children, '\0', sizeof(children));
         }
 
-        inline bool insert(uint8_t key, N *val, bool flush) __attribute__((always_inline));
+        inline bool insert(uint8_t key, N *val, uint64_t value, bool flush) __attribute__((always_inline));
 
         template<class NODE>
         void copyTo(NODE *n) const;
@@ -322,6 +466,12 @@ namespace ART_ROWEX {
 
         N *getChild(const uint8_t k) const;
 
+        void prefetchChild(const uint8_t k) const;
+
+#ifdef ART_INLINE_LEAVES
+        std::atomic<uint64_t> *getValuePos(const uint8_t k);
+#endif
+
         bool remove(uint8_t k, bool force, bool flush);
 
         N *getAnyChild() const;
@@ -331,6 +481,10 @@ namespace ART_ROWEX {
         void getChildren(uint8_t start, uint8_t end, std::tuple<uint8_t, N *> *&children,
                          uint32_t &childrenCount) const;
 
+        N *getNextChild(const uint8_t start, uint8_t &key) const;
+
+        N *getPrevChild(const uint8_t end, uint8_t &key) const;
+
         uint32_t getCount() const;
     };
 }
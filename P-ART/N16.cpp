@@ -5,7 +5,7 @@
 
 namespace ART_ROWEX {
 
-    inline bool N16::insert(uint8_t key, N *n, bool flush) {
+    inline bool N16::insert(uint8_t key, N *n, [[maybe_unused]] uint64_t value, bool flush) {
         if (compactCount.load(std::memory_order_acquire) == 16) {
             return false;
         }
@@ -17,9 +17,15 @@ namespace ART_ROWEX {
             keys[nextIndex].store(flipSign(key), std::memory_order_release);
             // this clflush will failure-atomically flush the cache line including counters and entire key entries
             clflush((char *)this, sizeof(uintptr_t), false, true);
+#ifdef ART_INLINE_LEAVES
+            if (N::isInlineLeaf(n)) movnt64((uint64_t *)&values[nextIndex], value, false, true);
+#endif
             movnt64((uint64_t *)&children[nextIndex], (uint64_t)n, false, true);
         } else {
             keys[nextIndex].store(flipSign(key), std::memory_order_relaxed);
+#ifdef ART_INLINE_LEAVES
+            values[nextIndex].store(value, std::memory_order_relaxed);
+#endif
             children[nextIndex].store(n, std::memory_order_relaxed);
         }
 
@@ -31,7 +37,11 @@ namespace ART_ROWEX {
         for (unsigned i = 0; i < compactCount.load(std::memory_order_acquire); i++) {
             N *child = children[i].load();
             if (child != nullptr) {
-                n->insert(flipSign(keys[i]), child, false);
+#ifdef ART_INLINE_LEAVES
+                n->insert(flipSign(keys[i]), child, values[i].load(), false);
+#else
+                n->insert(flipSign(keys[i]), child, 0, false);
+#endif
             }
         }
     }
@@ -73,6 +83,33 @@ namespace ART_ROWEX {
         return nullptr;
     }
 
+#ifdef ART_INLINE_LEAVES
+    std::atomic<uint64_t> *N16::getValuePos(const uint8_t k) {
+        __m128i cmp = _mm_cmpeq_epi8(_mm_set1_epi8(flipSign(k)),
+                                     _mm_loadu_si128(reinterpret_cast<const __m128i *>(keys)));
+        unsigned bitfield = _mm_movemask_epi8(cmp) & ((1 << 16) - 1);
+        while (bitfield) {
+            uint8_t pos = ctz(bitfield);
+
+            if (children[pos].load() != nullptr && keys[pos].load() == flipSign(k)) {
+                return &values[pos];
+            }
+            bitfield = bitfield ^ (1 << pos);
+        }
+        return nullptr;
+    }
+#endif
+
+    void N16::prefetchChild(const uint8_t k) const {
+        // the keys share the cache line with the header, only the child slot is fetched
+        __m128i cmp = _mm_cmpeq_epi8(_mm_set1_epi8(flipSign(k)),
+                                     _mm_loadu_si128(reinterpret_cast<const __m128i *>(keys)));
+        unsigned bitfield = _mm_movemask_epi8(cmp) & ((1 << 16) - 1);
+        if (bitfield) {
+            __builtin_prefetch(&children[ctz(bitfield)]);
+        }
+    }
+
     bool N16::remove(uint8_t k, bool force, bool flush) {
         if (count.load(std::memory_order_acquire) <= 3 && !force) {
             return false;
@@ -131,6 +168,36 @@ namespace ART_ROWEX {
         });
     }
 
+    N *N16::getNextChild(const uint8_t start, uint8_t &key) const {
+        N *next = nullptr;
+        for (int i = 0; i < compactCount.load(std::memory_order_acquire); ++i) {
+            uint8_t k = flipSign(this->keys[i]);
+            if (k >= start && (next == nullptr || k < key)) {
+                N *child = this->children[i].load();
+                if (child != nullptr) {
+                    next = child;
+                    key = k;
+                }
+            }
+        }
+        return next;
+    }
+
+    N *N16::getPrevChild(const uint8_t end, uint8_t &key) const {
+        N *prev = nullptr;
+        for (int i = 0; i < compactCount.load(std::memory_order_acquire); ++i) {
+            uint8_t k = flipSign(this->keys[i]);
+            if (k <= end && (prev == nullptr || k > key)) {
+                N *child = this->children[i].load();
+                if (child != nullptr) {
+                    prev = child;
+                    key = k;
+                }
+            }
+        }
+        return prev;
+    }
+
     uint32_t N16::getCount() const {
         uint32_t cnt = 0;
         for (uint32_t i = 0; i < compactCount.load(std::memory_order_acquire) && cnt < 3; i++) {
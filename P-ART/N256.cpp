@@ -13,13 +13,22 @@ namespace ART_ROWEX {
         }
     }
 
-    inline bool N256::insert(uint8_t key, N *val, bool flush) {
+    inline bool N256::insert(uint8_t key, N *val, [[maybe_unused]] uint64_t value, bool flush) {
         if (count.load(std::memory_order_acquire) >= 256) {
             return false;
         }
 
-        if (flush) movnt64((uint64_t *)&children[key], (uint64_t)val, false, true);
-        else children[key].store(val, std::memory_order_relaxed);
+        if (flush) {
+#ifdef ART_INLINE_LEAVES
+            if (N::isInlineLeaf(val)) movnt64((uint64_t *)&values[key], value, false, true);
+#endif
+            movnt64((uint64_t *)&children[key], (uint64_t)val, false, true);
+        } else {
+#ifdef ART_INLINE_LEAVES
+            values[key].store(value, std::memory_order_relaxed);
+#endif
+            children[key].store(val, std::memory_order_relaxed);
+        }
         count.fetch_add(1, std::memory_order_acq_rel);
 
         return true;
@@ -30,7 +39,11 @@ namespace ART_ROWEX {
         for (int i = 0; i < 256; ++i) {
             N *child = children[i].load();
             if (child != nullptr) {
-                n->insert(i, child, false);
+#ifdef ART_INLINE_LEAVES
+                n->insert(i, child, values[i].load(), false);
+#else
+                n->insert(i, child, 0, false);
+#endif
             }
         }
     }
@@ -43,6 +56,16 @@ namespace ART_ROWEX {
         return children[k].load();
     }
 
+#ifdef ART_INLINE_LEAVES
+    std::atomic<uint64_t> *N256::getValuePos(const uint8_t k) {
+        return &values[k];
+    }
+#endif
+
+    void N256::prefetchChild(const uint8_t k) const {
+        __builtin_prefetch(&children[k]);
+    }
+
     bool N256::remove(uint8_t k, bool force, bool flush) {
         if (count.load(std::memory_order_acquire) <= 37 && !force) {
             return false;
@@ -84,6 +107,28 @@ namespace ART_ROWEX {
         }
     }
 
+    N *N256::getNextChild(const uint8_t start, uint8_t &key) const {
+        for (unsigned i = start; i < 256; i++) {
+            N *child = this->children[i].load();
+            if (child != nullptr) {
+                key = i;
+                return child;
+            }
+        }
+        return nullptr;
+    }
+
+    N *N256::getPrevChild(const uint8_t end, uint8_t &key) const {
+        for (int i = end; i >= 0; i--) {
+            N *child = this->children[i].load();
+            if (child != nullptr) {
+                key = i;
+                return child;
+            }
+        }
+        return nullptr;
+    }
+
     uint32_t N256::getCount() const {
         uint32_t cnt = 0;
         for (uint32_t i = 0; i < 256 && cnt < 3; i++) {
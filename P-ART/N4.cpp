@@ -14,7 +14,7 @@ namespace ART_ROWEX {
         }
     }
 
-    inline bool N4::insert(uint8_t key, N *n, bool flush) {
+    inline bool N4::insert(uint8_t key, N *n, [[maybe_unused]] uint64_t value, bool flush) {
         if (compactCount.load(std::memory_order_acquire) == 4) {
             return false;
         }
@@ -24,10 +24,16 @@ namespace ART_ROWEX {
 
         if (flush) {
             keys[nextIndex].store(key, std::memory_order_release);
+#ifdef ART_INLINE_LEAVES
+            values[nextIndex].store(value, std::memory_order_relaxed);
+#endif
             clflush((char *)this, sizeof(N4), false, true);
             movnt64((uint64_t *)&children[nextIndex], (uint64_t)n, false, true);
         } else {
             keys[nextIndex].store(key, std::memory_order_relaxed);
+#ifdef ART_INLINE_LEAVES
+            values[nextIndex].store(value, std::memory_order_relaxed);
+#endif
             children[nextIndex].store(n, std::memory_order_relaxed);
         }
 
@@ -39,7 +45,11 @@ namespace ART_ROWEX {
         for (uint32_t i = 0; i < compactCount.load(std::memory_order_acquire); ++i) {
             N *child = children[i].load();
             if (child != nullptr) {
-                n->insert(keys[i].load(), child, false);
+#ifdef ART_INLINE_LEAVES
+                n->insert(keys[i].load(), child, values[i].load(), false);
+#else
+                n->insert(keys[i].load(), child, 0, false);
+#endif
             }
         }
     }
@@ -66,6 +76,22 @@ namespace ART_ROWEX {
         return nullptr;
     }
 
+#ifdef ART_INLINE_LEAVES
+    std::atomic<uint64_t> *N4::getValuePos(const uint8_t k) {
+        for (uint32_t i = 0; i < 4; ++i) {
+            N *child = children[i].load();
+            if (child != nullptr && keys[i].load() == k) {
+                return &values[i];
+            }
+        }
+        return nullptr;
+    }
+#endif
+
+    void N4::prefetchChild(const uint8_t) const {
+        __builtin_prefetch(children);
+    }
+
     bool N4::remove(uint8_t k, bool force, bool flush) {
         for (uint32_t i = 0; i < compactCount.load(std::memory_order_acquire); ++i) {
             if (children[i] != nullptr && keys[i].load() == k) {
@@ -124,6 +150,36 @@ namespace ART_ROWEX {
         });
     }
 
+    N *N4::getNextChild(const uint8_t start, uint8_t &key) const {
+        N *next = nullptr;
+        for (uint32_t i = 0; i < 4; ++i) {
+            uint8_t k = this->keys[i].load();
+            if (k >= start && (next == nullptr || k < key)) {
+                N *child = this->children[i].load();
+                if (child != nullptr) {
+                    next = child;
+                    key = k;
+                }
+            }
+        }
+        return next;
+    }
+
+    N *N4::getPrevChild(const uint8_t end, uint8_t &key) const {
+        N *prev = nullptr;
+        for (uint32_t i = 0; i < 4; ++i) {
+            uint8_t k = this->keys[i].load();
+            if (k <= end && (prev == nullptr || k > key)) {
+                N *child = this->children[i].load();
+                if (child != nullptr) {
+                    prev = child;
+                    key = k;
+                }
+            }
+        }
+        return prev;
+    }
+
     uint32_t N4::getCount() const {
         uint32_t cnt = 0;
         for (uint32_t i = 0; i < compactCount.load(std::memory_order_acquire) && cnt < 3; i++) {
@@ -4,7 +4,7 @@
 
 namespace ART_ROWEX {
 
-    inline bool N48::insert(uint8_t key, N *n, bool flush) {
+    inline bool N48::insert(uint8_t key, N *n, [[maybe_unused]] uint64_t value, bool flush) {
         if (compactCount.load(std::memory_order_acquire) == 48) {
             return false;
         }
@@ -20,6 +20,11 @@ namespace ART_ROWEX {
         }
 
         if (flush) {
+#ifdef ART_INLINE_LEAVES
+            if (N::isInlineLeaf(n)) {
+                movnt64((uint64_t *)&values[compactCount.load(std::memory_order_acquire)], value, false, true);
+            }
+#endif
             children[compactCount.load(std::memory_order_acquire)].store(n, std::memory_order_release);
             clflush((char *)&children[compactCount.load(std::memory_order_acquire)], sizeof(N *), false, true);
             uint64_t *childIndex64 = (uint64_t *)childIndex;
@@ -28,6 +33,9 @@ namespace ART_ROWEX {
             index8[key%8] = compactCount.load(std::memory_order_acquire);
             movnt64((uint64_t *)&childIndex64[key/8], index64, false, true);
         } else {
+#ifdef ART_INLINE_LEAVES
+            values[compactCount.load(std::memory_order_acquire)].store(value, std::memory_order_relaxed);
+#endif
             children[compactCount.load(std::memory_order_acquire)].store(n, std::memory_order_relaxed);
             childIndex[key].store(compactCount.load(std::memory_order_acquire), std::memory_order_relaxed);
         }
@@ -42,7 +50,11 @@ namespace ART_ROWEX {
         for (unsigned i = 0; i < 256; i++) {
             uint8_t index = childIndex[i].load();
             if (index != emptyMarker) {
-                n->insert(i, children[index], false);
+#ifdef ART_INLINE_LEAVES
+                n->insert(i, children[index], values[index].load(), false);
+#else
+                n->insert(i, children[index], 0, false);
+#endif
             }
         }
     }
@@ -62,6 +74,21 @@ namespace ART_ROWEX {
         }
     }
 
+#ifdef ART_INLINE_LEAVES
+    std::atomic<uint64_t> *N48::getValuePos(const uint8_t k) {
+        uint8_t index = childIndex[k].load();
+        if (index == emptyMarker) {
+            return nullptr;
+        } else {
+            return &values[index];
+        }
+    }
+#endif
+
+    void N48::prefetchChild(const uint8_t k) const {
+        __builtin_prefetch(&childIndex[k]);
+    }
+
     bool N48::remove(uint8_t k, bool force, bool flush) {
         if (count.load(std::memory_order_acquire) <= 12 && !force) {
             return false;
@@ -124,6 +151,34 @@ namespace ART_ROWEX {
         }
     }
 
+    N *N48::getNextChild(const uint8_t start, uint8_t &key) const {
+        for (unsigned i = start; i < 256; i++) {
+            uint8_t index = this->childIndex[i].load();
+            if (index != emptyMarker) {
+                N *child = this->children[index].load();
+                if (child != nullptr) {
+                    key = i;
+                    return child;
+                }
+            }
+        }
+        return nullptr;
+    }
+
+    N *N48::getPrevChild(const uint8_t end, uint8_t &key) const {
+        for (int i = end; i >= 0; i--) {
+            uint8_t index = this->childIndex[i].load();
+            if (index != emptyMarker) {
+                N *child = this->children[index].load();
+                if (child != nullptr) {
+                    key = i;
+                    return child;
+                }
+            }
+        }
+        return nullptr;
+    }
+
     uint32_t N48::getCount() const {
         uint32_t cnt = 0;
         for (uint32_t i = 0; i < 256 && cnt < 3; i++) {
@@ -0,0 +1,374 @@
+#ifndef ART_POOL_CPP
+#define ART_POOL_CPP
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <new>
+#include "tbb/parallel_for.h"
+#include "Pool.h"
+#include "N.h"
+
+using ART_ROWEX::N;
+
+namespace ART {
+
+    static constexpr uint64_t poolHeaderSize = 4096;
+
+    std::mutex Pool::openLock;
+    std::vector<Pool *> Pool::openPools;
+    std::atomic<uint64_t> Pool::generations{0};
+    thread_local Pool::ThreadCache Pool::cache;
+
+    static char *mapPool(const char *path, int fd, void *addr, std::size_t size) {
+        int fixed = 0;
+        void *p = MAP_FAILED;
+#ifdef MAP_FIXED_NOREPLACE
+        if (addr != nullptr) fixed = MAP_FIXED_NOREPLACE;
+#endif
+#ifdef MAP_SYNC
+        // DAX file: stores are persistent once flushed, no msync needed
+        p = mmap(addr, size, PROT_READ | PROT_WRITE, MAP_SHARED_VALIDATE | MAP_SYNC | fixed, fd, 0);
+#endif
+        if (p == MAP_FAILED) {
+            p = mmap(addr, size, PROT_READ | PROT_WRITE, MAP_SHARED | fixed, fd, 0);
+        }
+        if (p == MAP_FAILED) {
+            perror(path);
+            exit(1);
+        }
+        if (addr != nullptr && p != addr) {
+            printf("[P-ART] cannot map pool %s at its address %p\n", path, addr);
+            exit(1);
+        }
+        return reinterpret_cast<char *>(p);
+    }
+
+    Pool::Pool(const char *path, std::size_t size) : generation(++generations) {
+        int fd = open(path, O_RDWR | O_CREAT, 0666);
+        struct stat st;
+        if (fd < 0 || fstat(fd, &st) != 0) {
+            perror(path);
+            exit(1);
+        }
+
+        // magic, size, base
+        uint64_t h[3] = {0, 0, 0};
+        if (st.st_size >= (off_t)sizeof(h) && pread(fd, h, sizeof(h), 0) != sizeof(h)) {
+            perror(path);
+            exit(1);
+        }
+
+        // a pool whose initialization did not complete has no magic and is created again
+        created = h[0] != poolMagic;
+        if (created && st.st_size != 0 && h[0] != 0) {
+            printf("[P-ART] %s is not a P-ART pool\n", path);
+            exit(1);
+        }
+
+        if (created) {
+            if (size < poolHeaderSize + 2 * slabSize) {
+                printf("[P-ART] pool size %lu is too small\n", size);
+                exit(1);
+            }
+            if (ftruncate(fd, size) != 0) {
+                perror(path);
+                exit(1);
+            }
+            base = mapPool(path, fd, nullptr, size);
+        } else {
+            size = h[1];
+            base = mapPool(path, fd, reinterpret_cast<void *>(h[2]), size);
+        }
+        close(fd);
+
+        this->size = size;
+        header = reinterpret_cast<Header *>(base);
+        if (created) {
+            initialize(size);
+        }
+        slabClass = reinterpret_cast<uint8_t *>(base + poolHeaderSize);
+        heap = base + header->heapOffset;
+
+        std::lock_guard<std::mutex> guard(openLock);
+        openPools.push_back(this);
+    }
+
+    Pool::~Pool() {
+        {
+            std::lock_guard<std::mutex> guard(openLock);
+            openPools.erase(std::find(openPools.begin(), openPools.end(), this));
+        }
+        munmap(base, size);
+    }
+
+    void Pool::initialize(std::size_t size) {
+        uint64_t numSlabs = size / slabSize;
+        uint64_t heapOffset = (poolHeaderSize + numSlabs + slabSize - 1) & ~(slabSize - 1);
+        numSlabs = (size - heapOffset) / slabSize;
+
+        memset(base + poolHeaderSize, unusedSlab, numSlabs);
+        header->size = size;
+        header->base = reinterpret_cast<uint64_t>(base);
+        header->heapOffset = heapOffset;
+        header->numSlabs = numSlabs;
+        header->usedSlabs.store(0);
+        header->root.store(nullptr);
+        N::clflush(base, poolHeaderSize + numSlabs, false, true);
+
+        header->magic = poolMagic;
+        N::clflush((char *)&header->magic, sizeof(uint64_t), false, true);
+    }
+
+    bool Pool::isNew() const {
+        return created;
+    }
+
+    void *Pool::getRoot() const {
+        return header->root.load();
+    }
+
+    void Pool::setRoot(void *root) {
+        header->root.store(root);
+        N::clflush((char *)&header->root, sizeof(void *), false, true);
+    }
+
+    bool Pool::contains(const void *p) const {
+        return p >= heap && p < base + size;
+    }
+
+    int Pool::sizeClass(std::size_t size) {
+        for (std::size_t c = 0; c < numClasses; c++) {
+            if (size <= classSizes[c]) {
+                return c;
+            }
+        }
+        return -1;
+    }
+
+    Pool::ThreadCache &Pool::localCache() {
+        ThreadCache &tc = cache;
+        if (tc.pool != this || tc.generation != generation) {
+            releaseCache(tc);
+            tc.pool = this;
+            tc.generation = generation;
+        }
+        return tc;
+    }
+
+    void Pool::releaseCache(ThreadCache &tc) {
+        if (tc.pool != nullptr) {
+            // blocks cached for a closed pool are reclaimed by its next recovery
+            std::lock_guard<std::mutex> guard(openLock);
+            if (std::find(openPools.begin(), openPools.end(), tc.pool) != openPools.end() &&
+                    tc.pool->generation == tc.generation) {
+                for (std::size_t c = 0; c < numClasses; c++) {
+                    tc.pool->spill(tc, c, tc.count[c]);
+                }
+            }
+        }
+        memset(tc.head, 0, sizeof(tc.head));
+        memset(tc.count, 0, sizeof(tc.count));
+        tc.pool = nullptr;
+    }
+
+    Pool::ThreadCache::~ThreadCache() {
+        releaseCache(*this);
+    }
+
+    void Pool::refill(ThreadCache &tc, int c) {
+        ClassState &cs = classes[c];
+        std::lock_guard<std::mutex> guard(cs.lock);
+        uint32_t n = 0;
+
+        while (n < batchSize && cs.head != nullptr) {
+            FreeBlock *b = cs.head;
+            cs.head = b->next;
+            b->next = tc.head[c];
+            tc.head[c] = b;
+            n++;
+        }
+        while (n < batchSize) {
+            if (cs.bump == cs.bumpEnd) {
+                if (n > 0) break;
+                cs.bump = newSlab(c);
+                cs.bumpEnd = cs.bump + slabSize / classSizes[c] * classSizes[c];
+            }
+            FreeBlock *b = reinterpret_cast<FreeBlock *>(cs.bump);
+            cs.bump += classSizes[c];
+            b->next = tc.head[c];
+            tc.head[c] = b;
+            n++;
+        }
+        tc.count[c] += n;
+    }
+
+    char *Pool::newSlab(int c) {
+        std::lock_guard<std::mutex> guard(slabLock);
+        uint64_t slab = header->usedSlabs.load();
+        if (slab >= header->numSlabs) {
+            printf("[P-ART] pool is full\n");
+            exit(1);
+        }
+        // the size class is persisted before the slab is counted as used: a crash in between
+        // leaves the slab unused, and it is taken again (with a new class) by the next refill
+        slabClass[slab] = c;
+        N::clflush((char *)&slabClass[slab], 1, false, true);
+        header->usedSlabs.store(slab + 1);
+        N::clflush((char *)&header->usedSlabs, sizeof(uint64_t), false, true);
+        return heap + slab * slabSize;
+    }
+
+    void Pool::spill(ThreadCache &tc, int c, uint32_t n) {
+        if (n == 0) return;
+        FreeBlock *first = tc.head[c], *last = first;
+        for (uint32_t i = 1; i < n; i++) {
+            last = last->next;
+        }
+        tc.head[c] = last->next;
+        tc.count[c] -= n;
+
+        ClassState &cs = classes[c];
+        std::lock_guard<std::mutex> guard(cs.lock);
+        last->next = cs.head;
+        cs.head = first;
+    }
+
+    void *Pool::alloc(std::size_t size) {
+        int c = sizeClass(size);
+        if (c < 0) {
+            printf("[P-ART] allocation of %lu bytes exceeds the largest size class\n", size);
+            exit(1);
+        }
+        ThreadCache &tc = localCache();
+        if (tc.head[c] == nullptr) {
+            refill(tc, c);
+        }
+        FreeBlock *b = tc.head[c];
+        tc.head[c] = b->next;
+        tc.count[c]--;
+        return b;
+    }
+
+    void Pool::free(void *p) {
+        int c = slabClass[(reinterpret_cast<char *>(p) - heap) / slabSize];
+        ThreadCache &tc = localCache();
+        FreeBlock *b = reinterpret_cast<FreeBlock *>(p);
+        b->next = tc.head[c];
+        tc.head[c] = b;
+        if (++tc.count[c] > 2 * batchSize) {
+            spill(tc, c, batchSize);
+        }
+    }
+
+    Key *Pool::makeLeaf(char *key, size_t key_len, uint64_t value) {
+        Key *k = reinterpret_cast<Key *>(alloc(sizeof(Key) + key_len));
+        k->value = value;
+        k->key_len = key_len;
+        memcpy(k->fkey, key, key_len);
+        return k;
+    }
+
+    Key *Pool::makeLeaf(uint64_t key, size_t key_len, uint64_t value) {
+        Key *k = reinterpret_cast<Key *>(alloc(sizeof(Key) + key_len));
+        k->value = value;
+        k->key_len = key_len;
+        reinterpret_cast<uint64_t *> (&k->fkey[0])[0] = __builtin_bswap64(key);
+        return k;
+    }
+
+    void Pool::beginRecovery() {
+        uint64_t used = std::min(header->usedSlabs.load(), header->numSlabs);
+        uint64_t words = 0;
+
+        markOffset.resize(used + 1);
+        for (uint64_t s = 0; s < used; s++) {
+            markOffset[s] = words;
+            if (slabClass[s] != unusedSlab) {
+                words += (slabSize / classSizes[slabClass[s]] + 63) / 64;
+            }
+        }
+        markOffset[used] = words;
+
+        marks = new std::atomic<uint64_t>[words];
+        for (uint64_t i = 0; i < words; i++) {
+            marks[i].store(0, std::memory_order_relaxed);
+        }
+    }
+
+    bool Pool::mark(const void *p) {
+        if (!contains(p)) {
+            return false;
+        }
+        uint64_t off = reinterpret_cast<const char *>(p) - heap;
+        uint64_t slab = off / slabSize;
+        if (slab + 1 >= markOffset.size() || slabClass[slab] == unusedSlab) {
+            return false;
+        }
+        uint64_t block = (off % slabSize) / classSizes[slabClass[slab]];
+        uint64_t bit = 1ULL << (block % 64);
+        return (marks[markOffset[slab] + block / 64].fetch_or(bit) & bit) == 0;
+    }
+
+    void Pool::endRecovery() {
+        uint64_t used = markOffset.size() - 1;
+
+        for (std::size_t c = 0; c < numClasses; c++) {
+            classes[c].head = nullptr;
+            classes[c].bump = classes[c].bumpEnd = nullptr;
+        }
+
+        tbb::parallel_for(tbb::blocked_range<uint64_t>(0, used), [&](const tbb::blocked_range<uint64_t> &range) {
+            FreeBlock *head[numClasses] = {}, *tail[numClasses] = {};
+            for (uint64_t s = range.begin(); s != range.end(); s++) {
+                if (slabClass[s] == unusedSlab) continue;
+                int c = slabClass[s];
+                uint64_t blocks = slabSize / classSizes[c];
+                for (uint64_t b = 0; b < blocks; b++) {
+                    if (marks[markOffset[s] + b / 64].load(std::memory_order_relaxed) & (1ULL << (b % 64))) {
+                        continue;
+                    }
+                    FreeBlock *fb = reinterpret_cast<FreeBlock *>(heap + s * slabSize + b * classSizes[c]);
+                    fb->next = head[c];
+                    if (head[c] == nullptr) tail[c] = fb;
+                    head[c] = fb;
+                }
+            }
+            for (std::size_t c = 0; c < numClasses; c++) {
+                if (head[c] == nullptr) continue;
+                std::lock_guard<std::mutex> guard(classes[c].lock);
+                tail[c]->next = classes[c].head;
+                classes[c].head = head[c];
+            }
+        });
+
+        delete[] marks;
+        marks = nullptr;
+        markOffset.clear();
+    }
+
+    void *Pool::allocate(Pool *pool, std::size_t size) {
+        if (pool != nullptr) {
+            return pool->alloc(size);
+        }
+        // aligned like the leaves of Key::make_leaf, so that the epoche can free both with free()
+        void *p;
+        if (posix_memalign(&p, 64, size) != 0) {
+            throw std::bad_alloc();
+        }
+        return p;
+    }
+
+    void Pool::deallocate(Pool *pool, void *p) {
+        if (pool != nullptr && pool->contains(p)) {
+            pool->free(p);
+        } else {
+            ::free(p);
+        }
+    }
+}
+#endif //ART_POOL_CPP
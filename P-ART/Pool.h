@@ -0,0 +1,172 @@
+#ifndef ART_POOL_H
+#define ART_POOL_H
+
+#include <stdint.h>
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include "../Key.h"
+
+namespace ART {
+
+    /*
+     * Persistent memory pool for P-ART
+     *
+     * The pool is a file (on a DAX file system for PM) mapped at the same
+     * address every time it is opened, so the raw pointers stored in nodes stay
+     * valid across restarts. The heap is split into slabs, each carved into
+     * blocks of one size class. The only persistent allocator metadata is the
+     * size class of each slab and the tree root; whether a block is in use is
+     * defined by reachability from the root, so allocation and free do not
+     * flush anything. After a restart, the tree recovery marks every reachable
+     * node and leaf and all unmarked blocks, including those leaked by a crash,
+     * become free again.
+     *
+     * Free blocks are kept in per-thread lists that are refilled from and
+     * spilled to per-class global lists in batches.
+     */
+    class Pool {
+    public:
+        static constexpr std::size_t slabSize = 1ULL << 21;
+        static constexpr std::size_t numClasses = 15;
+#ifdef ART_INLINE_LEAVES
+        static constexpr std::size_t classSizes[numClasses] = {
+                64, 128, 192, 256, 320, 384, 448, 512, 768, 1024, 1088, 1536, 2048, 3072, 4160};
+#else
+        static constexpr std::size_t classSizes[numClasses] = {
+                64, 128, 192, 256, 320, 384, 448, 512, 768, 1024, 1536, 2048, 2560, 3072, 4096};
+#endif
+
+    private:
+        // changed with the node layout or the size classes
+#ifdef ART_INLINE_LEAVES
+        static constexpr uint64_t poolMagic = 0x324c4f5054524150ULL; // "PARTPOL2"
+#else
+        static constexpr uint64_t poolMagic = 0x4c4f4f5054524150ULL; // "PARTPOOL"
+#endif
+        static constexpr uint8_t unusedSlab = 0xff;
+        static constexpr uint32_t batchSize = 32;
+
+        struct Header {
+            uint64_t magic;
+            uint64_t size;
+            uint64_t base;
+            uint64_t heapOffset;
+            uint64_t numSlabs;
+            std::atomic<uint64_t> usedSlabs;
+            std::atomic<void *> root;
+        };
+
+        struct FreeBlock {
+            FreeBlock *next;
+        };
+
+        struct ThreadCache {
+            Pool *pool = nullptr;
+            uint64_t generation = 0;
+            FreeBlock *head[numClasses];
+            uint32_t count[numClasses];
+
+            ~ThreadCache();
+        };
+
+        struct ClassState {
+            std::mutex lock;
+            FreeBlock *head = nullptr;
+            char *bump = nullptr;
+            char *bumpEnd = nullptr;
+        };
+
+        // pools that are open in the process, so that thread caches only return blocks to those
+        static std::mutex openLock;
+        static std::vector<Pool *> openPools;
+        static std::atomic<uint64_t> generations;
+        static thread_local ThreadCache cache;
+
+        char *base;
+        std::size_t size;
+        Header *header;
+        uint8_t *slabClass;
+        char *heap;
+        uint64_t generation;
+        bool created;
+
+        ClassState classes[numClasses];
+
+        // serializes taking new slabs, whose class has to be written before usedSlabs
+        std::mutex slabLock;
+
+        // mark bitmaps of the used slabs, only allocated during recovery
+        std::vector<uint64_t> markOffset;
+        std::atomic<uint64_t> *marks = nullptr;
+
+        static int sizeClass(std::size_t size);
+
+        ThreadCache &localCache();
+
+        static void releaseCache(ThreadCache &tc);
+
+        void refill(ThreadCache &tc, int c);
+
+        char *newSlab(int c);
+
+        void spill(ThreadCache &tc, int c, uint32_t n);
+
+        void initialize(std::size_t size);
+
+    public:
+        /**
+         * Opens the pool in path, or creates it with the given size if the file does not
+         * exist or is empty
+         */
+        Pool(const char *path, std::size_t size);
+
+        Pool(const Pool &) = delete;
+
+        ~Pool();
+
+        /**
+         * true if the pool was created by this process, i.e. there is nothing to recover
+         */
+        bool isNew() const;
+
+        void *getRoot() const;
+
+        /**
+         * persistently stores the root pointer of the tree
+         */
+        void setRoot(void *root);
+
+        bool contains(const void *p) const;
+
+        void *alloc(std::size_t size);
+
+        void free(void *p);
+
+        Key *makeLeaf(char *key, size_t key_len, uint64_t value);
+
+        Key *makeLeaf(uint64_t key, size_t key_len, uint64_t value);
+
+        /**
+         * Recovery: every block that is still in use is passed to mark() between
+         * beginRecovery() and endRecovery(), all other blocks are freed
+         */
+        void beginRecovery();
+
+        /**
+         * returns true if p was not marked before; thread safe
+         */
+        bool mark(const void *p);
+
+        void endRecovery();
+
+        /**
+         * Allocation of nodes and epoch based reclamation for the tree using pool; a tree without a
+         * pool (nullptr) uses the general-purpose allocator
+         */
+        static void *allocate(Pool *pool, std::size_t size);
+
+        static void deallocate(Pool *pool, void *p);
+    };
+}
+#endif //ART_POOL_H
@@ -1,9 +1,9 @@
 #include <assert.h>
-#include <functional>
 #include <algorithm>
 #include "Tree.h"
 #include "N.cpp"
 #include "Epoche.cpp"
+#include "Pool.cpp"
 #include <sys/types.h>
 #include <sys/wait.h>
 #include <stdio.h>
@@ -24,9 +24,65 @@ namespace ART_ROWEX {
         N::clflush((char*)this, sizeof(Tree), false, true);
     }
 
+    Tree::Tree(LoadKeyFunction loadKey, Pool &pool) : root(attachRoot(pool)), loadKey(loadKey), pool(&pool) {
+        epoche.setPool(&pool);
+    }
+
     Tree::~Tree() {
-        N::deleteChildren(root);
-        N::deleteNode(root);
+        // a tree in a pool is kept for the next open
+        if (pool == nullptr) {
+            N::deleteChildren(root);
+            N::deleteNode(root);
+        }
+    }
+
+    N *Tree::attachRoot(Pool &pool) {
+        N *root = reinterpret_cast<N *>(pool.getRoot());
+
+        if (!pool.isNew()) {
+            pool.beginRecovery();
+            if (root != nullptr) {
+                recover(root, pool, true);
+            }
+            pool.endRecovery();
+        }
+        if (root == nullptr) {
+            root = new (&pool) N256(0, {});
+            N::clflush((char *)root, sizeof(N256), false, true);
+            pool.setRoot(root);
+        }
+        return root;
+    }
+
+    void Tree::recover(N *node, Pool &pool, bool parallel) {
+        pool.mark(node);
+        // locks held at the time of the crash
+        if (node->isLocked(node->getVersion())) {
+            node->writeUnlock();
+        }
+
+        std::tuple<uint8_t, N *> children[256];
+        uint32_t childrenCount = 0;
+        N::getChildren(node, 0u, 255u, children, childrenCount);
+
+        auto visit = [&](uint32_t i) {
+            N *child = std::get<1>(children[i]);
+            if (N::isLeaf(child)) {
+                // inline leaves are part of the node
+                if (!N::isInlineLeaf(child)) {
+                    pool.mark(N::getLeaf(child));
+                }
+            } else {
+                recover(child, pool, false);
+            }
+        };
+        if (parallel) {
+            tbb::parallel_for(0u, childrenCount, visit);
+        } else {
+            for (uint32_t i = 0; i < childrenCount; ++i) {
+                visit(i);
+            }
+        }
     }
 
     ThreadInfo Tree::getThreadInfo() {
@@ -35,12 +91,14 @@ namespace ART_ROWEX {
 
     void *Tree::lookup(const Key *k, ThreadInfo &threadEpocheInfo) const {
         EpocheGuardReadonly epocheGuard(threadEpocheInfo);
+        restart:
         N *node = root;
         uint32_t level = 0;
         bool optimisticPrefixMatch = false;
 	
 	//art_cout << "Searching key " << k->fkey << std::endl;
         while (true) {
+            uint64_t v = node->getVersion();
             switch (checkPrefix(node, k, level)) { // increases level
                 case CheckPrefixResult::NoMatch:
                     return NULL;
@@ -51,201 +109,346 @@ namespace ART_ROWEX {
                     if (k->getKeyLen() <= level) {
                         return NULL;
                     }
-                    node = N::getChild(k->fkey[level], node);
+                    N *child = N::getChild(k->fkey[level], node);
 
-                    if (node == nullptr) {
+                    if (child == nullptr) {
                         return NULL;
                     }
-                    if (N::isLeaf(node)) {
-                        Key *ret = N::getLeaf(node);
+                    if (N::isLeaf(child)) {
+                        if (N::isInlineLeaf(child)) {
+                            if (!checkInlineKey(child, k)) {
+                                return NULL;
+                            }
+                            uint64_t *value = threadEpocheInfo.getValueBuffer(1);
+                            if (!loadInlineValue(node, v, k->fkey[level], *value)) {
+                                goto restart;
+                            }
+                            return value;
+                        }
+                        Key *ret = N::getLeaf(child);
                         if (level < k->getKeyLen() - 1 || optimisticPrefixMatch) {
                             return checkKey(ret, k);
                         } else {
                             return &ret->value;
                         }
                     }
+                    node = child;
                 }
             }
             level++;
         }
     }
 
-    bool Tree::lookupRange(const Key *start, const Key *end, const Key *continueKey, Key *result[],
-                                std::size_t resultSize, std::size_t &resultsFound, ThreadInfo &threadEpocheInfo) const {
-        for (uint32_t i = 0; i < std::min(start->getKeyLen(), end->getKeyLen()); ++i) {
-            if (start->fkey[i] > end->fkey[i]) {
-                resultsFound = 0;
-                return false;
-            } else if (start->fkey[i] < end->fkey[i]) {
-                break;
-            }
-        }
-        EpocheGuard epocheGuard(threadEpocheInfo);
-        Key *toContinue = NULL;
-        bool restart;
-        std::function<void(const N *)> copy = [&result, &resultSize, &resultsFound, &toContinue, &copy](const N *node) {
-            if (N::isLeaf(node)) {
-                if (resultsFound == resultSize) {
-                    toContinue = N::getLeaf(node);
-                    return;
-                }
-                //result[resultsFound] = reinterpret_cast<TID>((N::getLeaf(node))->value);
-                result[resultsFound] = N::getLeaf(node);
-                resultsFound++;
-            } else {
-                std::tuple<uint8_t, N *> children[256];
-                uint32_t childrenCount = 0;
-                N::getChildren(node, 0u, 255u, children, childrenCount);
-                for (uint32_t i = 0; i < childrenCount; ++i) {
-                    const N *n = std::get<1>(children[i]);
-                    copy(n);
-                    if (toContinue != NULL) {
-                        break;
-                    }
-                }
-            }
+    void Tree::lookupBatch(const Key *keys[], void *results[], std::size_t count, ThreadInfo &threadEpocheInfo) const {
+        // number of traversals in flight, enough to cover the latency of a miss
+        constexpr std::size_t groupSize = 16;
+        enum class Step : uint8_t {
+            Prefix,
+            Child,
+            Leaf
+        };
+        struct Traversal {
+            const Key *k;
+            std::size_t index;
+            N *node;
+            Key *leaf;
+            uint64_t version;
+            uint32_t level;
+            bool optimisticPrefixMatch;
+            Step step;
         };
-        std::function<void(const N *, uint32_t)> findStart = [&copy, &start, &findStart, &toContinue, &restart, this](
-                const N *node, uint32_t level) {
-            if (N::isLeaf(node)) {
-                copy(node);
-                return;
-            }
 
-            PCCompareResults prefixResult;
-            prefixResult = checkPrefixCompare(node, start, level, loadKey);
-            switch (prefixResult) {
-                case PCCompareResults::Bigger:
-                    copy(node);
-                    break;
-                case PCCompareResults::Equal: {
-                    uint8_t startLevel = (start->getKeyLen() > level) ? start->fkey[level] : 0;
-                    std::tuple<uint8_t, N *> children[256];
-                    uint32_t childrenCount = 0;
-                    N::getChildren(node, startLevel, 255, children, childrenCount);
-                    for (uint32_t i = 0; i < childrenCount; ++i) {
-                        const uint8_t k = std::get<0>(children[i]);
-                        const N *n = std::get<1>(children[i]);
-                        if (k == startLevel) {
-                            findStart(n, level + 1);
-                        } else if (k > startLevel) {
-                            copy(n);
+        EpocheGuardReadonly epocheGuard(threadEpocheInfo);
+        uint64_t *values = threadEpocheInfo.getValueBuffer(count);
+        Traversal group[groupSize];
+        std::size_t nextKey = 0;
+        std::size_t active = 0;
+        for (; active < groupSize && nextKey < count; ++active, ++nextKey) {
+            group[active] = {keys[nextKey], nextKey, root, nullptr, 0, 0, false, Step::Prefix};
+        }
+
+        while (active > 0) {
+            for (std::size_t i = 0; i < active;) {
+                Traversal &t = group[i];
+                bool finished = true;
+                void *result = NULL;
+                switch (t.step) {
+                    case Step::Prefix:
+                        t.version = t.node->getVersion();
+                        switch (checkPrefix(t.node, t.k, t.level)) { // increases level
+                            case CheckPrefixResult::NoMatch:
+                                break;
+                            case CheckPrefixResult::OptimisticMatch:
+                                t.optimisticPrefixMatch = true;
+                                // fallthrough
+                            case CheckPrefixResult::Match:
+                                if (t.k->getKeyLen() > t.level) {
+                                    N::prefetchChild(t.k->fkey[t.level], t.node);
+                                    t.step = Step::Child;
+                                    finished = false;
+                                }
                         }
-                        if (toContinue != NULL || restart) {
+                        break;
+                    case Step::Child: {
+                        N *child = N::getChild(t.k->fkey[t.level], t.node);
+                        if (child == nullptr) {
                             break;
                         }
+                        if (N::isInlineLeaf(child)) {
+                            if (!checkInlineKey(child, t.k)) {
+                                break;
+                            }
+                            if (!loadInlineValue(t.node, t.version, t.k->fkey[t.level], values[t.index])) {
+                                t = {t.k, t.index, root, nullptr, 0, 0, false, Step::Prefix};
+                                finished = false;
+                                break;
+                            }
+                            result = &values[t.index];
+                        } else if (N::isLeaf(child)) {
+                            Key *ret = N::getLeaf(child);
+                            if (t.level < t.k->getKeyLen() - 1 || t.optimisticPrefixMatch) {
+                                __builtin_prefetch(ret);
+                                t.leaf = ret;
+                                t.step = Step::Leaf;
+                                finished = false;
+                            } else {
+                                result = &ret->value;
+                            }
+                        } else {
+                            __builtin_prefetch(child);
+                            t.node = child;
+                            t.level++;
+                            t.step = Step::Prefix;
+                            finished = false;
+                        }
+                        break;
                     }
-                    break;
+                    case Step::Leaf:
+                        result = checkKey(t.leaf, t.k);
+                        break;
+                }
+
+                if (!finished) {
+                    ++i;
+                    continue;
+                }
+                results[t.index] = result;
+                if (nextKey < count) {
+                    t = {keys[nextKey], nextKey, root, nullptr, 0, 0, false, Step::Prefix};
+                    ++nextKey;
+                    ++i;
+                } else {
+                    // the last traversal takes the slot and is advanced next
+                    t = group[--active];
                 }
-                case PCCompareResults::SkippedLevel:
-                    restart = true;
-                    break;
-                case PCCompareResults::Smaller:
-                    break;
             }
-        };
-        std::function<void(const N *, uint32_t)> findEnd = [&copy, &end, &toContinue, &restart, &findEnd, this](
-                const N *node, uint32_t level) {
-            if (N::isLeaf(node)) {
-                return;
+        }
+    }
+
+    template <typename Store>
+    bool Tree::scanRange(const Key *start, const Key *end, std::size_t resultSize, std::size_t &resultsFound,
+                         ThreadInfo &threadEpocheInfo, Store store) const {
+        resultsFound = 0;
+        if (compareKeys(start, end) > 0) {
+            return false;
+        }
+        Iterator it(*this, threadEpocheInfo);
+        for (bool found = it.seek(start); found && compareKeys(it.key(), end) <= 0; found = it.next()) {
+            if (resultsFound == resultSize) {
+                return true;
             }
+            store(resultsFound++, it);
+        }
+        return false;
+    }
 
-            PCCompareResults prefixResult;
-            prefixResult = checkPrefixCompare(node, end, level, loadKey);
+#ifndef ART_INLINE_LEAVES
+    bool Tree::lookupRange(const Key *start, const Key *end, const Key * /* continueKey */, Key *result[],
+                                std::size_t resultSize, std::size_t &resultsFound, ThreadInfo &threadEpocheInfo) const {
+        return scanRange(start, end, resultSize, resultsFound, threadEpocheInfo, [result](std::size_t i, const Iterator &it) {
+            // without inline leaves the iterator is on the leaf itself
+            result[i] = const_cast<Key *>(it.key());
+        });
+    }
+#endif
 
-            switch (prefixResult) {
-                case PCCompareResults::Smaller:
-                    copy(node);
-                    break;
-                case PCCompareResults::Equal: {
-                    uint8_t endLevel = (end->getKeyLen() > level) ? end->fkey[level] : 255;
-                    std::tuple<uint8_t, N *> children[256];
-                    uint32_t childrenCount = 0;
-                    N::getChildren(node, 0, endLevel, children, childrenCount);
-                    for (uint32_t i = 0; i < childrenCount; ++i) {
-                        const uint8_t k = std::get<0>(children[i]);
-                        const N *n = std::get<1>(children[i]);
-                        if (k == endLevel) {
-                            findEnd(n, level + 1);
-                        } else if (k < endLevel) {
-                            copy(n);
-                        }
-                        if (toContinue != NULL || restart) {
-                            break;
-                        }
-                    }
-                    break;
-                }
-                case PCCompareResults::Bigger:
-                    break;
-                case PCCompareResults::SkippedLevel:
-                    restart = true;
-                    break;
+    bool Tree::lookupRangeValues(const Key *start, const Key *end, TID result[],
+                                std::size_t resultSize, std::size_t &resultsFound, ThreadInfo &threadEpocheInfo) const {
+        return scanRange(start, end, resultSize, resultsFound, threadEpocheInfo, [result](std::size_t i, const Iterator &it) {
+            result[i] = it.value();
+        });
+    }
+
+    Tree::Iterator::Iterator(const Tree &tree, ThreadInfo &threadEpocheInfo) : tree(tree),
+                                                                                threadEpocheInfo(threadEpocheInfo) {
+        threadEpocheInfo.getEpoche().pin(threadEpocheInfo);
+        stack.reserve(16);
+    }
+
+    Tree::Iterator::~Iterator() {
+        threadEpocheInfo.getEpoche().unpin(threadEpocheInfo);
+    }
+
+    bool Tree::Iterator::seek(const Key *k) {
+        return seek(k, true, true) == Result::Found;
+    }
+
+    bool Tree::Iterator::next() {
+        return move(true);
+    }
+
+    bool Tree::Iterator::prev() {
+        return move(false);
+    }
+
+    bool Tree::Iterator::valid() const {
+        return currentKey != nullptr;
+    }
+
+    const Key *Tree::Iterator::key() const {
+        return currentKey;
+    }
+
+    TID Tree::Iterator::value() const {
+        return currentValue;
+    }
+
+    bool Tree::Iterator::move(bool forward) {
+        if (currentKey == nullptr) {
+            return false;
+        }
+        Result r = step(forward);
+        if (r == Result::Restart) {
+            // a node on the stack changed, continue from the current key
+            const Key *k = currentKey;
+            if (k == inlineKey.get()) {
+                savedKey = inlineKey;
+                k = savedKey.get();
             }
-        };
+            r = seek(k, forward, false);
+        }
+        if (r == Result::End) {
+            currentKey = nullptr;
+            return false;
+        }
+        return true;
+    }
+
+    Tree::Iterator::Result Tree::Iterator::push(N *node, bool forward) {
+        uint64_t v = node->getVersion();
+        if (node->isLocked(v) || N::isObsolete(v)) {
+            return Result::Restart;
+        }
+        stack.push_back({node, v, static_cast<int16_t>(forward ? -1 : 256)});
+        return Result::Found;
+    }
+
+    Tree::Iterator::Result Tree::Iterator::setLeaf(N *leaf) {
+        const Frame &frame = stack.back();
+        if (N::isInlineLeaf(leaf)) {
+            std::atomic<uint64_t> *valuePos = N::getValuePos(frame.key, frame.node);
+            if (valuePos == nullptr) {
+                return Result::Restart;
+            }
+            currentValue = valuePos->load();
+            if (!frame.node->readUnlockOrRestart(frame.version)) {
+                return Result::Restart;
+            }
+            // byte 0 of the key selected the child of the root
+            currentKey = N::getLeafKey(leaf, stack.front().key, inlineKey);
+        } else {
+            currentKey = N::getLeaf(leaf);
+            currentValue = currentKey->value;
+        }
+        return Result::Found;
+    }
 
+    Tree::Iterator::Result Tree::Iterator::step(bool forward) {
+        // moves from the child the top frame is in to the next (previous) leaf
+        while (!stack.empty()) {
+            Frame &frame = stack.back();
+            N *child = nullptr;
+            uint8_t key;
+            if (forward && frame.key < 255) {
+                child = N::getNextChild(frame.node, frame.key + 1, key);
+            } else if (!forward && frame.key > 0) {
+                child = N::getPrevChild(frame.node, frame.key - 1, key);
+            }
+            if (!frame.node->readUnlockOrRestart(frame.version)) {
+                return Result::Restart;
+            }
+            if (child == nullptr) {
+                stack.pop_back();
+                continue;
+            }
+            frame.key = key;
+            if (N::isLeaf(child)) {
+                return setLeaf(child);
+            }
+            if (push(child, forward) == Result::Restart) {
+                return Result::Restart;
+            }
+        }
+        return Result::End;
+    }
+
+    Tree::Iterator::Result Tree::Iterator::seek(const Key *k, bool forward, bool inclusive) {
         restart:
-        restart = false;
-        resultsFound = 0;
+        stack.clear();
+        currentKey = nullptr;
 
+        N *node = tree.root;
         uint32_t level = 0;
-        N *node = nullptr;
-        N *nextNode = root;
-
         while (true) {
-            if (!(node = nextNode) || toContinue) break;
-            PCEqualsResults prefixResult;
-            prefixResult = checkPrefixEquals(node, level, start, end, loadKey);
-            switch (prefixResult) {
-                case PCEqualsResults::SkippedLevel:
+            if (push(node, forward) == Result::Restart) {
+                goto restart;
+            }
+            Frame &frame = stack.back();
+            PCCompareResults prefixResult = checkPrefixCompare(node, k, level, tree.loadKey);
+            if (!node->readUnlockOrRestart(frame.version)) {
+                goto restart;
+            }
+            if (prefixResult == PCCompareResults::Equal && level >= k->getKeyLen()) {
+                // the keys below node extend k
+                prefixResult = PCCompareResults::Bigger;
+            }
+            if (prefixResult == PCCompareResults::SkippedLevel) {
+                goto restart;
+            }
+            if (prefixResult == PCCompareResults::Equal) {
+                frame.key = k->fkey[level];
+                N *child = N::getChild(k->fkey[level], node);
+                if (!node->readUnlockOrRestart(frame.version)) {
                     goto restart;
-                case PCEqualsResults::NoMatch: {
-                    return false;
                 }
-                case PCEqualsResults::Contained: {
-                    copy(node);
-                    break;
+                if (child != nullptr && !N::isLeaf(child)) {
+                    node = child;
+                    level++;
+                    continue;
                 }
-                case PCEqualsResults::BothMatch: {
-                    uint8_t startLevel = (start->getKeyLen() > level) ? start->fkey[level] : 0;
-                    uint8_t endLevel = (end->getKeyLen() > level) ? end->fkey[level] : 255;
-                    if (startLevel != endLevel) {
-                        std::tuple<uint8_t, N *> children[256];
-                        uint32_t childrenCount = 0;
-                        N::getChildren(node, startLevel, endLevel, children, childrenCount);
-                        for (uint32_t i = 0; i < childrenCount; ++i) {
-                            const uint8_t k = std::get<0>(children[i]);
-                            const N *n = std::get<1>(children[i]);
-                            if (k == startLevel) {
-                                findStart(n, level + 1);
-                            } else if (k > startLevel && k < endLevel) {
-                                copy(n);
-                            } else if (k == endLevel) {
-                                findEnd(n, level + 1);
-                            }
-                            if (restart) {
-                                goto restart;
-                            }
-                            if (toContinue) {
-                                break;
-                            }
-                        }
-                    } else {
-                        nextNode = N::getChild(startLevel, node);
-                        level++;
-                        continue;
+                if (child != nullptr) {
+                    if (setLeaf(child) == Result::Restart) {
+                        goto restart;
+                    }
+                    int cmp = compareKeys(currentKey, k);
+                    if (cmp == 0 ? inclusive : (cmp > 0) == forward) {
+                        return Result::Found;
                     }
-                    break;
                 }
+            } else if ((prefixResult == PCCompareResults::Bigger) != forward) {
+                // all keys below node are on the other side of k
+                stack.pop_back();
             }
-            break;
-        }
+            // otherwise the frame is before the first (after the last) child, so step enters node
 
-        if (toContinue != NULL) {
-            continueKey = toContinue;
-            return true;
-        } else {
-            return false;
+            Result r = step(forward);
+            if (r == Result::Restart) {
+                goto restart;
+            }
+            if (r == Result::End) {
+                currentKey = nullptr;
+            }
+            return r;
         }
     }
 
@@ -256,9 +459,130 @@ namespace ART_ROWEX {
         return NULL;
     }
 
+    bool Tree::checkInlineKey(const N *leaf, const Key *k) {
+        // the slot holds the whole key except byte 0, which selected the child of the root
+        return N::fitsInline(k) && leaf == N::setInlineLeaf(k);
+    }
+
+    bool Tree::loadInlineValue(N *node, uint64_t version, uint8_t key, uint64_t &value) {
+        if (node->isLocked(version) || N::isObsolete(version)) {
+            return false;
+        }
+        std::atomic<uint64_t> *valuePos = N::getValuePos(key, node);
+        if (valuePos == nullptr) {
+            return false;
+        }
+        value = valuePos->load();
+        return node->readUnlockOrRestart(version);
+    }
+
+    bool Tree::checkLeafKey(const N *leaf, const Key *k) const {
+        if (N::isInlineLeaf(leaf)) {
+            return checkInlineKey(leaf, k);
+        }
+        return checkKey(N::getLeaf(leaf), k) != NULL;
+    }
+
+    int Tree::compareKeys(const Key *a, const Key *b) {
+        int cmp = memcmp(a->fkey, b->fkey, std::min(a->getKeyLen(), b->getKeyLen()));
+        if (cmp != 0) {
+            return cmp;
+        }
+        return (a->getKeyLen() > b->getKeyLen()) - (a->getKeyLen() < b->getKeyLen());
+    }
+
     void Tree::insert(const Key *k, ThreadInfo &epocheInfo) {
+        insertOrUpdate(k, epocheInfo, false, nullptr);
+    }
+
+    void Tree::upsert(const Key *k, ThreadInfo &epocheInfo, Key **replaced) {
+        insertOrUpdate(k, epocheInfo, true, replaced);
+    }
+
+    void Tree::retireLeaf(Key *leaf, ThreadInfo &epocheInfo) {
+        this->epoche.markNodeForDeletion(leaf, epocheInfo);
+    }
+
+    bool Tree::update(const Key *k, ThreadInfo &threadInfo, Key **replaced) {
+        if (replaced != nullptr) {
+            *replaced = nullptr;
+        }
+        if (!N::fitsInline(k)) {
+            N::clflush((char *)k, sizeof(Key) + k->key_len, false, true);
+        }
+        EpocheGuard epocheGuard(threadInfo);
+        restart:
+        bool needRestart = false;
+
+        N *node = nullptr;
+        N *nextNode = root;
+        uint8_t nodeKey = 0;
+        uint32_t level = 0;
+
+        while (true) {
+            node = nextNode;
+            auto v = node->getVersion();
+
+            switch (checkPrefix(node, k, level)) { // increases level
+                case CheckPrefixResult::NoMatch:
+                    if (N::isObsolete(v) || !node->readUnlockOrRestart(v)) {
+                        goto restart;
+                    }
+                    return false;
+                case CheckPrefixResult::OptimisticMatch:
+                    // fallthrough
+                case CheckPrefixResult::Match: {
+                    if (k->getKeyLen() <= level) {
+                        return false;
+                    }
+                    nodeKey = k->fkey[level];
+                    nextNode = N::getChild(nodeKey, node);
+
+                    if (nextNode == nullptr) {
+                        if (N::isObsolete(v) || !node->readUnlockOrRestart(v)) {
+                            goto restart;
+                        }
+                        return false;
+                    }
+                    if (N::isLeaf(nextNode)) {
+                        node->lockVersionOrRestart(v, needRestart);
+                        if (needRestart) goto restart;
+
+                        // the full key is compared, so an optimistic prefix match is resolved here
+                        if (!checkLeafKey(nextNode, k)) {
+                            node->writeUnlock();
+                            return false;
+                        }
+
+                        if (N::isInlineLeaf(nextNode)) {
+                            // the value is stored in place
+                            N::setValue(node, nodeKey, k->value);
+                            node->writeUnlock();
+                            return true;
+                        }
+                        // the new leaf is already persistent, swapping the child is a single 8-byte store
+                        if (replaced != nullptr) {
+                            *replaced = N::getLeaf(nextNode);
+                        }
+                        N::change(node, nodeKey, N::setLeaf(k));
+                        node->writeUnlock();
+                        return true;
+                    }
+                    level++;
+                }
+            }
+        }
+    }
+
+    void Tree::insertOrUpdate(const Key *k, ThreadInfo &epocheInfo, bool upsert, Key **replaced) {
+        if (replaced != nullptr) {
+            *replaced = nullptr;
+        }
 	//art_cout << "Inserting key " << k->fkey << std::endl;
-        N::clflush((char *)k, sizeof(Key) + k->key_len, false, true);
+        // an inline key is copied into the node, only a Key leaf has to be persistent
+        if (!N::fitsInline(k)) {
+            N::clflush((char *)k, sizeof(Key) + k->key_len, false, true);
+        }
         EpocheGuard epocheGuard(epocheInfo);
         restart:
         bool needRestart = false;
@@ -291,17 +615,17 @@ namespace ART_ROWEX {
                     // 1) Create new node which will be parent of node, Set common prefix, level to this node
                     Prefix prefi = node->getPrefi();
                     prefi.prefixCount = nextLevel - level;
-                    auto newNode = new N4(nextLevel, prefi);
+                    auto newNode = new (pool) N4(nextLevel, prefi);
 
                     // 2)  add node and (tid, *k) as children
-                    newNode->insert(k->fkey[nextLevel], N::setLeaf(k), false);
-                    newNode->insert(nonMatchingKey, node, false);
+                    newNode->insert(k->fkey[nextLevel], N::makeLeaf(k), k->value, false);
+                    newNode->insert(nonMatchingKey, node, 0, false);
                     N::clflush((char *)newNode, sizeof(N4), false, true);
 
                     // 3) lockVersionOrRestart, update parentNode to point to the new node, unlock
                     parentNode->writeLockOrRestart(needRestart);
                     if (needRestart) {
-                        delete newNode;
+                        N::deleteNode(newNode, pool);
                         node->writeUnlock();
                         goto restart;
                     }
@@ -352,15 +676,28 @@ namespace ART_ROWEX {
                 node->lockVersionOrRestart(v, needRestart);
 		if (needRestart) goto restart;
 
-                N::insertAndUnlock(node, parentNode, parentKey, nodeKey, N::setLeaf(k), epocheInfo, needRestart);
+                N::insertAndUnlock(node, parentNode, parentKey, nodeKey, N::makeLeaf(k), k->value, epocheInfo, needRestart);
                 if (needRestart) goto restart;
 		return;
             }
             if (N::isLeaf(nextNode)) {
                 node->lockVersionOrRestart(v, needRestart);
                 if (needRestart) goto restart;
-                Key *key;
-                key = N::getLeaf(nextNode);
+                InlineKey inlineKey;
+                const Key *key = N::getLeafKey(nextNode, k->fkey[0], inlineKey);
+
+                if (upsert && checkLeafKey(nextNode, k)) {
+                    if (N::isInlineLeaf(nextNode)) {
+                        N::setValue(node, nodeKey, k->value);
+                    } else {
+                        if (replaced != nullptr) {
+                            *replaced = N::getLeaf(nextNode);
+                        }
+                        N::change(node, nodeKey, N::setLeaf(k));
+                    }
+                    node->writeUnlock();
+                    return;
+                }
 
                 level++;
                 assert(level < key->getKeyLen()); //prevent inserting when prefix of key exists already
@@ -369,9 +706,10 @@ namespace ART_ROWEX {
                     prefixLength++;
                 }
 
-                auto n4 = new N4(level + prefixLength, &k->fkey[level], prefixLength);
-                n4->insert(k->fkey[level + prefixLength], N::setLeaf(k), false);
-                n4->insert(key->fkey[level + prefixLength], nextNode, false);
+                auto n4 = new (pool) N4(level + prefixLength, &k->fkey[level], prefixLength);
+                n4->insert(k->fkey[level + prefixLength], N::makeLeaf(k), k->value, false);
+                uint64_t nextValue = N::isInlineLeaf(nextNode) ? N::getValuePos(nodeKey, node)->load() : 0;
+                n4->insert(key->fkey[level + prefixLength], nextNode, nextValue, false);
                 N::clflush((char *)n4, sizeof(N4), false, true);
 
                 N::change(node, k->fkey[level - 1], n4);
@@ -422,7 +760,7 @@ namespace ART_ROWEX {
                         node->lockVersionOrRestart(v, needRestart);
                         if (needRestart) goto restart;
 
-                        if (!checkKey(N::getLeaf(nextNode), k)) {
+                        if (!checkLeafKey(nextNode, k)) {
                             node->writeUnlock();
                             return;
                         }
@@ -440,6 +778,9 @@ namespace ART_ROWEX {
                                 }
 
                                 //N::remove(node, k[level]); not necessary
+                                if (N::isInlineLeaf(secondNodeN)) {
+                                    N::setValue(parentNode, parentKey, N::getValuePos(secondNodeK, node)->load());
+                                }
                                 N::change(parentNode, parentKey, secondNodeN);
 
                                 parentNode->writeUnlock();
@@ -547,7 +888,8 @@ namespace ART_ROWEX {
                 // 1) Picking up arbitrary two leaf nodes and then 2) rebuilding correct compressed prefix
 		art_cout << __func__ << " PERFORMING RECOVERY" << std::endl;
                 uint32_t discrimination = (n->getLevel() > level ? n->getLevel() - level : level - n->getLevel());
-                Key *kr = N::getAnyChildTid(n);
+                InlineKey inlineKey;
+                const Key *kr = N::getAnyChildTid(n, inlineKey);
                 p.prefixCount = discrimination;
                 for (uint32_t i = 0; i < std::min(discrimination, maxStoredPrefixLength); i++)
                     p.prefix[i] = kr->fkey[level + i];
@@ -564,18 +906,19 @@ namespace ART_ROWEX {
 
         if (p.prefixCount > 0) {
             uint32_t prevLevel = level;
-            Key *kt = NULL;
+            const Key *kt = NULL;
+            InlineKey inlineKey;
             for (uint32_t i = ((level + p.prefixCount) - n->getLevel()); i < p.prefixCount; ++i) {
                 if (i == maxStoredPrefixLength) {
                     //Optimistic path compression
-                    kt = N::getAnyChildTid(n);
+                    kt = N::getAnyChildTid(n, inlineKey);
                 }
                 uint8_t curKey = i >= maxStoredPrefixLength ? kt->fkey[level] : p.prefix[i];
                 if (curKey != k->fkey[level]) {
                     nonMatchingKey = curKey;
                     if (p.prefixCount > maxStoredPrefixLength) {
                         if (i < maxStoredPrefixLength) {
-                            kt = N::getAnyChildTid(n);
+                            kt = N::getAnyChildTid(n, inlineKey);
                         }
                         for (uint32_t j = 0; j < std::min((p.prefixCount - (level - prevLevel) - 1),
                                                           maxStoredPrefixLength); ++j) {
@@ -601,11 +944,12 @@ namespace ART_ROWEX {
             return PCCompareResults::SkippedLevel;
         }
         if (p.prefixCount > 0) {
-            Key *kt = NULL;
+            const Key *kt = NULL;
+            InlineKey inlineKey;
             for (uint32_t i = ((level + p.prefixCount) - n->getLevel()); i < p.prefixCount; ++i) {
                 if (i == maxStoredPrefixLength) {
                     //loadKey(N::getAnyChildTid(n), kt);
-                    kt = N::getAnyChildTid(n);
+                    kt = N::getAnyChildTid(n, inlineKey);
                 }
                 uint8_t kLevel = (k->getKeyLen() > level) ? k->fkey[level] : 0;
 
@@ -628,11 +972,12 @@ namespace ART_ROWEX {
             return PCEqualsResults::SkippedLevel;
         }
         if (p.prefixCount > 0) {
-            Key *kt = NULL;
+            const Key *kt = NULL;
+            InlineKey inlineKey;
             for (uint32_t i = ((level + p.prefixCount) - n->getLevel()); i < p.prefixCount; ++i) {
                 if (i == maxStoredPrefixLength) {
                     //loadKey(N::getAnyChildTid(n), kt);
-                    kt = N::getAnyChildTid(n);
+                    kt = N::getAnyChildTid(n, inlineKey);
                 }
                 uint8_t startLevel = (start->getKeyLen() > level) ? start->fkey[level] : 0;
                 uint8_t endLevel = (end->getKeyLen() > level) ? end->fkey[level] : 0;
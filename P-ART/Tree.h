@@ -4,6 +4,7 @@
 
 #ifndef ART_ROWEX_TREE_H
 #define ART_ROWEX_TREE_H
+#include <vector>
 #include "N.h"
 
 using namespace ART;
@@ -19,10 +20,38 @@ namespace ART_ROWEX {
 
         void *checkKey(const Key *ret, const Key *k) const;
 
+        static bool checkInlineKey(const N *leaf, const Key *k);
+
+        /**
+         * copies the value of the inline leaf of key out of node, false if node was locked or changed
+         * since version was read (the value slot may belong to another key by then)
+         */
+        static bool loadInlineValue(N *node, uint64_t version, uint8_t key, uint64_t &value);
+
+        bool checkLeafKey(const N *leaf, const Key *k) const;
+
+        static int compareKeys(const Key *a, const Key *b);
+
+        void insertOrUpdate(const Key *k, ThreadInfo &epocheInfo, bool upsert, Key **replaced);
+
         LoadKeyFunction loadKey;
 
         Epoche epoche{256};
 
+        Pool *pool = nullptr;
+
+        static N *attachRoot(Pool &pool);
+
+        static void recover(N *node, Pool &pool, bool parallel);
+
+        /**
+         * Walks the keys from start to end with an Iterator and passes up to resultSize of them to
+         * store(index, iterator). Returns true if there are more keys in the range.
+         */
+        template <typename Store>
+        bool scanRange(const Key *start, const Key *end, std::size_t resultSize, std::size_t &resultsFound,
+                       ThreadInfo &threadEpocheInfo, Store store) const;
+
     public:
         enum class CheckPrefixResult : uint8_t {
             Match,
@@ -63,22 +92,163 @@ namespace ART_ROWEX {
 
         Tree(LoadKeyFunction loadKey);
 
+        /**
+         * Opens the tree stored in pool, or creates it if the pool is empty. All nodes of the tree are
+         * allocated from the pool and the leaves of keys that are not stored inline have to be
+         * allocated with Pool::makeLeaf. When an existing pool is opened, locks held at the time
+         * of a crash are released and every block that is not reachable from the root is
+         * returned to the pool. The pool has to outlive the tree.
+         */
+        Tree(LoadKeyFunction loadKey, Pool &pool);
+
         Tree(const Tree &) = delete;
 
-        Tree(Tree &&t) : root(t.root), loadKey(t.loadKey) { }
+        Tree(Tree &&t) : root(t.root), loadKey(t.loadKey), pool(t.pool) {
+            epoche.setPool(pool);
+        }
 
         ~Tree();
 
         ThreadInfo getThreadInfo();
 
+        /**
+         * Returns a pointer to the value of k, or NULL if k does not exist. For a key that is stored
+         * inline (see N::fitsInline) the value is copied out of its node into the thread's
+         * ThreadInfo, the pointer stays readable until the next lookup of the thread.
+         */
         void *lookup(const Key *k, ThreadInfo &threadEpocheInfo) const;
 
+        /**
+         * Looks up count keys and stores the result of lookup(keys[i]) into results[i]. The lookups
+         * advance in an interleaved group: each traversal takes one step (prefix check or child
+         * access), prefetches the memory of its next step and yields to the next traversal, so
+         * the cache misses of the group overlap instead of stalling one key at a time.
+         */
+        void lookupBatch(const Key *keys[], void *results[], std::size_t count, ThreadInfo &threadEpocheInfo) const;
+
+#ifndef ART_INLINE_LEAVES
+        /**
+         * Stores the leaves of the keys from start to end into result, up to resultLen of them. Returns
+         * true if there are more keys in the range, an Iterator continues a scan (continueKey is passed by
+         * value and is not set).
+         */
         bool lookupRange(const Key *start, const Key *end, const Key *continueKey, Key *result[], std::size_t resultLen,
                          std::size_t &resultCount, ThreadInfo &threadEpocheInfo) const;
-
+#endif
+
+        /**
+         * Stores the values of the keys from start to end into result, up to resultLen of them.
+         * Returns true if there are more keys in the range. Unlike lookupRange this also works with
+         * ART_INLINE_LEAVES, where keys stored inline have no Key leaf to return.
+         */
+        bool lookupRangeValues(const Key *start, const Key *end, TID result[], std::size_t resultLen,
+                               std::size_t &resultCount, ThreadInfo &threadEpocheInfo) const;
+
+        /**
+         * Inserts k. With ART_INLINE_LEAVES, a key of up to maxInlineKeyLength bytes is copied into the tree
+         * together with its value (an inline leaf), so k is not referenced after the call. Other keys are
+         * linked as leaf.
+         */
         void insert(const Key *k, ThreadInfo &epocheInfo);
 
+        /**
+         * Replaces the leaf of an existing key with k (same key, new value). k is persisted
+         * before it is published with a single 8-byte store to the parent's child slot, so a
+         * crash leaves either the old or the new leaf reachable. As with remove, the replaced
+         * leaf is not freed by the tree: it is returned in replaced (nullptr if the value of an
+         * inline leaf was replaced in place, also with a single 8-byte store), and the caller
+         * can free it with retireLeaf. Returns false if the key does not exist.
+         */
+        bool update(const Key *k, ThreadInfo &epocheInfo, Key **replaced = nullptr);
+
+        /**
+         * Inserts k, or replaces the leaf of the key if it already exists (see update).
+         */
+        void upsert(const Key *k, ThreadInfo &epocheInfo, Key **replaced = nullptr);
+
+        /**
+         * Frees a leaf that is no longer reachable (e.g. replaced by update) once no concurrent lookup can
+         * read it anymore, through the epoche of the tree like removed nodes. The leaf has to come from the
+         * pool of the tree (Pool::makeLeaf) or, without a pool, from Key::make_leaf.
+         */
+        void retireLeaf(Key *leaf, ThreadInfo &epocheInfo);
+
         void remove(const Key *k, ThreadInfo &epocheInfo);
+
+        /**
+         * Cursor over the keys of the tree in order. The path from the root to the current key is kept
+         * on a stack together with the version of each node when it was read, so next and prev continue
+         * from there. A node that changed in the meantime invalidates the stack and the iterator seeks
+         * again, from the root, to the key after (before) the current one. The iterator pins the epoche of
+         * the thread (see Epoche::pin) while it exists, so the thread can run other operations between the
+         * calls, but nodes removed from the tree are not freed until it is destroyed. The iterator is a
+         * traversal of its own and does not depend on lookupRange, which is implemented with it.
+         */
+        class Iterator {
+        public:
+            Iterator(const Tree &tree, ThreadInfo &threadEpocheInfo);
+
+            Iterator(const Iterator &) = delete;
+
+            ~Iterator();
+
+            /**
+             * Moves to the first key not smaller than k. Returns false if there is none.
+             */
+            bool seek(const Key *k);
+
+            /**
+             * Moves to the next (previous) key. Returns false, and invalidates the iterator, at the end.
+             */
+            bool next();
+
+            bool prev();
+
+            bool valid() const;
+
+            /**
+             * The current key. For an inline leaf it points into the iterator and is overwritten by the
+             * next move.
+             */
+            const Key *key() const;
+
+            /**
+             * The value of the current key when the iterator moved to it.
+             */
+            TID value() const;
+
+        private:
+            enum class Result : uint8_t {
+                Found,
+                End,
+                Restart
+            };
+
+            struct Frame {
+                N *node;
+                uint64_t version;
+                // key of the child the iterator is in, -1 (256) before the first (after the last) child
+                int16_t key;
+            };
+
+            const Tree &tree;
+            ThreadInfo &threadEpocheInfo;
+            std::vector<Frame> stack;
+            const Key *currentKey = nullptr;
+            TID currentValue = 0;
+            InlineKey inlineKey;
+            InlineKey savedKey;
+
+            Result push(N *node, bool forward);
+
+            Result setLeaf(N *leaf);
+
+            Result step(bool forward);
+
+            Result seek(const Key *k, bool forward, bool inclusive);
+
+            bool move(bool forward);
+        };
     };
 }
 #endif //ART_ROWEX_TREE_H
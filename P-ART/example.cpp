@@ -11,7 +11,7 @@ void loadKey(TID tid, Key &key) {
     return ;
 }
 
-void run(char **argv) {
+void run(int argc, char **argv) {
     std::cout << "Simple Example of P-ART" << std::endl;
 
     uint64_t n = std::atoll(argv[1]);
@@ -29,14 +29,40 @@ void run(char **argv) {
     tbb::task_scheduler_init init(num_thread);
 
     printf("operation,n,ops/s\n");
-    ART_ROWEX::Tree tree(loadKey);
-    {
+    ART::Pool *pool = nullptr;
+    ART_ROWEX::Tree *treep;
+    if (argc == 4) {
+        // Open or recover the tree in a pool file, leaves that are not stored inline are allocated from the pool as well
+        auto starttime = std::chrono::system_clock::now();
+        pool = new ART::Pool(argv[3], std::max<uint64_t>(n * 256, 1ULL << 30));
+        treep = new ART_ROWEX::Tree(loadKey, *pool);
+        auto duration = std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::system_clock::now() - starttime);
+        printf("Elapsed time: %s,%ld,%f sec\n", pool->isNew() ? "create" : "recover", n, duration.count() / 1000000.0);
+    } else {
+        treep = new ART_ROWEX::Tree(loadKey);
+    }
+    ART_ROWEX::Tree &tree = *treep;
+
+    if (pool != nullptr && !pool->isNew()) {
+        // The keys are already in the recovered tree
+        for (uint64_t i = 0; i < n; i++) {
+            Keys[i] = Keys[i]->make_leaf(keys[i], sizeof(uint64_t), keys[i]);
+        }
+    } else {
         // Build tree
         auto starttime = std::chrono::system_clock::now();
         tbb::parallel_for(tbb::blocked_range<uint64_t>(0, n), [&](const tbb::blocked_range<uint64_t> &range) {
             auto t = tree.getThreadInfo();
             for (uint64_t i = range.begin(); i != range.end(); i++) {
+#ifdef ART_INLINE_LEAVES
                 Keys[i] = Keys[i]->make_leaf(keys[i], sizeof(uint64_t), keys[i]);
+#else
+                if (pool != nullptr)
+                    Keys[i] = pool->makeLeaf(keys[i], sizeof(uint64_t), keys[i]);
+                else
+                    Keys[i] = Keys[i]->make_leaf(keys[i], sizeof(uint64_t), keys[i]);
+#endif
                 tree.insert(Keys[i], t);
             }
         });
@@ -65,15 +91,18 @@ void run(char **argv) {
         printf("Elapsed time: lookup,%ld,%f sec\n", n, duration.count() / 1000000.0);
     }
 
+    delete treep;
+    delete pool;
     delete[] keys;
 }
 
 int main(int argc, char **argv) {
-    if (argc != 3) {
-        printf("usage: %s [n] [nthreads]\nn: number of keys (integer)\nnthreads: number of threads (integer)\n", argv[0]);
+    if (argc != 3 && argc != 4) {
+        printf("usage: %s [n] [nthreads] [pool]\nn: number of keys (integer)\nnthreads: number of threads (integer)\n"
+                "pool: pool file to create or recover the tree from (optional)\n", argv[0]);
         return 1;
     }
 
-    run(argv);
+    run(argc, argv);
     return 0;
 }
\ No newline at end of file
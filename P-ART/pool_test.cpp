@@ -0,0 +1,178 @@
+#include <iostream>
+#include <cstring>
+#include <set>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace std;
+
+#include "Tree.h"
+
+// layout of the pool file, see Pool.cpp
+static const off_t usedSlabsOffset = 40;
+static const off_t slabClassOffset = 4096;
+
+static const char *poolPath = "pool_test.pool";
+static const std::size_t poolSize = 256ULL << 20;
+static const int numKeys = 20000;
+
+int failures = 0;
+
+void check(bool ok, const char *what) {
+    if (!ok) {
+        printf("FAIL: %s\n", what);
+        failures++;
+    }
+}
+
+void loadKey(TID, Key &) {}
+
+uint64_t readUsedSlabs() {
+    int fd = open(poolPath, O_RDONLY);
+    uint64_t used = 0;
+    if (fd < 0 || pread(fd, &used, sizeof(used), usedSlabsOffset) != sizeof(used)) {
+        perror(poolPath);
+        exit(1);
+    }
+    close(fd);
+    return used;
+}
+
+uint8_t readSlabClass(uint64_t slab) {
+    int fd = open(poolPath, O_RDONLY);
+    uint8_t c = 0;
+    if (fd < 0 || pread(fd, &c, 1, slabClassOffset + slab) != 1) {
+        perror(poolPath);
+        exit(1);
+    }
+    close(fd);
+    return c;
+}
+
+void writeSlabClass(uint64_t slab, uint8_t c) {
+    int fd = open(poolPath, O_RDWR);
+    if (fd < 0 || pwrite(fd, &c, 1, slabClassOffset + slab) != 1) {
+        perror(poolPath);
+        exit(1);
+    }
+    close(fd);
+}
+
+std::string keyString(int i) {
+    return "pool-test-key-" + std::to_string(i);
+}
+
+// the value of key i, or 0 if it does not exist
+uint64_t lookupKey(ART_ROWEX::Tree &tree, ART::ThreadInfo &t, int i) {
+    std::string s = keyString(i);
+    Key *k = k->make_leaf((char *)s.c_str(), s.size() + 1, 0);
+    void *v = tree.lookup(k, t);
+    free(k);
+    return v == NULL ? 0 : *reinterpret_cast<uint64_t *>(v);
+}
+
+void insertKey(ART::Pool &pool, ART_ROWEX::Tree &tree, ART::ThreadInfo &t, int i) {
+    std::string s = keyString(i);
+    tree.insert(pool.makeLeaf((char *)s.c_str(), s.size() + 1, i + 1), t);
+}
+
+void removeKey(ART_ROWEX::Tree &tree, ART::ThreadInfo &t, int i) {
+    std::string s = keyString(i);
+    Key *k = k->make_leaf((char *)s.c_str(), s.size() + 1, 0);
+    tree.remove(k, t);
+    free(k);
+}
+
+bool checkKeys(ART_ROWEX::Tree &tree, ART::ThreadInfo &t, bool removedExist) {
+    bool ok = true;
+    for (int i = 0; i < numKeys; i++) {
+        uint64_t expected = (i % 3 == 0 && !removedExist) ? 0 : i + 1;
+        ok &= lookupKey(tree, t, i) == expected;
+    }
+    return ok;
+}
+
+// Fills a tree, removes every third key and leaves the pool as a crash between persisting the
+// class of a new slab and counting the slab as used would leave it
+uint64_t run_create() {
+    unlink(poolPath);
+    ART::Pool pool(poolPath, poolSize);
+    ART_ROWEX::Tree tree(loadKey, pool);
+    auto t = tree.getThreadInfo();
+
+    check(pool.isNew(), "a new pool is created");
+    for (int i = 0; i < numKeys; i++) {
+        insertKey(pool, tree, t, i);
+    }
+    for (int i = 0; i < numKeys; i += 3) {
+        removeKey(tree, t, i);
+    }
+    check(checkKeys(tree, t, false), "keys after the removal");
+
+    uint64_t used = readUsedSlabs();
+    writeSlabClass(used, ART::Pool::numClasses - 1);
+    return used;
+}
+
+// Reopens the pool: the half taken slab is not counted as used, the blocks of the removed keys
+// are reused and no block is handed out twice
+void run_recover(uint64_t used) {
+    ART::Pool pool(poolPath, poolSize);
+    ART_ROWEX::Tree tree(loadKey, pool);
+    auto t = tree.getThreadInfo();
+
+    check(!pool.isNew(), "the pool is reopened");
+    check(readUsedSlabs() == used, "recovery does not take slabs");
+    check(checkKeys(tree, t, false), "keys after the recovery");
+
+    for (int i = 0; i < numKeys; i += 3) {
+        insertKey(pool, tree, t, i);
+    }
+    check(checkKeys(tree, t, true), "keys after inserting the removed keys again");
+    check(readUsedSlabs() == used, "the blocks of the removed keys are reused");
+
+    // a tree on the general-purpose allocator in the same process does not allocate from the pool
+    std::vector<Key *> leaves;
+    {
+        ART_ROWEX::Tree heapTree(loadKey);
+        auto ht = heapTree.getThreadInfo();
+        for (int i = 0; i < 1000; i++) {
+            std::string s = keyString(i);
+            Key *k = k->make_leaf((char *)s.c_str(), s.size() + 1, i + 1);
+            heapTree.insert(k, ht);
+            leaves.push_back(k);
+        }
+        check(lookupKey(heapTree, ht, 999) == 1000, "lookup in the heap tree");
+        check(readUsedSlabs() == used, "the heap tree does not allocate from the pool");
+    }
+    for (Key *k : leaves) {
+        free(k);
+    }
+
+    // allocate until a new slab is taken, it has to be the one of the interrupted refill
+    std::set<void *> blocks;
+    bool distinct = true;
+    while (readUsedSlabs() == used) {
+        void *p = pool.alloc(ART::Pool::classSizes[0]);
+        distinct &= blocks.insert(p).second;
+        memset(p, 0xab, ART::Pool::classSizes[0]);
+    }
+    check(distinct, "no block is handed out twice");
+    check(readUsedSlabs() == used + 1, "one slab is taken");
+    check(readSlabClass(used) == 0, "the slab of the interrupted refill is reused with the new class");
+    check(checkKeys(tree, t, true), "keys are not overwritten by new blocks");
+}
+
+int main() {
+    uint64_t used = run_create();
+    run_recover(used);
+    unlink(poolPath);
+
+    if (failures != 0) {
+        printf("%d checks failed\n", failures);
+        return 1;
+    }
+    printf("All checks passed\n");
+    return 0;
+}
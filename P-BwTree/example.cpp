@@ -134,18 +134,15 @@ void run(char **argv) {
         next_thread_id.store(0);
         t->UpdateThreadLocal(num_thread);
         auto func = [&]() {
-            std::vector<uint64_t> v{};
-            v.reserve(1);
             int thread_id = next_thread_id.fetch_add(1);
             uint64_t start_key = n / num_thread * (uint64_t)thread_id;
             uint64_t end_key = start_key + n / num_thread;
 
             t->AssignGCID(thread_id);
             for (uint64_t i = start_key; i < end_key; i++) {
-                v.clear();
-                t->GetValue(keys[i], v);
-                if (v[0] != keys[i]) {
-                    std::cout << "[BwTree] wrong value read: " << v[0] << " expected:" << keys[i] << std::endl;
+                uint64_t v = 0;
+                if (!t->GetValueSingle(keys[i], v) || v != keys[i]) {
+                    std::cout << "[BwTree] wrong value read: " << v << " expected:" << keys[i] << std::endl;
                 }
             }
             t->UnregisterThread(thread_id);
@@ -274,6 +274,29 @@ class AtomicStack {
       return;
     }
 
+    /*
+     * SingleThreadTryPush() - Push an element unless the stack is full
+     *
+     * Returns false if there is no space left. This function must be called
+     * in single-threaded environment
+     */
+    inline bool SingleThreadTryPush(const T &item) {
+      VersionedPointer<T> snapshot_top_p = PreparePush();
+
+      if((snapshot_top_p - data) + 1 >= (std::ptrdiff_t)STACK_SIZE) {
+        // Nothing has changed, so the previous top can be restored as it is
+        top_p.store(snapshot_top_p);
+
+        return false;
+      }
+
+      *(++snapshot_top_p) = item;
+      snapshot_top_p.ToNextVersion();
+      top_p.store(snapshot_top_p);
+
+      return true;
+    }
+
     /*
      * SingleThreadCommitPush() - Commit all buffered items
      *
@@ -69,6 +69,8 @@ using NodeID = uint64_t;
 #include "sorted_small_set.h"
 #include "bloom_filter.h"
 #include "atomic_stack.h"
+#include "persist.h"
+#include "mapping_table.h"
 
 // Copied from Linux kernel code to facilitate branch prediction unit on CPU
 // if there is one
@@ -101,6 +103,11 @@ using NodeID = uint64_t;
 
 /*
  * USE_OLD_EPOCH - This flag switches between old epoch and new epoch mechanism
+ *
+ * The old mechanism counts active threads on a shared epoch node, which every
+ * operation has to modify. The new one lets each registered thread publish
+ * its epoch in its own cache line of BwTreeBase, and garbage is reclaimed by
+ * taking the minimum over these slots
  */
 //#define USE_OLD_EPOCH
 
@@ -167,8 +174,18 @@ extern bool print_flag;
 // no thread sneaking in while GC decision is being made
 #define MAX_THREAD_COUNT ((int)0x7FFFFFFF)
 
-// The maximum number of nodes we could map in this index
-#define MAPPING_TABLE_SIZE ((size_t)(1 << 20))
+// The mapping table is allocated in chunks of this many entries, and
+// the maximum number of nodes we could map in this index is
+// MAPPING_TABLE_CHUNK_SIZE * MAPPING_TABLE_DIRECTORY_SIZE
+#define MAPPING_TABLE_CHUNK_SIZE ((size_t)(1 << 16))
+#define MAPPING_TABLE_DIRECTORY_SIZE ((size_t)(1 << 14))
+#define MAPPING_TABLE_SIZE (MAPPING_TABLE_CHUNK_SIZE * MAPPING_TABLE_DIRECTORY_SIZE)
+
+// At most this many NodeIDs freed by merges wait for being reused
+#define FREE_NODE_ID_LIST_SIZE ((size_t)(1 << 14))
+
+// Set in a mapping table entry until the entry has been flushed
+#define NEEDS_PERSIST_TAG ((uintptr_t)0x1UL)
 
 // If the length of delta chain exceeds ( >= ) this then we consolidate the node
 #define INNER_DELTA_CHAIN_LENGTH_THRESHOLD ((int)8)
@@ -210,31 +227,6 @@ extern bool print_flag;
                                                         sizeof(T)) \
                                                     ) T{__VA_ARGS__} ))
 
-// This is the presumed size of cache line
-static constexpr size_t CACHE_LINE_SIZE = 64;
-
-static inline void mfence() {
-    asm volatile("sfence":::"memory");
-}
-
-static inline void clflush(char *data, int len, bool front, bool back)
-{
-    volatile char *ptr = (char *)((unsigned long)data &~(CACHE_LINE_SIZE-1));
-    if (front)
-        mfence();
-    for(; ptr<data+len; ptr+=CACHE_LINE_SIZE){
-#ifdef CLFLUSH
-        asm volatile("clflush %0" : "+m" (*(volatile char *)ptr));
-#elif CLFLUSH_OPT
-        asm volatile(".byte 0x66; clflush %0" : "+m" (*(volatile char *)(ptr)));
-#elif CLWB
-        asm volatile(".byte 0x66; xsaveopt %0" : "+m" (*(volatile char *)(ptr)));
-#endif
-    }
-    if (back)
-        mfence();
-}
-
 /*
  * class BwTreeBase - Base class of BwTree that stores some common members
  */
@@ -247,6 +239,10 @@ class BwTreeBase {
   
   // We invoke the GC procedure after this has been reached
   static constexpr size_t GC_NODE_COUNT_THREADHOLD = 1024;
+  
+  // A thread publishes this as its epoch when it is not inside an operation
+  // such that it never holds back reclamation
+  static constexpr uint64_t QUIESCENT_EPOCH = static_cast<uint64_t>(-1);
 
   
   /*
@@ -291,7 +287,10 @@ class BwTreeBase {
     // So if we take a global minimum of this value, that minimum could be
     // be used as the global epoch value to decide whether a garbage node could
     // be recycled
-    uint64_t last_active_epoch;
+    //
+    // This is QUIESCENT_EPOCH while the thread is outside of the tree. It is
+    // only written by the owning thread and read by threads doing GC
+    std::atomic<uint64_t> last_active_epoch;
     
     // We only need a pointer
     GarbageNode header; 
@@ -312,7 +311,7 @@ class BwTreeBase {
      * Default constructor
      */
     GCMetaData() :
-      last_active_epoch{0UL},
+      last_active_epoch{QUIESCENT_EPOCH},
       header{},
       last_p{&header},
       node_count{0UL}
@@ -378,7 +377,7 @@ class BwTreeBase {
   
   // This is current epoch
   // We need to make it atomic since multiple threads might try to modify it
-  uint64_t epoch;
+  std::atomic<uint64_t> epoch;
   
  public:
    
@@ -539,7 +538,7 @@ class BwTreeBase {
    * it will cause contention
    */
   inline void IncreaseEpoch() {
-    epoch++;
+    epoch.fetch_add(1);
     
     return;
   }
@@ -552,9 +551,28 @@ class BwTreeBase {
    * unlinked before this epoch could be safely collected since at the time 
    * the thread local counter is updated, we know all references to shared
    * resources have been released
+   *
+   * This is called before a thread accesses the tree. The store must become
+   * visible before any node pointer is loaded (a sequentially consistent
+   * store is the only ordering needed), otherwise a GC thread could miss this
+   * epoch and free a node we are about to read. Nothing shared is written
    */
   inline void UpdateLastActiveEpoch() {
-    GetCurrentGCMetaData()->last_active_epoch = GetGlobalEpoch();
+    GetCurrentGCMetaData()->last_active_epoch.store(GetGlobalEpoch());
+    
+    return;
+  }
+  
+  /*
+   * ClearLastActiveEpoch() - Marks the current thread as quiescent after it
+   *                          has released all references to the tree
+   *
+   * Threads that stay idle after this therefore do not prevent other
+   * threads from reclaiming garbage
+   */
+  inline void ClearLastActiveEpoch() {
+    GetCurrentGCMetaData()->last_active_epoch.store(QUIESCENT_EPOCH,
+                                                    std::memory_order_release);
     
     return;
   }
@@ -565,7 +583,7 @@ class BwTreeBase {
    *                      for GC
    */
   inline void UnregisterThread(int thread_id) {
-    GetGCMetaData(thread_id)->last_active_epoch = static_cast<uint64_t>(-1);
+    GetGCMetaData(thread_id)->last_active_epoch.store(QUIESCENT_EPOCH);
   }
   
   /*
@@ -577,7 +595,7 @@ class BwTreeBase {
    * when it reads the counter
    */
   inline uint64_t GetGlobalEpoch() {
-    return epoch; 
+    return epoch.load(std::memory_order_relaxed); 
   }
   
   /*
@@ -609,14 +627,14 @@ class BwTreeBase {
     assert(thread_num >= 1);
     
     // Use the first metadata's epoch as min and update it on the fly
-    uint64_t min_epoch = GetGCMetaData(0)->last_active_epoch;
+    uint64_t min_epoch = GetGCMetaData(0)->last_active_epoch.load();
     
     // This might not be executed if there is only one thread
     for(int i = 1;i < static_cast<int>(thread_num);i++) {
       // Note: std::min pass a const & of into the function. We need to first copy the shared GetGCMetaData(i)->last_active_epoch
       // into a local variable before calling std::min. Otherwise we will have a Heisenbug where std::min first check which one is smaller,
       // and before it returns, other thread modify the variable and we actually return the larger one.
-      auto ts = GetGCMetaData(i)->last_active_epoch;
+      uint64_t ts = GetGCMetaData(i)->last_active_epoch.load();
       min_epoch = std::min(ts, min_epoch);
     }
     
@@ -2698,6 +2716,32 @@ class BwTree : public BwTreeBase {
          KeyHashFunc p_key_hash_obj = KeyHashFunc{},
          ValueEqualityChecker p_value_eq_obj = ValueEqualityChecker{},
          ValueHashFunc p_value_hash_obj = ValueHashFunc{}) :
+      BwTree(nullptr,
+             start_gc_thread,
+             p_key_cmp_obj,
+             p_key_eq_obj,
+             p_key_hash_obj,
+             p_value_eq_obj,
+             p_value_hash_obj) {}
+
+  /*
+   * Constructor - Keep the mapping table in a file
+   *
+   *   mapping_table_path - File of the mapping table, a new tree is
+   *                        created in it. nullptr keeps the table in
+   *                        memory
+   *
+   * NOTE: The nodes are not stored in the file, the entries are heap
+   * addresses of this process. A file that already holds a tree is
+   * refused instead of restarting from dangling node pointers
+   */
+  BwTree(const char *mapping_table_path,
+         bool start_gc_thread = true,
+         KeyComparator p_key_cmp_obj = KeyComparator{},
+         KeyEqualityChecker p_key_eq_obj = KeyEqualityChecker{},
+         KeyHashFunc p_key_hash_obj = KeyHashFunc{},
+         ValueEqualityChecker p_value_eq_obj = ValueEqualityChecker{},
+         ValueHashFunc p_value_hash_obj = ValueHashFunc{}) :
       BwTreeBase(),
       // Key comparator, equality checker and hasher
       key_cmp_obj{p_key_cmp_obj},
@@ -2721,6 +2765,9 @@ class BwTree : public BwTreeBase {
       // NodeID counter
       next_unused_node_id{1},
 
+      // Mapping table chunks are allocated on demand
+      mapping_table{mapping_table_path},
+
       // Initialize free NodeID stack
       free_node_id_list{},
 
@@ -2873,7 +2920,10 @@ class BwTree : public BwTreeBase {
     clflush((char *)&mapping_table[node_id], sizeof(mapping_table[node_id]), false, true);
 
     // Next time if we need a node ID we just push back from this
-    //free_node_id_list.SingleThreadPush(node_id);
+    // Worker threads also run GC, so pushes are serialized here; if the
+    // list is full the NodeID is not reused
+    std::lock_guard<std::mutex> guard{free_node_id_lock};
+    free_node_id_list.SingleThreadTryPush(node_id);
 
     return;
   }
@@ -2980,8 +3030,18 @@ class BwTree : public BwTreeBase {
           // or will be freed) epoch manager
           // NOTE: No need to call InvalidateNodeID since this function is
           // only called on destruction of the tree
-          mapping_table[((InnerDeleteNode *)node_p)->item.second] = \
-            nullptr;
+          //
+          // NOTE 2: If the epoch manager has recycled the NodeID it might
+          // map a live node again, which is freed through its parent
+          {
+            NodeID deleted_node_id = ((InnerDeleteNode *)node_p)->item.second;
+            const BaseNode *deleted_node_p = GetNode(deleted_node_id);
+            if(deleted_node_p != nullptr &&
+               (deleted_node_p->GetType() == NodeType::LeafRemoveType ||
+                deleted_node_p->GetType() == NodeType::InnerRemoveType)) {
+              mapping_table[deleted_node_id] = nullptr;
+            }
+          }
 
           ((InnerDeleteNode *)node_p)->~InnerDeleteNode();
           freed_count++;
@@ -3141,23 +3201,29 @@ class BwTree : public BwTreeBase {
 
     InstallNewNode(first_leaf_id, left_most_leaf);
 
+    // Only recorded once both nodes are persistent
+    mapping_table.SetRootID(root_id);
+
     return;
   }
 
   /*
    * InitMappingTable() - Initialize the mapping table
    *
-   * It initialize all elements to NULL in order to make
-   * first CAS on the mapping table would succeed
-   *
-   * NOTE: As an optimization we do not set the mapping table to zero
-   * since installing new node could be done as directly writing into
-   * the mapping table rather than CAS with nullptr
+   * Chunks of the mapping table are zeroed when they are allocated, so
+   * there is nothing to do for a new table. A table opened from a file
+   * that already holds a tree cannot be used: its entries point to nodes
+   * of the process that wrote it
    */
   void InitMappingTable() {
-    bwt_printf("Initializing mapping table.... size = %lu\n",
+    bwt_printf("Initializing mapping table.... max size = %lu\n",
                MAPPING_TABLE_SIZE);
-    bwt_printf("Fast initialization: Do not set to zero\n");
+
+    if(mapping_table.IsNew() == false && mapping_table.GetRootID() != INVALID_NODE_ID) {
+      std::cout << "[P-BwTree] the mapping table file already holds a tree, "
+                   "restarting from it is not supported" << std::endl;
+      exit(1);
+    }
 
     return;
   }
@@ -3174,8 +3240,8 @@ class BwTree : public BwTreeBase {
     // If the first element is false then NodeID is invalid and the
     // stack is either empty or being used (we cannot lock and wait)
     //
-    // In current implementation, this free list is initialized with empty list.
-    // It always returns false.
+    // NodeIDs are pushed by InvalidateNodeID() once no thread can still
+    // access them
     auto ret_pair = free_node_id_list.Pop();
 
     // If there is no free node id
@@ -3184,6 +3250,11 @@ class BwTree : public BwTreeBase {
       // automatically
       uint64_t ret = next_unused_node_id.fetch_add(1);
       clflush((char *)&next_unused_node_id, sizeof(std::atomic<NodeID>), false, true);
+      if(ret >= MAPPING_TABLE_SIZE) {
+        std::cout << "[P-BwTree] mapping table is full (" << MAPPING_TABLE_SIZE
+                  << " nodes)" << std::endl;
+        exit(1);
+      }
       return ret;
     } else {
       return ret_pair.second;
@@ -3278,9 +3349,18 @@ class BwTree : public BwTreeBase {
     } // switch type
 
 remove_abort:
-    bool ret = mapping_table[node_id].compare_exchange_strong(prev_p, node_p);
-    if (ret)
+    const BaseNode *tagged_p = TagNeedsPersist(node_p);
+    const BaseNode *expected_p = prev_p;
+    bool ret = mapping_table[node_id].compare_exchange_strong(expected_p, tagged_p);
+
+    // The previous node may still carry its own needs-persist tag
+    if (!ret && expected_p == TagNeedsPersist(prev_p))
+        ret = mapping_table[node_id].compare_exchange_strong(expected_p, tagged_p);
+
+    if (ret) {
         clflush((char *)&mapping_table[node_id], sizeof(mapping_table[node_id]), false, true);
+        mapping_table[node_id].compare_exchange_strong(tagged_p, node_p);
+    }
     return ret;
   }
 
@@ -3298,8 +3378,10 @@ remove_abort:
     //std::cout << "Install ROOT node" << std::endl;
     bool ret = root_id.compare_exchange_strong(old_root_node_id,
                                            new_root_node_id);
-    if (ret == true)
+    if (ret == true) {
         clflush((char *) &root_id, sizeof(root_id), false, true);
+        mapping_table.SetRootID(new_root_node_id);
+    }
 
     return ret;
   }
@@ -3357,7 +3439,42 @@ remove_abort:
 	//std::cout << __func__ << " Node id = " << node_id << std::endl;    
     assert(node_id < MAPPING_TABLE_SIZE);
     
-    return mapping_table[node_id].load();
+    return StripPersistTag(mapping_table[node_id].load());
+  }
+
+  /*
+   * Needs-persist tag of mapping table entries
+   *
+   * A writer installs a node pointer with the lowest bit set, flushes the
+   * entry and then clears the bit. A thread that acts on an entry it has
+   * read (e.g. returns a value found under it) only has to flush the entry
+   * if the bit is still set, and clears it afterwards, so entries that are
+   * already persistent are never flushed again. Node pointers are at least
+   * 8-byte aligned, and GetNode() strips the tag.
+   */
+  static inline const BaseNode *TagNeedsPersist(const BaseNode *node_p) {
+    return reinterpret_cast<const BaseNode *>(
+        reinterpret_cast<uintptr_t>(node_p) | NEEDS_PERSIST_TAG);
+  }
+
+  static inline const BaseNode *StripPersistTag(const BaseNode *node_p) {
+    return reinterpret_cast<const BaseNode *>(
+        reinterpret_cast<uintptr_t>(node_p) & ~NEEDS_PERSIST_TAG);
+  }
+
+  /*
+   * PersistNodeID() - Make sure the mapping of a node ID is persistent
+   */
+  inline void PersistNodeID(NodeID node_id) {
+    const BaseNode *node_p = mapping_table[node_id].load();
+    if((reinterpret_cast<uintptr_t>(node_p) & NEEDS_PERSIST_TAG) == 0) {
+      return;
+    }
+
+    clflush((char *)&mapping_table[node_id], sizeof(mapping_table[node_id]), false, true);
+
+    // Fails if another thread has cleared the tag or replaced the node
+    mapping_table[node_id].compare_exchange_strong(node_p, StripPersistTag(node_p));
   }
 
   /*
@@ -4405,9 +4522,12 @@ abort_traverse:
    * problems since now the snapshot has been changed, and we need to check
    * whether there is data in the map again to make sure there is no
    * map insert conflict
+   *
+   * Values are passed to visitor, which returns false to stop collecting
    */
+  template <typename ValueVisitor>
   void NavigateLeafNode(Context *context_p,
-                        std::vector<ValueType> &value_list) {
+                        ValueVisitor &&visitor) {
                           
     // This will go to the right sibling until we have seen
     // a node whose range match the search key
@@ -4496,7 +4616,9 @@ abort_traverse:
                 // definitely will not block the remaining values, since we
                 // know they do not duplicate inside the leaf node
 
-                value_list.push_back(copy_start_it->second);
+                if(visitor(copy_start_it->second) == false) {
+                  return;
+                }
               }
             }
 
@@ -4517,7 +4639,9 @@ abort_traverse:
               if(present_set.Exists(insert_node_p->item.second) == false) {
                 present_set.Insert(insert_node_p->item.second);
 
-                value_list.push_back(insert_node_p->item.second);
+                if(visitor(insert_node_p->item.second) == false) {
+                  return;
+                }
               }
             }
           } else if(KeyCmpGreater(search_key, insert_node_p->item.first)) {
@@ -5691,7 +5815,7 @@ before_switch:
 	// If the abort flag is not set, it means there is a remove delta, 
 	// but the parent isn't locked. So a crash has probably occured.
 	if (!context_p->abort_flag) {
-        clflush((char *)&mapping_table[snapshot_p->node_id], sizeof(mapping_table[snapshot_p->node_id]), false, true);
+        PersistNodeID(snapshot_p->node_id);
         	// The right branch for merging is the child node under remove node
         	const BaseNode *merge_right_branch = \
           		(static_cast<const DeltaNode *>(snapshot_p->node_p))->child_node_p;
@@ -5904,8 +6028,9 @@ abort_traverse:
     return;
   }
   
+  template <typename ValueVisitor>
   void TraverseReadOptimized(Context *context_p,
-                             std::vector<ValueType> *value_list_p) {
+                             ValueVisitor &&visitor) {
 retry_traverse:
     assert(context_p->abort_flag == false);
     assert(context_p->current_level == -1);
@@ -5964,7 +6089,7 @@ retry_traverse:
       if(snapshot_p->IsLeaf() == true) {
         bwt_printf("The next node is a leaf (RO)\n");
 
-        NavigateLeafNode(context_p, *value_list_p);
+        NavigateLeafNode(context_p, visitor);
 
         if(context_p->abort_flag == true) {
           bwt_printf("NavigateLeafNode aborts (RO). ABORT\n");
@@ -6207,7 +6332,7 @@ before_switch:
       case NodeType::LeafRemoveType:
       case NodeType::InnerRemoveType: {
         bwt_printf("Helping along remove node...\n");
-        clflush((char *)&mapping_table[snapshot_p->node_id], sizeof(mapping_table[snapshot_p->node_id]), false, true);
+        PersistNodeID(snapshot_p->node_id);
 
         // The right branch for merging is the child node under remove node
         const BaseNode *merge_right_branch = \
@@ -6317,7 +6442,7 @@ before_switch:
       case NodeType::InnerMergeType:
       case NodeType::LeafMergeType: {
         bwt_printf("Helping along merge delta\n");
-        clflush((char *)&mapping_table[snapshot_p->node_id], sizeof(mapping_table[snapshot_p->node_id]), false, true);
+        PersistNodeID(snapshot_p->node_id);
 
         // First consolidate parent node and find the left/right
         // sep pair plus left node ID
@@ -6375,7 +6500,7 @@ before_switch:
         if(found_pair_p != nullptr) {
           assert(found_pair_p->second == delete_item_p->second);
         } else {
-          clflush((char *)&mapping_table[parent_snapshot_p->node_id], sizeof(mapping_table[parent_snapshot_p->node_id]), false, true);
+          PersistNodeID(parent_snapshot_p->node_id);
           return NO_CRASH;
         }
 
@@ -6402,7 +6527,7 @@ before_switch:
       case NodeType::InnerSplitType:
       case NodeType::LeafSplitType: {
         bwt_printf("Helping along split node\n");
-        clflush((char *)&mapping_table[snapshot_p->node_id], sizeof(mapping_table[snapshot_p->node_id]), false, true);
+        PersistNodeID(snapshot_p->node_id);
         //std::cout << __func__ << ": Helping split " << std::endl;
 
         // These two will be stored inside InnerInsertNode
@@ -6575,7 +6700,7 @@ before_switch:
           // If the item has been found then we do not post
           // InnerInsertNode onto the parent
           if(found_item_p != nullptr) {
-            clflush((char *)&mapping_table[parent_snapshot_p->node_id], sizeof(mapping_table[parent_snapshot_p->node_id]), false, true);
+            PersistNodeID(parent_snapshot_p->node_id);
             // Check whether there is an item in the parent
             // node that has the same key but different NodeID
             // This is totally legal
@@ -7756,8 +7881,7 @@ before_switch:
 
       // If the key-value pair already exists then return false
       if(item_p != nullptr && item_p != DUMMY_PTR) {
-        clflush((char *)&mapping_table[context.current_snapshot.node_id], 
-                sizeof(mapping_table[context.current_snapshot.node_id]), false, true);
+        PersistNodeID(context.current_snapshot.node_id);
         epoch_manager.LeaveEpoch(epoch_node_p);
 	//std::cout << "Leaving epoch for key " << key << std::endl;
         return false;
@@ -8049,19 +8173,52 @@ before_switch:
    */
   void GetValue(const KeyType &search_key,
                 std::vector<ValueType> &value_list) {
-    bwt_printf("GetValue()\n");
+    VisitValue(search_key, [&value_list](const ValueType &value) {
+      value_list.push_back(value);
+      return true;
+    });
+
+    return;
+  }
+
+  /*
+   * GetValueSingle() - Copy one value of the key into value
+   *
+   * This is the lookup for trees with unique keys: it stops at the first
+   * value found and does not allocate. Returns false if the key is not found
+   */
+  bool GetValueSingle(const KeyType &search_key, ValueType &value) {
+    bool found = false;
+
+    VisitValue(search_key, [&value, &found](const ValueType &v) {
+      value = v;
+      found = true;
+      return false;
+    });
+
+    return found;
+  }
+
+  /*
+   * VisitValue() - Pass each value stored with the key to a visitor
+   *
+   * The visitor is called as bool visitor(const ValueType &) inside the
+   * epoch, and returns false to skip the remaining values. The mapping
+   * table entry of the leaf is only flushed if its writer has not done so
+   * yet (see PersistNodeID())
+   */
+  template <typename ValueVisitor>
+  void VisitValue(const KeyType &search_key, ValueVisitor &&visitor) {
+    bwt_printf("VisitValue()\n");
 
     EpochNode *epoch_node_p = epoch_manager.JoinEpoch();
 
     Context context{search_key};
-    
-    //std::pair<int, bool> index_pair;
-    TraverseReadOptimized(&context, &value_list);
-    //Traverse(&context, &value_list, &index_pair);
+
+    TraverseReadOptimized(&context, visitor);
 
     if (context.current_snapshot.node_id != INVALID_NODE_ID)
-        clflush((char *)&mapping_table[context.current_snapshot.node_id], 
-                sizeof(mapping_table[context.current_snapshot.node_id]), false, true);
+        PersistNodeID(context.current_snapshot.node_id);
 
     epoch_manager.LeaveEpoch(epoch_node_p);
 
@@ -8075,20 +8232,8 @@ before_switch:
    * remove this method
    */
   ValueSet GetValue(const KeyType &search_key) {
-    bwt_printf("GetValue()\n");
-
-    EpochNode *epoch_node_p = epoch_manager.JoinEpoch();
-
-    Context context{search_key};
-
     std::vector<ValueType> value_list{};
-    TraverseReadOptimized(&context, &value_list);
-
-    if (context.current_snapshot.node_id != INVALID_NODE_ID)
-        clflush((char *)&mapping_table[context.current_snapshot.node_id], 
-                sizeof(mapping_table[context.current_snapshot.node_id]), false, true);
-
-    epoch_manager.LeaveEpoch(epoch_node_p);
+    GetValue(search_key, value_list);
 
     ValueSet value_set{value_list.begin(),
                        value_list.end(),
@@ -8184,11 +8329,14 @@ before_switch:
   NodeID first_leaf_id;
 
   std::atomic<NodeID> next_unused_node_id;
-  std::array<std::atomic<const BaseNode *>, MAPPING_TABLE_SIZE> mapping_table;
+  MappingTable<const BaseNode *,
+               MAPPING_TABLE_CHUNK_SIZE,
+               MAPPING_TABLE_DIRECTORY_SIZE> mapping_table;
 
   // This list holds free NodeID which was removed by remove delta
   // We recycle NodeID in epoch manager
-  AtomicStack<NodeID, MAPPING_TABLE_SIZE> free_node_id_list;
+  AtomicStack<NodeID, FREE_NODE_ID_LIST_SIZE> free_node_id_list;
+  std::mutex free_node_id_lock;
 
   std::atomic<uint64_t> insert_op_count;
   std::atomic<uint64_t> insert_abort_count;
@@ -8580,6 +8728,13 @@ try_join_again:
       return;
     }
     
+    /*
+     * JoinEpoch()/LeaveEpoch() - Publish the epoch of the current thread in
+     *                            its own GC slot, and clear it on leave
+     *
+     * Both only touch the thread's own cache line. There is no epoch node, so
+     * nullptr is returned and ignored by LeaveEpoch()
+     */
     inline EpochNode *JoinEpoch() {
       tree_p->UpdateLastActiveEpoch();
       
@@ -8587,7 +8742,7 @@ try_join_again:
     }
     
     inline void LeaveEpoch(EpochNode *epoch_p) {
-      tree_p->UpdateLastActiveEpoch();
+      tree_p->ClearLastActiveEpoch();
       
       (void)epoch_p;
       return;
@@ -9215,7 +9370,7 @@ try_join_again:
       // Consolidate the current node. Note that we pass in the leaf node
       // object embedded inside the IteratorContext object
       p_tree_p->CollectAllValuesOnLeaf(&snapshot, ic_p->GetLeafNode());
-      clflush((char *)&mapping_table[snapshot.node_id], sizeof(mapping_table[snapshot.node_id]), false, true);
+      p_tree_p->PersistNodeID(snapshot.node_id);
       
       // Leave epoch
       p_tree_p->epoch_manager.LeaveEpoch(epoch_node_p);
@@ -9632,7 +9787,7 @@ try_join_again:
         // Consolidate the current node and store all key value pairs
         // to the embedded leaf node 
         p_tree_p->CollectAllValuesOnLeaf(snapshot_p, ic_p->GetLeafNode());
-        clflush((char *)&p_tree_p->mapping_table[snapshot_p->node_id], sizeof(p_tree_p->mapping_table[snapshot_p->node_id]), false, true);
+        p_tree_p->PersistNodeID(snapshot_p->node_id);
 
         // Leave the epoch, since we have already had all information
         p_tree_p->epoch_manager.LeaveEpoch(epoch_node_p);
@@ -9730,7 +9885,7 @@ try_join_again:
         ic_p = IteratorContext::Get(tree_p, node_p);
         assert(ic_p->GetRefCount() == 1UL);
         tree_p->CollectAllValuesOnLeaf(snapshot_p, ic_p->GetLeafNode());
-        clflush((char *)&tree_p->mapping_table[snapshot_p->node_id], sizeof(tree_p->mapping_table[snapshot_p->node_id]), false, true);
+        tree_p->PersistNodeID(snapshot_p->node_id);
         
         // Now we could safely release the reference
         tree_p->epoch_manager.LeaveEpoch(epoch_node_p);
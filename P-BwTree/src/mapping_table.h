@@ -0,0 +1,237 @@
+
+#pragma once
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "persist.h"
+
+#ifdef BWTREE_PELOTON
+namespace peloton {
+namespace index {
+#else
+namespace wangziqi2013 {
+namespace bwtree {
+#endif
+
+/*
+ * class MappingTable - Segmented mapping table from NodeID to node pointer
+ *
+ * The table is a directory of DIRECTORY_SIZE pointers to chunks of
+ * CHUNK_SIZE atomic entries. Chunks are allocated (zero filled) the first
+ * time an entry in them is accessed, so a small tree only pays for the
+ * chunks it uses and the table grows while other threads keep reading and
+ * CAS-ing entries of the existing chunks. Only threads that need the same
+ * new chunk wait for each other.
+ *
+ * The table either lives in memory, or in a file that is mapped with the
+ * chunks at fixed offsets behind a header, which records the number of
+ * chunks and the root NodeID. Entries are stored as-is and point to nodes
+ * on the heap, so they are only valid in the process that wrote them; an
+ * existing file is reopened only to tell whether it already holds a tree.
+ *
+ * Persisting entries is left to the caller; the table only persists its own
+ * header and the zeroed content of new chunks.
+ */
+template <typename T, size_t CHUNK_SIZE, size_t DIRECTORY_SIZE>
+class MappingTable {
+ private:
+  static constexpr uint64_t FILE_MAGIC = 0x4c4254504d545742ULL; // "BWTMPTBL"
+  static constexpr size_t HEADER_SIZE = 4096;
+  static constexpr size_t CHUNK_BYTES = CHUNK_SIZE * sizeof(std::atomic<T>);
+
+  static_assert((CHUNK_SIZE & (CHUNK_SIZE - 1)) == 0,
+                "Mapping table chunk size must be a power of two");
+
+  struct FileHeader {
+    uint64_t magic;
+    uint64_t chunk_size;
+    uint64_t chunk_count;
+    uint64_t root_id;
+  };
+
+  // Chunk pointers; nullptr until the chunk is used
+  std::atomic<std::atomic<T> *> directory[DIRECTORY_SIZE];
+
+  // Serializes the allocation of new chunks
+  std::mutex grow_lock;
+
+  // Only used for file-backed tables
+  int fd;
+  char *base;
+  FileHeader *header;
+  bool created;
+
+  static inline void Persist(const void *data, size_t len) {
+    clflush((char *)data, len, false, true);
+  }
+
+  /*
+   * Grow() - Allocate chunk c if no other thread has done so
+   *
+   * The chunk is persisted (as all zero) before it is published in the
+   * directory, and for file-backed tables before the chunk count covers it
+   */
+  std::atomic<T> *Grow(size_t c) {
+    assert(c < DIRECTORY_SIZE);
+
+    std::lock_guard<std::mutex> guard{grow_lock};
+    std::atomic<T> *chunk_p = directory[c].load();
+    if(chunk_p != nullptr) {
+      return chunk_p;
+    }
+
+    if(base == nullptr) {
+      chunk_p = static_cast<std::atomic<T> *>(aligned_alloc(64, CHUNK_BYTES));
+      if(chunk_p == nullptr) {
+        perror("mapping table");
+        exit(1);
+      }
+      memset((void *)chunk_p, 0, CHUNK_BYTES);
+      Persist(chunk_p, CHUNK_BYTES);
+    } else {
+      // Chunks are filled in order, the file grows up to the requested one
+      uint64_t chunk_count = header->chunk_count;
+      if(c >= chunk_count) {
+        if(ftruncate(fd, HEADER_SIZE + (c + 1) * CHUNK_BYTES) != 0) {
+          perror("mapping table");
+          exit(1);
+        }
+        Persist(base + HEADER_SIZE + chunk_count * CHUNK_BYTES,
+                (c + 1 - chunk_count) * CHUNK_BYTES);
+        header->chunk_count = c + 1;
+        Persist(&header->chunk_count, sizeof(uint64_t));
+      }
+      chunk_p = reinterpret_cast<std::atomic<T> *>(base + HEADER_SIZE + c * CHUNK_BYTES);
+    }
+
+    directory[c].store(chunk_p);
+    return chunk_p;
+  }
+
+  void OpenFile(const char *path) {
+    fd = open(path, O_RDWR | O_CREAT, 0666);
+    struct stat st;
+    if(fd < 0 || fstat(fd, &st) != 0) {
+      perror(path);
+      exit(1);
+    }
+
+    // The whole directory is reserved up front so the table never moves
+    size_t length = HEADER_SIZE + DIRECTORY_SIZE * CHUNK_BYTES;
+    base = static_cast<char *>(mmap(nullptr, length, PROT_READ | PROT_WRITE,
+                                    MAP_SHARED | MAP_NORESERVE, fd, 0));
+    if(base == MAP_FAILED) {
+      perror(path);
+      exit(1);
+    }
+    header = reinterpret_cast<FileHeader *>(base);
+
+    if((size_t)st.st_size < HEADER_SIZE || header->magic != FILE_MAGIC) {
+      if(ftruncate(fd, HEADER_SIZE) != 0) {
+        perror(path);
+        exit(1);
+      }
+      header->chunk_size = CHUNK_SIZE;
+      header->chunk_count = 0;
+      header->root_id = 0;
+      Persist(header, sizeof(FileHeader));
+      header->magic = FILE_MAGIC;
+      Persist(&header->magic, sizeof(uint64_t));
+      created = true;
+      return;
+    }
+
+    if(header->chunk_size != CHUNK_SIZE ||
+       (size_t)st.st_size < HEADER_SIZE + header->chunk_count * CHUNK_BYTES) {
+      std::cout << "[P-BwTree] " << path << " is not a compatible mapping table" << std::endl;
+      exit(1);
+    }
+
+    for(size_t c = 0; c < header->chunk_count; c++) {
+      directory[c].store(reinterpret_cast<std::atomic<T> *>(base + HEADER_SIZE + c * CHUNK_BYTES));
+    }
+    created = false;
+  }
+
+ public:
+  /*
+   * Constructor - Creates an in-memory table, or opens the table in path
+   *               if path is not nullptr (and creates the file if needed)
+   */
+  MappingTable(const char *path = nullptr) :
+    fd{-1},
+    base{nullptr},
+    header{nullptr},
+    created{true} {
+    for(size_t c = 0; c < DIRECTORY_SIZE; c++) {
+      directory[c].store(nullptr, std::memory_order_relaxed);
+    }
+
+    if(path != nullptr) {
+      OpenFile(path);
+    }
+  }
+
+  MappingTable(const MappingTable &) = delete;
+
+  ~MappingTable() {
+    if(base != nullptr) {
+      munmap(base, HEADER_SIZE + DIRECTORY_SIZE * CHUNK_BYTES);
+      close(fd);
+      return;
+    }
+
+    for(size_t c = 0; c < DIRECTORY_SIZE; c++) {
+      free(directory[c].load());
+    }
+  }
+
+  /*
+   * operator[] - Return the entry of a NodeID, allocating its chunk
+   *              if this is the first access
+   */
+  inline std::atomic<T> &operator[](uint64_t id) {
+    std::atomic<T> *chunk_p = directory[id / CHUNK_SIZE].load(std::memory_order_acquire);
+    if(__builtin_expect(chunk_p == nullptr, 0)) {
+      chunk_p = Grow(id / CHUNK_SIZE);
+    }
+
+    return chunk_p[id % CHUNK_SIZE];
+  }
+
+  /*
+   * IsNew() - Whether the table was created rather than opened from a file
+   */
+  bool IsNew() const {
+    return created;
+  }
+
+  /*
+   * GetRootID()/SetRootID() - The root NodeID recorded in the file
+   */
+  uint64_t GetRootID() const {
+    return header != nullptr ? header->root_id : 0;
+  }
+
+  void SetRootID(uint64_t root_id) {
+    if(header != nullptr) {
+      header->root_id = root_id;
+      Persist(&header->root_id, sizeof(uint64_t));
+    }
+  }
+};
+
+}  // End index/bwtree namespace
+}  // End peloton/wangziqi2013 namespace
@@ -0,0 +1,47 @@
+
+#pragma once
+
+#include <cstddef>
+
+/*
+ * Cache line flushes used by BwTree and its mapping table
+ *
+ * The flush instruction is chosen at compile time (CLFLUSH, CLFLUSH_OPT or
+ * CLWB); without any of them only the fences are issued.
+ */
+
+#ifdef BWTREE_PELOTON
+namespace peloton {
+namespace index {
+#else
+namespace wangziqi2013 {
+namespace bwtree {
+#endif
+
+// This is the presumed size of cache line
+static constexpr size_t CACHE_LINE_SIZE = 64;
+
+static inline void mfence() {
+    asm volatile("sfence":::"memory");
+}
+
+static inline void clflush(char *data, size_t len, bool front, bool back)
+{
+    volatile char *ptr = (char *)((unsigned long)data &~(CACHE_LINE_SIZE-1));
+    if (front)
+        mfence();
+    for(; ptr<data+len; ptr+=CACHE_LINE_SIZE){
+#ifdef CLFLUSH
+        asm volatile("clflush %0" : "+m" (*(volatile char *)ptr));
+#elif CLFLUSH_OPT
+        asm volatile(".byte 0x66; clflush %0" : "+m" (*(volatile char *)(ptr)));
+#elif CLWB
+        asm volatile(".byte 0x66; xsaveopt %0" : "+m" (*(volatile char *)(ptr)));
+#endif
+    }
+    if (back)
+        mfence();
+}
+
+}  // End index/bwtree namespace
+}  // End peloton/wangziqi2013 namespace
@@ -34,6 +34,7 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <inttypes.h>
+#include <stdbool.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -229,8 +230,8 @@ typedef struct ALIGNED(CACHE_LINE_SIZE) clht_hashtable_s
 	volatile uint32_t num_expands_threshold;
 	uint32_t num_buckets_prev;
       };
-      volatile int32_t is_helper;
-      volatile int32_t helper_done;
+      volatile uint32_t resize_next;
+      volatile uint32_t resize_done;
       size_t version_min;
     };
     uint8_t padding[2*CACHE_LINE_SIZE];
@@ -351,6 +352,17 @@ clht_val_t clht_get(clht_hashtable_t* hashtable, clht_addr_t key);
 /* Remove a key-value pair from a hashtable. */
 clht_val_t clht_remove(clht_t* hashtable, clht_addr_t key);
 
+/* Create a new hashtable for variable-length string keys. */
+clht_t* clht_str_create(uint64_t num_buckets);
+
+/* Insert, retrieve and remove string keys; keys are copied by clht_str_put. */
+bool clht_str_put(clht_t* hashtable, const char* key, size_t len, clht_val_t val);
+uintptr_t clht_str_get(clht_hashtable_t* hashtable, const char* key, size_t len);
+uintptr_t clht_str_remove(clht_t* hashtable, const char* key, size_t len);
+
+/* migrate part of a resize in progress; updates do this on their own */
+void clht_resize_help(clht_t* hashtable);
+
 /* returns the size of the hash table */
 size_t clht_size(clht_hashtable_t* hashtable);
 
@@ -52,7 +52,8 @@ extern __thread ssmem_allocator_t* clht_alloc;
 /* #define DEBUG */
 
 #define CLHT_READ_ONLY_FAIL   1
-#define CLHT_HELP_RESIZE      1
+#define CLHT_RESIZE_CHUNK     256	   /* buckets migrated at a time */
+#define CLHT_RESIZE_CHUNKS_PER_OP 1	   /* chunks migrated by each update during a resize */
 #define CLHT_PERC_EXPANSIONS  1
 #define CLHT_MAX_EXPANSIONS   24
 #define CLHT_PERC_FULL_DOUBLE 50	   /* % */
@@ -109,6 +110,19 @@ extern __thread ssmem_allocator_t* clht_alloc;
 #define CACHE_LINE_SIZE    64
 #define ENTRIES_PER_BUCKET 3
 
+/* Hash functions for integer keys, select one with -DCLHT_HASH=... */
+#define CLHT_HASH_MASK     0	/* key & (num_buckets - 1), the original CLHT hash */
+#define CLHT_HASH_MULTIPLY 1	/* multiply-shift: high bits of key * 2^64/phi */
+#define CLHT_HASH_CRC32    2	/* SSE4.2 crc32 instruction */
+
+#ifndef CLHT_HASH
+#  define CLHT_HASH CLHT_HASH_MULTIPLY
+#endif
+
+#if CLHT_HASH == CLHT_HASH_CRC32 && !defined(__SSE4_2__)
+#  error "CLHT_HASH_CRC32 requires SSE4.2"
+#endif
+
 #ifndef ALIGNED
 #  if __GNUC__ && !SCC
 #    define ALIGNED(N) __attribute__ ((aligned (N)))
@@ -168,6 +182,24 @@ typedef struct ALIGNED(CACHE_LINE_SIZE) bucket_s
 //_Static_assert (sizeof(bucket_t) % 64 == 0, "sizeof(bucket_t) == 64");
 //#endif
 
+/*
+ * Out-of-line key of a string-keyed table (clht_str_create). The bucket key
+ * slot holds a pointer to the key with the low 16 bits of its hash as a tag
+ * in the unused top 16 bits, so lookups only dereference keys whose tag
+ * matches. The full hash is kept for rehashing on resize.
+ */
+typedef struct clht_skey_s
+{
+  uint64_t hash;
+  uint64_t len;
+  char key[];
+} clht_skey_t;
+
+#define CLHT_SKEY_TAG_SHIFT 48
+#define CLHT_SKEY_PTR_MASK  ((1ULL << CLHT_SKEY_TAG_SHIFT) - 1)
+#define CLHT_SKEY_TAG(hash) ((uint64_t) (uint16_t) (hash) << CLHT_SKEY_TAG_SHIFT)
+#define CLHT_SKEY_PTR(slot) ((clht_skey_t*) ((slot) & CLHT_SKEY_PTR_MASK))
+
 typedef struct ALIGNED(CACHE_LINE_SIZE) clht
 {
   union
@@ -207,9 +239,10 @@ typedef struct ALIGNED(CACHE_LINE_SIZE) clht_hashtable_s
 	volatile uint32_t num_expands_threshold;
 	uint32_t num_buckets_prev;
       };
-      volatile int32_t is_helper;
-      volatile int32_t helper_done;
+      volatile uint32_t resize_next;	/* next chunk to migrate to table_tmp */
+      volatile uint32_t resize_done;	/* chunks migrated */
       size_t version_min;
+      uint32_t string_keys;
     };
     uint8_t padding[2*CACHE_LINE_SIZE];
   };
@@ -236,6 +269,10 @@ extern uint64_t __ac_Jenkins_hash_64(uint64_t key);
 /* Hash a key for a particular hashtable. */
 uint64_t clht_hash(clht_hashtable_t* hashtable, clht_addr_t key );
 
+/* 64-bit hash of a string key, and its bucket in a particular hashtable. */
+uint64_t clht_hash_str(const char* key, size_t len);
+uint64_t clht_hash_str_bin(clht_hashtable_t* hashtable, uint64_t hash);
+
 static inline void
 _mm_pause_rep(uint64_t w)
 {
@@ -253,9 +290,15 @@ _mm_pause_rep(uint64_t w)
 #  define TAS_RLS_MFENCE()
 #endif
 
-#define LOCK_FREE   0
-#define LOCK_UPDATE 1
-#define LOCK_RESIZE 2
+/*
+ * Bucket lock states. During a resize, the buckets of the old table move
+ * from LOCK_RESIZE (being copied) to LOCK_MIGRATED and stay there; their
+ * keys live in table_tmp from then on.
+ */
+#define LOCK_FREE     0
+#define LOCK_UPDATE   1
+#define LOCK_RESIZE   2
+#define LOCK_MIGRATED 3
 
 #if CLHT_USE_RTM == 1		/* USE RTM */
 #  define LOCK_ACQ(lock, ht)			\
@@ -291,8 +334,6 @@ _mm_pause_rep(uint64_t w)
 #define TRYLOCK_RLS(lock)			\
   lock = LOCK_FREE
 
-void ht_resize_help(clht_hashtable_t* h);
-
 #if defined(DEBUG)
 extern __thread uint32_t put_num_restarts;
 #endif
@@ -300,6 +341,7 @@ extern __thread uint32_t put_num_restarts;
 static inline int
 lock_acq_chk_resize(clht_lock_t* lock, clht_hashtable_t* h)
 {
+  (void) h;
   char once = 1;
   clht_lock_t l;
   while ((l = CAS_U8(lock, LOCK_FREE, LOCK_UPDATE)) == LOCK_UPDATE)
@@ -312,17 +354,12 @@ lock_acq_chk_resize(clht_lock_t* lock, clht_hashtable_t* h)
       _mm_pause();
     }
 
-  if (l == LOCK_RESIZE)
+  if (l >= LOCK_RESIZE)
     {
-      /* helping with the resize */
-#if CLHT_HELP_RESIZE == 1
-      ht_resize_help(h);
-#endif
-
-      while (h->table_new == NULL)
+      /* the bucket moves to h->table_tmp, wait until its keys are copied */
+      while (*lock == LOCK_RESIZE)
 	{
 	  _mm_pause();
-	  _mm_mfence();
 	}
 
       return 0;
@@ -340,7 +377,7 @@ lock_acq_resize(clht_lock_t* lock)
       _mm_pause();
     }
 
-  if (l == LOCK_RESIZE)
+  if (l >= LOCK_RESIZE)
     {
       return 0;
     }
@@ -374,16 +411,12 @@ lock_acq_rtm_chk_resize(clht_lock_t* lock, clht_hashtable_t* h)
 	    {
 	      return 1;
 	    }
-	  else if (lv == LOCK_RESIZE)
+	  else if (lv >= LOCK_RESIZE)
 	    {
 	      _xend();
-#  if CLHT_HELP_RESIZE == 1
-	      ht_resize_help(h);
-#  endif
-
-	      while (h->table_new == NULL)
+	      while (*lock == LOCK_RESIZE)
 		{
-		  _mm_mfence();
+		  _mm_pause();
 		}
 
 	      return 0;
@@ -416,6 +449,16 @@ clht_val_t clht_get(clht_hashtable_t* hashtable, clht_addr_t key);
 /* Remove a key-value pair from a hashtable. */
 clht_val_t clht_remove(clht_t* hashtable, clht_addr_t key);
 
+/*
+ * String keys: a table created with clht_str_create() only takes the
+ * clht_str_* operations. Keys are copied; clht_str_remove() releases the
+ * copy through the thread's ssmem allocator (see clht_gc_thread_init()).
+ */
+clht_t* clht_str_create(uint64_t num_buckets);
+bool clht_str_put(clht_t* hashtable, const char* key, size_t len, clht_val_t val);
+uintptr_t clht_str_get(clht_hashtable_t* hashtable, const char* key, size_t len);
+uintptr_t clht_str_remove(clht_t* hashtable, const char* key, size_t len);
+
 size_t clht_size(clht_hashtable_t* hashtable);
 size_t clht_size_mem(clht_hashtable_t* hashtable);
 size_t clht_size_mem_garbage(clht_hashtable_t* hashtable);
@@ -438,6 +481,8 @@ size_t ht_status(clht_t* hashtable, int resize_increase, int just_print);
 #endif
 bucket_t* clht_bucket_create();
 int ht_resize_pes(clht_t* hashtable, int is_increase, int by);
+/* migrate up to CLHT_RESIZE_CHUNKS_PER_OP chunks of a resize in progress */
+void clht_resize_help(clht_t* hashtable);
 
 const char* clht_type_desc();
 
@@ -238,6 +238,33 @@ clht_gc_free(clht_hashtable_t* hashtable)
   return 1;
 }
 
+/* 
+ * free the out-of-line keys of a string-keyed hashtable; old versions
+ * share them with the latest one
+ */
+static void
+clht_gc_free_keys(clht_hashtable_t* hashtable)
+{
+  uint64_t bin;
+  for (bin = 0; bin < hashtable->num_buckets; bin++)
+    {
+      volatile bucket_t* bucket = hashtable->table + bin;
+      do
+	{
+	  uint32_t j;
+	  for (j = 0; j < ENTRIES_PER_BUCKET; j++)
+	    {
+	      if (bucket->key[j] != 0)
+		{
+		  free(CLHT_SKEY_PTR(bucket->key[j]));
+		}
+	    }
+	  bucket = bucket->next;
+	}
+      while (bucket != NULL);
+    }
+}
+
 /* 
  * free all hashtable version (inluding the latest)
  */
@@ -245,7 +272,16 @@ void
 clht_gc_destroy(clht_t* hashtable)
 {
 #if !defined(CLHT_LINKED)
+  /* complete a resize in progress, the new table holds keys the old one does not */
+  while (hashtable->ht->table_tmp != NULL)
+    {
+      clht_resize_help(hashtable);
+    }
   clht_gc_collect_all(hashtable);
+  if (hashtable->ht->string_keys)
+    {
+      clht_gc_free_keys(hashtable->ht);
+    }
   clht_gc_free(hashtable->ht);
   free(hashtable);
 #endif
@@ -39,6 +39,10 @@
 
 #include "clht_lb_res.h"
 
+#if CLHT_HASH == CLHT_HASH_CRC32
+#include <nmmintrin.h>
+#endif
+
 //#define CLHTDEBUG
 //#define CRASH_AFTER_SWAP_CLHT
 //#define CRASH_BEFORE_SWAP_CLHT
@@ -298,26 +302,145 @@ clht_hashtable_create(uint64_t num_buckets)
     {
         hashtable->num_expands_threshold = 1;
     }
-    hashtable->is_helper = 1;
-    hashtable->helper_done = 0;
+    hashtable->resize_next = 0;
+    hashtable->resize_done = 0;
+    hashtable->string_keys = 0;
 
     return hashtable;
 }
 
+    clht_t*
+clht_str_create(uint64_t num_buckets)
+{
+    clht_t* w = clht_create(num_buckets);
+    if (w == NULL)
+    {
+        return NULL;
+    }
+
+    w->ht->string_keys = 1;
+    clflush((char *)w->ht, sizeof(clht_hashtable_t), false, true);
+
+    return w;
+}
+
+#define CLHT_HASH_GOLDEN 0x9E3779B97F4A7C15ULL	/* 2^64 / phi */
+
+/* Map a 64-bit hash to [0, num_buckets) by its high bits. */
+    static inline uint64_t
+clht_hash_range(clht_hashtable_t* hashtable, uint64_t hash)
+{
+    return ((unsigned __int128) hash * hashtable->num_buckets) >> 64;
+}
 
 /* Hash a key for a particular hash table. */
     uint64_t
 clht_hash(clht_hashtable_t* hashtable, clht_addr_t key) 
 {
-    /* uint64_t hashval; */
+#if CLHT_HASH == CLHT_HASH_MULTIPLY
+    /* multiply-shift: num_buckets is a power of two, so this takes the top log2(num_buckets) bits */
+    return clht_hash_range(hashtable, key * CLHT_HASH_GOLDEN);
+#elif CLHT_HASH == CLHT_HASH_CRC32
+    return _mm_crc32_u64(0, key) & (hashtable->hash);
+#else
     /* return __ac_Jenkins_hash_64(key) & (hashtable->hash); */
-    /* return hashval % hashtable->num_buckets; */
-    /* return key % hashtable->num_buckets; */
-    /* return key & (hashtable->num_buckets - 1); */
     return key & (hashtable->hash);
+#endif
+}
+
+/* murmur3 finalizer */
+    static inline uint64_t
+clht_hash_fmix(uint64_t h)
+{
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+/*
+ * Hash a string key. The bucket is taken from the high bits of the hash and
+ * the key slot tag from the low 16 bits.
+ */
+    uint64_t
+clht_hash_str(const char* key, size_t len)
+{
+    uint64_t w;
+    size_t i;
+#if CLHT_HASH == CLHT_HASH_CRC32
+    uint64_t crc = len;
+    for (i = 0; i + sizeof(uint64_t) <= len; i += sizeof(uint64_t))
+    {
+        memcpy(&w, key + i, sizeof(uint64_t));
+        crc = _mm_crc32_u64(crc, w);
+    }
+    if (i < len)
+    {
+        w = 0;
+        memcpy(&w, key + i, len - i);
+        crc = _mm_crc32_u64(crc, w);
+    }
+    /* spread the 32-bit crc over the high bits */
+    return (crc | (crc << 32)) * CLHT_HASH_GOLDEN;
+#else
+    uint64_t h = len * CLHT_HASH_GOLDEN;
+    for (i = 0; i + sizeof(uint64_t) <= len; i += sizeof(uint64_t))
+    {
+        memcpy(&w, key + i, sizeof(uint64_t));
+        h = (h ^ clht_hash_fmix(w)) * CLHT_HASH_GOLDEN;
+    }
+    if (i < len)
+    {
+        w = 0;
+        memcpy(&w, key + i, len - i);
+        h = (h ^ clht_hash_fmix(w)) * CLHT_HASH_GOLDEN;
+    }
+    return clht_hash_fmix(h);
+#endif
+}
+
+    uint64_t
+clht_hash_str_bin(clht_hashtable_t* hashtable, uint64_t hash)
+{
+    return clht_hash_range(hashtable, hash);
+}
+
+/* Does the key slot hold the given string key? Only keys with a matching tag are read. */
+    static inline int
+skey_equal(clht_addr_t slot, uint64_t hash, const char* key, size_t len)
+{
+    if (slot == 0 || (slot & ~CLHT_SKEY_PTR_MASK) != CLHT_SKEY_TAG(hash))
+    {
+        return false;
+    }
+    clht_skey_t* k = CLHT_SKEY_PTR(slot);
+    return k->hash == hash && k->len == len && memcmp(k->key, key, len) == 0;
+}
+
+/* Create the persistent copy of a string key and return its tagged key slot. */
+    static clht_addr_t
+skey_create(uint64_t hash, const char* key, size_t len)
+{
+    clht_skey_t* k = (clht_skey_t*) memalign(CACHE_LINE_SIZE, sizeof(clht_skey_t) + len);
+    if (k == NULL)
+    {
+        printf("** alloc: string key\n");
+        exit(1);
+    }
+    k->hash = hash;
+    k->len = len;
+    memcpy(k->key, key, len);
+    clflush((char *)k, sizeof(clht_skey_t) + len, false, true);
+
+    return (clht_addr_t) k | CLHT_SKEY_TAG(hash);
 }
 
 
+static inline void clht_resize_help_if_needed(clht_t* h);
+static void bucket_clear_migrated(volatile bucket_t* bucket, clht_addr_t key);
+
 /* Retrieve a key-value entry from a hash table. */
 clht_val_t clht_get(clht_hashtable_t* hashtable, clht_addr_t key)
 {
@@ -350,6 +473,12 @@ clht_val_t clht_get(clht_hashtable_t* hashtable, clht_addr_t key)
         bucket = bucket->next;
     }
     while (unlikely(bucket != NULL));
+
+    /* keys inserted since the bucket was migrated are only in the new table */
+    if (unlikely(hashtable->table[bin].lock >= LOCK_RESIZE))
+    {
+        return clht_get(hashtable->table_tmp, key);
+    }
     return 0;
 }
 
@@ -388,7 +517,8 @@ bool clht_put(clht_t* h, clht_addr_t key, clht_val_t val)
     clht_lock_t* lock = &bucket->lock;
     while (!LOCK_ACQ(lock, hashtable))
     {
-        hashtable = h->ht;
+        /* the bucket was migrated by a resize in progress */
+        hashtable = hashtable->table_tmp;
         size_t bin = clht_hash(hashtable, key);
 
         bucket = hashtable->table + bin;
@@ -460,6 +590,7 @@ bool clht_put(clht_t* h, clht_addr_t key, clht_val_t val)
 				if (ret == 0)
 					return true;
             }
+            clht_resize_help_if_needed(h);
             return true;
         }
         bucket = bucket->next;
@@ -476,16 +607,19 @@ clht_val_t clht_remove(clht_t* h, clht_addr_t key)
     volatile bucket_t* bucket = hashtable->table + bin;
 
 #if CLHT_READ_ONLY_FAIL == 1
-    if (!bucket_exists(bucket, key))
+    if (!bucket_exists(bucket, key) && bucket->lock < LOCK_RESIZE)
     {
         return 0;
     }
 #endif
 
+    volatile bucket_t* migrated = NULL;
     clht_lock_t* lock = &bucket->lock;
     while (!LOCK_ACQ(lock, hashtable))
     {
-        hashtable = h->ht;
+        /* the bucket was migrated by a resize in progress */
+        migrated = bucket;
+        hashtable = hashtable->table_tmp;
         size_t bin = clht_hash(hashtable, key);
 
         bucket = hashtable->table + bin;
@@ -504,8 +638,214 @@ clht_val_t clht_remove(clht_t* h, clht_addr_t key)
             if (bucket->key[j] == key)
             {
                 clht_val_t val = bucket->val[j];
+                if (unlikely(migrated != NULL))
+                {
+                    bucket_clear_migrated(migrated, key);
+                }
+                movnt64((uint64_t *)&bucket->key[j], emptyMarker, true, true);
+                LOCK_RLS(lock);
+                clht_resize_help_if_needed(h);
+                return val;
+            }
+        }
+        bucket = bucket->next;
+    }
+    while (unlikely(bucket != NULL));
+    LOCK_RLS(lock);
+    return 0;
+}
+
+/* Retrieve a string key-value entry from a hash table. */
+uintptr_t clht_str_get(clht_hashtable_t* hashtable, const char* key, size_t len)
+{
+    uint64_t hash = clht_hash_str(key, len);
+    size_t bin = clht_hash_str_bin(hashtable, hash);
+    CLHT_GC_HT_VERSION_USED(hashtable);
+    volatile bucket_t* bucket = hashtable->table + bin;
+
+    uint32_t j;
+    do
+    {
+        for (j = 0; j < ENTRIES_PER_BUCKET; j++)
+        {
+            clht_val_t val = bucket->val[j];
+            clht_addr_t slot = bucket->key[j];
+            if (skey_equal(slot, hash, key, len))
+            {
+                if (likely(bucket->val[j] == val && bucket->key[j] == slot))
+                {
+                    return val;
+                }
+                else
+                {
+                    return 0;
+                }
+            }
+        }
+
+        bucket = bucket->next;
+    }
+    while (unlikely(bucket != NULL));
+
+    /* keys inserted since the bucket was migrated are only in the new table */
+    if (unlikely(hashtable->table[bin].lock >= LOCK_RESIZE))
+    {
+        return clht_str_get(hashtable->table_tmp, key, len);
+    }
+    return 0;
+}
+
+    static inline int
+bucket_exists_str(volatile bucket_t* bucket, uint64_t hash, const char* key, size_t len)
+{
+    uint32_t j;
+    do 
+    {
+        for (j = 0; j < ENTRIES_PER_BUCKET; j++)
+        {
+            if (skey_equal(bucket->key[j], hash, key, len))
+            {
+                return true;
+            }
+        }
+        bucket = bucket->next;
+    } 
+    while (unlikely(bucket != NULL));
+    return false;
+}
+
+/* Insert a string key-value entry into a hash table. */
+bool clht_str_put(clht_t* h, const char* key, size_t len, clht_val_t val)
+{
+    uint64_t hash = clht_hash_str(key, len);
+    clht_hashtable_t* hashtable = h->ht;
+    size_t bin = clht_hash_str_bin(hashtable, hash);
+    volatile bucket_t* bucket = hashtable->table + bin;
+#if CLHT_READ_ONLY_FAIL == 1
+    if (bucket_exists_str(bucket, hash, key, len))
+    {
+        return false;
+    }
+#endif
+
+    clht_lock_t* lock = &bucket->lock;
+    while (!LOCK_ACQ(lock, hashtable))
+    {
+        /* the bucket was migrated by a resize in progress */
+        hashtable = hashtable->table_tmp;
+        size_t bin = clht_hash_str_bin(hashtable, hash);
+
+        bucket = hashtable->table + bin;
+        lock = &bucket->lock;
+    }
+
+    CLHT_GC_HT_VERSION_USED(hashtable);
+    CLHT_CHECK_STATUS(h);
+    clht_addr_t* empty = NULL;
+    clht_val_t* empty_v = NULL;
+
+    uint32_t j;
+    do 
+    {
+        for (j = 0; j < ENTRIES_PER_BUCKET; j++)
+        {
+            if (skey_equal(bucket->key[j], hash, key, len))
+            {
+                LOCK_RLS(lock);
+                return false;
+            }
+            else if (empty == NULL && bucket->key[j] == 0)
+            {
+                empty = (clht_addr_t*) &bucket->key[j];
+                empty_v = &bucket->val[j];
+            }
+        }
+
+        int resize = 0;
+        if (likely(bucket->next == NULL))
+        {
+            /* the key is persistent before the slot that points to it */
+            clht_addr_t slot = skey_create(hash, key, len);
+            if (unlikely(empty == NULL))
+            {
+                DPP(put_num_failed_expand);
+
+                bucket_t* b = clht_bucket_create_stats(hashtable, &resize);
+                b->val[0] = val;
+                b->key[0] = slot;
+                clflush((char *)b, sizeof(bucket_t), false, true);
+                movnt64((uint64_t *)&bucket->next, (uint64_t)b, false, true);
+            }
+            else
+            {
+                *empty_v = val;
+                clflush((char *)empty_v, sizeof(clht_val_t), false, true);
+                movnt64((uint64_t *)empty, (uint64_t)slot, false, true);
+            }
+
+            LOCK_RLS(lock);
+            if (unlikely(resize))
+            {
+                ht_status(h, 1, 0);
+            }
+            clht_resize_help_if_needed(h);
+            return true;
+        }
+        bucket = bucket->next;
+    }
+    while (true);
+}
+
+/* Remove a string key-value entry from a hash table. */
+uintptr_t clht_str_remove(clht_t* h, const char* key, size_t len)
+{
+    uint64_t hash = clht_hash_str(key, len);
+    clht_hashtable_t* hashtable = h->ht;
+    size_t bin = clht_hash_str_bin(hashtable, hash);
+    volatile bucket_t* bucket = hashtable->table + bin;
+
+#if CLHT_READ_ONLY_FAIL == 1
+    if (!bucket_exists_str(bucket, hash, key, len) && bucket->lock < LOCK_RESIZE)
+    {
+        return 0;
+    }
+#endif
+
+    volatile bucket_t* migrated = NULL;
+    clht_lock_t* lock = &bucket->lock;
+    while (!LOCK_ACQ(lock, hashtable))
+    {
+        /* the bucket was migrated by a resize in progress */
+        migrated = bucket;
+        hashtable = hashtable->table_tmp;
+        size_t bin = clht_hash_str_bin(hashtable, hash);
+
+        bucket = hashtable->table + bin;
+        lock = &bucket->lock;
+    }
+
+    CLHT_GC_HT_VERSION_USED(hashtable);
+    CLHT_CHECK_STATUS(h);
+
+    uint32_t j;
+    uint64_t emptyMarker = 0;
+    do
+    {
+        for (j = 0; j < ENTRIES_PER_BUCKET; j++)
+        {
+            clht_addr_t slot = bucket->key[j];
+            if (skey_equal(slot, hash, key, len))
+            {
+                clht_val_t val = bucket->val[j];
+                if (unlikely(migrated != NULL))
+                {
+                    bucket_clear_migrated(migrated, slot);
+                }
                 movnt64((uint64_t *)&bucket->key[j], emptyMarker, true, true);
                 LOCK_RLS(lock);
+                clht_resize_help_if_needed(h);
+                /* concurrent readers may still compare against the key */
+                ssmem_release(clht_alloc, CLHT_SKEY_PTR(slot));
                 return val;
             }
         }
@@ -516,12 +856,16 @@ clht_val_t clht_remove(clht_t* h, clht_addr_t key)
     return 0;
 }
 
+/* Copy an entry into a table that is not visible to lookups yet, or only through migrated buckets. */
     static uint32_t
 clht_put_seq(clht_hashtable_t* hashtable, clht_addr_t key, clht_val_t val, uint64_t bin)
 {
     volatile bucket_t* bucket = hashtable->table + bin;
+    clht_lock_t* lock = &bucket->lock;
     uint32_t j;
 
+    /* updates of migrated buckets and other chunks may insert into the same bucket */
+    lock_acq_chk_resize(lock, hashtable);
     do
     {
         for (j = 0; j < ENTRIES_PER_BUCKET; j++)
@@ -530,6 +874,9 @@ clht_put_seq(clht_hashtable_t* hashtable, clht_addr_t key, clht_val_t val, uint6
             {
                 bucket->val[j] = val;
                 bucket->key[j] = key;
+                clflush((char *)bucket, sizeof(bucket_t), false, false);
+                TAS_RLS_MFENCE();
+                *lock = LOCK_FREE;
                 return true;
             }
         }
@@ -538,9 +885,14 @@ clht_put_seq(clht_hashtable_t* hashtable, clht_addr_t key, clht_val_t val, uint6
         {
             DPP(put_num_failed_expand);
             int null;
-            bucket->next = clht_bucket_create_stats(hashtable, &null);
-            bucket->next->val[0] = val;
-            bucket->next->key[0] = key;
+            bucket_t* b = clht_bucket_create_stats(hashtable, &null);
+            b->val[0] = val;
+            b->key[0] = key;
+            clflush((char *)b, sizeof(bucket_t), false, false);
+            bucket->next = b;
+            clflush((char *)bucket, sizeof(bucket_t), false, false);
+            TAS_RLS_MFENCE();
+            *lock = LOCK_FREE;
             return true;
         }
 
@@ -549,6 +901,12 @@ clht_put_seq(clht_hashtable_t* hashtable, clht_addr_t key, clht_val_t val, uint6
     while (true);
 }
 
+    static inline uint64_t
+clht_rehash(clht_hashtable_t* ht_new, clht_addr_t key)
+{
+    return ht_new->string_keys ?
+        clht_hash_str_bin(ht_new, CLHT_SKEY_PTR(key)->hash) : clht_hash(ht_new, key);
+}
 
     static int
 bucket_cpy(clht_t* h, volatile bucket_t* bucket, clht_hashtable_t* ht_new)
@@ -565,7 +923,7 @@ bucket_cpy(clht_t* h, volatile bucket_t* bucket, clht_hashtable_t* ht_new)
             clht_addr_t key = bucket->key[j];
             if (key != 0)
             {
-                uint64_t bin = clht_hash(ht_new, key);
+                uint64_t bin = clht_rehash(ht_new, key);
 
 #if defined(CRASH_DURING_NODE_CREATE)
     			pid_t pid = fork();
@@ -605,122 +963,37 @@ bucket_cpy(clht_t* h, volatile bucket_t* bucket, clht_hashtable_t* ht_new)
     return 1;
 }
 
-
-    void
-ht_resize_help(clht_hashtable_t* h)
+/*
+ * Clear the slot of a removed key in the migrated bucket of the old table,
+ * before it is cleared in the new one, so that neither a lookup in the old
+ * table nor the recovery of the resize brings the key back.
+ */
+    static void
+bucket_clear_migrated(volatile bucket_t* bucket, clht_addr_t key)
 {
-    if ((int32_t) FAD_U32((volatile uint32_t*) &h->is_helper) <= 0)
-    {
-        return;
-    }
-
-    int32_t b;
-    /* hash = num_buckets - 1 */
-    for (b = h->hash; b >= 0; b--)
+    uint32_t j;
+    uint64_t emptyMarker = 0;
+    do
     {
-        bucket_t* bu_cur = h->table + b;
-        if (!bucket_cpy((clht_t *)h, bu_cur, h->table_tmp))
-        {	    /* reached a point where the resizer is handling */
-            /* printf("[GC-%02d] helped  #buckets: %10zu = %5.1f%%\n",  */
-            /* 	 clht_gc_get_id(), h->num_buckets - b, 100.0 * (h->num_buckets - b) / h->num_buckets); */
-            break;
+        for (j = 0; j < ENTRIES_PER_BUCKET; j++)
+        {
+            if (bucket->key[j] == key)
+            {
+                movnt64((uint64_t *)&bucket->key[j], emptyMarker, true, true);
+                return;
+            }
         }
+        bucket = bucket->next;
     }
-
-    h->helper_done = 1;
+    while (bucket != NULL);
 }
 
-
 // return -1 if crash is simulated.
-    int
-ht_resize_pes(clht_t* h, int is_increase, int by)
+    static int
+ht_resize_finish(clht_t* h, clht_hashtable_t* ht_old, clht_hashtable_t* ht_new)
 {
-//    ticks s = getticks();
-
-    check_ht_status_steps = CLHT_STATUS_INVOK;
-
-    clht_hashtable_t* ht_old = h->ht;
-
-    if (TRYLOCK_ACQ(&h->resize_lock))
-    {
-        return 0;
-    }
-
-    size_t num_buckets_new;
-    if (is_increase == true)
-    {
-        /* num_buckets_new = CLHT_RATIO_DOUBLE * ht_old->num_buckets; */
-        num_buckets_new = by * ht_old->num_buckets;
-    }
-    else
-    {
-#if CLHT_HELP_RESIZE == 1
-        ht_old->is_helper = 0;
-#endif
-        num_buckets_new = ht_old->num_buckets / CLHT_RATIO_HALVE;
-    }
-
-    /* printf("// resizing: from %8zu to %8zu buckets\n", ht_old->num_buckets, num_buckets_new); */
-
-    clht_hashtable_t* ht_new = clht_hashtable_create(num_buckets_new);
-    ht_new->version = ht_old->version + 1;
-
-#if CLHT_HELP_RESIZE == 1
-    ht_old->table_tmp = ht_new;
-
-    size_t b;
-    for (b = 0; b < ht_old->num_buckets; b++)
-    {
-        bucket_t* bu_cur = ht_old->table + b;
-        int ret = bucket_cpy(h, bu_cur, ht_new); /* reached a point where the helper is handling */
-		if (ret == -1)
-			return -1;
-
-		if (!ret)
-            break;
-    }
-
-    if (is_increase && ht_old->is_helper != 1)	/* there exist a helper */
-    {
-        while (ht_old->helper_done != 1)
-        {
-            _mm_pause();
-        }
-    }
-
-#else
-
-    size_t b;
-    for (b = 0; b < ht_old->num_buckets; b++)
-    {
-        bucket_t* bu_cur = ht_old->table + b;
-        int ret = bucket_cpy(h, bu_cur, ht_new);
-		if (ret == -1)
-			return -1;
-    }
-#endif
-
-#if defined(DEBUG)
-    /* if (clht_size(ht_old) != clht_size(ht_new)) */
-    /*   { */
-    /*     printf("**clht_size(ht_old) = %zu != clht_size(ht_new) = %zu\n", clht_size(ht_old), clht_size(ht_new)); */
-    /*   } */
-#endif
-
     ht_new->table_prev = ht_old;
-
-    int ht_resize_again = 0;
-    if (ht_new->num_expands >= ht_new->num_expands_threshold)
-    {
-        /* printf("--problem: have already %u expands\n", ht_new->num_expands); */
-        ht_resize_again = 1;
-        /* ht_new->num_expands_threshold = ht_new->num_expands + 1; */
-    }
-
-    mfence();
-    clflush((char *)ht_new, sizeof(clht_hashtable_t), false, false);
-    clflush_next_check((char *)ht_new->table, num_buckets_new * sizeof(bucket_t), false);
-    mfence();
+    clflush((char *)ht_new, sizeof(clht_hashtable_t), true, true);
 
 #if defined(CRASH_BEFORE_SWAP_CLHT)
     pid_t pid = fork();
@@ -753,8 +1026,6 @@ ht_resize_pes(clht_t* h, int is_increase, int by)
 #endif
 
 	// atomically swap the root pointer
-    //SWAP_U64((uint64_t*) h, (uint64_t) ht_new);
-    //clflush((char *)h, sizeof(uint64_t), false, true);
     movnt64((uint64_t *)&h->ht, (uint64_t)ht_new, false, true);
 
 #if defined(CRASH_AFTER_SWAP_CLHT)
@@ -790,11 +1061,6 @@ ht_resize_pes(clht_t* h, int is_increase, int by)
     ht_old->table_new = ht_new;
     TRYLOCK_RLS(h->resize_lock);
 
-//    ticks e = getticks() - s;
-//    double mba = (ht_new->num_buckets * 64) / (1024.0 * 1024);
-//    printf("[RESIZE-%02d] to #bu %7zu = MB: %7.2f    | took: %13llu ti = %8.6f s\n",
-//            clht_gc_get_id(), ht_new->num_buckets, mba, (unsigned long long) e, e / 2.1e9);
-
 #if defined(CLHTDEBUG)
 	DEBUG_PRINT("-------------ht old------------\n");
 	clht_print(ht_old);
@@ -811,13 +1077,178 @@ ht_resize_pes(clht_t* h, int is_increase, int by)
     clht_gc_release(ht_old);
 #endif
 
-    if (ht_resize_again)
+    if (ht_new->num_expands >= ht_new->num_expands_threshold)
     {
+        /* printf("--problem: have already %u expands\n", ht_new->num_expands); */
         ht_status(h, 1, 0);
     }
     return 1;
 }
 
+/*
+ * Incremental resize: the resizing thread only publishes the new table in
+ * table_tmp of the old one. Every update then claims and migrates up to
+ * CLHT_RESIZE_CHUNKS_PER_OP chunks of CLHT_RESIZE_CHUNK buckets, and the
+ * thread that completes the last chunk switches h->ht to the new table.
+ * Updates of migrated buckets go to the new table right away; lookups that
+ * miss in a migrated bucket look into the new table as well.
+ */
+    static int
+ht_resize_step(clht_t* h)
+{
+    clht_hashtable_t* ht_old = h->ht;
+    clht_hashtable_t* ht_new = ht_old->table_tmp;
+    if (ht_new == NULL)
+    {
+        return 0;
+    }
+
+    uint32_t num_chunks = (ht_old->num_buckets + CLHT_RESIZE_CHUNK - 1) / CLHT_RESIZE_CHUNK;
+    int c;
+    for (c = 0; c < CLHT_RESIZE_CHUNKS_PER_OP; c++)
+    {
+        uint32_t chunk = FAI_U32(&ht_old->resize_next);
+        if (chunk >= num_chunks)
+        {
+            return 0;
+        }
+
+        size_t b, start = (size_t) chunk * CLHT_RESIZE_CHUNK;
+        size_t end = start + CLHT_RESIZE_CHUNK < ht_old->num_buckets ? start + CLHT_RESIZE_CHUNK : ht_old->num_buckets;
+        for (b = start; b < end; b++)
+        {
+            if (bucket_cpy(h, ht_old->table + b, ht_new) == -1)
+            {
+                return -1;
+            }
+        }
+
+        /* the copies are persistent before updates of these buckets go to the new table */
+        mfence();
+        for (b = start; b < end; b++)
+        {
+            ht_old->table[b].lock = LOCK_MIGRATED;
+        }
+
+        if (IAF_U32(&ht_old->resize_done) == num_chunks)
+        {
+            return ht_resize_finish(h, ht_old, ht_new);
+        }
+    }
+    return 1;
+}
+
+    void
+clht_resize_help(clht_t* h)
+{
+    ht_resize_step(h);
+}
+
+/* Updates take part in a resize in progress */
+    static inline void
+clht_resize_help_if_needed(clht_t* h)
+{
+    if (unlikely(h->ht->table_tmp != NULL))
+    {
+        ht_resize_step(h);
+    }
+}
+
+
+// return -1 if crash is simulated.
+    int
+ht_resize_pes(clht_t* h, int is_increase, int by)
+{
+//    ticks s = getticks();
+
+    check_ht_status_steps = CLHT_STATUS_INVOK;
+
+    if (TRYLOCK_ACQ(&h->resize_lock))
+    {
+        return 0;
+    }
+
+    /* read after taking the lock, the table may have been switched in between */
+    clht_hashtable_t* ht_old = h->ht;
+
+    size_t num_buckets_new;
+    if (is_increase == true)
+    {
+        /* num_buckets_new = CLHT_RATIO_DOUBLE * ht_old->num_buckets; */
+        num_buckets_new = by * ht_old->num_buckets;
+    }
+    else
+    {
+        num_buckets_new = ht_old->num_buckets / CLHT_RATIO_HALVE;
+        if (num_buckets_new < CLHT_MIN_CLHT_SIZE)
+        {
+            TRYLOCK_RLS(h->resize_lock);
+            return 0;
+        }
+    }
+
+    /* printf("// resizing: from %8zu to %8zu buckets\n", ht_old->num_buckets, num_buckets_new); */
+
+    clht_hashtable_t* ht_new = clht_hashtable_create(num_buckets_new);
+    ht_new->version = ht_old->version + 1;
+    ht_new->string_keys = ht_old->string_keys;
+
+    /* the empty new table is persistent before the resize is, so that recovery can complete it */
+    clflush((char *)ht_new->table, num_buckets_new * sizeof(bucket_t), false, false);
+    clflush((char *)ht_new, sizeof(clht_hashtable_t), false, false);
+    ht_old->resize_next = 0;
+    ht_old->resize_done = 0;
+    movnt64((uint64_t *)&ht_old->table_tmp, (uint64_t)ht_new, true, true);
+
+    return ht_resize_step(h) == -1 ? -1 : 1;
+}
+
+/*
+ * Complete a resize interrupted by a crash: the migrated buckets of the old
+ * table are a subset of the new table, so every old key that is missing in
+ * the new table is copied again.
+ */
+    static void
+ht_resize_recover(clht_t* h)
+{
+    clht_hashtable_t* ht_old = h->ht;
+    clht_hashtable_t* ht_new = ht_old->table_tmp;
+    uint64_t bin;
+
+    for (bin = 0; bin < ht_new->num_buckets; bin++)
+    {
+        ht_new->table[bin].lock = LOCK_FREE;
+    }
+
+    for (bin = 0; bin < ht_old->num_buckets; bin++)
+    {
+        volatile bucket_t* bucket = ht_old->table + bin;
+        do
+        {
+            uint32_t j;
+            for (j = 0; j < ENTRIES_PER_BUCKET; j++)
+            {
+                clht_addr_t key = bucket->key[j];
+                if (key != 0)
+                {
+                    uint64_t bin_new = clht_rehash(ht_new, key);
+                    if (!bucket_exists(ht_new->table + bin_new, key))
+                    {
+                        clht_put_seq(ht_new, key, bucket->val[j], bin_new);
+                    }
+                }
+            }
+            bucket = bucket->next;
+        }
+        while (bucket != NULL);
+    }
+
+    ht_new->table_prev = ht_old;
+    clflush((char *)ht_new, sizeof(clht_hashtable_t), true, true);
+    movnt64((uint64_t *)&h->ht, (uint64_t)ht_new, false, true);
+    ht_old->table_new = ht_new;
+}
+
     size_t
 clht_size(clht_hashtable_t* hashtable)
 {
@@ -1011,6 +1442,11 @@ clht_print(clht_hashtable_t* hashtable)
 void clht_lock_initialization(clht_t *h)
 {
 	DEBUG_PRINT("Performing Lock initialization\n");
+    if (h->ht->table_tmp != NULL)
+    {
+        ht_resize_recover(h);
+    }
+
     clht_hashtable_t *ht = h->ht;
     volatile bucket_t *next;
 
@@ -0,0 +1,62 @@
+#ifndef __HOT__COMMONS__DELETION_INFORMATION___
+#define __HOT__COMMONS__DELETION_INFORMATION___
+
+#include <cassert>
+#include <cstdint>
+
+#include <hot/commons/DiscriminativeBit.hpp>
+
+namespace hot { namespace commons {
+
+/**
+ * The deletion information contains all information, which is necessary to remove an entry from a node.
+ * In the binary patricia trie represented by a node, each entry is the direct child of a BiNode.
+ * Removing the entry removes this BiNode and pulls up its other subtree, the sibling subtree.
+ * It consists of:
+ * 	+ the index of the entry to remove
+ * 	+ the discriminative bit of the entry's parent BiNode, its value is the side of the entry to remove
+ * 	+ the partial key, which only has this discriminative bit set
+ * 	+ the positions of the entries in the sibling subtree
+ */
+struct DeletionInformation {
+	uint32_t const mIndexOfEntryToRemove;
+	uint32_t const mDiscriminativeBitMask;
+	DiscriminativeBit const mDiscriminativeBit;
+	uint32_t const mFirstIndexInSiblingSubtree;
+	uint32_t const mNumberEntriesInSiblingSubtree;
+
+	DeletionInformation(uint32_t const indexOfEntryToRemove, uint32_t const discriminativeBitMask, DiscriminativeBit const & discriminativeBit,
+						uint32_t const firstIndexInSiblingSubtree, uint32_t const numberEntriesInSiblingSubtree
+	)
+		: mIndexOfEntryToRemove(indexOfEntryToRemove), mDiscriminativeBitMask(discriminativeBitMask),
+		  mDiscriminativeBit(discriminativeBit), mFirstIndexInSiblingSubtree(firstIndexInSiblingSubtree),
+		  mNumberEntriesInSiblingSubtree(numberEntriesInSiblingSubtree)
+	{
+		assert(numberEntriesInSiblingSubtree > 0);
+	}
+
+	/**
+	 * @return a mask with a bit set for each entry in the sibling subtree
+	 */
+	uint32_t getSiblingSubtreeMask() const {
+		return (UINT32_MAX >> (32 - mNumberEntriesInSiblingSubtree)) << mFirstIndexInSiblingSubtree;
+	}
+
+	/**
+	 * @return whether the entry to remove and a single other entry are the children of the same BiNode
+	 */
+	bool hasSingleSibling() const {
+		return mNumberEntriesInSiblingSubtree == 1u;
+	}
+
+	/**
+	 * @return whether the entry to remove is the right (larger) child of its BiNode
+	 */
+	bool isRightChild() const {
+		return mDiscriminativeBit.mValue != 0;
+	}
+};
+
+} }
+
+#endif
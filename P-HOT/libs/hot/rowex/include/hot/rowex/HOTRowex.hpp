@@ -10,11 +10,14 @@
 #include <map>
 #include <numeric>
 #include <cstring>
+#include <limits>
 
 #include <hot/commons/Algorithms.hpp>
 #include <hot/commons/BiNode.hpp>
+#include <hot/commons/DeletionInformation.hpp>
 #include <hot/commons/DiscriminativeBit.hpp>
 #include <hot/commons/InsertInformation.hpp>
+#include <hot/commons/NodeAllocationInformations.hpp>
 #include <hot/commons/TwoEntriesNode.hpp>
 
 #include "hot/rowex/HOTRowexChildPointer.hpp"
@@ -64,6 +67,9 @@ template<typename ValueType, template <typename> typename KeyExtractor> inline i
 	uint8_t const* byteKey = idx::contenthelpers::interpretAsByteArray(fixedSizeKey);
 
 	HOTRowexChildPointer current = mRoot.pcas_read();
+	if(!current.isUsed()) {
+		return {};
+	}
 	while(!current.isLeaf()) {
 		current = *(current.search(byteKey));
 	}
@@ -79,6 +85,33 @@ template<typename ValueType, template <typename> typename KeyExtractor> inline i
 	return iterator == end() ? idx::contenthelpers::OptionalValue<ValueType>({}) : idx::contenthelpers::OptionalValue<ValueType>({ true, *iterator });
 }
 
+template<typename ValueType, template <typename> typename KeyExtractor> template<typename ValueConsumer> inline size_t HOTRowex<ValueType, KeyExtractor>::scan(HOTRowex<ValueType, KeyExtractor>::KeyType const &key, size_t numberValues, ValueConsumer && consumer) {
+	return const_iterator::scan(&mRoot, key, numberValues, consumer, const_cast<EpochBasedMemoryReclamationStrategy*>(mMemoryReclamation));
+}
+
+template<typename ValueType, template <typename> typename KeyExtractor> inline size_t HOTRowex<ValueType, KeyExtractor>::scan(HOTRowex<ValueType, KeyExtractor>::KeyType const &key, size_t numberValues, ValueType* results) {
+	return scan(key, numberValues, [&](ValueType const & value) {
+		*results++ = value;
+		return true;
+	});
+}
+
+template<typename ValueType, template <typename> typename KeyExtractor> template<typename ValueConsumer> inline size_t HOTRowex<ValueType, KeyExtractor>::scanRange(HOTRowex<ValueType, KeyExtractor>::KeyType const &startKey, HOTRowex<ValueType, KeyExtractor>::KeyType const &endKey, ValueConsumer && consumer) {
+	return scan(startKey, std::numeric_limits<size_t>::max(), [&](ValueType const & value) {
+		return compareKeys(extractKey(value), endKey) && consumer(value);
+	});
+}
+
+template<typename ValueType, template <typename> typename KeyExtractor> inline size_t HOTRowex<ValueType, KeyExtractor>::scanRange(HOTRowex<ValueType, KeyExtractor>::KeyType const &startKey, HOTRowex<ValueType, KeyExtractor>::KeyType const &endKey, size_t maximumNumberValues, ValueType* results) {
+	return scan(startKey, maximumNumberValues, [&](ValueType const & value) {
+		if(!compareKeys(extractKey(value), endKey)) {
+			return false;
+		}
+		*results++ = value;
+		return true;
+	});
+}
+
 
 template<typename ValueType, template <typename> typename KeyExtractor>
 inline bool HOTRowex<ValueType, KeyExtractor>::insert(ValueType const & value) {
@@ -314,6 +347,162 @@ template<typename ValueType, template <typename> typename KeyExtractor> inline v
 	currentNodeStackEntry.updateChildPointer(newNode);
 }
 
+template<typename ValueType, template <typename> typename KeyExtractor> inline idx::contenthelpers::OptionalValue<ValueType> HOTRowex<ValueType, KeyExtractor>::remove(HOTRowex<ValueType, KeyExtractor>::KeyType const & key) {
+	MemoryGuard guard(mMemoryReclamation);
+	auto const & fixedSizeKey = idx::contenthelpers::toFixSizedKey(idx::contenthelpers::toBigEndianByteOrder(key));
+	uint8_t const* keyBytes = idx::contenthelpers::interpretAsByteArray(fixedSizeKey);
+	idx::contenthelpers::OptionalValue<ValueType> removeResult;
+	bool removeCompleted = false;
+
+	while(!removeCompleted) {
+		HOTRowexChildPointer currentRoot = mRoot.pcas_read();
+		removeResult = {};
+		if (currentRoot.isAValidNode()) {
+			InsertStackType insertStack{currentRoot, &mRoot, keyBytes};
+			if(insertStack.getMismatchingBit(keyBytes).mIsValid) {
+				removeCompleted = true;
+			} else {
+				removeResult = { true, idx::contenthelpers::tidToValue<ValueType>(insertStack.mLeafEntry->getChildPointer().getTid()) };
+				removeCompleted = removeFromStack(insertStack);
+			}
+		} else if (currentRoot.isLeaf()) {
+			ValueType existingValue = idx::contenthelpers::tidToValue<ValueType>(currentRoot.getTid());
+			if (idx::contenthelpers::contentEquals(extractKey(existingValue), key)) {
+				removeCompleted = mRoot.persistent_cas(currentRoot, HOTRowexChildPointer {});
+				removeResult = { true, existingValue };
+			} else {
+				removeCompleted = true;
+			}
+		} else {
+			removeCompleted = true;
+		}
+	}
+	return removeResult;
+}
+
+template<typename ValueType, template <typename> typename KeyExtractor>
+inline bool HOTRowex<ValueType, KeyExtractor>::removeFromStack(typename HOTRowex<ValueType, KeyExtractor>::InsertStackType & insertStack) {
+	InsertStackEntryType* nodeEntry = insertStack.mLeafEntry - 1;
+	InsertStackEntryType* parentEntry = nodeEntry - 1;
+	bool hasParent = nodeEntry > insertStack.getRawStack();
+	HOTRowexChildPointer const & node = nodeEntry->getChildPointer();
+	uint32_t entryIndex = nodeEntry->mSearchResultForInsert.mEntryIndex;
+	unsigned int numberRemainingEntries = node.getNumberEntries() - 1;
+
+	//the node is underfull after the removal, try to merge it with its sibling
+	if(hasParent && numberRemainingEntries > 1 && numberRemainingEntries <= (hot::commons::MAXIMUM_NUMBER_NODE_ENTRIES / 2)) {
+		HOTRowexChildPointer const & parent = parentEntry->getChildPointer();
+		uint32_t nodeIndexInParent = parentEntry->mSearchResultForInsert.mEntryIndex;
+		hot::commons::DeletionInformation const & deletionInformationInParent = parent.executeForSpecificNodeType(false, [&](auto const & parentNode) -> hot::commons::DeletionInformation {
+			return parentNode.getDeletionInformation(nodeIndexInParent);
+		});
+
+		if(deletionInformationInParent.hasSingleSibling()) {
+			HOTRowexChildPointer sibling = parent.getNode()->getPointers()[deletionInformationInParent.mFirstIndexInSiblingSubtree];
+			if(sibling.isAValidNode() && (numberRemainingEntries + sibling.getNumberEntries()) <= hot::commons::MAXIMUM_NUMBER_NODE_ENTRIES) {
+				return removeAndMerge(insertStack, sibling, deletionInformationInParent);
+			}
+		}
+	}
+
+	unsigned int numberLockedEntries = 0;
+	bool lockedSuccessfully = nodeEntry->tryLock();
+	numberLockedEntries += static_cast<unsigned int>(lockedSuccessfully);
+	if(lockedSuccessfully & hasParent) {
+		lockedSuccessfully = parentEntry->tryLock();
+		numberLockedEntries += static_cast<unsigned int>(lockedSuccessfully);
+	}
+
+	bool isValid = lockedSuccessfully && insertStack.isConsistent(nodeEntry, numberLockedEntries);
+	if(isValid) {
+		nodeEntry->updateChildPointer(node.executeForSpecificNodeType(false, [&](auto & currentNode) -> HOTRowexChildPointer {
+			return currentNode.removeEntry(entryIndex);
+		}));
+		nodeEntry->markAsObsolete(*mMemoryReclamation);
+	}
+
+	//unlock top down
+	for(int i = numberLockedEntries - 1; i >= 0; --i) {
+		(nodeEntry - i)->unlock();
+	}
+	return isValid;
+}
+
+template<typename ValueType, template <typename> typename KeyExtractor>
+inline bool HOTRowex<ValueType, KeyExtractor>::removeAndMerge(
+	typename HOTRowex<ValueType, KeyExtractor>::InsertStackType & insertStack, HOTRowexChildPointer const & sibling, hot::commons::DeletionInformation const & deletionInformationInParent
+) {
+	InsertStackEntryType* nodeEntry = insertStack.mLeafEntry - 1;
+	InsertStackEntryType* parentEntry = nodeEntry - 1;
+	bool hasGrandParent = parentEntry > insertStack.getRawStack();
+	bool isRightNode = deletionInformationInParent.isRightChild();
+	HOTRowexNodeBase* siblingNode = sibling.getNode();
+
+	//siblings are locked from left to right, afterwards the remaining nodes are locked bottom up
+	unsigned int numberLockedEntries = 0;
+	bool siblingLocked = false;
+	bool lockedSuccessfully = true;
+	if(isRightNode) {
+		lockedSuccessfully = siblingLocked = siblingNode->tryLock();
+	}
+	if(lockedSuccessfully) {
+		lockedSuccessfully = nodeEntry->tryLock();
+		numberLockedEntries += static_cast<unsigned int>(lockedSuccessfully);
+	}
+	if(lockedSuccessfully & (!isRightNode)) {
+		lockedSuccessfully = siblingLocked = siblingNode->tryLock();
+	}
+	if(lockedSuccessfully) {
+		lockedSuccessfully = parentEntry->tryLock();
+		numberLockedEntries += static_cast<unsigned int>(lockedSuccessfully);
+	}
+	if(lockedSuccessfully & hasGrandParent) {
+		lockedSuccessfully = (parentEntry - 1)->tryLock();
+		numberLockedEntries += static_cast<unsigned int>(lockedSuccessfully);
+	}
+
+	HOTRowexChildPointer const & parent = parentEntry->getChildPointer();
+	bool isValid = lockedSuccessfully && insertStack.isConsistent(nodeEntry, numberLockedEntries)
+		&& parent.getNode()->getPointers()[deletionInformationInParent.mFirstIndexInSiblingSubtree] == sibling;
+	if(isValid) {
+		uint32_t entryIndex = nodeEntry->mSearchResultForInsert.mEntryIndex;
+		HOTRowexChildPointer remainingEntries = nodeEntry->getChildPointer().executeForSpecificNodeType(false, [&](auto & currentNode) -> HOTRowexChildPointer {
+			return currentNode.removeEntry(entryIndex);
+		});
+
+		HOTRowexChildPointer const & leftNode = isRightNode ? sibling : remainingEntries;
+		HOTRowexChildPointer const & rightNode = isRightNode ? remainingEntries : sibling;
+		HOTRowexChildPointer mergedNode = leftNode.executeForSpecificNodeType(false, [&](auto const & left) -> HOTRowexChildPointer {
+			return rightNode.executeForSpecificNodeType(false, [&](auto const & right) -> HOTRowexChildPointer {
+				return left.mergeWithRightSibling(deletionInformationInParent.mDiscriminativeBit.mAbsoluteBitIndex, right);
+			});
+		});
+
+		if(mergedNode.isAValidNode()) {
+			//the copy without the removed entry was never published
+			remainingEntries.free();
+			uint32_t nodeIndexInParent = parentEntry->mSearchResultForInsert.mEntryIndex;
+			parentEntry->updateChildPointer(parent.executeForSpecificNodeType(false, [&](auto & parentNode) -> HOTRowexChildPointer {
+				return parentNode.removeAndReplaceEntry(deletionInformationInParent.mFirstIndexInSiblingSubtree, nodeIndexInParent, mergedNode);
+			}));
+			parentEntry->markAsObsolete(*mMemoryReclamation);
+			siblingNode->markAsObsolete();
+			mMemoryReclamation->scheduleForDeletion(sibling);
+		} else {
+			nodeEntry->updateChildPointer(remainingEntries);
+		}
+		nodeEntry->markAsObsolete(*mMemoryReclamation);
+	}
+
+	//unlock top down
+	for(int i = numberLockedEntries - 1; i >= 0; --i) {
+		(nodeEntry - i)->unlock();
+	}
+	if(siblingLocked) {
+		siblingNode->unlock();
+	}
+	return isValid;
+}
 
 template<typename ValueType, template <typename> typename KeyExtractor> inline typename HOTRowex<ValueType, KeyExtractor>::const_iterator HOTRowex<ValueType, KeyExtractor>::begin() {
 	return HOTRowexSynchronizedIterator<ValueType, KeyExtractor>::begin(&mRoot, const_cast<EpochBasedMemoryReclamationStrategy*>(mMemoryReclamation));
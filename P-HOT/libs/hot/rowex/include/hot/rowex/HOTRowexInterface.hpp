@@ -6,6 +6,7 @@
 
 #include <hot/commons/InsertInformation.hpp>
 #include <hot/commons/BiNode.hpp>
+#include <hot/commons/DeletionInformation.hpp>
 
 #include "hot/rowex/HOTRowexChildPointerInterface.hpp"
 #include "hot/rowex/EpochBasedMemoryReclamationStrategy.hpp"
@@ -70,6 +71,40 @@ template<typename ValueType, template <typename> typename KeyExtractor> struct H
 	 */
 	inline idx::contenthelpers::OptionalValue<ValueType> scan(KeyType const &key, size_t numberValues);
 
+	/**
+	 * Passes up to numberValues values in key order to a consumer, starting at the first key not less than the given key.
+	 * The scan is executed in a single traversal of the trie, without going through the iterator.
+	 *
+	 * @param key the key to start the scanning operation at
+	 * @param numberValues the maximum number of values to scan
+	 * @param consumer a function bool(ValueType const &). Returning false rejects the value and stops the scan.
+	 * @return the number of values accepted by the consumer
+	 */
+	template<typename ValueConsumer> inline size_t scan(KeyType const &key, size_t numberValues, ValueConsumer && consumer);
+
+	/**
+	 * Stores up to numberValues values in key order into results, starting at the first key not less than the given key.
+	 *
+	 * @param results a buffer with room for at least numberValues values
+	 * @return the number of values stored into results
+	 */
+	inline size_t scan(KeyType const &key, size_t numberValues, ValueType* results);
+
+	/**
+	 * Passes all values with keys in [startKey, endKey) in key order to a consumer.
+	 *
+	 * @param consumer a function bool(ValueType const &). Returning false rejects the value and stops the scan.
+	 * @return the number of values accepted by the consumer
+	 */
+	template<typename ValueConsumer> inline size_t scanRange(KeyType const &startKey, KeyType const &endKey, ValueConsumer && consumer);
+
+	/**
+	 * Stores the values with keys in [startKey, endKey) in key order into results, but not more than maximumNumberValues.
+	 *
+	 * @return the number of values stored into results
+	 */
+	inline size_t scanRange(KeyType const &startKey, KeyType const &endKey, size_t maximumNumberValues, ValueType* results);
+
 	/**
 	 * Inserts the given record into the index. The value is inserted according to its keys value.
 	 * In case the index already contains a value for the corresponding key, the value is not inserted.
@@ -115,6 +150,26 @@ private:
 		InsertStackEntryType & currentNodeStackEntry, hot::commons::BiNode<HOTRowexChildPointer> const & splitEntries
 	);
 
+public:
+	/**
+	 * Removes the value for the given key from the index.
+	 * The node containing the value is replaced by a copy without the value. If this copy is at most half full and its only sibling in the parent node is a node,
+	 * both are merged into a single node, in case their entries fit into a single node.
+	 * Replaced nodes are reclaimed by the epoch based memory reclamation strategy.
+	 *
+	 * Concurrent readers may still access the removed value until they have finished, hence it must not be freed before all concurrent operations have finished.
+	 *
+	 * @param key the key of the value to remove
+	 * @return the removed value or an invalid result if the index does not contain a value for the given key
+	 */
+	inline idx::contenthelpers::OptionalValue<ValueType> remove(KeyType const & key);
+
+private:
+	inline bool removeFromStack(InsertStackType & insertStack);
+	inline bool removeAndMerge(
+		InsertStackType & insertStack, HOTRowexChildPointer const & sibling, hot::commons::DeletionInformation const & deletionInformationInParent
+	);
+
 public:
 	/**
 	 * @return an iterator to the first value according to the key order.
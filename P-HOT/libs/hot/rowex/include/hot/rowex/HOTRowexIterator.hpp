@@ -10,6 +10,7 @@
 #include <idx/contenthelpers/TidConverters.hpp>
 #include <idx/contenthelpers/KeyUtilities.hpp>
 #include <idx/contenthelpers/ContentEquals.hpp>
+#include <idx/contenthelpers/KeyComparator.hpp>
 
 #include "hot/rowex/HOTRowexChildPointer.hpp"
 #include "hot/rowex/HOTRowexNodeBase.hpp"
@@ -28,6 +29,8 @@ template<typename ValueType, template <typename> typename KeyExtractor> class HO
 	static KeyExtractor<ValueType> extractKey;
 
 	using KeyType = decltype(extractKey(std::declval<ValueType>()));
+
+	static typename idx::contenthelpers::KeyComparator<KeyType>::type compareKeys;
 	using FixedSizedKeyType = decltype(idx::contenthelpers::toFixSizedKey(idx::contenthelpers::toBigEndianByteOrder(KeyType())));
 
 	static HOTRowexSynchronizedIterator<ValueType, KeyExtractor> const END_ITERATOR;
@@ -66,6 +69,30 @@ public:
 			   : END_ITERATOR;
 	}
 
+	/**
+	 * Passes the values starting at the first key not less than searchKey to consumer in key order, until maximumNumberValues
+	 * values were passed, the end of the data structure is reached or consumer returns false for a value.
+	 * In contrast to iterating, the whole scan is executed in a single traversal protected by a single memory guard,
+	 * and consecutive leaf entries of a node are extracted in one go instead of being copied through the iterator buffer.
+	 *
+	 * @param consumer a function bool(ValueType const &), returning false rejects the value and stops the scan.
+	 * @return the number of values accepted by consumer
+	 */
+	template<typename ValueConsumer> static inline size_t scan(HOTRowexChildPointer * rootPointerLocation, KeyType const & searchKey, size_t maximumNumberValues, ValueConsumer && consumer, EpochBasedMemoryReclamationStrategy * const & memoryReclamationStrategy) {
+		MemoryGuard guard(memoryReclamationStrategy);
+		HOTRowexChildPointer const currentRoot = rootPointerLocation->pcas_read();
+		if(maximumNumberValues == 0 || !currentRoot.isUsed()) {
+			return 0;
+		} else if(currentRoot.isLeaf()) {
+			ValueType const & value = idx::contenthelpers::tidToValue<ValueType>(currentRoot.getTid());
+			return (!compareKeys(extractKey(value), searchKey) && consumer(value)) ? 1 : 0;
+		}
+
+		HOTRowexIteratorStackEntry stack[64];
+		FixedSizedKeyType const & fixedSizedKey = toFixedSizedKey(searchKey);
+		return visitValues(descendToBound(stack, rootPointerLocation, currentRoot, idx::contenthelpers::interpretAsByteArray(fixedSizedKey), true), maximumNumberValues, consumer);
+	}
+
 	inline HOTRowexSynchronizedIterator(const HOTRowexSynchronizedIterator<ValueType, KeyExtractor> & other) : mRootPointerLocation(other.mRootPointerLocation), mMemoryReclamationStrategy(other.mMemoryReclamationStrategy), mCurrentBufferState(getBufferRoot()) {
 		mCurrentBufferState.copy(other.mCurrentBufferState);
 	}
@@ -187,6 +214,10 @@ private:
 	}
 
 	static inline HotRowexIteratorBufferState<KeyType> fillBufferForBoundWithByteKey(HOTRowexChildPointer * const & bufferRoot, HOTRowexIteratorStackEntry * currentStackRoot, HOTRowexChildPointer const * rootPointerLocation, HOTRowexChildPointer const & rootPointer, uint8_t const* searchKeyBytes, bool isLowerBound, MemoryGuard const &guard) {
+		return fillBuffer({ bufferRoot }, descendToBound(currentStackRoot, rootPointerLocation, rootPointer, searchKeyBytes, isLowerBound), guard);
+	}
+
+	static inline HOTRowexSynchronizedIteratorStackState descendToBound(HOTRowexIteratorStackEntry * currentStackRoot, HOTRowexChildPointer const * rootPointerLocation, HOTRowexChildPointer const & rootPointer, uint8_t const* searchKeyBytes, bool isLowerBound) {
 		HOTRowexIteratorStackEntry * currentStackEntry = currentStackRoot;
 		currentStackEntry->init(rootPointerLocation, rootPointer, rootPointerLocation + 1);
 
@@ -219,7 +250,7 @@ private:
 				currentStackEntry = parentStackEntry;
 				--mMostSignificantBitIndex;
 			}
-			return fillBuffer({ bufferRoot }, currentStackEntry->getCurrent().executeForSpecificNodeType(false, [&](auto const &existingNode) -> HOTRowexSynchronizedIteratorStackState {
+			return currentStackEntry->getCurrent().executeForSpecificNodeType(false, [&](auto const &existingNode) -> HOTRowexSynchronizedIteratorStackState {
 				hot::commons::InsertInformation const & insertInformation = existingNode.getInsertInformation(entryIndex, mismatchingBit.mValue);
 
 				unsigned int nextEntryIndex = insertInformation.mKeyInformation.mValue
@@ -233,10 +264,60 @@ private:
 					(++currentStackEntry)->init(nextEntryLocation, existingNode.end());
 					return HOTRowexSynchronizedIteratorStackState(currentStackRoot, HOTRowexSynchronizedIterator::descendOrStore(currentStackEntry), currentStackEntry );
 				}
-			}), guard);
+			});
 		} else {
 			//in case of isLowerBound == true the next ACTION is STORE otherwise the next ACTION is ADVANCE or ASCEND
-			return fillBuffer({ bufferRoot }, { currentStackRoot, isLowerBound ? ITERATOR_FILL_BUFFER_STATE_STORE : ascendOrAdvance(currentStackEntry), currentStackEntry }, guard);
+			return { currentStackRoot, isLowerBound ? ITERATOR_FILL_BUFFER_STATE_STORE : ascendOrAdvance(currentStackEntry), currentStackEntry };
+		}
+	}
+
+	/**
+	 * Same state machine as fillBuffer, but instead of storing leaves into the buffer and stopping once it is full, values are
+	 * handed to the consumer. In the STORE state all following leaf entries of the current node are consumed at once.
+	 */
+	template<typename ValueConsumer> static inline size_t visitValues(HOTRowexSynchronizedIteratorStackState stackState, size_t maximumNumberValues, ValueConsumer & consumer) {
+		size_t numberValues = 0u;
+		while(true) {
+			switch(stackState.mBufferState) {
+				case ITERATOR_FILL_BUFFER_STATE_DESCEND: {
+					HOTRowexNodeBase *childNode = stackState.mStackEntry->getCurrent().getNode();
+					(++stackState.mStackEntry)->init(childNode->begin(), childNode->end());
+					stackState.mBufferState = descendOrStore(stackState.mStackEntry);
+					break;
+				}
+				case ITERATOR_FILL_BUFFER_STATE_STORE: {
+					HOTRowexIteratorStackEntry * const currentStackEntry = stackState.mStackEntry;
+					while(true) {
+						if(!consumer(idx::contenthelpers::tidToValue<ValueType>(currentStackEntry->getCurrent().getTid()))) {
+							return numberValues;
+						} else if(++numberValues == maximumNumberValues) {
+							return numberValues;
+						} else if(currentStackEntry->isLastElement()) {
+							stackState.mBufferState = ITERATOR_FILL_BUFFER_STATE_ASCEND;
+							break;
+						}
+						currentStackEntry->advance();
+						if(!currentStackEntry->getCurrent().isLeaf()) {
+							stackState.mBufferState = ITERATOR_FILL_BUFFER_STATE_DESCEND;
+							break;
+						}
+					}
+					break;
+				}
+				case ITERATOR_FILL_BUFFER_STATE_ADVANCE: {
+					stackState.mStackEntry->advance();
+					stackState.mBufferState = descendOrStore(stackState.mStackEntry);
+					break;
+				}
+				case ITERATOR_FILL_BUFFER_STATE_ASCEND: {
+					bool elementsRemaining = ((--stackState.mStackEntry) >= stackState.mRootEntry);
+					stackState.mBufferState = elementsRemaining ? ascendOrAdvance(stackState.mStackEntry) : ITERATOR_FILL_BUFFER_STATE_END;
+					break;
+				}
+				default: { //END
+					return numberValues;
+				}
+			}
 		}
 	}
 
@@ -293,6 +374,7 @@ private:
 
 template<typename ValueType, template <typename> typename KeyExtractor> HOTRowexSynchronizedIterator<ValueType, KeyExtractor> const HOTRowexSynchronizedIterator<ValueType, KeyExtractor>::END_ITERATOR {};
 template<typename ValueType, template <typename> typename KeyExtractor> KeyExtractor<ValueType> HOTRowexSynchronizedIterator<ValueType, KeyExtractor>::extractKey;
+template<typename ValueType, template <typename> typename KeyExtractor> typename idx::contenthelpers::KeyComparator<typename HOTRowexSynchronizedIterator<ValueType, KeyExtractor>::KeyType>::type HOTRowexSynchronizedIterator<ValueType, KeyExtractor>::compareKeys;
 
 }}
 
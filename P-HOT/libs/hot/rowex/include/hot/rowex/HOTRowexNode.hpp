@@ -6,11 +6,13 @@
 #include <iostream>
 
 #include <hot/commons/BiNode.hpp>
+#include <hot/commons/DeletionInformation.hpp>
 #include <hot/commons/DiscriminativeBit.hpp>
 #include <hot/commons/InsertInformation.hpp>
 #include <hot/commons/SparsePartialKeys.hpp>
 #include <hot/commons/MultiMaskPartialKeyMapping.hpp>
 #include <hot/commons/NodeAllocationInformations.hpp>
+#include <hot/commons/NodeMergeInformation.hpp>
 #include <hot/commons/SearchResultForInsert.hpp>
 #include <hot/commons/TwoEntriesNode.hpp>
 
@@ -250,6 +252,82 @@ template<typename DiscriminativeBitsRepresentation, typename PartialKeyType> tem
 	assert(getMaskForLargerEntries() != this->mUsedEntriesMask);
 }
 
+//remove single entry and replace another one
+template<typename DiscriminativeBitsRepresentation, typename PartialKeyType> template<typename SourceDiscriminativeBitsRepresentation, typename SourcePartialKeyType> inline HOTRowexNode<DiscriminativeBitsRepresentation, PartialKeyType>::HOTRowexNode(
+	HOTRowexNode<SourceDiscriminativeBitsRepresentation, SourcePartialKeyType> const & sourceNode,
+	uint16_t const height,
+	uint16_t const newNumberEntries,
+	DiscriminativeBitsRepresentation const & discriminativeBitsRepresentation,
+	SourcePartialKeyType compressionMask,
+	hot::commons::DeletionInformation const & deletionInformation,
+	uint32_t indexOfEntryToReplace,
+	HOTRowexChildPointer const & replacement
+) : HOTRowexNode(height, newNumberEntries, discriminativeBitsRepresentation) {
+	HOTRowexChildPointer const * __restrict__ sourcePointers = sourceNode.getPointers();
+	HOTRowexChildPointer* __restrict__ targetPointers = this->getPointers();
+
+	SourcePartialKeyType const * __restrict__ sourceMasks = sourceNode.mPartialKeys.mEntries;
+	PartialKeyType * __restrict__ targetMasks = mPartialKeys.mEntries;
+
+	uint32_t indexOfEntryToRemove = deletionInformation.mIndexOfEntryToRemove;
+	//the same discriminative bit may be used in other subtrees, therefore it is explicitly cleared in the sibling subtree of the removed entry
+	uint32_t siblingSubtreeMask = deletionInformation.getSiblingSubtreeMask();
+	SourcePartialKeyType removedBitMask = static_cast<SourcePartialKeyType>(deletionInformation.mDiscriminativeBitMask);
+
+	for(uint32_t sourceIndex = 0; sourceIndex < indexOfEntryToRemove; ++sourceIndex) {
+		SourcePartialKeyType sourceMask = ((siblingSubtreeMask >> sourceIndex) & 1u) ? (sourceMasks[sourceIndex] & ~removedBitMask) : sourceMasks[sourceIndex];
+		targetMasks[sourceIndex] = _pext_u32(sourceMask, compressionMask);
+		targetPointers[sourceIndex] = sourcePointers[sourceIndex];
+	}
+
+	for(uint32_t sourceIndex = indexOfEntryToRemove + 1; sourceIndex <= newNumberEntries; ++sourceIndex) {
+		uint32_t targetIndex = sourceIndex - 1;
+		SourcePartialKeyType sourceMask = ((siblingSubtreeMask >> sourceIndex) & 1u) ? (sourceMasks[sourceIndex] & ~removedBitMask) : sourceMasks[sourceIndex];
+		targetMasks[targetIndex] = _pext_u32(sourceMask, compressionMask);
+		targetPointers[targetIndex] = sourcePointers[sourceIndex];
+	}
+
+	if(indexOfEntryToReplace != indexOfEntryToRemove) {
+		targetPointers[indexOfEntryToReplace - (indexOfEntryToReplace > indexOfEntryToRemove)] = replacement;
+	}
+
+	//This is important for the tree to have fast lookup and maintain integrity!! the first mask always is zero!!
+	assert(targetMasks[0] == 0u);
+	targetMasks[0] = 0u;
+
+	assert(getMaskForLargerEntries() != this->mUsedEntriesMask);
+}
+
+//merge two sibling nodes
+template<typename DiscriminativeBitsRepresentation, typename PartialKeyType> template<typename LeftNodeType, typename RightNodeType> inline HOTRowexNode<DiscriminativeBitsRepresentation, PartialKeyType>::HOTRowexNode(
+	LeftNodeType const & leftNode,
+	RightNodeType const & rightNode,
+	uint16_t const newNumberEntries,
+	DiscriminativeBitsRepresentation const & discriminativeBitsRepresentation,
+	uint32_t leftRecodingMask,
+	uint32_t rightRecodingMask,
+	PartialKeyType rootBitMask
+) : HOTRowexNode(std::max(leftNode.mHeight, rightNode.mHeight), newNumberEntries, discriminativeBitsRepresentation) {
+	HOTRowexChildPointer* __restrict__ targetPointers = this->getPointers();
+	PartialKeyType * __restrict__ targetMasks = mPartialKeys.mEntries;
+
+	uint32_t numberLeftEntries = leftNode.getNumberEntries();
+	HOTRowexChildPointer const * __restrict__ leftPointers = leftNode.getPointers();
+	for(uint32_t index = 0; index < numberLeftEntries; ++index) {
+		targetMasks[index] = static_cast<PartialKeyType>(_pdep_u32(leftNode.mPartialKeys.mEntries[index], leftRecodingMask));
+		targetPointers[index] = leftPointers[index];
+	}
+
+	HOTRowexChildPointer const * __restrict__ rightPointers = rightNode.getPointers();
+	for(uint32_t index = numberLeftEntries; index < newNumberEntries; ++index) {
+		uint32_t sourceIndex = index - numberLeftEntries;
+		targetMasks[index] = static_cast<PartialKeyType>(_pdep_u32(rightNode.mPartialKeys.mEntries[sourceIndex], rightRecodingMask)) | rootBitMask;
+		targetPointers[index] = rightPointers[sourceIndex];
+	}
+
+	assert(getMaskForLargerEntries() != this->mUsedEntriesMask);
+}
+
 template<typename DiscriminativeBitsRepresentation, typename PartialKeyType> inline HOTRowexChildPointer const * HOTRowexNode<DiscriminativeBitsRepresentation, PartialKeyType>::search(uint8_t const * keyBytes) const {
 	return this->getPointers() + this->toResultIndex(mPartialKeys.search(mDiscriminativeBitsRepresentation.extractMask(keyBytes)));
 }
@@ -387,6 +465,106 @@ HOTRowexChildPointer HOTRowexNode<DiscriminativeBitsRepresentation, PartialKeyTy
 	}
 }
 
+template<typename DiscriminativeBitsRepresentation, typename PartialKeyType> inline
+hot::commons::DeletionInformation HOTRowexNode<DiscriminativeBitsRepresentation, PartialKeyType>::getDeletionInformation(uint32_t entryIndex) const
+{
+	uint32_t numberEntries = this->getNumberEntries();
+	bool isRightChild = mPartialKeys.determineValueOfDiscriminatingBit(entryIndex, numberEntries);
+
+	//the entry and its direct neighbour on the other side of the parent BiNode only differ in the BiNode's discriminative bit
+	uint32_t smallerIndex = isRightChild ? (entryIndex - 1) : entryIndex;
+	PartialKeyType discriminativeBitMask = mPartialKeys.mEntries[smallerIndex + 1] & ~mPartialKeys.mEntries[smallerIndex];
+	hot::commons::DiscriminativeBit discriminativeBit(mDiscriminativeBitsRepresentation.getLeastSignificantBitIndex(discriminativeBitMask), isRightChild);
+
+	hot::commons::InsertInformation const & subtreeInformation = getInsertInformation(entryIndex, discriminativeBit);
+	uint32_t firstIndexInSubtree = subtreeInformation.getFirstIndexInAffectedSubtree();
+	uint32_t numberEntriesInSiblingSubtree = subtreeInformation.getNumberEntriesInAffectedSubtree() - 1;
+
+	return {
+		entryIndex, discriminativeBitMask, discriminativeBit,
+		isRightChild ? firstIndexInSubtree : (entryIndex + 1), numberEntriesInSiblingSubtree
+	};
+}
+
+template<typename DiscriminativeBitsRepresentation, typename PartialKeyType> inline
+HOTRowexChildPointer HOTRowexNode<DiscriminativeBitsRepresentation, PartialKeyType>::removeEntry(uint32_t entryIndex) const
+{
+	return removeAndReplaceEntry(entryIndex, entryIndex, HOTRowexChildPointer {});
+}
+
+template<typename DiscriminativeBitsRepresentation, typename PartialKeyType> inline
+HOTRowexChildPointer HOTRowexNode<DiscriminativeBitsRepresentation, PartialKeyType>::removeAndReplaceEntry(
+	uint32_t indexOfEntryToRemove, uint32_t indexOfEntryToReplace, HOTRowexChildPointer const & replacement
+) const
+{
+	uint16_t numberEntries = this->getNumberEntries();
+	uint16_t newNumberEntries = numberEntries - 1;
+
+	if(newNumberEntries > 1) {
+		hot::commons::DeletionInformation const & deletionInformation = getDeletionInformation(indexOfEntryToRemove);
+		PartialKeyType relevantBits = mPartialKeys.getRelevantBitsForAllExceptOneEntry(numberEntries, indexOfEntryToRemove);
+		HOTRowexNode<DiscriminativeBitsRepresentation, PartialKeyType> const &self = *this;
+
+		//the removed entry might have been the only one of maximum height
+		uint16_t maximumChildHeight = 0;
+		for(uint32_t entryIndex = 0; entryIndex < numberEntries; ++entryIndex) {
+			if(entryIndex != indexOfEntryToRemove) {
+				HOTRowexChildPointer const & child = (entryIndex == indexOfEntryToReplace) ? replacement : this->getPointers()[entryIndex];
+				maximumChildHeight = std::max(maximumChildHeight, child.getHeight());
+			}
+		}
+		uint16_t newHeight = maximumChildHeight + 1;
+
+		return mDiscriminativeBitsRepresentation.extract(relevantBits, [&](auto const &newDiscriminativeBitsRepresentation) {
+			return newDiscriminativeBitsRepresentation.executeWithCorrectMaskAndDiscriminativeBitsRepresentation([&](auto const &finalDiscriminativeBitsRepresentation, auto maximumMask) {
+				using FinalDiscriminativeBitsRepresentationType = typename std::remove_const<
+					typename std::remove_reference<decltype(finalDiscriminativeBitsRepresentation)>::type
+				>::type;
+
+				HOTRowexChildPointer newChild = (new (newNumberEntries) HOTRowexNode<FinalDiscriminativeBitsRepresentationType, decltype(maximumMask)>(
+					self, newHeight, newNumberEntries, finalDiscriminativeBitsRepresentation, relevantBits, deletionInformation, indexOfEntryToReplace, replacement
+				))->toChildPointer();
+
+				hot::commons::NodeAllocationInformation const & allocationInformation =
+				hot::commons::NodeAllocationInformations<HOTRowexNode<FinalDiscriminativeBitsRepresentationType, decltype(maximumMask)>>::getAllocationInformation(newNumberEntries);
+				hot::commons::clflush(reinterpret_cast <char *> (newChild.getNode()), allocationInformation.mTotalSizeInBytes, true, true);
+				return newChild;
+			});
+		});
+	} else {
+		return (indexOfEntryToReplace != indexOfEntryToRemove) ? replacement : this->getPointers()[1 - indexOfEntryToRemove];
+	}
+}
+
+template<typename DiscriminativeBitsRepresentation, typename PartialKeyType> template<typename RightNodeType> inline
+HOTRowexChildPointer HOTRowexNode<DiscriminativeBitsRepresentation, PartialKeyType>::mergeWithRightSibling(uint16_t rootBitIndex, RightNodeType const & rightNode) const
+{
+	hot::commons::NodeMergeInformation const mergeInformation(rootBitIndex, mDiscriminativeBitsRepresentation, rightNode.mDiscriminativeBitsRepresentation);
+	if(!mergeInformation.isValid()) {
+		return HOTRowexChildPointer {};
+	}
+
+	uint16_t newNumberEntries = this->getNumberEntries() + rightNode.getNumberEntries();
+	HOTRowexNode<DiscriminativeBitsRepresentation, PartialKeyType> const & self = *this;
+
+	return mergeInformation.executeWithMergedDiscriminativeBitsRepresentationAndFittingPartialKeyType([&](auto const & mergedDiscriminativeBitsRepresentation, auto maximumMask, uint32_t leftRecodingMask, uint32_t rightRecodingMask) {
+		using MergedDiscriminativeBitsRepresentationType = typename std::remove_const<
+			typename std::remove_reference<decltype(mergedDiscriminativeBitsRepresentation)>::type
+		>::type;
+		using MergedPartialKeyType = decltype(maximumMask);
+
+		MergedPartialKeyType rootBitMask = static_cast<MergedPartialKeyType>(mergedDiscriminativeBitsRepresentation.getMaskFor(hot::commons::DiscriminativeBit { rootBitIndex }));
+		HOTRowexChildPointer newChild = (new (newNumberEntries) HOTRowexNode<MergedDiscriminativeBitsRepresentationType, MergedPartialKeyType>(
+			self, rightNode, newNumberEntries, mergedDiscriminativeBitsRepresentation, leftRecodingMask, rightRecodingMask, rootBitMask
+		))->toChildPointer();
+
+		hot::commons::NodeAllocationInformation const & allocationInformation =
+		hot::commons::NodeAllocationInformations<HOTRowexNode<MergedDiscriminativeBitsRepresentationType, MergedPartialKeyType>>::getAllocationInformation(newNumberEntries);
+		hot::commons::clflush(reinterpret_cast <char *> (newChild.getNode()), allocationInformation.mTotalSizeInBytes, true, true);
+		return newChild;
+	});
+}
+
 template<typename DiscriminativeBitsRepresentation, typename PartialKeyType>  inline
 uint16_t HOTRowexNode<DiscriminativeBitsRepresentation, PartialKeyType>::getLeastSignificantDiscriminativeBitForEntry(
 	unsigned int entryIndex) const
@@ -511,7 +689,8 @@ template<typename DiscriminativeBitsRepresentation, typename PartialKeyType> inl
 			maxChildHeight = std::max(maxChildHeight, child.getHeight());
 		}
 	}
-	if(partitionIsCorrect && ((maxChildHeight + 1) != this->mHeight)) {
+	//removing entries from a child node can lower its height without changing the height of this node
+	if(partitionIsCorrect && ((maxChildHeight + 1) > this->mHeight)) {
 		std::cout << "maximum childHeight " << maxChildHeight << " does not match node height " << this->mHeight << std::endl;
 		partitionIsCorrect = false;
 	}
@@ -4,6 +4,7 @@
 #include <iostream>
 
 #include <hot/commons/BiNode.hpp>
+#include <hot/commons/DeletionInformation.hpp>
 #include <hot/commons/DiscriminativeBit.hpp>
 #include <hot/commons/InsertInformation.hpp>
 #include <hot/commons/PartialKeyConversionInformation.hpp>
@@ -130,6 +131,54 @@ public:
 		HOTRowexChildPointer const & newValue
 	);
 
+	/**
+	 * constructs a new node from a given source node by removing one of its entries and optionally replacing the child pointer of another entry
+	 *
+	 * @tparam SourceDiscriminativeBitsRepresentation the discriminative bits representation of the source node
+	 * @tparam SourcePartialKeyType the partial key type used to store partial keys in the source node
+	 * @param sourceNode the source node
+	 * @param height the height of the new node, which is lower than the source node's height in case the removed entry was the only one of maximum height
+	 * @param numberEntries the number of entries to store in the new node. must be the number of entries in the source node - 1
+	 * @param discriminativeBitsRepresentation the discriminative bits information, which is required to distinguish all remaining entries
+	 * @param compressionMask the compression mask which can be used to recode the partial keys from the source representation to the representation for the new node
+	 * @param deletionInformation the deletion information of the entry to remove
+	 * @param indexOfEntryToReplace the index of the entry whose child pointer is replaced. If it is equal to the index of the entry to remove no child pointer is replaced
+	 * @param replacement the new child pointer for the entry at indexOfEntryToReplace
+	 */
+	template<typename SourceDiscriminativeBitsRepresentation, typename SourcePartialKeyType> inline HOTRowexNode(
+		HOTRowexNode<SourceDiscriminativeBitsRepresentation, SourcePartialKeyType> const & sourceNode,
+		uint16_t const height,
+		uint16_t const numberEntries,
+		DiscriminativeBitsRepresentation const & discriminativeBitsRepresentation,
+		SourcePartialKeyType compressionMask,
+		hot::commons::DeletionInformation const & deletionInformation,
+		uint32_t indexOfEntryToReplace,
+		HOTRowexChildPointer const & replacement
+	);
+
+	/**
+	 * constructs a new node containing all entries of two source nodes, which are the two children of the same BiNode in their parent node
+	 *
+	 * @tparam LeftNodeType the type of the node containing the smaller entries
+	 * @tparam RightNodeType the type of the node containing the larger entries
+	 * @param leftNode the node containing the smaller entries
+	 * @param rightNode the node containing the larger entries
+	 * @param numberEntries the number of entries to store in the new node. must be the sum of the number of entries in both source nodes
+	 * @param discriminativeBitsRepresentation the discriminative bits information, which is required to distinguish all entries of both source nodes
+	 * @param leftRecodingMask the mask used to deposit the partial keys of the left node into the partial keys of the new node
+	 * @param rightRecodingMask the mask used to deposit the partial keys of the right node into the partial keys of the new node
+	 * @param rootBitMask the partial key in the new node, which only has the discriminative bit of the BiNode set
+	 */
+	template<typename LeftNodeType, typename RightNodeType> inline HOTRowexNode(
+		LeftNodeType const & leftNode,
+		RightNodeType const & rightNode,
+		uint16_t const numberEntries,
+		DiscriminativeBitsRepresentation const & discriminativeBitsRepresentation,
+		uint32_t leftRecodingMask,
+		uint32_t rightRecodingMask,
+		PartialKeyType rootBitMask
+	);
+
 	/**
 	 * searches the node and returns a potential result candidate by:
 	 * 	1. extracting the discriminative bits of the search key bytes thereby creating a dense partial key
@@ -204,6 +253,45 @@ public:
 		uint32_t firstIndexInRange, uint16_t numberEntriesInRange, hot::commons::InsertInformation const & insertInformation, HOTRowexChildPointer const & newValue
 	) const;
 
+	/**
+	 * Determines the information required to remove an entry from the node.
+	 * The deletion information describes the entry's parent BiNode and the sibling subtree, which replaces this BiNode after the removal.
+	 *
+	 * @param entryIndex the index of the entry to remove
+	 * @return the deletion information
+	 */
+	inline hot::commons::DeletionInformation getDeletionInformation(uint32_t entryIndex) const;
+
+	/**
+	 * This method creates a copy of the existing node without the entry at the given index.
+	 * In case the node only contains two entries, no node is created and the remaining entry is returned.
+	 *
+	 * @param entryIndex the index of the entry to remove
+	 * @return the pointer to the newly created node or the remaining entry
+	 */
+	inline HOTRowexChildPointer removeEntry(uint32_t entryIndex) const;
+
+	/**
+	 * This method creates a copy of the existing node without the entry at the given index and with the child pointer of another entry replaced.
+	 * In case the node only contains two entries, no node is created and the replacement is returned.
+	 *
+	 * @param indexOfEntryToRemove the index of the entry to remove
+	 * @param indexOfEntryToReplace the index of the entry whose child pointer is replaced
+	 * @param replacement the new child pointer for the entry at indexOfEntryToReplace
+	 * @return the pointer to the newly created node or the replacement
+	 */
+	inline HOTRowexChildPointer removeAndReplaceEntry(uint32_t indexOfEntryToRemove, uint32_t indexOfEntryToReplace, HOTRowexChildPointer const & replacement) const;
+
+	/**
+	 * This method creates a new node containing the entries of this node and the entries of its right sibling.
+	 * Both nodes must be the two children of the same BiNode in their parent node.
+	 *
+	 * @param rootBitIndex the absolute bit index of the BiNode's discriminative bit
+	 * @param rightNode the node containing the larger entries
+	 * @return the pointer to the newly created node, or an unused child pointer if the discriminative bits of both nodes cannot be represented in a single node
+	 */
+	template<typename RightNodeType> inline HOTRowexChildPointer mergeWithRightSibling(uint16_t rootBitIndex, RightNodeType const & rightNode) const;
+
 	/**
 	 * For a specific entry it determines the index of its least significant used discriminative bit (thereby representing its parent BiNode)
 	 *
@@ -7,7 +7,7 @@ using namespace std;
 
 #include "masstree.h"
 
-void run(char **argv) {
+void run(int argc, char **argv) {
     std::cout << "Simple Example of P-Masstree" << std::endl;
 
     uint64_t n = std::atoll(argv[1]);
@@ -24,7 +24,20 @@ void run(char **argv) {
     printf("operation,n,ops/s\n");
     masstree::masstree *tree = new masstree::masstree();
 
-    {
+    if (argc == 4 && strcmp(argv[3], "bulk") == 0) {
+        // Build tree from the sorted keys
+        auto starttime = std::chrono::system_clock::now();
+        void **values = new void*[n];
+        for (uint64_t i = 0; i < n; i++) {
+            values[i] = &keys[i];
+        }
+        tree->bulk_load(keys, values, n);
+        auto duration = std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::system_clock::now() - starttime);
+        printf("Throughput: bulk_load,%ld,%f ops/us\n", n, (n * 1.0) / duration.count());
+        printf("Elapsed time: bulk_load,%ld,%f sec\n", n, duration.count() / 1000000.0);
+        delete[] values;
+    } else {
         // Build tree
         auto starttime = std::chrono::system_clock::now();
         tbb::parallel_for(tbb::blocked_range<uint64_t>(0, n), [&](const tbb::blocked_range<uint64_t> &range) {
@@ -62,11 +75,12 @@ void run(char **argv) {
 }
 
 int main(int argc, char **argv) {
-    if (argc != 3) {
-        printf("usage: %s [n] [nthreads]\nn: number of keys (integer)\nnthreads: number of threads (integer)\n", argv[0]);
+    if (argc != 3 && argc != 4) {
+        printf("usage: %s [n] [nthreads] [bulk]\nn: number of keys (integer)\nnthreads: number of threads (integer)\n"
+                "bulk: build the tree with bulk_load instead of inserts (optional)\n", argv[0]);
         return 1;
     }
 
-    run(argv);
+    run(argc, argv);
     return 0;
 }
\ No newline at end of file
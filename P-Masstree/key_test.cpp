@@ -0,0 +1,49 @@
+#include <iostream>
+#include <cstring>
+
+using namespace std;
+
+#include "masstree.h"
+
+int failures = 0;
+
+void check(bool ok, const char *what) {
+    if (!ok) {
+        printf("FAIL: %s\n", what);
+        failures++;
+    }
+}
+
+// Keys that only differ by zero bytes at their end have the same 8-byte slices
+void run_trailing_zero_keys() {
+    masstree::masstree *tree = new masstree::masstree();
+    auto t = tree->getThreadInfo();
+
+    check(tree->put("ab", 2, 1, t), "put(\"ab\", 2)");
+    check(!tree->put("ab\0", 3, 2, t), "put(\"ab\\0\", 3) is rejected");
+    check(tree->get("ab", 2, t) == (void *)1, "get(\"ab\", 2)");
+    check(tree->get("ab\0", 3, t) == NULL, "get(\"ab\\0\", 3)");
+
+    // the same past a full slice, where the second key would need a new layer
+    const char longer[] = "abcdefgh\0\0\0\0\0\0\0\0x";
+    check(tree->put("abcdefgh", 8, 3, t), "put(\"abcdefgh\", 8)");
+    check(!tree->put(longer, sizeof(longer) - 1, 4, t), "put(\"abcdefgh\\0...x\", 17) is rejected");
+    check(tree->get("abcdefgh", 8, t) == (void *)3, "get(\"abcdefgh\", 8)");
+    check(tree->get(longer, sizeof(longer) - 1, t) == NULL, "get(\"abcdefgh\\0...x\", 17)");
+
+    // the zero-terminated form reports the result of the same insert
+    char cstr[] = "abc";
+    check(tree->put(cstr, 5, t), "put(\"abc\")");
+    check(tree->get("abc", 3, t) == (void *)5, "get(\"abc\", 3)");
+}
+
+int main() {
+    run_trailing_zero_keys();
+
+    if (failures != 0) {
+        printf("%d checks failed\n", failures);
+        return 1;
+    }
+    printf("All checks passed\n");
+    return 0;
+}
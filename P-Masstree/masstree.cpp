@@ -2,6 +2,11 @@
 #include "Epoche.cpp"
 
 #include <memory>
+#include <vector>
+#ifdef MASSTREE_SIMD_SEARCH
+#include <immintrin.h>
+#endif
+#include "tbb/parallel_for.h"
 
 using namespace MASS;
 
@@ -208,9 +213,63 @@ int leafnode::compare_key(const uint64_t a, const uint64_t b)
         return a < b ? -1 : 1;
 }
 
+#ifdef MASSTREE_SIMD_SEARCH
+// Compares key with the keys of all slots at once instead of a binary search through the permuter,
+// which is only used to mask out the free slots. Returns the number of keys smaller than key, which
+// is its sorted position, and sets p to the slot holding key, or -1
+int leafnode::key_rank(uint64_t key, const permuter &perm, int &p)
+{
+    uint32_t lt = 0, eq = 0;
+#ifdef USE_AVX512
+    // four entries per vector, the keys are the even lanes
+    const __m512i probe = _mm512_set1_epi64(key);
+    for (int i = 0; i < (LEAF_WIDTH + 3) / 4; i++) {
+        __mmask8 lanes = (LEAF_WIDTH - 4 * i >= 4) ? 0xFF : (__mmask8)((1 << (2 * (LEAF_WIDTH - 4 * i))) - 1);
+        __m512i k = _mm512_maskz_loadu_epi64(lanes, &entry[4 * i]);
+        lt |= (uint32_t)_mm512_mask_cmplt_epu64_mask(lanes & 0x55, k, probe) << (8 * i);
+        eq |= (uint32_t)_mm512_mask_cmpeq_epu64_mask(lanes & 0x55, k, probe) << (8 * i);
+    }
+    lt = _pext_u32(lt, 0x55555555);
+    eq = _pext_u32(eq, 0x55555555);
+#else
+    // four entries per group, their keys are gathered from two vectors as entries 0, 2, 1, 3;
+    // AVX2 only compares signed
+    const __m256i sign = _mm256_set1_epi64x(INT64_MIN);
+    const __m256i probe = _mm256_xor_si256(_mm256_set1_epi64x(key), sign);
+    for (int i = 0; i < (LEAF_WIDTH + 3) / 4; i++) {
+        __m256i lo = _mm256_loadu_si256(reinterpret_cast<const __m256i *> (&entry[4 * i]));
+        __m256i hi;
+        if (4 * i + 3 < LEAF_WIDTH)
+            hi = _mm256_loadu_si256(reinterpret_cast<const __m256i *> (&entry[4 * i + 2]));
+        else
+            hi = _mm256_maskload_epi64(reinterpret_cast<const long long *> (&entry[4 * i + 2]), _mm256_setr_epi64x(-1, -1, 0, 0));
+        __m256i k = _mm256_xor_si256(_mm256_unpacklo_epi64(lo, hi), sign);
+        uint32_t l = _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(probe, k)));
+        uint32_t e = _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(probe, k)));
+        lt |= ((l & 9) | ((l & 2) << 1) | ((l & 4) >> 1)) << (4 * i);
+        eq |= ((e & 9) | ((e & 2) << 1) | ((e & 4) >> 1)) << (4 * i);
+    }
+#endif
+
+    uint64_t x = perm.value();
+    uint32_t live = 0;
+    for (int i = 0; i < permuter::size(x); i++)
+        live |= 1U << ((x >> ((i << 2) + 4)) & LEAF_WIDTH);
+
+    eq &= live;
+    p = eq ? __builtin_ctz(eq) : -1;
+    return __builtin_popcount(lt & live);
+}
+#endif
+
 key_indexed_position leafnode::key_lower_bound_by(uint64_t key)
 {
     permuter perm = permutation;
+#ifdef MASSTREE_SIMD_SEARCH
+    int p;
+    int l = key_rank(key, perm, p);
+    return key_indexed_position(l, p);
+#else
     int l = 0, r = perm.size();
     while (l < r) {
         int m = (l + r) >> 1;
@@ -224,11 +283,18 @@ key_indexed_position leafnode::key_lower_bound_by(uint64_t key)
             l = m + 1;
     }
     return key_indexed_position(l, -1);
+#endif
 }
 
 key_indexed_position leafnode::key_lower_bound(uint64_t key)
 {
     permuter perm = permutation;
+#ifdef MASSTREE_SIMD_SEARCH
+    int p;
+    int l = key_rank(key, perm, p);
+    if (p >= 0)
+        return key_indexed_position(l, p);
+#else
     int l = 0, r = perm.size();
     while (l < r) {
         int m = (l + r) >> 1;
@@ -241,6 +307,7 @@ key_indexed_position leafnode::key_lower_bound(uint64_t key)
         else
             l = m + 1;
     }
+#endif
 
     return (l-1 < 0 ? key_indexed_position(l-1, -1) : key_indexed_position(l-1, perm[l-1]));
 }
@@ -268,7 +335,7 @@ void leafnode::prefetch() const
         prefetch_((const char *) this + i);
 }
 
-leafvalue *masstree::make_leaf(char *key, size_t key_len, uint64_t value)
+leafvalue *masstree::make_leaf(const char *key, size_t key_len, uint64_t value)
 {
     void *aligned_alloc;
     size_t len = (key_len % sizeof(uint64_t)) == 0 ? key_len : (((key_len) / sizeof(uint64_t)) + 1) * sizeof(uint64_t);
@@ -294,29 +361,33 @@ leafvalue *masstree::make_leaf(char *key, size_t key_len, uint64_t value)
     return lv;
 }
 
-leafvalue *leafnode::smallest_leaf(size_t key_len, uint64_t value)
+key_view::key_view(const char *key, size_t key_len)
 {
-    void *aligned_alloc;
-    size_t len = (key_len % sizeof(uint64_t)) == 0 ? key_len : (((key_len) / sizeof(uint64_t)) + 1) * sizeof(uint64_t);
-
-    int ret = posix_memalign(&aligned_alloc, CACHE_LINE_SIZE, sizeof(leafvalue) + len);
-    if (ret != 0) {
-        printf("%s Allocation error by posix_memalign\n", __func__);
-        exit(ret);
+    size_t words = aligned_len(key_len) / sizeof(uint64_t);
+    uint64_t *slices = buf;
+    if (key_len > INLINE_KEY_LEN) {
+        slices = reinterpret_cast<uint64_t *> (malloc(sizeof(leafvalue) + (words + 1) * sizeof(uint64_t)));
+        if (slices == NULL) {
+            printf("%s Allocation error by malloc\n", __func__);
+            exit(1);
+        }
     }
 
-    leafvalue *lv = reinterpret_cast<leafvalue *> (aligned_alloc);
-    memset(lv, 0, sizeof(leafvalue) + len);
-
-    lv->value = value;
-    lv->key_len = key_len;          // key_len or len??
-
-    for (uint64_t i = 0; i < (len / sizeof(uint64_t)); i++)
-        lv->fkey[i] = 0ULL;
+    lv = reinterpret_cast<leafvalue *> (slices);
+    lv->value = 0;
+    lv->key_len = key_len;
+    for (size_t i = 0; i < words; i++) {
+        uint64_t slice = 0;
+        memcpy(&slice, key + i * sizeof(uint64_t), std::min(sizeof(uint64_t), key_len - i * sizeof(uint64_t)));
+        lv->fkey[i] = __builtin_bswap64(slice);
+    }
+    lv->fkey[words] = 0;
+}
 
-    if (value != 0)
-        clflush((char *) lv, sizeof(leafvalue) + len, false, true);
-    return lv;
+key_view::~key_view()
+{
+    if (lv != reinterpret_cast<leafvalue *> (buf))
+        free(lv);
 }
 
 void leafnode::make_new_layer(leafnode *l, key_indexed_position &kx_, leafvalue *olv,
@@ -512,14 +583,22 @@ leaf_retry:
     }
 }
 
-void masstree::put(char *key, uint64_t value, ThreadInfo &threadEpocheInfo)
+bool masstree::put(char *key, uint64_t value, ThreadInfo &threadEpocheInfo)
+{
+    return put(key, strlen(key), value, threadEpocheInfo);
+}
+
+bool masstree::put(const char *key, size_t key_len, uint64_t value, ThreadInfo &threadEpocheInfo)
 {
+    if (memchr(key, 0, key_len) != NULL)
+        return false;
+
     EpocheGuard epocheGuard(threadEpocheInfo);
     void *root = NULL;
     key_indexed_position kx_;
     uint32_t depth = 0;
     leafnode *next = NULL, *p = NULL;
-    leafvalue *lv = make_leaf(key, strlen(key), value);
+    leafvalue *lv = make_leaf(key, key_len, value);
     void *snapshot_v = NULL;
 
     int needRestart;
@@ -629,9 +708,10 @@ leaf_retry:
         }
     } else {
         if (!(l->leaf_insert(this, root, depth, lv, lv->fkey[depth], SET_LV(lv), kx_))) {
-            put(key, value, threadEpocheInfo);
+            return put(key, key_len, value, threadEpocheInfo);
         }
     }
+    return true;
 }
 
 void masstree::del(uint64_t key, ThreadInfo &threadEpocheInfo)
@@ -734,6 +814,11 @@ leaf_retry:
 }
 
 void masstree::del(char *key, ThreadInfo &threadEpocheInfo)
+{
+    del(key, strlen(key), threadEpocheInfo);
+}
+
+void masstree::del(const char *key, size_t key_len, ThreadInfo &threadEpocheInfo)
 {
     EpocheGuard epocheGuard(threadEpocheInfo);
     void *root = NULL;
@@ -742,8 +827,7 @@ void masstree::del(char *key, ThreadInfo &threadEpocheInfo)
     leafnode *next = NULL;
     void *snapshot_v = NULL;
 
-    auto customDeleter = [](leafvalue *lv) { free(lv); };
-    std::unique_ptr<leafvalue, decltype(customDeleter)> lv(make_leaf(key, strlen(key), 0), customDeleter);
+    key_view lv(key, key_len);
 
     int needRestart;
     uint64_t v;
@@ -840,7 +924,7 @@ leaf_retry:
         } else if (IS_LV(l->value(kx_.p)) && (LV_PTR(l->value(kx_.p)))->key_len == lv->key_len &&
                 memcmp(lv->fkey, (LV_PTR(l->value(kx_.p)))->fkey, aligned_len(lv->key_len)) == 0) {
             if (!(l->leaf_delete(this, root, depth, lv.get(), kx_, threadEpocheInfo))) {
-                del(key, threadEpocheInfo);
+                del(key, key_len, threadEpocheInfo);
             }
         } else {
             l->writeUnlock(false);
@@ -1794,6 +1878,11 @@ leaf_retry:
 }
 
 void *masstree::get(char *key, ThreadInfo &threadEpocheInfo)
+{
+    return get(key, strlen(key), threadEpocheInfo);
+}
+
+void *masstree::get(const char *key, size_t key_len, ThreadInfo &threadEpocheInfo)
 {
     EpocheGuard epocheGuard(threadEpocheInfo);
     void *root = NULL;
@@ -1805,8 +1894,7 @@ void *masstree::get(char *key, ThreadInfo &threadEpocheInfo)
     int needRestart;
     uint64_t v;
 
-    auto customDeleter = [](leafvalue *lv) { free(lv); };
-    std::unique_ptr<leafvalue, decltype(customDeleter)> lv(make_leaf(key, strlen(key), 0), customDeleter);
+    key_view lv(key, key_len);
 
 restart:
     depth = 0;
@@ -1926,8 +2014,10 @@ leaf_retry:
     }
 }
 
-void leafnode::get_range(leafvalue * &lv, int num, int &count, uint64_t *buf, leafnode *root, uint32_t depth)
+// Copies the values of the layer rooted at root from lv on, or from its smallest key if lv is NULL
+void leafnode::get_range(const leafvalue *lv, int num, int &count, uint64_t *buf, leafnode *root, uint32_t depth)
 {
+    uint64_t min = lv != NULL ? lv->fkey[depth] : 0;
     key_indexed_position kx_;
     leafnode *next = NULL;
     void *snapshot_v = NULL, *snapshot_n = NULL;
@@ -1942,7 +2032,7 @@ restart:
     leafnode *p = root;
     while (p->level() != 0) {
 inter_retry:
-        next = p->advance_to_key(lv->fkey[depth]);
+        next = p->advance_to_key(min);
         if (next != p) {
             p = next;
             goto inter_retry;
@@ -1959,7 +2049,7 @@ inter_retry:
         p->prefetch();
         fence();
 
-        kx_ = p->key_lower_bound(lv->fkey[depth]);
+        kx_ = p->key_lower_bound(min);
 
         if (kx_.i >= 0)
             snapshot_v = p->value(kx_.p);
@@ -1994,20 +2084,18 @@ leaf_retry:
         for (int i = 0; i < perm.size() && count < num; i++) {
             snapshot_v = l->value(perm[i]);
             if (!IS_LV(l->value(perm[i]))) {
-                if (l->key(perm[i]) > lv->fkey[depth]) {
+                if (lv == NULL || l->key(perm[i]) > min) {
                     p = reinterpret_cast<leafnode *> (snapshot_v);
-                    leafvalue *smallest = p->smallest_leaf(lv->key_len, lv->value);
-                    p->get_range(smallest, num, count, buf, p, depth + 1);
-                    free(smallest);
-                } else if (l->key(perm[i]) == lv->fkey[depth]) {
+                    p->get_range(NULL, num, count, buf, p, depth + 1);
+                } else if (l->key(perm[i]) == min) {
                     p = reinterpret_cast<leafnode *> (snapshot_v);
                     p->get_range(lv, num, count, buf, p, depth + 1);
                 }
             } else {
                 snapshot_v = (LV_PTR(snapshot_v));
-                if (l->key(perm[i]) > lv->fkey[depth]) {
+                if (lv == NULL || l->key(perm[i]) > min) {
                     buf[count++] = reinterpret_cast<leafvalue *> (snapshot_v)->value;
-                } else if (l->key(perm[i]) == lv->fkey[depth] && keycmp((LV_PTR(l->value(perm[i])))->fkey, lv->fkey, lv->key_len) >= 0) {
+                } else if (l->key(perm[i]) == min && keycmp((LV_PTR(l->value(perm[i])))->fkey, lv->fkey, lv->key_len) >= 0) {
                     buf[count++] = reinterpret_cast<leafvalue *> (snapshot_v)->value;
                 }
             }
@@ -2027,6 +2115,11 @@ leaf_retry:
 }
 
 int masstree::scan(char *min, int num, uint64_t *buf, ThreadInfo &threadEpocheInfo)
+{
+    return scan(min, strlen(min), num, buf, threadEpocheInfo);
+}
+
+int masstree::scan(const char *min, size_t min_len, int num, uint64_t *buf, ThreadInfo &threadEpocheInfo)
 {
     EpocheGuard epocheGuard(threadEpocheInfo);
     void *root = NULL;
@@ -2037,7 +2130,7 @@ int masstree::scan(char *min, int num, uint64_t *buf, ThreadInfo &threadEpocheIn
     permuter perm;
     int count, backup;
 
-    leafvalue *lv = make_leaf(min, strlen(min), 0);
+    key_view lv(min, min_len);
 
     int needRestart;
     uint64_t v;
@@ -2103,12 +2196,10 @@ leaf_retry:
             if (!IS_LV(l->value(perm[i]))) {
                 if (l->key(perm[i]) > lv->fkey[depth]) {
                     p = reinterpret_cast<leafnode *> (snapshot_v);
-                    leafvalue *smallest = p->smallest_leaf(lv->key_len, lv->value);
-                    p->get_range(smallest, num, count, buf, p, depth + 1);
-                    free(smallest);
+                    p->get_range(NULL, num, count, buf, p, depth + 1);
                 } else if (l->key(perm[i]) == lv->fkey[depth]) {
                     p = reinterpret_cast<leafnode *> (snapshot_v);
-                    p->get_range(lv, num, count, buf, p, depth + 1);
+                    p->get_range(lv.get(), num, count, buf, p, depth + 1);
                 }
             } else {
                 snapshot_v = (LV_PTR(snapshot_v));
@@ -2132,7 +2223,6 @@ leaf_retry:
         }
     }
 
-    free(lv);
     return count;
 }
 
@@ -2227,4 +2317,428 @@ leaf_retry:
     return count;
 }
 
+void leafnode::bulk_assign(const uint64_t *keys, void *const *values, int num, uint64_t highest, leafnode *leftmost, leafnode *next)
+{
+    for (int i = 0; i < num; i++)
+        assign_initialize(i, keys[i], values[i]);
+    permutation = permuter::make_sorted(num);
+    this->highest = highest;
+    leftmost_ptr = leftmost;
+    this->next.store(next, std::memory_order_release);
+}
+
+leafnode *masstree::build_layer(const uint64_t *keys, void *const *values, uint64_t num)
+{
+    if (num == 0) {
+        leafnode *l = new leafnode(0);
+        clflush((char *)l, sizeof(leafnode), false, true);
+        return l;
+    }
+
+    // leaf level: full nodes, lows[i] is the smallest key below nodes[i]
+    uint64_t count = (num + LEAF_WIDTH - 1) / LEAF_WIDTH;
+    std::vector<leafnode *> nodes(count);
+    std::vector<uint64_t> lows(count);
+
+    tbb::parallel_for(tbb::blocked_range<uint64_t>(0, count), [&](const tbb::blocked_range<uint64_t> &range) {
+        for (uint64_t i = range.begin(); i != range.end(); i++)
+            nodes[i] = new leafnode(0);
+    });
+    tbb::parallel_for(tbb::blocked_range<uint64_t>(0, count), [&](const tbb::blocked_range<uint64_t> &range) {
+        for (uint64_t i = range.begin(); i != range.end(); i++) {
+            uint64_t start = i * LEAF_WIDTH;
+            int n = (int)std::min<uint64_t>(LEAF_WIDTH, num - start);
+            lows[i] = keys[start];
+            nodes[i]->bulk_assign(&keys[start], &values[start], n, i == 0 ? 0 : keys[start], NULL,
+                    i + 1 < count ? nodes[i + 1] : NULL);
+            clflush((char *)nodes[i], sizeof(leafnode), false, false);
+        }
+        mfence();
+    });
+
+    // interior levels: LEAF_WIDTH + 1 children per node, the leftmost one in leftmost_ptr
+    uint32_t level = 0;
+    while (nodes.size() > 1) {
+        level++;
+        uint64_t children = nodes.size();
+        count = (children + LEAF_WIDTH) / (LEAF_WIDTH + 1);
+        std::vector<leafnode *> parents(count);
+        std::vector<uint64_t> parent_lows(count);
+
+        tbb::parallel_for(tbb::blocked_range<uint64_t>(0, count), [&](const tbb::blocked_range<uint64_t> &range) {
+            for (uint64_t i = range.begin(); i != range.end(); i++)
+                parents[i] = new leafnode(level);
+        });
+        tbb::parallel_for(tbb::blocked_range<uint64_t>(0, count), [&](const tbb::blocked_range<uint64_t> &range) {
+            for (uint64_t i = range.begin(); i != range.end(); i++) {
+                uint64_t start = i * (LEAF_WIDTH + 1);
+                int n = (int)std::min<uint64_t>(LEAF_WIDTH + 1, children - start);
+                parent_lows[i] = lows[start];
+                parents[i]->bulk_assign(&lows[start + 1], reinterpret_cast<void *const *>(&nodes[start + 1]), n - 1,
+                        i == 0 ? 0 : lows[start], nodes[start], i + 1 < count ? parents[i + 1] : NULL);
+                clflush((char *)parents[i], sizeof(leafnode), false, false);
+            }
+            mfence();
+        });
+
+        nodes.swap(parents);
+        lows.swap(parent_lows);
+    }
+
+    return nodes[0];
+}
+
+leafnode *masstree::bulk_load_layer(leafvalue **lvs, uint64_t num, uint32_t depth)
+{
+    // one entry per distinct key slice of this layer, keys sharing a slice go to a new layer
+    std::vector<uint64_t> slices;
+    std::vector<void *> values;
+    std::vector<uint64_t> layers, starts, ends;
+
+    for (uint64_t i = 0; i < num; ) {
+        uint64_t j = i + 1;
+        while (j < num && lvs[j]->fkey[depth] == lvs[i]->fkey[depth])
+            j++;
+        slices.push_back(lvs[i]->fkey[depth]);
+        values.push_back(SET_LV(lvs[i]));
+        if (j - i > 1) {
+            layers.push_back(values.size() - 1);
+            starts.push_back(i);
+            ends.push_back(j);
+        }
+        i = j;
+    }
+
+    tbb::parallel_for(tbb::blocked_range<uint64_t>(0, layers.size()), [&](const tbb::blocked_range<uint64_t> &range) {
+        for (uint64_t i = range.begin(); i != range.end(); i++)
+            values[layers[i]] = bulk_load_layer(&lvs[starts[i]], ends[i] - starts[i], depth + 1);
+    });
+
+    return build_layer(slices.data(), values.data(), slices.size());
+}
+
+bool masstree::bulk_load_empty()
+{
+    leafnode *r = reinterpret_cast<leafnode *> (this->root());
+    if (r->level() != 0 || r->permute().size() != 0) {
+        printf("[bulk_load] the tree is not empty\n");
+        return false;
+    }
+    return true;
+}
+
+void masstree::install_bulk_root(leafnode *new_root)
+{
+    leafnode *old = reinterpret_cast<leafnode *> (this->root());
+    setNewRoot(new_root);
+    delete old;
+}
+
+bool masstree::bulk_load(const uint64_t *keys, void *const *values, uint64_t num)
+{
+    if (!bulk_load_empty())
+        return false;
+
+    install_bulk_root(build_layer(keys, values, num));
+    return true;
+}
+
+bool masstree::bulk_load(char *const *keys, const uint64_t *values, uint64_t num)
+{
+    if (!bulk_load_empty())
+        return false;
+
+    std::vector<leafvalue *> lvs(num);
+    tbb::parallel_for(tbb::blocked_range<uint64_t>(0, num), [&](const tbb::blocked_range<uint64_t> &range) {
+        for (uint64_t i = range.begin(); i != range.end(); i++)
+            lvs[i] = make_leaf(keys[i], strlen(keys[i]), values[i]);
+    });
+
+    install_bulk_root(bulk_load_layer(lvs.data(), num, 0));
+    return true;
+}
+
+cursor::cursor(masstree *t, ThreadInfo &threadEpocheInfo)
+    : tree(t), epocheGuard(threadEpocheInfo), string_keys(false), valid_(false), resume_inclusive(true),
+      key_(0), value_(NULL), has_end(false), end_(0)
+{
+}
+
+cursor::~cursor()
+{
+}
+
+// Returns the leaf of the layer rooted at root that covers key, or NULL if an obsolete node was met
+leafnode *cursor::find_leaf(void *root, uint64_t key)
+{
+    key_indexed_position kx_;
+    leafnode *next = NULL;
+    void *snapshot_v = NULL;
+
+    int needRestart;
+    uint64_t v;
+
+    leafnode *p = reinterpret_cast<leafnode *> (root);
+    while (p->level() != 0) {
+inter_retry:
+        next = p->advance_to_key(key);
+        if (next != p) {
+            p = next;
+            goto inter_retry;
+        }
+
+        v = p->readLockOrRestart(needRestart);
+        if (needRestart) {
+            if (needRestart == LOCKED)
+                goto inter_retry;
+            else
+                return NULL;
+        }
+
+        p->prefetch();
+        fence();
+
+        kx_ = p->key_lower_bound(key);
+
+        if (kx_.i >= 0)
+            snapshot_v = p->value(kx_.p);
+        else
+            snapshot_v = p->leftmost();
+
+        p->checkOrRestart(v, needRestart);
+        if (needRestart)
+            goto inter_retry;
+        else
+            p = reinterpret_cast<leafnode *> (snapshot_v);
+    }
+
+    while ((next = p->advance_to_key(key)) != p)
+        p = next;
+    return p;
+}
+
+// Copies the sorted entries of l above bound into f, returns false if l is obsolete
+bool cursor::load(frame &f, leafnode *l, uint64_t bound, bool inclusive)
+{
+    int needRestart;
+    uint64_t v;
+
+leaf_retry:
+    v = l->readLockOrRestart(needRestart);
+    if (needRestart) {
+        if (needRestart == LOCKED)
+            goto leaf_retry;
+        else
+            return false;
+    }
+
+    l->prefetch();
+    fence();
+
+    permuter perm = l->permute();
+    f.count = 0;
+    for (int i = 0; i < perm.size(); i++) {
+        uint64_t k = l->key(perm[i]);
+        if (k > bound || (inclusive && k == bound)) {
+            f.keys[f.count] = k;
+            f.values[f.count] = l->value(perm[i]);
+            f.count++;
+        }
+    }
+
+    l->checkOrRestart(v, needRestart);
+    if (needRestart)
+        goto leaf_retry;
+
+    f.leaf = l;
+    f.bound = bound;
+    f.inclusive = inclusive;
+    f.pos = 0;
+    return true;
+}
+
+// Moves from the current frame position to the next key/value pair
+void cursor::settle()
+{
+    int needRestart;
+
+    while (!stack.empty()) {
+        frame &f = stack.back();
+
+        if (f.pos < f.count) {
+            void *v = f.values[f.pos];
+            if (string_keys && !IS_LV(v)) {
+                // keys sharing this slice continue in the next layer
+                frame nf;
+                leafnode *l = find_leaf(v, 0);
+                if (l == NULL || !load(nf, l, 0, true)) {
+                    reseek();
+                    return;
+                }
+                stack.push_back(nf);
+                continue;
+            }
+
+            if (string_keys) {
+                leafvalue *lv = LV_PTR(v);
+                size_t words = aligned_len(lv->key_len) / sizeof(uint64_t);
+                skey_.resize(words * sizeof(uint64_t));
+                for (size_t i = 0; i < words; i++) {
+                    uint64_t w = __builtin_bswap64(lv->fkey[i]);
+                    memcpy(&skey_[i * sizeof(uint64_t)], &w, sizeof(uint64_t));
+                }
+                skey_.resize(lv->key_len);
+                value_ = (void *)lv->value;
+                valid_ = !has_end || skey_ < send_;
+            } else {
+                key_ = f.keys[f.pos];
+                value_ = v;
+                valid_ = !has_end || key_ < end_;
+            }
+
+            if (valid_)
+                resume_inclusive = false;
+            else
+                stack.clear();
+            return;
+        }
+
+        // end of the leaf: continue with the right sibling, skipping the keys already returned
+        // if the leaf was split after it was copied
+        l_retry:
+        f.leaf->readLockOrRestart(needRestart);
+        if (needRestart == LOCKED)
+            goto l_retry;
+        if (needRestart == OBSOLETE) {
+            reseek();
+            return;
+        }
+
+        leafnode *n = f.leaf->next_();
+        if (n == NULL) {
+            stack.pop_back();
+            if (!stack.empty())
+                stack.back().pos++;
+            continue;
+        }
+
+        uint64_t bound = f.count > 0 ? f.keys[f.count - 1] : f.bound;
+        bool inclusive = f.count > 0 ? false : f.inclusive;
+        if (!load(f, n, bound, inclusive)) {
+            reseek();
+            return;
+        }
+    }
+
+    valid_ = false;
+}
+
+// Descends from the root again after a leaf on the way was removed
+void cursor::reseek()
+{
+    if (string_keys) {
+        std::string key = skey_;
+        seek_layers(key, resume_inclusive);
+    } else {
+        seek(key_, resume_inclusive);
+    }
+}
+
+void cursor::seek(uint64_t key, bool inclusive)
+{
+    string_keys = false;
+    key_ = key;
+    resume_inclusive = inclusive;
+    valid_ = false;
+
+    while (true) {
+        frame f;
+        stack.clear();
+        leafnode *l = find_leaf(tree->root(), key);
+        if (l != NULL && load(f, l, key, inclusive)) {
+            stack.push_back(f);
+            break;
+        }
+    }
+
+    settle();
+}
+
+void cursor::seek_layers(const std::string &key, bool inclusive)
+{
+    // slices as stored in the tree, followed by zero words
+    size_t words = aligned_len(key.size()) / sizeof(uint64_t);
+    std::vector<uint64_t> fkey(words + 2, 0);
+    memcpy(fkey.data(), key.data(), key.size());
+    for (size_t i = 0; i < words; i++)
+        fkey[i] = __builtin_bswap64(fkey[i]);
+
+    string_keys = true;
+    skey_ = key;
+    resume_inclusive = inclusive;
+    valid_ = false;
+
+restart:
+    stack.clear();
+    void *root = tree->root();
+    for (size_t depth = 0; depth < fkey.size(); depth++) {
+        frame f;
+        leafnode *l = find_leaf(root, fkey[depth]);
+        if (l == NULL || !load(f, l, fkey[depth], true))
+            goto restart;
+        stack.push_back(f);
+
+        frame &top = stack.back();
+        if (top.count == 0 || top.keys[0] != fkey[depth])
+            break;
+
+        void *v = top.values[0];
+        if (!IS_LV(v) && depth + 1 < fkey.size()) {
+            root = v;
+            continue;
+        }
+        if (IS_LV(v)) {
+            // same slice: order by the full key, a shorter key being the smaller one
+            leafvalue *lv = LV_PTR(v);
+            size_t lwords = aligned_len(lv->key_len) / sizeof(uint64_t);
+            int cmp = keycmp(lv->fkey, fkey.data(), std::min(lwords, words) * sizeof(uint64_t));
+            if (cmp == 0)
+                cmp = lv->key_len < key.size() ? -1 : (lv->key_len > key.size() ? 1 : 0);
+            if (cmp < 0 || (cmp == 0 && !inclusive))
+                top.pos++;
+        }
+        break;
+    }
+
+    settle();
+}
+
+void cursor::seek(const char *key, size_t key_len, bool inclusive)
+{
+    seek_layers(std::string(key, key_len), inclusive);
+}
+
+void cursor::set_end(uint64_t end)
+{
+    has_end = true;
+    end_ = end;
+}
+
+void cursor::set_end(const char *end, size_t end_len)
+{
+    has_end = true;
+    send_.assign(end, end_len);
+}
+
+bool cursor::next()
+{
+    if (!valid_)
+        return false;
+
+    valid_ = false;
+    stack.back().pos++;
+    settle();
+    return valid_;
+}
+
 }
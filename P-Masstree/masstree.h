@@ -9,6 +9,8 @@
 #include <mutex>
 #include <atomic>
 #include <assert.h>
+#include <string>
+#include <vector>
 #include <emmintrin.h>
 #ifdef LOCK_INIT
 #include "tbb/concurrent_vector.h"
@@ -50,6 +52,30 @@ typedef struct leafvalue {
     uint64_t fkey[];
 } leafvalue;
 
+/**
+ * Key of a get, del or scan: the key bytes as big-endian 8-byte slices in the layout of a leafvalue,
+ * followed by a zero slice. Keys of up to INLINE_KEY_LEN bytes are sliced into a buffer on the stack,
+ * so reading a string key does not allocate; longer keys fall back to the heap.
+ */
+class key_view {
+    public:
+        static constexpr size_t INLINE_KEY_LEN = 256;
+
+        key_view(const char *key, size_t key_len);
+
+        key_view(const key_view &) = delete;
+
+        ~key_view();
+
+        leafvalue *get() const {return lv;}
+
+        leafvalue *operator->() const {return lv;}
+
+    private:
+        leafvalue *lv;
+        uint64_t buf[(sizeof(leafvalue) + INLINE_KEY_LEN) / sizeof(uint64_t) + 1];
+};
+
 typedef struct key_indexed_position {
     int i;
     int p;
@@ -60,11 +86,21 @@ typedef struct key_indexed_position {
     }
 } key_indexed_position;
 
+class leafnode;
+
 class masstree {
     private:
         std::atomic<void *> root_;
 
         MASS::Epoche epoche{256};
+
+        leafnode *build_layer(const uint64_t *keys, void *const *values, uint64_t num);
+
+        leafnode *bulk_load_layer(leafvalue **lvs, uint64_t num, uint32_t depth);
+
+        bool bulk_load_empty();
+
+        void install_bulk_root(leafnode *new_root);
     public:
         masstree();
 
@@ -83,25 +119,50 @@ class masstree {
 
         void put(uint64_t key, void *value, MASS::ThreadInfo &threadEpocheInfo);
 
-        void put(char *key, uint64_t value, MASS::ThreadInfo &threadEpocheInfo);
+        /** String key insert of a zero-terminated key; returns the result of the put below */
+        bool put(char *key, uint64_t value, MASS::ThreadInfo &threadEpocheInfo);
+
+        /**
+         * String key insert with the key length given. Keys are compared by their zero-padded 8-byte
+         * slices, so a key must not contain zero bytes (it could not be told apart from the same key
+         * with more zero bytes at its end); returns false without inserting such a key.
+         */
+        bool put(const char *key, size_t key_len, uint64_t value, MASS::ThreadInfo &threadEpocheInfo);
 
         void del(uint64_t key, MASS::ThreadInfo &threadEpocheInfo);
 
         void del(char *key, MASS::ThreadInfo &threadEpocheInfo);
 
+        void del(const char *key, size_t key_len, MASS::ThreadInfo &threadEpocheInfo);
+
         void *get(uint64_t key, MASS::ThreadInfo &threadEpocheInfo);
 
         void *get(char *key, MASS::ThreadInfo &threadEpocheInfo);
 
+        /** String key lookup with the key length given, a key with zero bytes is never found (see put) */
+        void *get(const char *key, size_t key_len, MASS::ThreadInfo &threadEpocheInfo);
+
         void split(void *left, void *root, uint32_t depth, leafvalue *lv, uint64_t key, void *right, uint32_t level, void *child, bool isOverWrite);
 
         int merge(void *left, void *root, uint32_t depth, leafvalue *lv, uint64_t key, uint32_t level, MASS::ThreadInfo &threadInfo);
 
-        leafvalue *make_leaf(char *key, size_t key_len, uint64_t value);
+        leafvalue *make_leaf(const char *key, size_t key_len, uint64_t value);
 
         int scan(uint64_t min, int num, uint64_t *buf, MASS::ThreadInfo &threadEpocheInfo);
 
         int scan(char *min, int num, uint64_t *buf, MASS::ThreadInfo &threadEpocheInfo);
+
+        int scan(const char *min, size_t min_len, int num, uint64_t *buf, MASS::ThreadInfo &threadEpocheInfo);
+
+        /**
+         * Bulk loading into an empty tree: keys have to be sorted in ascending order and unique.
+         * Full leaf nodes are packed sequentially and the interior levels are built bottom-up,
+         * each node is flushed once after it is filled. Must not run concurrently with other
+         * operations on the tree. Returns false if the tree is not empty.
+         */
+        bool bulk_load(const uint64_t *keys, void *const *values, uint64_t num);
+
+        bool bulk_load(char *const *keys, const uint64_t *values, uint64_t num);
 };
 
 class permuter {
@@ -367,6 +428,10 @@ class leafnode {
 
         key_indexed_position key_lower_bound(uint64_t key);
 
+#ifdef MASSTREE_SIMD_SEARCH
+        int key_rank(uint64_t key, const permuter &perm, int &p);
+#endif
+
         bool isLocked(uint64_t version) const;
 
         void writeLock();
@@ -409,6 +474,8 @@ class leafnode {
 
         void split_into_inter(leafnode *nr, uint64_t& split_key);
 
+        void bulk_assign(const uint64_t *keys, void *const *values, int num, uint64_t highest, leafnode *leftmost, leafnode *next);
+
         void *leaf_insert(masstree *t, void *root, uint32_t depth, leafvalue *lv, uint64_t key, void *value, key_indexed_position &kx_);
 
         void *leaf_delete(masstree *t, void *root, uint32_t depth, leafvalue *lv, key_indexed_position &kx_, MASS::ThreadInfo &threadInfo);
@@ -439,12 +506,93 @@ class leafnode {
 
         void check_for_recovery(masstree *t, leafnode *left, leafnode *right, void *root, uint32_t depth, leafvalue *lv);
 
-        void get_range(leafvalue * &lv, int num, int &count, uint64_t *buf, leafnode *root, uint32_t depth);
-
-        leafvalue *smallest_leaf(size_t key_len, uint64_t value);
+        void get_range(const leafvalue *lv, int num, int &count, uint64_t *buf, leafnode *root, uint32_t depth);
 
         leafnode *search_for_leftsibling(std::atomic<void*> *root1, void **root, uint64_t key, uint32_t level, leafnode *right);
 };
 
+/**
+ * Range scan cursor
+ *
+ * Walks the next chain of the leaf nodes, copying the entries of one leaf at a time under an
+ * optimistic version check, and returns key/value pairs in ascending key order. The tree is only
+ * descended from the root by seek() and when a leaf was removed in between, in which case the
+ * scan is continued after the last returned key. A cursor is either used with integer keys or
+ * with string keys, where it also walks the layers of keys sharing an 8-byte slice.
+ *
+ * The cursor keeps the calling thread in an epoch while it is alive, so the leaf nodes it refers
+ * to stay valid between calls; the thread must not run other operations on the tree meanwhile.
+ * To resume a scan later, seek to the last returned key with inclusive = false.
+ */
+class cursor {
+    private:
+        struct frame {
+            leafnode *leaf;
+            uint64_t bound;
+            bool inclusive;
+            int count;
+            int pos;
+            uint64_t keys[LEAF_WIDTH];
+            void *values[LEAF_WIDTH];
+        };
+
+        masstree *tree;
+        MASS::EpocheGuard epocheGuard;
+        bool string_keys;
+
+        // one frame per layer, stack.back() holds the current entry
+        std::vector<frame> stack;
+        bool valid_;
+        bool resume_inclusive;
+
+        uint64_t key_;
+        void *value_;
+        std::string skey_;
+
+        bool has_end;
+        uint64_t end_;
+        std::string send_;
+
+        static leafnode *find_leaf(void *root, uint64_t key);
+
+        bool load(frame &f, leafnode *l, uint64_t bound, bool inclusive);
+
+        void settle();
+
+        void reseek();
+
+        void seek_layers(const std::string &key, bool inclusive);
+
+    public:
+        cursor(masstree *t, MASS::ThreadInfo &threadEpocheInfo);
+
+        cursor(const cursor &) = delete;
+
+        ~cursor();
+
+        /** Positions the cursor at the first key >= key, or > key if !inclusive */
+        void seek(uint64_t key, bool inclusive = true);
+
+        /** String keys are given with their length, so that seek(0) is the integer overload */
+        void seek(const char *key, size_t key_len, bool inclusive = true);
+
+        /** Exclusive upper bound, the cursor becomes invalid at the first key >= end */
+        void set_end(uint64_t end);
+
+        void set_end(const char *end, size_t end_len);
+
+        bool valid() const {return valid_;}
+
+        /** Advances to the next key, returns valid() */
+        bool next();
+
+        uint64_t key() const {return key_;}
+
+        const std::string &string_key() const {return skey_;}
+
+        /** The value as stored by put(), i.e. the uint64_t value for string keys */
+        void *value() const {return value_;}
+};
+
 }
 #endif
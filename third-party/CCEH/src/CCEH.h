@@ -59,6 +59,10 @@ struct Directory {
   size_t capacity;
   bool lock;
   int sema = 0 ;
+#ifdef CCEH_LOCKFREE
+  size_t depth = 0;               // global depth
+  Directory* doubled = nullptr;   // the next directory while doubling
+#endif
 
   Directory(void) {
     capacity = kDefaultDirectorySize;
@@ -114,8 +118,16 @@ class CCEH : public Hash {
     }
 
   private:
+#ifdef CCEH_LOCKFREE
+    // The directory is replaced as a whole when it is doubled,
+    // so it also holds the global depth
+    Directory* dir;
+    Directory* Double(Directory*);
+    bool UpdateDirectory(Directory*, Segment*, Segment**, size_t);
+#else
     size_t global_depth;
     Directory dir;
+#endif
 };
 
 #endif  // EXTENDIBLE_PTR_H_
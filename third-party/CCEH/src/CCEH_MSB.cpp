@@ -45,9 +45,10 @@ int Segment::Insert(Key_t& key, Value_t value, size_t loc, size_t key_hash) {
   if ((key_hash >> (8*sizeof(key_hash)-local_depth)) != pattern) return 2;
   auto lock = sema;
   int ret = 1;
-  while (!CAS(&sema, &lock, lock+1)) {
-    lock = sema;
-  }
+  do {
+    // the segment is being split
+    if (lock == -1) return 2;
+  } while (!CAS(&sema, &lock, lock+1));
   Key_t LOCK = INVALID;
   for (unsigned i = 0; i < kNumPairPerCacheLine * kNumCacheLine; ++i) {
     auto slot = (loc + i) % kNumSlot;
@@ -126,7 +127,123 @@ Segment** Segment::Split(void) {
 #endif
 }
 
+#ifdef CCEH_LOCKFREE
+#ifdef INPLACE
+#error "CCEH_LOCKFREE requires copy-on-write segment splits"
+#endif
+
+// While a directory is doubled, its entries are frozen by setting the
+// lowest bit of the segment pointer before they are copied
+static inline bool IsFrozen(Segment* s) {
+  return (uintptr_t)s & 1;
+}
+
+static inline Segment* Unfreeze(Segment* s) {
+  return (Segment*)((uintptr_t)s & ~(uintptr_t)1);
+}
+
+static inline Segment* LoadEntry(Segment** entry) {
+  return __atomic_load_n(entry, __ATOMIC_ACQUIRE);
+}
+
+static inline bool CASEntry(Segment** entry, Segment** expected, Segment* desired) {
+  return __atomic_compare_exchange_n(entry, expected, desired, false,
+      __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+}
 
+CCEH::CCEH(void)
+: dir{new Directory(1)}
+{
+  for (unsigned i = 0; i < dir->capacity; ++i) {
+    dir->_[i] = new Segment(dir->depth);
+    dir->_[i]->pattern = i;
+  }
+}
+
+CCEH::CCEH(size_t initCap)
+: dir{new Directory(initCap)}
+{
+  dir->depth = static_cast<size_t>(log2(initCap));
+  for (unsigned i = 0; i < dir->capacity; ++i) {
+    dir->_[i] = new Segment(dir->depth);
+    dir->_[i]->pattern = i;
+  }
+}
+
+// Old directories and segments are not freed, readers might still use them
+CCEH::~CCEH(void)
+{ }
+
+// Doubles the directory d, or helps the thread that started doubling it.
+// Every entry is frozen and copied into two entries of the new directory,
+// which is persisted before it replaces d. Copies are only written into
+// empty entries, so late helpers cannot undo splits in the new directory.
+Directory* CCEH::Double(Directory* d) {
+  auto next = __atomic_load_n(&d->doubled, __ATOMIC_ACQUIRE);
+  if (next == nullptr) {
+    auto _dir = new Directory(d->capacity*2);
+    memset(_dir->_, 0, sizeof(Segment*)*_dir->capacity);
+    _dir->depth = d->depth + 1;
+    if (__atomic_compare_exchange_n(&d->doubled, &next, _dir, false,
+          __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+      next = _dir;
+    } else {
+      delete _dir;
+    }
+  }
+
+  for (unsigned i = 0; i < d->capacity; ++i) {
+    auto s = LoadEntry(&d->_[i]);
+    while (!IsFrozen(s) && !CASEntry(&d->_[i], &s, (Segment*)((uintptr_t)s | 1))) {
+      asm("nop");
+    }
+    s = Unfreeze(s);
+    Segment* empty = nullptr;
+    CASEntry(&next->_[2*i], &empty, s);
+    empty = nullptr;
+    CASEntry(&next->_[2*i+1], &empty, s);
+  }
+
+  auto current = d;
+  if (__atomic_load_n(&dir, __ATOMIC_ACQUIRE) == d) {
+    clflush((char*)next, sizeof(Directory));
+    clflush((char*)&next->_[0], sizeof(Segment*)*next->capacity);
+    if (__atomic_compare_exchange_n(&dir, &current, next, false,
+          __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+      clflush((char*)&dir, sizeof(Directory*));
+    }
+  }
+  return next;
+}
+
+// Replaces the entries of the split segment target in d by the two new
+// segments, the upper half first so that Recovery() can undo a partial
+// update. Returns false if d has to be doubled first or is being doubled,
+// in which case the caller retries on the current directory.
+bool CCEH::UpdateDirectory(Directory* d, Segment* target, Segment** s, size_t key_hash) {
+  if (target->local_depth == d->depth) {
+    Double(d);
+    return false;
+  }
+
+  size_t chunk_size = (size_t)1 << (d->depth - target->local_depth);
+  auto x = (key_hash >> (8*sizeof(key_hash)-d->depth));
+  x = x - (x % chunk_size);
+  for (unsigned half = 2; half > 0; --half) {
+    auto from = x + (half-1)*chunk_size/2;
+    for (unsigned i = 0; i < chunk_size/2; ++i) {
+      auto expected = target;
+      if (!CASEntry(&d->_[from+i], &expected, s[half-1]) && expected != s[half-1]) {
+        // frozen by a doubling
+        Double(d);
+        return false;
+      }
+    }
+    clflush((char*)&d->_[from], sizeof(Segment*)*chunk_size/2);
+  }
+  return true;
+}
+#else
 CCEH::CCEH(void)
 : dir{1}, global_depth{0}
 {
@@ -147,6 +264,7 @@ CCEH::CCEH(size_t initCap)
 
 CCEH::~CCEH(void)
 { }
+#endif
 
 void Directory::LSBUpdate(int local_depth, int global_depth, int dir_cap, int x, Segment** s) {
   int depth_diff = global_depth - local_depth;
@@ -174,6 +292,63 @@ void Directory::LSBUpdate(int local_depth, int global_depth, int dir_cap, int x,
   return;
 }
 
+#ifdef CCEH_LOCKFREE
+// Readers and inserters never wait for a directory lock. The thread that
+// splits a segment publishes the new segments in the directory, doubling it
+// if needed, while other inserters retry until they find them.
+void CCEH::Insert(Key_t& key, Value_t value) {
+STARTOVER:
+  auto key_hash = h(&key, sizeof(key));
+  auto y = (key_hash & kMask) * kNumPairPerCacheLine;
+
+RETRY:
+  auto d = __atomic_load_n(&dir, __ATOMIC_ACQUIRE);
+  auto x = (key_hash >> (8*sizeof(key_hash)-d->depth));
+  auto target = Unfreeze(LoadEntry(&d->_[x]));
+  auto ret = target->Insert(key, value, y, key_hash);
+
+  if (ret == 1) {
+    timer.Start();
+    Segment** s = target->Split();
+    timer.Stop();
+    breakdown += timer.GetSeconds();
+    if (s == nullptr) {
+      // another thread is doing split
+      goto RETRY;
+    }
+
+    s[0]->pattern = (key_hash >> (8*sizeof(key_hash)-s[0]->local_depth+1)) << 1;
+    s[1]->pattern = ((key_hash >> (8*sizeof(key_hash)-s[1]->local_depth+1)) << 1) + 1;
+
+    while (!UpdateDirectory(d, target, s, key_hash)) {
+      d = __atomic_load_n(&dir, __ATOMIC_ACQUIRE);
+    }
+    delete [] s;
+    goto RETRY;
+  } else if (ret == 2) {
+    goto STARTOVER;
+  } else {
+    clflush((char*)&target->_[y], 64);
+  }
+}
+
+// This function does not allow resizing
+bool CCEH::InsertOnly(Key_t& key, Value_t value) {
+  auto key_hash = h(&key, sizeof(key));
+  auto d = __atomic_load_n(&dir, __ATOMIC_ACQUIRE);
+  auto x = (key_hash >> (8*sizeof(key_hash)-d->depth));
+  auto y = (key_hash & kMask) * kNumPairPerCacheLine;
+
+  auto target = Unfreeze(LoadEntry(&d->_[x]));
+  auto ret = target->Insert(key, value, y, key_hash);
+  if (ret == 0) {
+    clflush((char*)&target->_[y], 64);
+    return true;
+  }
+
+  return false;
+}
+#else
 void CCEH::Insert(Key_t& key, Value_t value) {
 STARTOVER:
   auto key_hash = h(&key, sizeof(key));
@@ -295,12 +470,33 @@ bool CCEH::InsertOnly(Key_t& key, Value_t value) {
 
   return false;
 }
+#endif
 
 // TODO
 bool CCEH::Delete(Key_t& key) {
   return false;
 }
 
+#ifdef CCEH_LOCKFREE
+// A segment is not changed after it was split, so a reader that still
+// finds it in the directory can search it without waiting
+Value_t CCEH::Get(Key_t& key) {
+  auto key_hash = h(&key, sizeof(key));
+  auto d = __atomic_load_n(&dir, __ATOMIC_ACQUIRE);
+  auto x = (key_hash >> (8*sizeof(key_hash)-d->depth));
+  auto y = (key_hash & kMask) * kNumPairPerCacheLine;
+
+  auto dir_ = Unfreeze(LoadEntry(&d->_[x]));
+
+  for (unsigned i = 0; i < kNumPairPerCacheLine * kNumCacheLine; ++i) {
+    auto slot = (y+i) % Segment::kNumSlot;
+    if (dir_->_[slot].key == key) {
+      return dir_->_[slot].value;
+    }
+  }
+  return NONE;
+}
+#else
 Value_t CCEH::Get(Key_t& key) {
   auto key_hash = h(&key, sizeof(key));
   auto x = (key_hash >> (8*sizeof(key_hash)-global_depth));
@@ -336,10 +532,14 @@ Value_t CCEH::Get(Key_t& key) {
 #endif
   return NONE;
 }
+#endif
 
 double CCEH::Utilization(void) {
   size_t sum = 0;
   std::unordered_map<Segment*, bool> set;
+#ifdef CCEH_LOCKFREE
+  auto& dir = *this->dir;
+#endif
   for (size_t i = 0; i < dir.capacity; ++i) {
     set[dir._[i]] = true;
   }
@@ -353,6 +553,9 @@ double CCEH::Utilization(void) {
 
 size_t CCEH::Capacity(void) {
   std::unordered_map<Segment*, bool> set;
+#ifdef CCEH_LOCKFREE
+  auto& dir = *this->dir;
+#endif
   for (size_t i = 0; i < dir.capacity; ++i) {
     set[dir._[i]] = true;
   }
@@ -369,6 +572,40 @@ size_t Segment::numElem(void) {
   return sum;
 }
 
+#ifdef CCEH_LOCKFREE
+// A crash during a doubling leaves frozen entries in the directory, the new
+// directory was not published yet. A crash during a split leaves a part of
+// the entries of the split segment updated, they are reset to the segment
+// (the upper half is updated first) or to its lower half.
+bool CCEH::Recovery(void) {
+  bool recovered = false;
+  auto d = dir;
+  d->doubled = nullptr;
+  for (size_t i = 0; i < d->capacity; ++i) {
+    if (IsFrozen(d->_[i])) {
+      d->_[i] = Unfreeze(d->_[i]);
+      recovered = true;
+    }
+  }
+
+  size_t i = 0;
+  while (i < d->capacity) {
+    size_t depth_cur = d->_[i]->local_depth;
+    size_t stride = (size_t)1 << (d->depth - depth_cur);
+    for (size_t j = i + stride - 1; i < j; j--) {
+      if (d->_[j] != d->_[i]) {
+        d->_[j] = d->_[i];
+        recovered = true;
+      }
+    }
+    i = i+stride;
+  }
+  if (recovered) {
+    clflush((char*)&d->_[0], sizeof(void*)*d->capacity);
+  }
+  return recovered;
+}
+#else
 bool CCEH::Recovery(void) {
   bool recovered = false;
   size_t i = 0;
@@ -389,10 +626,15 @@ bool CCEH::Recovery(void) {
   }
   return recovered;
 }
+#endif
 
 // for debugging
 Value_t CCEH::FindAnyway(Key_t& key) {
   using namespace std;
+#ifdef CCEH_LOCKFREE
+  auto& dir = *this->dir;
+  auto global_depth = dir.depth;
+#endif
   for (size_t i = 0; i < dir.capacity; ++i) {
      for (size_t j = 0; j < Segment::kNumSlot; ++j) {
        if (dir._[i]->_[j].key == key) {
@@ -418,5 +660,9 @@ void Directory::SanityCheck(void* addr) {
 }
 
 void CCEH::lock_initialization(void) {
+#ifdef CCEH_LOCKFREE
+    dir->lock = false;
+#else
     dir.lock = false;
+#endif
 }
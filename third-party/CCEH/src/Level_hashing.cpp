@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <cmath>
 #include <cstdlib>
 #include <cstring>
@@ -13,6 +14,16 @@ using namespace std;
 #define F_IDX(hash, capacity) (hash % (capacity/2))
 #define S_IDX(hash, capacity) ((hash % (capacity/2)) + (capacity/2))
 
+#ifdef LEVEL_BACKGROUND_RESIZE
+// The locks are not replaced by resizes, buckets share a fixed number of them
+#define LOCK_IDX(idx) (((idx)/locksize) % nlocks)
+#define NUM_LOCKS 1024
+#define MIGRATION_CHUNK 4
+#define PREALLOC_LOAD_FACTOR 0.7
+#else
+#define LOCK_IDX(idx) ((idx)/locksize)
+#endif
+
 void LevelHashing::generate_seeds(void) {
   srand(time(NULL));
 
@@ -29,8 +40,31 @@ LevelHashing::LevelHashing(void){
 }
 
 LevelHashing::~LevelHashing(void){
+#ifdef LEVEL_BACKGROUND_RESIZE
+  {
+    std::lock_guard<std::mutex> guard(resizer_mutex);
+    stop_resizer = true;
+  }
+  resizer_cv.notify_one();
+  resizer->join();
+  delete resizer;
+
+  for (auto levels_ : retired_levels) {
+    delete levels_;
+  }
+  for (auto bottom : retired_buckets) {
+    delete [] bottom;
+  }
+  auto levels_ = current.load();
+  delete [] levels_->top;
+  delete [] levels_->bottom;
+  delete levels_;
+  delete [] spare_level;
+  delete [] mutex;
+#else
   delete [] mutex;
   delete [] buckets;
+#endif
 }
 
 LevelHashing::LevelHashing(size_t _levels)
@@ -40,7 +74,11 @@ LevelHashing::LevelHashing(size_t _levels)
   resize_num{0}
 {
   locksize = 256;
+#ifdef LEVEL_BACKGROUND_RESIZE
+  nlocks = NUM_LOCKS;
+#else
   nlocks = (3*addr_capacity/2)/locksize+1;
+#endif
   mutex = new std::shared_mutex[nlocks];
 
   generate_seeds();
@@ -49,9 +87,289 @@ LevelHashing::LevelHashing(size_t _levels)
   level_item_num[0] = 0;
   level_item_num[1] = 0;
   interim_level_buckets = NULL;
+#ifdef LEVEL_BACKGROUND_RESIZE
+  current = new Levels(buckets[0], buckets[1], NULL, addr_capacity);
+  resizer = new std::thread(&LevelHashing::resize_thread, this);
+#endif
+}
+
+#ifdef LEVEL_BACKGROUND_RESIZE
+// Inserts never wait for a resize. While the bottom level is moved to the
+// interim level, an insert that finds its buckets full moves a chunk of it
+// and tries again.
+void LevelHashing::Insert(Key_t& key, Value_t value) {
+  uint64_t f_hash = F_HASH(key);
+  uint64_t s_hash = S_HASH(key);
+
+RETRY:
+  auto levels_ = current.load();
+  auto capacity = levels_->addr_capacity;
+
+  if (levels_->interim != NULL) {
+    if (try_insert(levels_, levels_->interim, F_IDX(f_hash, 2*capacity), S_IDX(s_hash, 2*capacity), key, value) ||
+        try_insert(levels_, levels_->top, F_IDX(f_hash, capacity), S_IDX(s_hash, capacity), key, value)) {
+      return;
+    }
+    migrate_chunk(levels_);
+    goto RETRY;
+  }
+
+  if (try_insert(levels_, levels_->top, F_IDX(f_hash, capacity), S_IDX(s_hash, capacity), key, value) ||
+      try_insert(levels_, levels_->bottom, F_IDX(f_hash, capacity/2), S_IDX(s_hash, capacity/2), key, value)) {
+    return;
+  }
+
+  auto lock = 0;
+  if (!CAS(&resizing_lock, &lock, 1)) {
+    while (resizing_lock == 1 && current.load() == levels_) {
+      std::this_thread::yield();
+    }
+    goto RETRY;
+  }
+
+  // No resize may start or end while keys are moved
+  if (current.load() == levels_ && insert_by_movement(f_hash, s_hash, key, value)) {
+    resizing_lock = 0;
+    return;
+  }
+  if (current.load() != levels_) {
+    resizing_lock = 0;
+    goto RETRY;
+  }
+  // The resize thread releases resizing_lock when the interim level is there
+  notify_resizer(&resize_requested);
+  while (current.load() == levels_) {
+    std::this_thread::yield();
+  }
+  goto RETRY;
+}
+
+LevelHashing::Levels::Levels(Node* _top, Node* _bottom, Node* _interim, uint64_t _addr_capacity)
+  : top{_top},
+  bottom{_bottom},
+  interim{_interim},
+  addr_capacity{_addr_capacity},
+  prealloc_items{(uint64_t)((_addr_capacity + _addr_capacity/2)*ASSOC_NUM*PREALLOC_LOAD_FACTOR)}
+{
+}
+
+void LevelHashing::notify_resizer(bool* request) {
+  {
+    std::lock_guard<std::mutex> guard(resizer_mutex);
+    *request = true;
+  }
+  resizer_cv.notify_one();
+}
+
+// Inserts into a free slot of the bucket f_idx or s_idx of level, false if
+// there is none or if levels_ was replaced in the meantime
+bool LevelHashing::try_insert(Levels* levels_, Node* level, uint64_t f_idx, uint64_t s_idx, Key_t& key, Value_t value) {
+  uint64_t idx[2] = {f_idx, s_idx};
+  for (int j = 0; j < ASSOC_NUM; j ++) {
+    for (int k = 0; k < 2; k ++) {
+      std::unique_lock<std::shared_mutex> lock(mutex[LOCK_IDX(idx[k])]);
+      if (current.load() != levels_) {
+        return false;
+      }
+      if (level[idx[k]].token[j] == 0) {
+        level[idx[k]].slot[j].value = value;
+        mfence();
+        level[idx[k]].slot[j].key = key;
+        level[idx[k]].token[j] = 1;
+        clflush((char*)&level[idx[k]], sizeof(Node));
+        if (level == levels_->interim) {
+          levels_->interim_item_num++;
+          return true;
+        }
+        level_item_num[level == levels_->top ? 0 : 1]++;
+        lock.unlock();
+
+        if (level_item_num[0] + level_item_num[1] >= levels_->prealloc_items &&
+            !levels_->prealloc_requested.load(std::memory_order_relaxed) &&
+            !levels_->prealloc_requested.exchange(true)) {
+          notify_resizer(&prealloc_requested);
+        }
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+// Allocates the next interim level once the table is filled up to
+// PREALLOC_LOAD_FACTOR, so that the insert asking for a resize does not
+// wait for it. The bottom level is then moved to it, together with the
+// inserters.
+void LevelHashing::resize_thread(void) {
+  std::unique_lock<std::mutex> guard(resizer_mutex);
+  while (true) {
+    resizer_cv.wait(guard, [this] { return stop_resizer || resize_requested || prealloc_requested; });
+    if (stop_resizer) {
+      break;
+    }
+
+    auto levels_ = current.load();
+    auto capacity = levels_->addr_capacity;
+    if (spare_level == NULL || spare_capacity != 2*capacity) {
+      delete [] spare_level;
+      guard.unlock();
+      Node* interim = new Node[2*capacity]();
+      if (!interim) {
+        perror("The expanding fails");
+      }
+      clflush((char*)interim, sizeof(Node)*2*capacity);
+      guard.lock();
+      spare_level = interim;
+      spare_capacity = 2*capacity;
+    }
+    prealloc_requested = false;
+    if (!resize_requested) {
+      continue;
+    }
+    resize_requested = false;
+    Node* interim = spare_level;
+    spare_level = NULL;
+    guard.unlock();
+
+    auto next = new Levels(levels_->top, levels_->bottom, interim, capacity);
+    current.store(next);
+    __atomic_store_n(&resizing_lock, 0, __ATOMIC_RELEASE);
+
+    timer.Start();
+    while (migrate_chunk(next)) { }
+    timer.Stop();
+    breakdown += timer.GetSeconds();
+
+    guard.lock();
+    retired_levels.push_back(levels_);
+  }
+}
+
+// Moves the next chunk of buckets of the bottom level to the interim level,
+// false if there is none left. The last chunk to be moved ends the resize.
+bool LevelHashing::migrate_chunk(Levels* levels_) {
+  uint64_t num_buckets = levels_->addr_capacity/2;
+  uint64_t num_chunks = (num_buckets + MIGRATION_CHUNK - 1)/MIGRATION_CHUNK;
+  uint64_t chunk = levels_->next_chunk++;
+  if (chunk >= num_chunks) {
+    return false;
+  }
+
+  uint64_t end = std::min(num_buckets, (chunk + 1)*MIGRATION_CHUNK);
+  for (uint64_t idx = chunk*MIGRATION_CHUNK; idx < end; idx ++) {
+    migrate_bucket(levels_, idx);
+  }
+
+  if (++levels_->migrated_chunks == num_chunks) {
+    finish_resize(levels_);
+  }
+  return true;
 }
 
+// A key is inserted into the interim level before it is removed from the
+// bottom level, which lookups search first
+void LevelHashing::migrate_bucket(Levels* levels_, uint64_t idx) {
+  uint64_t capacity = levels_->addr_capacity;
+  Node* bucket = &levels_->bottom[idx];
+
+  // Inserts into the bucket that started before the resize are done
+  { std::unique_lock<std::shared_mutex> lock(mutex[LOCK_IDX(idx)]); }
+
+  for (int i = 0; i < ASSOC_NUM; i ++) {
+    if (bucket->token[i] == 1) {
+      Key_t key = bucket->slot[i].key;
+      Value_t value = bucket->slot[i].value;
+      uint64_t f_idx = F_IDX(F_HASH(key), 2*capacity);
+      uint64_t s_idx = S_IDX(S_HASH(key), 2*capacity);
+
+      if (!try_insert(levels_, levels_->interim, f_idx, s_idx, key, value) &&
+          !try_insert(levels_, levels_->top, F_IDX(F_HASH(key), capacity), S_IDX(S_HASH(key), capacity), key, value) &&
+          !interim_movement(levels_, f_idx, s_idx, key, value)) {
+        std::cout << "[Level Hashing] no free slot for key " << key << " while resizing" << std::endl;
+        exit(1);
+      }
+
+      bucket->token[i] = 0;
+      clflush((char*)&bucket->token[i], sizeof(uint8_t));
+    }
+  }
+}
 
+// Makes room for the key in the interim level by moving a key of its
+// buckets to the other bucket of that key
+bool LevelHashing::interim_movement(Levels* levels_, uint64_t f_idx, uint64_t s_idx, Key_t& key, Value_t value) {
+  uint64_t capacity = 2*levels_->addr_capacity;
+  Node* level = levels_->interim;
+  uint64_t idx[2] = {f_idx, s_idx};
+
+  for (int k = 0; k < 2; k ++) {
+    for (int j = 0; j < ASSOC_NUM; j ++) {
+      std::unique_lock<std::shared_mutex> lock(mutex[LOCK_IDX(idx[k])], std::defer_lock);
+      std::unique_lock<std::shared_mutex> alt_lock;
+      Key_t m_key = level[idx[k]].slot[j].key;
+      uint64_t alt_idx = (k == 0) ? S_IDX(S_HASH(m_key), capacity) : F_IDX(F_HASH(m_key), capacity);
+      if (LOCK_IDX(alt_idx) == LOCK_IDX(idx[k])) {
+        lock.lock();
+      } else {
+        alt_lock = std::unique_lock<std::shared_mutex>(mutex[LOCK_IDX(alt_idx)], std::defer_lock);
+        std::lock(lock, alt_lock);
+      }
+      if (level[idx[k]].token[j] == 0) {
+        level[idx[k]].slot[j].value = value;
+        mfence();
+        level[idx[k]].slot[j].key = key;
+        level[idx[k]].token[j] = 1;
+        clflush((char*)&level[idx[k]], sizeof(Node));
+        levels_->interim_item_num++;
+        return true;
+      }
+      if (level[idx[k]].slot[j].key != m_key) {
+        continue;
+      }
+
+      for (int i = 0; i < ASSOC_NUM; i ++) {
+        if (level[alt_idx].token[i] == 0) {
+          level[alt_idx].slot[i].value = level[idx[k]].slot[j].value;
+          mfence();
+          level[alt_idx].slot[i].key = m_key;
+          level[alt_idx].token[i] = 1;
+          clflush((char*)&level[alt_idx], sizeof(Node));
+
+          level[idx[k]].slot[j].value = value;
+          mfence();
+          level[idx[k]].slot[j].key = key;
+          clflush((char*)&level[idx[k]], sizeof(Node));
+          levels_->interim_item_num++;
+          return true;
+        }
+      }
+    }
+  }
+  return false;
+}
+
+// Makes the interim level the top level and the top level the bottom level
+void LevelHashing::finish_resize(Levels* levels_) {
+  auto next = new Levels(levels_->interim, levels_->top, NULL, 2*levels_->addr_capacity);
+
+  levels++;
+  resize_num++;
+  buckets[0] = next->top;
+  buckets[1] = next->bottom;
+  level_item_num[1] = level_item_num[0];
+  level_item_num[0] = levels_->interim_item_num;
+  addr_capacity = next->addr_capacity;
+  total_capacity = pow(2, levels) + pow(2, levels - 1);
+
+  current.store(next);
+
+  std::lock_guard<std::mutex> guard(resizer_mutex);
+  retired_levels.push_back(levels_);
+  retired_buckets.push_back(levels_->bottom);
+}
+
+
+#else
 void LevelHashing::Insert(Key_t& key, Value_t value) {
 RETRY:
   while (resizing_lock == 1) {
@@ -67,7 +385,7 @@ RETRY:
   for(i = 0; i < 2; i ++){
     for(j = 0; j < ASSOC_NUM; j ++){
       {
-        std::unique_lock<std::shared_mutex> lock(mutex[f_idx/locksize]);
+        std::unique_lock<std::shared_mutex> lock(mutex[LOCK_IDX(f_idx)]);
 	if(buckets[i][f_idx].token[j] == 0){
           buckets[i][f_idx].slot[j].value = value;
           mfence();
@@ -79,7 +397,7 @@ RETRY:
         }
       }
       {
-        std::unique_lock<std::shared_mutex> lock(mutex[s_idx/locksize]);
+        std::unique_lock<std::shared_mutex> lock(mutex[LOCK_IDX(s_idx)]);
 	if(buckets[i][s_idx].token[j] == 0){
           buckets[i][s_idx].slot[j].value = value;
           mfence();
@@ -95,76 +413,83 @@ RETRY:
     s_idx = S_IDX(s_hash, addr_capacity / 2);
   }
 
-  f_idx = F_IDX(f_hash, addr_capacity);
-  s_idx = S_IDX(s_hash, addr_capacity);
-
-  int empty_loc;
   auto lock = 0;
   if (CAS(&resizing_lock, &lock, 1)) {
-    for(i=0; i<2; i++){
-      if(!try_movement(f_idx, i, key, value)){
-        resizing_lock = 0;
-        return;
-      }
-      if(!try_movement(s_idx, i, key, value)){
-        resizing_lock = 0;
-        return;
-      }
-      f_idx = F_IDX(f_hash, addr_capacity / 2);
-      s_idx = S_IDX(s_hash, addr_capacity / 2);
+    if (insert_by_movement(f_hash, s_hash, key, value)) {
+      resizing_lock = 0;
+      return;
     }
+    timer.Start();
+    resize();
+    timer.Stop();
+    breakdown += timer.GetSeconds();
+    resizing_lock = 0;
+  }
+  goto RETRY;
+}
+#endif
 
-    if(resize_num>0){
-      {
-        std::unique_lock<std::shared_mutex> lock(mutex[f_idx/locksize]);
+// Makes room for the key in one of its buckets by moving a key to its other
+// bucket in the same level, or from the bottom to the top level
+bool LevelHashing::insert_by_movement(uint64_t f_hash, uint64_t s_hash, Key_t& key, Value_t value) {
+  uint32_t f_idx = F_IDX(f_hash, addr_capacity);
+  uint32_t s_idx = S_IDX(s_hash, addr_capacity);
+  int i, empty_loc;
+
+  for(i=0; i<2; i++){
+    if(!try_movement(f_idx, i, key, value)){
+      return true;
+    }
+    if(!try_movement(s_idx, i, key, value)){
+      return true;
+    }
+    f_idx = F_IDX(f_hash, addr_capacity / 2);
+    s_idx = S_IDX(s_hash, addr_capacity / 2);
+  }
+
+  if(resize_num>0){
+    {
+      std::unique_lock<std::shared_mutex> lock(mutex[LOCK_IDX(f_idx)]);
 #ifdef TIME
-	cuck_timer.Start();
+      cuck_timer.Start();
 #endif
-        empty_loc = b2t_movement(f_idx);
+      empty_loc = b2t_movement(f_idx);
 #ifdef TIME
-	cuck_timer.Stop();
-	displacement += cuck_timer.GetSeconds();
+      cuck_timer.Stop();
+      displacement += cuck_timer.GetSeconds();
 #endif
-        if(empty_loc != -1){
-          buckets[1][f_idx].slot[empty_loc].value = value;
-          mfence();
-          buckets[1][f_idx].slot[empty_loc].key = key;
-	  buckets[1][f_idx].token[empty_loc] = 1;
-	  clflush((char*)&buckets[1][f_idx], sizeof(Node));
-	  level_item_num[1]++;
-          resizing_lock = 0;
-          return;
-        }
+      if(empty_loc != -1){
+        buckets[1][f_idx].slot[empty_loc].value = value;
+        mfence();
+        buckets[1][f_idx].slot[empty_loc].key = key;
+	buckets[1][f_idx].token[empty_loc] = 1;
+	clflush((char*)&buckets[1][f_idx], sizeof(Node));
+	level_item_num[1]++;
+        return true;
       }
-      {
-        std::unique_lock<std::shared_mutex> lock(mutex[s_idx/locksize]);
+    }
+    {
+      std::unique_lock<std::shared_mutex> lock(mutex[LOCK_IDX(s_idx)]);
 #ifdef TIME
-	cuck_timer.Start();
+      cuck_timer.Start();
 #endif
-        empty_loc = b2t_movement(s_idx);
+      empty_loc = b2t_movement(s_idx);
 #ifdef TIME
-	cuck_timer.Stop();
-	displacement += cuck_timer.GetSeconds();
+      cuck_timer.Stop();
+      displacement += cuck_timer.GetSeconds();
 #endif
-        if(empty_loc != -1){
-          buckets[1][s_idx].slot[empty_loc].value = value;
-          mfence();
-          buckets[1][s_idx].slot[empty_loc].key = key;
-	  buckets[1][s_idx].token[empty_loc] = 1;
-	  clflush((char*)&buckets[1][s_idx], sizeof(Node));
-	  level_item_num[1]++;
-          resizing_lock = 0;
-          return;
-        }
+      if(empty_loc != -1){
+        buckets[1][s_idx].slot[empty_loc].value = value;
+        mfence();
+        buckets[1][s_idx].slot[empty_loc].key = key;
+	buckets[1][s_idx].token[empty_loc] = 1;
+	clflush((char*)&buckets[1][s_idx], sizeof(Node));
+	level_item_num[1]++;
+        return true;
       }
     }
-    timer.Start();
-    resize();
-    timer.Stop();
-    breakdown += timer.GetSeconds();
-    resizing_lock = 0;
   }
-  goto RETRY;
+  return false;
 }
 
 bool LevelHashing::InsertOnly(Key_t& key, Value_t value) {
@@ -276,7 +601,7 @@ cuck_timer.Start();
   uint64_t i, j, jdx;
   {
     std::unique_lock<std::shared_mutex> *lock[2];
-    lock[0] = new std::unique_lock<std::shared_mutex>(mutex[idx/locksize]);
+    lock[0] = new std::unique_lock<std::shared_mutex>(mutex[LOCK_IDX(idx)]);
     for(i=0; i<ASSOC_NUM; i++){
       Key_t m_key = buckets[level_num][idx].slot[i].key;
       Value_t m_value = buckets[level_num][idx].slot[i].value;
@@ -288,8 +613,8 @@ cuck_timer.Start();
       if(f_idx == idx) jdx = s_idx;
       else jdx = f_idx;
 
-      if((jdx/locksize)!=(idx/locksize)){
-        lock[1] = new std::unique_lock<std::shared_mutex>(mutex[jdx/locksize]);
+      if(LOCK_IDX(jdx)!=LOCK_IDX(idx)){
+        lock[1] = new std::unique_lock<std::shared_mutex>(mutex[LOCK_IDX(jdx)]);
       }
 
       for(j=0; j<ASSOC_NUM; j++){
@@ -309,7 +634,7 @@ cuck_timer.Start();
 	  clflush((char*)&buckets[level_num][idx], sizeof(Node));
 	  level_item_num[level_num]++;
 
-          if((jdx/locksize) != (idx/locksize)) delete lock[1];
+          if(LOCK_IDX(jdx) != LOCK_IDX(idx)) delete lock[1];
           delete lock[0];
 #ifdef TIME
 	  cuck_timer.Stop();
@@ -318,7 +643,7 @@ cuck_timer.Start();
           return 0;
         }
       }
-      if((jdx/locksize) != (idx/locksize)) delete lock[1];
+      if(LOCK_IDX(jdx) != LOCK_IDX(idx)) delete lock[1];
     }
     delete lock[0];
   }
@@ -348,8 +673,8 @@ int LevelHashing::b2t_movement(uint64_t idx){
     s_idx = S_IDX(s_hash, addr_capacity);
 
     for(j=0; j<ASSOC_NUM; j++){
-      if((idx/locksize) != (f_idx/locksize))
-        lock = new std::unique_lock<std::shared_mutex>(mutex[f_idx/locksize]);
+      if(LOCK_IDX(idx) != LOCK_IDX(f_idx))
+        lock = new std::unique_lock<std::shared_mutex>(mutex[LOCK_IDX(f_idx)]);
       if(buckets[0][f_idx].token[j] == 0){
         buckets[0][f_idx].slot[j].value = value;
         mfence();
@@ -361,12 +686,12 @@ int LevelHashing::b2t_movement(uint64_t idx){
 	level_item_num[0]++;
 	level_item_num[1]--;
 
-        if((idx/locksize) != (f_idx/locksize)) delete lock;
+        if(LOCK_IDX(idx) != LOCK_IDX(f_idx)) delete lock;
         return i;
       }
-      if((idx/locksize)!=(f_idx/locksize)) delete lock;
-      if((idx/locksize)!=(s_idx/locksize))
-        lock = new std::unique_lock<std::shared_mutex>(mutex[s_idx/locksize]);
+      if(LOCK_IDX(idx)!=LOCK_IDX(f_idx)) delete lock;
+      if(LOCK_IDX(idx)!=LOCK_IDX(s_idx))
+        lock = new std::unique_lock<std::shared_mutex>(mutex[LOCK_IDX(s_idx)]);
 
       if(buckets[0][s_idx].token[j] == 0){
         buckets[0][s_idx].slot[j].value = value;
@@ -380,10 +705,10 @@ int LevelHashing::b2t_movement(uint64_t idx){
 	level_item_num[0]++;
 	level_item_num[1]--;
 
-        if((idx/locksize) != (s_idx/locksize)) delete lock;
+        if(LOCK_IDX(idx) != LOCK_IDX(s_idx)) delete lock;
         return i;
       }
-      if((idx/locksize)!=(s_idx/locksize)) delete lock;
+      if(LOCK_IDX(idx)!=LOCK_IDX(s_idx)) delete lock;
     }
   }
   return -1;
@@ -393,6 +718,41 @@ int LevelHashing::b2t_movement(uint64_t idx){
 
 
 
+#ifdef LEVEL_BACKGROUND_RESIZE
+// The bottom level is searched before the interim level, where its keys are
+// moved to. A lookup that started before the levels were replaced and did
+// not find the key searches again.
+Value_t LevelHashing::Get(Key_t& key) {
+  uint64_t f_hash = F_HASH(key);
+  uint64_t s_hash = S_HASH(key);
+
+RETRY:
+  auto levels_ = current.load();
+  auto capacity = levels_->addr_capacity;
+  Node* level[3] = {levels_->bottom, levels_->top, levels_->interim};
+  uint64_t level_capacity[3] = {capacity/2, capacity, 2*capacity};
+
+  for (int i = 0; i < 3; i ++) {
+    if (level[i] == NULL) {
+      continue;
+    }
+    uint64_t idx[2] = {F_IDX(f_hash, level_capacity[i]), S_IDX(s_hash, level_capacity[i])};
+    for (int k = 0; k < 2; k ++) {
+      std::shared_lock<std::shared_mutex> lock(mutex[LOCK_IDX(idx[k])]);
+      for (int j = 0; j < ASSOC_NUM; j ++) {
+        if (level[i][idx[k]].token[j] == 1 && level[i][idx[k]].slot[j].key == key) {
+          return level[i][idx[k]].slot[j].value;
+        }
+      }
+    }
+  }
+
+  if (current.load() != levels_) {
+    goto RETRY;
+  }
+  return NONE;
+}
+#else
 Value_t LevelHashing::Get(Key_t& key) {
   uint64_t f_hash = F_HASH(key);
   uint64_t s_hash = S_HASH(key);
@@ -402,7 +762,7 @@ Value_t LevelHashing::Get(Key_t& key) {
 
   for(i = 0; i < 2; i ++){
     {
-      std::shared_lock<std::shared_mutex> lock(mutex[f_idx/locksize]);
+      std::shared_lock<std::shared_mutex> lock(mutex[LOCK_IDX(f_idx)]);
       for(j = 0; j < ASSOC_NUM; j ++){
         if (buckets[i][f_idx].token[j] == 1 && buckets[i][f_idx].slot[j].key == key)
         {
@@ -411,7 +771,7 @@ Value_t LevelHashing::Get(Key_t& key) {
       }
     }
     {
-      std::shared_lock<std::shared_mutex> lock(mutex[s_idx/locksize]);
+      std::shared_lock<std::shared_mutex> lock(mutex[LOCK_IDX(s_idx)]);
       for(j = 0; j < ASSOC_NUM; j ++){
         if (buckets[i][s_idx].token[j] == 1 && buckets[i][s_idx].slot[j].key == key)
         {
@@ -425,6 +785,7 @@ Value_t LevelHashing::Get(Key_t& key) {
 
   return NONE;
 }
+#endif
 
 bool LevelHashing::Delete(Key_t& key) {
   return false;
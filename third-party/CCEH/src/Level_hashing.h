@@ -4,6 +4,12 @@
 #include <stdint.h>
 #include <mutex>
 #include <shared_mutex>
+#ifdef LEVEL_BACKGROUND_RESIZE
+#include <atomic>
+#include <condition_variable>
+#include <thread>
+#include <vector>
+#endif
 #include "src/hash.h"
 #include "util/pair.h"
 #define ASSOC_NUM 3
@@ -69,6 +75,47 @@ class LevelHashing: public Hash {
     void resize(void);
     int b2t_movement(uint64_t );
     uint8_t try_movement(uint64_t , uint64_t , Key_t& , Value_t);
+    bool insert_by_movement(uint64_t, uint64_t, Key_t&, Value_t);
+
+#ifdef LEVEL_BACKGROUND_RESIZE
+    // The levels to search, replaced as a whole when a resize starts and
+    // when it ends. While resizing, the bottom level is moved in chunks of
+    // buckets to the interim level, which becomes the next top level.
+    struct Levels {
+      Node* top;
+      Node* bottom;
+      Node* interim;
+      uint64_t addr_capacity;   // number of buckets in the top level
+      uint64_t prealloc_items;  // number of items at which the next interim level is allocated
+      std::atomic<bool> prealloc_requested{false};
+      std::atomic<uint64_t> next_chunk{0};
+      std::atomic<uint64_t> migrated_chunks{0};
+      std::atomic<uint64_t> interim_item_num{0};
+
+      Levels(Node*, Node*, Node*, uint64_t);
+    };
+    std::atomic<Levels*> current;
+
+    bool resize_requested = false;
+    bool prealloc_requested = false;
+    bool stop_resizer = false;
+    Node* spare_level = NULL;
+    uint64_t spare_capacity = 0;
+    std::thread* resizer;
+    std::mutex resizer_mutex;
+    std::condition_variable resizer_cv;
+    // Freed with the table, readers might still use them
+    std::vector<Levels*> retired_levels;
+    std::vector<Node*> retired_buckets;
+
+    void notify_resizer(bool*);
+    bool try_insert(Levels*, Node*, uint64_t, uint64_t, Key_t&, Value_t);
+    bool interim_movement(Levels*, uint64_t, uint64_t, Key_t&, Value_t);
+    bool migrate_chunk(Levels*);
+    void migrate_bucket(Levels*, uint64_t);
+    void finish_resize(Levels*);
+    void resize_thread(void);
+#endif
 
   public:
     LevelHashing(void);
@@ -15,6 +15,12 @@
 #include <climits>
 #include <future>
 #include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <atomic>
+#ifdef FASTFAIR_SIMD_SEARCH
+#include <immintrin.h>
+#endif
 #ifdef LOCK_INIT
 #include "tbb/concurrent_vector.h"
 #endif
@@ -60,6 +66,23 @@ static inline void mfence()
     asm volatile("mfence":::"memory");
 }
 
+// Readers do not lock pages: they rely on FAST and FAIR leaving every page in
+// a searchable state after each store of a writer. This only holds if the
+// stores to the records, switch_counter, last_index, sibling_ptr and root
+// become visible in program order and readers load these fields again every
+// time, so they are accessed through these instead of plain loads and stores.
+template <typename T>
+static inline T load_acquire(T &field)
+{
+    return __atomic_load_n(&field, __ATOMIC_ACQUIRE);
+}
+
+template <typename T, typename V>
+static inline void store_release(T &field, V value)
+{
+    __atomic_store_n(&field, (T)value, __ATOMIC_RELEASE);
+}
+
 static inline void clflush(char *data, int len)
 {
     volatile char *ptr = (char *)((unsigned long)data &~(CACHE_LINE_SIZE-1));
@@ -109,25 +132,39 @@ class btree{
         int height;
         char* root;
 
+        // Background merging of underfull leaves, see start_compaction()
+        std::atomic<bool> compaction_on;
+        bool compaction_stop;
+        std::thread *compaction_thread;
+        std::mutex compaction_mtx;
+        std::condition_variable compaction_cv;
+        std::vector<page *> compaction_queue;
+        std::vector<page *> retired_pages;
+
+        void compaction_enqueue(page *);
+        void compaction_run();
+        bool merge_with_left(page *);
+
     public:
 
         btree();
-        ~btree() {
-        }
-        void setNewRoot(char *) __attribute__((optimize(0)));
-        void getNumberOfNodes() __attribute__((optimize(0)));
-        void btree_insert(uint64_t, char*) __attribute__((optimize(0)));
-        void btree_insert(char*, char*) __attribute__((optimize(0)));
-        void btree_insert_internal(char *, uint64_t, char *, uint32_t) __attribute__((optimize(0)));
-        void btree_insert_internal(char *, key_item *, char *, uint32_t) __attribute__((optimize(0)));
-        void btree_delete(uint64_t) __attribute__((optimize(0)));
+        ~btree();
+        void setNewRoot(char *);
+        void getNumberOfNodes();
+        void btree_insert(uint64_t, char*);
+        void btree_insert(char*, char*);
+        void btree_insert_internal(char *, uint64_t, char *, uint32_t);
+        void btree_insert_internal(char *, key_item *, char *, uint32_t);
+        void btree_delete(uint64_t);
         //void btree_delete_internal
         //    (entry_key_t, char *, uint32_t, entry_key_t *, bool *, page **);
-        char *btree_search(uint64_t) __attribute__((optimize(0)));
-        char *btree_search(char *) __attribute__((optimize(0)));
-        void btree_search_range(uint64_t, uint64_t, unsigned long *, int, int &) __attribute__((optimize(0)));
-        void btree_search_range(char *, char *, unsigned long *, int, int &) __attribute__((optimize(0)));
-        key_item *make_key_item(char *, size_t, bool) __attribute__((optimize(0)));
+        char *btree_search(uint64_t);
+        char *btree_search(char *);
+        void btree_search_range(uint64_t, uint64_t, unsigned long *, int, int &);
+        void btree_search_range(char *, char *, unsigned long *, int, int &);
+        key_item *make_key_item(char *, size_t, bool);
+        void start_compaction();
+        void stop_compaction();
 
         friend class page;
 };
@@ -142,7 +179,8 @@ class header{
         union Key highest;          // 8 bytes
         uint8_t is_deleted;         // 1 bytes
         int16_t last_index;         // 2 bytes
-        uint8_t dummy[5];           // 5 bytes
+        uint8_t queued;             // 1 bytes
+        uint8_t dummy[4];           // 4 bytes
 
         friend class page;
         friend class btree;
@@ -155,7 +193,9 @@ class header{
             sibling_ptr = NULL;
             switch_counter = 0;
             last_index = -1;
+            highest.ikey = 0;
             is_deleted = false;
+            queued = false;
 #ifdef LOCK_INIT
             lock_initializer.push_back(mtx);
 #endif
@@ -184,6 +224,11 @@ class entry{
 const int cardinality = (PAGESIZE-sizeof(header))/sizeof(entry);
 const int count_in_line = CACHE_LINE_SIZE / sizeof(entry);
 
+// Leaves with fewer entries are queued for compaction, and two leaves are
+// merged only if the merged leaf has at most merge_limit entries
+const int merge_threshold = cardinality / 3;
+const int merge_limit = (cardinality - 1) * 3 / 4;
+
 class page{
     private:
         header hdr;  // header in persistent memory, 16 bytes
@@ -229,14 +274,18 @@ class page{
             return ret;
         }
 
-        inline int count() __attribute__((optimize(0))) {
+        void operator delete(void *addr) {
+            free(addr);
+        }
+
+        inline int count() {
             uint32_t previous_switch_counter;
             int count = 0;
             do {
-                previous_switch_counter = hdr.switch_counter;
-                count = hdr.last_index + 1;
+                previous_switch_counter = load_acquire(hdr.switch_counter);
+                count = load_acquire(hdr.last_index) + 1;
 
-                while(count >= 0 && records[count].ptr != NULL) {
+                while(count >= 0 && load_acquire(records[count].ptr) != NULL) {
                     if(IS_FORWARD(previous_switch_counter))
                         ++count;
                     else
@@ -245,35 +294,35 @@ class page{
 
                 if(count < 0) {
                     count = 0;
-                    while(records[count].ptr != NULL) {
+                    while(load_acquire(records[count].ptr) != NULL) {
                         ++count;
                     }
                 }
 
-            } while(IS_FORWARD(previous_switch_counter) != IS_FORWARD(hdr.switch_counter));
+            } while(IS_FORWARD(previous_switch_counter) != IS_FORWARD(load_acquire(hdr.switch_counter)));
 
             return count;
         }
 
-        inline bool remove_key(uint64_t key) __attribute__((optimize(0))) {
+        inline bool remove_key(uint64_t key) {
             // Set the switch_counter
             if(IS_FORWARD(hdr.switch_counter))
-                ++hdr.switch_counter;
+                store_release(hdr.switch_counter, hdr.switch_counter + 1);
             else
-                hdr.switch_counter += 2;
+                store_release(hdr.switch_counter, hdr.switch_counter + 2);
 
             bool shift = false;
             int i;
             for(i = 0; records[i].ptr != NULL; ++i) {
                 if(!shift && records[i].key.ikey == key) {
-                    records[i].ptr = (i == 0) ?
-                        (char *)hdr.leftmost_ptr : records[i - 1].ptr;
+                    store_release(records[i].ptr, (i == 0) ?
+                        (char *)hdr.leftmost_ptr : records[i - 1].ptr);
                     shift = true;
                 }
 
                 if(shift) {
-                    records[i].key.ikey = records[i + 1].key.ikey;
-                    records[i].ptr = records[i + 1].ptr;
+                    store_release(records[i].key.ikey, records[i + 1].key.ikey);
+                    store_release(records[i].ptr, records[i + 1].ptr);
 
                     // flush
                     uint64_t records_ptr = (uint64_t)(&records[i]);
@@ -293,14 +342,42 @@ class page{
             return shift;
         }
 
-        bool remove(btree* bt, uint64_t key, bool only_rebalance = false, bool with_lock = true) __attribute__((optimize(0))) {
+        // Returns false if the key has moved to another page, because this
+        // page was split or merged into its left sibling, in which case the
+        // caller has to search the key again
+        bool remove(btree* bt, uint64_t key, bool only_rebalance = false, bool with_lock = true) {
             hdr.mtx->lock();
+            if(hdr.is_deleted) {
+                hdr.mtx->unlock();
+                return false;
+            }
 
             bool ret = remove_key(key);
+            if(!ret && hdr.sibling_ptr && key >= hdr.sibling_ptr->hdr.highest.ikey) {
+                hdr.mtx->unlock();
+                return false;
+            }
+
+            bool underfull = ret && hdr.last_index + 1 < merge_threshold;
 
             hdr.mtx->unlock();
 
-            return ret;
+            if(underfull && bt->compaction_on.load(std::memory_order_relaxed))
+                bt->compaction_enqueue(this);
+
+            return true;
+        }
+
+        // Returns the child left of the entry with the given key pointing to
+        // child, NULL if there is no such entry
+        page *child_before(uint64_t key, page *child) {
+            for(int i = 0; load_acquire(records[i].ptr) != NULL; ++i) {
+                if(load_acquire(records[i].ptr) == (char *)child && load_acquire(records[i].key.ikey) == key) {
+                    page *prev = (i == 0) ? hdr.leftmost_ptr : (page *)load_acquire(records[i - 1].ptr);
+                    return (prev != child) ? prev : NULL;
+                }
+            }
+            return NULL;
         }
 
 #if 0
@@ -546,21 +623,21 @@ class page{
 #endif
         inline void
             insert_key(uint64_t key, char* ptr, int *num_entries, bool flush = true,
-                    bool update_last_index = true) __attribute__((optimize(0))) {
+                    bool update_last_index = true) {
                 // update switch_counter
                 if(!IS_FORWARD(hdr.switch_counter))
-                    ++hdr.switch_counter;
+                    store_release(hdr.switch_counter, hdr.switch_counter + 1);
                 else
-                    hdr.switch_counter += 2;
+                    store_release(hdr.switch_counter, hdr.switch_counter + 2);
 
                 // FAST
                 if(*num_entries == 0) {  // this page is empty
                     entry* new_entry = (entry*) &records[0];
                     entry* array_end = (entry*) &records[1];
-                    new_entry->key.ikey = (uint64_t) key;
-                    new_entry->ptr = (char*) ptr;
+                    store_release(new_entry->key.ikey, (uint64_t) key);
+                    store_release(new_entry->ptr, (char*) ptr);
 
-                    array_end->ptr = (char*)NULL;
+                    store_release(array_end->ptr, (char*)NULL);
 
                     if(flush) {
                         clflush((char*) this, CACHE_LINE_SIZE);
@@ -568,7 +645,7 @@ class page{
                 }
                 else {
                     int i = *num_entries - 1, inserted = 0, to_flush_cnt = 0;
-                    records[*num_entries+1].ptr = records[*num_entries].ptr;
+                    store_release(records[*num_entries+1].ptr, records[*num_entries].ptr);
                     if(flush) {
                         if((uint64_t)&(records[*num_entries+1].ptr) % CACHE_LINE_SIZE == 0)
                             clflush((char*)&(records[*num_entries+1].ptr), sizeof(char*));
@@ -577,8 +654,8 @@ class page{
                     // FAST
                     for(i = *num_entries - 1; i >= 0; i--) {
                         if(key < records[i].key.ikey) {
-                            records[i+1].ptr = records[i].ptr;
-                            records[i+1].key.ikey = records[i].key.ikey;
+                            store_release(records[i+1].ptr, records[i].ptr);
+                            store_release(records[i+1].key.ikey, records[i].key.ikey);
 
                             if(flush) {
                                 uint64_t records_ptr = (uint64_t)(&records[i+1]);
@@ -596,9 +673,9 @@ class page{
                             }
                         }
                         else{
-                            records[i+1].ptr = records[i].ptr;
-                            records[i+1].key.ikey = key;
-                            records[i+1].ptr = ptr;
+                            store_release(records[i+1].ptr, records[i].ptr);
+                            store_release(records[i+1].key.ikey, key);
+                            store_release(records[i+1].ptr, ptr);
 
                             if(flush)
                                 clflush((char*)&records[i+1],sizeof(entry));
@@ -607,37 +684,37 @@ class page{
                         }
                     }
                     if(inserted==0){
-                        records[0].ptr =(char*) hdr.leftmost_ptr;
-                        records[0].key.ikey = key;
-                        records[0].ptr = ptr;
+                        store_release(records[0].ptr, (char*) hdr.leftmost_ptr);
+                        store_release(records[0].key.ikey, key);
+                        store_release(records[0].ptr, ptr);
                         if(flush)
                             clflush((char*) &records[0], sizeof(entry));
                     }
                 }
 
                 if(update_last_index) {
-                    hdr.last_index = *num_entries;
+                    store_release(hdr.last_index, *num_entries);
                 }
                 ++(*num_entries);
             }
 
         inline void
             insert_key(key_item *key, char* ptr, int *num_entries, bool flush = true,
-                    bool update_last_index = true) __attribute__((optimize(0))) {
+                    bool update_last_index = true) {
                 // update switch_counter
                 if(!IS_FORWARD(hdr.switch_counter))
-                    ++hdr.switch_counter;
+                    store_release(hdr.switch_counter, hdr.switch_counter + 1);
                 else
-                    hdr.switch_counter += 2;
+                    store_release(hdr.switch_counter, hdr.switch_counter + 2);
 
                 // FAST
                 if(*num_entries == 0) {  // this page is empty
                     entry* new_entry = (entry*) &records[0];
                     entry* array_end = (entry*) &records[1];
-                    new_entry->key.skey = key;
-                    new_entry->ptr = (char*) ptr;
+                    store_release(new_entry->key.skey, key);
+                    store_release(new_entry->ptr, (char*) ptr);
 
-                    array_end->ptr = (char*)NULL;
+                    store_release(array_end->ptr, (char*)NULL);
 
                     if(flush) {
                         clflush((char*) this, CACHE_LINE_SIZE);
@@ -645,7 +722,7 @@ class page{
                 }
                 else {
                     int i = *num_entries - 1, inserted = 0, to_flush_cnt = 0;
-                    records[*num_entries+1].ptr = records[*num_entries].ptr;
+                    store_release(records[*num_entries+1].ptr, records[*num_entries].ptr);
                     if(flush) {
                         if((uint64_t)&(records[*num_entries+1].ptr) % CACHE_LINE_SIZE == 0)
                             clflush((char*)&(records[*num_entries+1].ptr), sizeof(char*));
@@ -655,8 +732,8 @@ class page{
                     for(i = *num_entries - 1; i >= 0; i--) {
                         if(memcmp(key->key, records[i].key.skey->key,
                                     std::min(key->key_len, records[i].key.skey->key_len)) < 0) {
-                            records[i+1].ptr = records[i].ptr;
-                            records[i+1].key.skey = records[i].key.skey;
+                            store_release(records[i+1].ptr, records[i].ptr);
+                            store_release(records[i+1].key.skey, records[i].key.skey);
 
                             if(flush) {
                                 uint64_t records_ptr = (uint64_t)(&records[i+1]);
@@ -674,9 +751,9 @@ class page{
                             }
                         }
                         else{
-                            records[i+1].ptr = records[i].ptr;
-                            records[i+1].key.skey = key;
-                            records[i+1].ptr = ptr;
+                            store_release(records[i+1].ptr, records[i].ptr);
+                            store_release(records[i+1].key.skey, key);
+                            store_release(records[i+1].ptr, ptr);
 
                             if(flush)
                                 clflush((char*)&records[i+1],sizeof(entry));
@@ -685,16 +762,16 @@ class page{
                         }
                     }
                     if(inserted==0){
-                        records[0].ptr =(char*) hdr.leftmost_ptr;
-                        records[0].key.skey = key;
-                        records[0].ptr = ptr;
+                        store_release(records[0].ptr, (char*) hdr.leftmost_ptr);
+                        store_release(records[0].key.skey, key);
+                        store_release(records[0].ptr, ptr);
                         if(flush)
                             clflush((char*) &records[0], sizeof(entry));
                     }
                 }
 
                 if(update_last_index) {
-                    hdr.last_index = *num_entries;
+                    store_release(hdr.last_index, *num_entries);
                 }
                 ++(*num_entries);
             }
@@ -702,7 +779,7 @@ class page{
         // Insert a new integer key - FAST and FAIR
         page *store
             (btree* bt, char* left, uint64_t key, char* right,
-             bool flush, bool with_lock, page *invalid_sibling = NULL) __attribute__((optimize(0))) {
+             bool flush, bool with_lock, page *invalid_sibling = NULL) {
                 if(with_lock) {
                     hdr.mtx->lock(); // Lock the write lock
                 }
@@ -793,23 +870,23 @@ class page{
                         sibling->hdr.mtx->lock();
 
                     if(IS_FORWARD(hdr.switch_counter))
-                        hdr.switch_counter++;
+                        store_release(hdr.switch_counter, hdr.switch_counter + 1);
                     else
-                        hdr.switch_counter += 2;
+                        store_release(hdr.switch_counter, hdr.switch_counter + 2);
                     mfence();
-                    hdr.sibling_ptr = sibling;
+                    store_release(hdr.sibling_ptr, sibling);
                     clflush((char*) &hdr, sizeof(hdr));
 
                     // set to NULL
-                    records[m].ptr = NULL;
+                    store_release(records[m].ptr, NULL);
                     clflush((char*) &records[m], sizeof(entry));
 
-                    hdr.last_index = m - 1;
+                    store_release(hdr.last_index, m - 1);
                     clflush((char *)&(hdr.last_index), sizeof(int16_t));
 
                     num_entries = hdr.last_index + 1;
 
-                    page *ret;
+                    page *ret = NULL;
 
                     // insert the key for internal node
                     if (hdr.leftmost_ptr != NULL) {
@@ -824,7 +901,7 @@ class page{
                     }
 
                     // Set a new root or insert the split key to the parent
-                    if(bt->root == (char *)this) { // only one node can update the root ptr
+                    if(load_acquire(bt->root) == (char *)this) { // only one node can update the root ptr
                         page* new_root = new page((page*)this, split_key, sibling,
                                 hdr.level + 1);
                         bt->setNewRoot((char *)new_root);
@@ -867,7 +944,7 @@ class page{
         // Insert a new string key - FAST and FAIR
         page *store
             (btree* bt, char* left, key_item *key, char* right,
-             bool flush, bool with_lock, page *invalid_sibling = NULL) __attribute__((optimize(0))) {
+             bool flush, bool with_lock, page *invalid_sibling = NULL) {
                 if(with_lock) {
                     hdr.mtx->lock(); // Lock the write lock
                 }
@@ -961,22 +1038,22 @@ class page{
 
                     // set to NULL
                     if(IS_FORWARD(hdr.switch_counter))
-                        hdr.switch_counter++;
+                        store_release(hdr.switch_counter, hdr.switch_counter + 1);
                     else
-                        hdr.switch_counter += 2;
+                        store_release(hdr.switch_counter, hdr.switch_counter + 2);
                     mfence();
-                    hdr.sibling_ptr = sibling;
+                    store_release(hdr.sibling_ptr, sibling);
                     clflush((char*) &hdr, sizeof(hdr));
 
-                    records[m].ptr = NULL;
+                    store_release(records[m].ptr, NULL);
                     clflush((char*) &records[m], sizeof(entry));
 
-                    hdr.last_index = m - 1;
+                    store_release(hdr.last_index, m - 1);
                     clflush((char *)&(hdr.last_index), sizeof(int16_t));
 
                     num_entries = hdr.last_index + 1;
 
-                    page *ret;
+                    page *ret = NULL;
 
                     if (hdr.leftmost_ptr != NULL) {
                         // insert the key for internal node
@@ -992,7 +1069,7 @@ class page{
                     }
 
                     // Set a new root or insert the split key to the parent
-                    if(bt->root == (char *)this) { // only one node can update the root ptr
+                    if(load_acquire(bt->root) == (char *)this) { // only one node can update the root ptr
                         page* new_root = new page((page*)this, split_key, sibling,
                                 hdr.level + 1);
                         bt->setNewRoot((char *)new_root);
@@ -1033,9 +1110,119 @@ class page{
 
             }
 
+#ifdef FASTFAIR_SIMD_SEARCH
+#ifndef USE_AVX512
+        // Entries i and i + 1; the ones past records[] are read as zero
+        inline __m256i load_pair(int i) {
+            if(i + 1 < cardinality)
+                return _mm256_loadu_si256((const __m256i *)&records[i]);
+            else if(i < cardinality)
+                return _mm256_maskload_epi64((const long long *)&records[i], _mm256_setr_epi64x(-1, -1, 0, 0));
+            return _mm256_setzero_si256();
+        }
+#endif
+
+        // Compares key with the keys of all entries at once instead of one
+        // entry after the other. Sets bit i for each entry i before the NULL
+        // ptr that ends records[] whose key equals (eq) or is greater than key,
+        // and stores the index of the NULL ptr in end. Nothing branches on the
+        // keys, so the position of key in the page is not mispredicted. This is
+        // a snapshot: callers only take the entries as candidates and check the
+        // one they pick with the duplicate ptr rule
+        inline uint32_t key_mask(uint64_t key, bool eq, int &end) {
+            static_assert(cardinality < 32, "a page has more entries than the mask has bits");
+            uint32_t m = 0, null = 0;
+#ifdef USE_AVX512
+            // gathers the keys and the ptrs of eight entries in two vectors;
+            // the entries past records[] are read as zero and end the page
+            const __m512i keys = _mm512_setr_epi64(0, 2, 4, 6, 8, 10, 12, 14);
+            const __m512i ptrs = _mm512_setr_epi64(1, 3, 5, 7, 9, 11, 13, 15);
+            const __m512i probe = _mm512_set1_epi64(key);
+            for(int i = 0; i < cardinality; i += 8) {
+                int left = cardinality - i;
+                __mmask8 lo_lanes = (left >= 4) ? 0xFF : (__mmask8)((1 << (2 * left)) - 1);
+                __mmask8 hi_lanes = (left >= 8) ? 0xFF : (left <= 4) ? 0 : (__mmask8)((1 << (2 * (left - 4))) - 1);
+                __m512i lo = _mm512_maskz_loadu_epi64(lo_lanes, &records[i]);
+                __m512i hi = _mm512_maskz_loadu_epi64(hi_lanes, &records[i + 4]);
+                __m512i k = _mm512_permutex2var_epi64(lo, keys, hi);
+                __m512i p = _mm512_permutex2var_epi64(lo, ptrs, hi);
+                m |= (uint32_t)(eq ? _mm512_cmpeq_epu64_mask(k, probe) : _mm512_cmpgt_epu64_mask(k, probe)) << i;
+                null |= (uint32_t)_mm512_cmpeq_epu64_mask(p, _mm512_setzero_si512()) << i;
+            }
+#else
+            // the same with four entries in two vectors; AVX2 only compares signed
+            const __m256i sign = _mm256_set1_epi64x(INT64_MIN);
+            const __m256i probe = _mm256_xor_si256(_mm256_set1_epi64x(key), sign);
+            for(int i = 0; i < cardinality; i += 4) {
+                __m256i lo = load_pair(i), hi = load_pair(i + 2);
+                __m256i k = _mm256_permute4x64_epi64(_mm256_unpacklo_epi64(lo, hi), 0xD8);
+                __m256i p = _mm256_permute4x64_epi64(_mm256_unpackhi_epi64(lo, hi), 0xD8);
+                k = _mm256_xor_si256(k, sign);
+                __m256i c = eq ? _mm256_cmpeq_epi64(k, probe) : _mm256_cmpgt_epi64(k, probe);
+                m |= _mm256_movemask_pd(_mm256_castsi256_pd(c)) << i;
+                null |= _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(p, _mm256_setzero_si256()))) << i;
+            }
+#endif
+            end = __builtin_ctz(null);
+            return m & ((1U << end) - 1);
+        }
+
+        // Forward search of a leaf node for key; NULL if no entry holds it
+        char *leaf_search_simd(uint64_t key) {
+            int end;
+            for(uint32_t m = key_mask(key, true, end); m; m &= m - 1) {
+                int j = __builtin_ctz(m);
+                char *t = load_acquire(records[j].ptr);
+                char *prev = (j == 0) ? NULL : load_acquire(records[j - 1].ptr);
+                if(t != NULL && t != prev && load_acquire(records[j].key.ikey) == key)
+                    return t;
+            }
+            return NULL;
+        }
+
+        // Forward search of an internal node for the child covering key; NULL if
+        // the entry before the chosen one is no longer smaller than key because
+        // the node changed after the snapshot
+        char *internal_search_simd(uint64_t key) {
+            int end, j = 0;
+            char *t = NULL;
+            for(uint32_t m = key_mask(key, false, end); m; m &= m - 1) {
+                j = __builtin_ctz(m);
+                t = (j == 0) ? (char *)hdr.leftmost_ptr : load_acquire(records[j - 1].ptr);
+                if(t != load_acquire(records[j].ptr))
+                    break;
+                t = NULL;
+            }
+
+            if(t == NULL) {
+                // no greater key, the last child
+                if(end == 0)
+                    return NULL;
+                j = end;
+                t = load_acquire(records[end - 1].ptr);
+            }
+
+            if(j > 0 && load_acquire(records[j - 1].key.ikey) > key)
+                return NULL;
+            return t;
+        }
+
+        // Index of the first entry whose key is greater than key, where a range
+        // scan from key starts; 0 if the node changed after the snapshot
+        int first_greater_simd(uint64_t key) {
+            int end;
+            uint32_t m = key_mask(key, false, end);
+            int j = m ? __builtin_ctz(m) : end;
+
+            if(j > 0 && load_acquire(records[j - 1].key.ikey) > key)
+                return 0;
+            return j;
+        }
+#endif
+
         // Search integer keys with linear search
         void linear_search_range
-            (uint64_t min, uint64_t max, unsigned long *buf, int num, int &off) __attribute__((optimize(0))) {
+            (uint64_t min, uint64_t max, unsigned long *buf, int num, int &off) {
                 int i;
                 uint32_t previous_switch_counter;
                 page *current = this;
@@ -1044,20 +1231,26 @@ class page{
 
                 while(current) {
                     int old_off = off;
-                    snapshot_n = current->hdr.sibling_ptr;
+                    snapshot_n = load_acquire(current->hdr.sibling_ptr);
                     mfence();
                     do {
-                        previous_switch_counter = current->hdr.switch_counter;
+                        previous_switch_counter = load_acquire(current->hdr.switch_counter);
                         off = old_off;
 
                         uint64_t tmp_key;
                         char *tmp_ptr;
 
                         if(IS_FORWARD(previous_switch_counter)) {
-                            if((tmp_key = current->records[0].key.ikey) > min) {
+                            int start = 0;
+#ifdef FASTFAIR_SIMD_SEARCH
+                            // only the first leaf has keys not greater than min
+                            if(current == this)
+                                start = current->first_greater_simd(min);
+#endif
+                            if(start == 0 && (tmp_key = load_acquire(current->records[0].key.ikey)) > min) {
                                 if(tmp_key < max && off < num) {
-                                    if((tmp_ptr = current->records[0].ptr) != NULL) {
-                                        if(tmp_key == current->records[0].key.ikey) {
+                                    if((tmp_ptr = load_acquire(current->records[0].ptr)) != NULL) {
+                                        if(tmp_key == load_acquire(current->records[0].key.ikey)) {
                                             if(tmp_ptr) {
                                                 buf[off++] = (unsigned long)tmp_ptr;
                                             }
@@ -1068,11 +1261,11 @@ class page{
                                     return;
                             }
 
-                            for(i=1; current->records[i].ptr != NULL; ++i) {
-                                if((tmp_key = current->records[i].key.ikey) > min) {
+                            for(i = std::max(start, 1); load_acquire(current->records[i].ptr) != NULL; ++i) {
+                                if((tmp_key = load_acquire(current->records[i].key.ikey)) > min) {
                                     if(tmp_key < max && off < num) {
-                                        if((tmp_ptr = current->records[i].ptr) != current->records[i - 1].ptr) {
-                                            if(tmp_key == current->records[i].key.ikey) {
+                                        if((tmp_ptr = load_acquire(current->records[i].ptr)) != load_acquire(current->records[i - 1].ptr)) {
+                                            if(tmp_key == load_acquire(current->records[i].key.ikey)) {
                                                 if(tmp_ptr) {
                                                     buf[off++] = (unsigned long)tmp_ptr;
                                                 }
@@ -1086,10 +1279,10 @@ class page{
                         }
                         else {
                             for(i = current->count() - 1; i > 0; --i) {
-                                if((tmp_key = current->records[i].key.ikey) > min) {
+                                if((tmp_key = load_acquire(current->records[i].key.ikey)) > min) {
                                     if(tmp_key < max && off < num) {
-                                        if((tmp_ptr = current->records[i].ptr) != current->records[i - 1].ptr) {
-                                            if(tmp_key == current->records[i].key.ikey) {
+                                        if((tmp_ptr = load_acquire(current->records[i].ptr)) != load_acquire(current->records[i - 1].ptr)) {
+                                            if(tmp_key == load_acquire(current->records[i].key.ikey)) {
                                                 if(tmp_ptr) {
                                                     buf[off++] = (unsigned long)tmp_ptr;
                                                 }
@@ -1101,10 +1294,10 @@ class page{
                                 }
                             }
 
-                            if((tmp_key = current->records[0].key.ikey) > min) {
+                            if((tmp_key = load_acquire(current->records[0].key.ikey)) > min) {
                                 if(tmp_key < max && off < num) {
-                                    if((tmp_ptr = current->records[0].ptr) != NULL) {
-                                        if(tmp_key == current->records[0].key.ikey) {
+                                    if((tmp_ptr = load_acquire(current->records[0].ptr)) != NULL) {
+                                        if(tmp_key == load_acquire(current->records[0].key.ikey)) {
                                             if(tmp_ptr) {
                                                 buf[off++] = (unsigned long)tmp_ptr;
                                             }
@@ -1115,10 +1308,14 @@ class page{
                                     return;
                             }
                         }
-                    } while(previous_switch_counter != current->hdr.switch_counter);
+                    } while(previous_switch_counter != load_acquire(current->hdr.switch_counter));
 
-                    if (snapshot_n == current->hdr.sibling_ptr)
-                        current = current->hdr.sibling_ptr;
+                    // A deleted sibling is being merged into the current
+                    // page, scan the current page again until it is done
+                    page *next = load_acquire(current->hdr.sibling_ptr);
+                    if (snapshot_n == next && (next == NULL || !load_acquire(next->hdr.is_deleted) ||
+                                load_acquire(current->hdr.is_deleted)))
+                        current = next;
                     else
                         off = old_off;
                 }
@@ -1126,7 +1323,7 @@ class page{
 
         // Search string keys with linear search
         void linear_search_range
-            (key_item *min, key_item *max, unsigned long *buf, int num, int &off) __attribute__((optimize(0))) {
+            (key_item *min, key_item *max, unsigned long *buf, int num, int &off) {
                 int i;
                 uint32_t previous_switch_counter;
                 page *current = this;
@@ -1135,23 +1332,23 @@ class page{
 
                 while(current) {
                     int old_off = off;
-                    snapshot_n = current->hdr.sibling_ptr;
+                    snapshot_n = load_acquire(current->hdr.sibling_ptr);
                     mfence();
                     do {
-                        previous_switch_counter = current->hdr.switch_counter;
+                        previous_switch_counter = load_acquire(current->hdr.switch_counter);
                         off = old_off;
 
                         key_item *tmp_key;
                         char *tmp_ptr;
 
                         if(IS_FORWARD(previous_switch_counter)) {
-                            tmp_key = current->records[0].key.skey;
+                            tmp_key = load_acquire(current->records[0].key.skey);
                             if(memcmp(tmp_key->key, min->key, std::min(tmp_key->key_len, min->key_len)) > 0) {
                                 //if(memcmp(tmp_key->key, max->key, std::min(tmp_key->key_len, max->key_len)) < 0 && off < num) {
                                 if(off < num) {
-                                    if((tmp_ptr = current->records[0].ptr) != NULL) {
-                                        if(memcmp(tmp_key->key, current->records[0].key.skey->key,
-                                                    std::min(tmp_key->key_len, current->records[0].key.skey->key_len)) == 0) {
+                                    if((tmp_ptr = load_acquire(current->records[0].ptr)) != NULL) {
+                                        if(memcmp(tmp_key->key, load_acquire(current->records[0].key.skey)->key,
+                                                    std::min(tmp_key->key_len, load_acquire(current->records[0].key.skey)->key_len)) == 0) {
                                             if(tmp_ptr) {
                                                 buf[off++] = (unsigned long)tmp_ptr;
                                             }
@@ -1162,14 +1359,14 @@ class page{
                                     return;
                             }
 
-                            for(i=1; current->records[i].ptr != NULL; ++i) {
-                                tmp_key = current->records[i].key.skey;
+                            for(i=1; load_acquire(current->records[i].ptr) != NULL; ++i) {
+                                tmp_key = load_acquire(current->records[i].key.skey);
                                 if(memcmp(tmp_key->key, min->key, std::min(tmp_key->key_len, min->key_len)) > 0) {
                                     //if(memcmp(tmp_key->key, max->key, std::min(tmp_key->key_len, max->key_len)) < 0 && off < num) {
                                     if(off < num) {
-                                        if((tmp_ptr = current->records[i].ptr) != current->records[i - 1].ptr) {
-                                            if(memcmp(tmp_key->key, current->records[i].key.skey->key,
-                                                        std::min(tmp_key->key_len, current->records[i].key.skey->key_len)) == 0) {
+                                        if((tmp_ptr = load_acquire(current->records[i].ptr)) != load_acquire(current->records[i - 1].ptr)) {
+                                            if(memcmp(tmp_key->key, load_acquire(current->records[i].key.skey)->key,
+                                                        std::min(tmp_key->key_len, load_acquire(current->records[i].key.skey)->key_len)) == 0) {
                                                 if(tmp_ptr) {
                                                     buf[off++] = (unsigned long)tmp_ptr;
                                                 }
@@ -1183,12 +1380,12 @@ class page{
                         }
                         else {
                             for(i = current->count() - 1; i > 0; --i) {
-                                tmp_key = current->records[i].key.skey;
+                                tmp_key = load_acquire(current->records[i].key.skey);
                                 if(memcmp(tmp_key->key, min->key, std::min(tmp_key->key_len, min->key_len)) > 0 && off < num) {
                                     //if(memcmp(tmp_key->key, max->key, std::min(tmp_key->key_len, max->key_len)) < 0 && off < num) {
                                     if(off < num) {
-                                        if((tmp_ptr = current->records[i].ptr) != current->records[i - 1].ptr) {
-                                            if(memcmp(tmp_key->key, current->records[i].key.skey->key, std::min(tmp_key->key_len, current->records[i].key.skey->key_len)) == 0) {
+                                        if((tmp_ptr = load_acquire(current->records[i].ptr)) != load_acquire(current->records[i - 1].ptr)) {
+                                            if(memcmp(tmp_key->key, load_acquire(current->records[i].key.skey)->key, std::min(tmp_key->key_len, load_acquire(current->records[i].key.skey)->key_len)) == 0) {
                                                 if(tmp_ptr) {
                                                     buf[off++] = (unsigned long)tmp_ptr;
                                                 }
@@ -1200,12 +1397,12 @@ class page{
                                 }
                             }
 
-                            tmp_key = current->records[0].key.skey;
+                            tmp_key = load_acquire(current->records[0].key.skey);
                             if(memcmp(tmp_key->key, min->key, std::min(tmp_key->key_len, min->key_len)) > 0 && off < num) {
                                 //if(memcmp(tmp_key->key, max->key, std::min(tmp_key->key_len, min->key_len)) < 0 && off < num) {
                                 if(off < num) {
-                                    if((tmp_ptr = current->records[0].ptr) != NULL) {
-                                        if(memcmp(tmp_key->key, current->records[0].key.skey->key, std::min(tmp_key->key_len, current->records[0].key.skey->key_len)) == 0) {
+                                    if((tmp_ptr = load_acquire(current->records[0].ptr)) != NULL) {
+                                        if(memcmp(tmp_key->key, load_acquire(current->records[0].key.skey)->key, std::min(tmp_key->key_len, load_acquire(current->records[0].key.skey)->key_len)) == 0) {
                                             if(tmp_ptr) {
                                                 buf[off++] = (unsigned long)tmp_ptr;
                                             }
@@ -1216,16 +1413,20 @@ class page{
                                     return;
                             }
                         }
-                    } while(previous_switch_counter != current->hdr.switch_counter);
+                    } while(previous_switch_counter != load_acquire(current->hdr.switch_counter));
 
-                    if (snapshot_n == current->hdr.sibling_ptr)
-                        current = current->hdr.sibling_ptr;
+                    // A deleted sibling is being merged into the current
+                    // page, scan the current page again until it is done
+                    page *next = load_acquire(current->hdr.sibling_ptr);
+                    if (snapshot_n == next && (next == NULL || !load_acquire(next->hdr.is_deleted) ||
+                                load_acquire(current->hdr.is_deleted)))
+                        current = next;
                     else
                         off = old_off;
                 }
             }
 
-        char *linear_search(btree *bt, uint64_t key) __attribute__((optimize(0))) {
+        char *linear_search(btree *bt, uint64_t key) {
             int i = 1;
             uint32_t previous_switch_counter;
             char *ret = NULL;
@@ -1234,24 +1435,29 @@ class page{
 
             if(hdr.leftmost_ptr == NULL) { // Search a leaf node
                 do {
-                    previous_switch_counter = hdr.switch_counter;
+                    previous_switch_counter = load_acquire(hdr.switch_counter);
                     ret = NULL;
 
                     // search from left ro right
                     if(IS_FORWARD(previous_switch_counter)) {
-                        if((k = records[0].key.ikey) == key) {
-                            if((t = records[0].ptr) != NULL) {
-                                if(k == records[0].key.ikey) {
+#ifdef FASTFAIR_SIMD_SEARCH
+                        if((ret = leaf_search_simd(key)) != NULL) {
+                            continue;
+                        }
+#endif
+                        if((k = load_acquire(records[0].key.ikey)) == key) {
+                            if((t = load_acquire(records[0].ptr)) != NULL) {
+                                if(k == load_acquire(records[0].key.ikey)) {
                                     ret = t;
                                     continue;
                                 }
                             }
                         }
 
-                        for(i=1; records[i].ptr != NULL; ++i) {
-                            if((k = records[i].key.ikey) == key) {
-                                if(records[i-1].ptr != (t = records[i].ptr)) {
-                                    if(k == records[i].key.ikey) {
+                        for(i=1; load_acquire(records[i].ptr) != NULL; ++i) {
+                            if((k = load_acquire(records[i].key.ikey)) == key) {
+                                if(load_acquire(records[i-1].ptr) != (t = load_acquire(records[i].ptr))) {
+                                    if(k == load_acquire(records[i].key.ikey)) {
                                         ret = t;
                                         break;
                                     }
@@ -1261,9 +1467,9 @@ class page{
                     }
                     else { // search from right to left
                         for(i = count() - 1; i > 0; --i) {
-                            if((k = records[i].key.ikey) == key) {
-                                if(records[i - 1].ptr != (t = records[i].ptr) && t) {
-                                    if(k == records[i].key.ikey) {
+                            if((k = load_acquire(records[i].key.ikey)) == key) {
+                                if(load_acquire(records[i - 1].ptr) != (t = load_acquire(records[i].ptr)) && t) {
+                                    if(k == load_acquire(records[i].key.ikey)) {
                                         ret = t;
                                         break;
                                     }
@@ -1272,9 +1478,9 @@ class page{
                         }
 
                         if(!ret) {
-                            if((k = records[0].key.ikey) == key) {
-                                if(NULL != (t = records[0].ptr) && t) {
-                                    if(k == records[0].key.ikey) {
+                            if((k = load_acquire(records[0].key.ikey)) == key) {
+                                if(NULL != (t = load_acquire(records[0].ptr)) && t) {
+                                    if(k == load_acquire(records[0].key.ikey)) {
                                         ret = t;
                                         continue;
                                     }
@@ -1282,18 +1488,18 @@ class page{
                             }
                         }
                     }
-                } while(IS_FORWARD(hdr.switch_counter) != IS_FORWARD(previous_switch_counter));
+                } while(IS_FORWARD(load_acquire(hdr.switch_counter)) != IS_FORWARD(previous_switch_counter));
 
                 if(ret) {
                     return ret;
                 }
 
-                if((t = (char *)hdr.sibling_ptr) && key >= ((page *)t)->hdr.highest.ikey) {
+                if((t = (char *)load_acquire(hdr.sibling_ptr)) && key >= ((page *)t)->hdr.highest.ikey) {
                     hdr.mtx->lock();
-                    hdr.sibling_ptr->hdr.mtx->lock();
-                    bt->btree_insert_internal((char *)this, hdr.sibling_ptr->hdr.highest.ikey,
-                            (char *)hdr.sibling_ptr, hdr.level + 1);
-                    hdr.sibling_ptr->hdr.mtx->unlock();
+                    load_acquire(hdr.sibling_ptr)->hdr.mtx->lock();
+                    bt->btree_insert_internal((char *)this, load_acquire(hdr.sibling_ptr)->hdr.highest.ikey,
+                            (char *)load_acquire(hdr.sibling_ptr), hdr.level + 1);
+                    load_acquire(hdr.sibling_ptr)->hdr.mtx->unlock();
                     hdr.mtx->unlock();
                     return t;
                 }
@@ -1302,20 +1508,25 @@ class page{
             }
             else { // internal node
                 do {
-                    previous_switch_counter = hdr.switch_counter;
+                    previous_switch_counter = load_acquire(hdr.switch_counter);
                     ret = NULL;
 
                     if(IS_FORWARD(previous_switch_counter)) {
-                        if(key < (k = records[0].key.ikey)) {
-                            if((t = (char *)hdr.leftmost_ptr) != records[0].ptr) {
+#ifdef FASTFAIR_SIMD_SEARCH
+                        if((ret = internal_search_simd(key)) != NULL) {
+                            continue;
+                        }
+#endif
+                        if(key < (k = load_acquire(records[0].key.ikey))) {
+                            if((t = (char *)hdr.leftmost_ptr) != load_acquire(records[0].ptr)) {
                                 ret = t;
                                 continue;
                             }
                         }
 
-                        for(i = 1; records[i].ptr != NULL; ++i) {
-                            if(key < (k = records[i].key.ikey)) {
-                                if((t = records[i-1].ptr) != records[i].ptr) {
+                        for(i = 1; load_acquire(records[i].ptr) != NULL; ++i) {
+                            if(key < (k = load_acquire(records[i].key.ikey))) {
+                                if((t = load_acquire(records[i-1].ptr)) != load_acquire(records[i].ptr)) {
                                     ret = t;
                                     break;
                                 }
@@ -1323,21 +1534,21 @@ class page{
                         }
 
                         if(!ret) {
-                            ret = records[i - 1].ptr;
+                            ret = load_acquire(records[i - 1].ptr);
                             continue;
                         }
                     }
                     else { // search from right to left
                         for(i = count() - 1; i >= 0; --i) {
-                            if(key >= (k = records[i].key.ikey)) {
+                            if(key >= (k = load_acquire(records[i].key.ikey))) {
                                 if(i == 0) {
-                                    if((char *)hdr.leftmost_ptr != (t = records[i].ptr)) {
+                                    if((char *)hdr.leftmost_ptr != (t = load_acquire(records[i].ptr))) {
                                         ret = t;
                                         break;
                                     }
                                 }
                                 else {
-                                    if(records[i - 1].ptr != (t = records[i].ptr)) {
+                                    if(load_acquire(records[i - 1].ptr) != (t = load_acquire(records[i].ptr))) {
                                         ret = t;
                                         break;
                                     }
@@ -1345,15 +1556,15 @@ class page{
                             }
                         }
                     }
-                } while(IS_FORWARD(hdr.switch_counter) != IS_FORWARD(previous_switch_counter));
+                } while(IS_FORWARD(load_acquire(hdr.switch_counter)) != IS_FORWARD(previous_switch_counter));
 
-                if((t = (char *)hdr.sibling_ptr) != NULL) {
+                if((t = (char *)load_acquire(hdr.sibling_ptr)) != NULL) {
                     if(key >= ((page *)t)->hdr.highest.ikey) {
                         hdr.mtx->lock();
-                        hdr.sibling_ptr->hdr.mtx->lock();
-                        bt->btree_insert_internal((char *)this, hdr.sibling_ptr->hdr.highest.ikey,
-                                (char *)hdr.sibling_ptr, hdr.level + 1);
-                        hdr.sibling_ptr->hdr.mtx->unlock();
+                        load_acquire(hdr.sibling_ptr)->hdr.mtx->lock();
+                        bt->btree_insert_internal((char *)this, load_acquire(hdr.sibling_ptr)->hdr.highest.ikey,
+                                (char *)load_acquire(hdr.sibling_ptr), hdr.level + 1);
+                        load_acquire(hdr.sibling_ptr)->hdr.mtx->unlock();
                         hdr.mtx->unlock();
                         return t;
                     }
@@ -1370,7 +1581,7 @@ class page{
         }
 
 
-        char *linear_search(uint64_t key) __attribute__((optimize(0))) {
+        char *linear_search(uint64_t key) {
             int i = 1;
             uint32_t previous_switch_counter;
             char *ret = NULL;
@@ -1379,24 +1590,29 @@ class page{
 
             if(hdr.leftmost_ptr == NULL) { // Search a leaf node
                 do {
-                    previous_switch_counter = hdr.switch_counter;
+                    previous_switch_counter = load_acquire(hdr.switch_counter);
                     ret = NULL;
 
                     // search from left ro right
                     if(IS_FORWARD(previous_switch_counter)) {
-                        if((k = records[0].key.ikey) == key) {
-                            if((t = records[0].ptr) != NULL) {
-                                if(k == records[0].key.ikey) {
+#ifdef FASTFAIR_SIMD_SEARCH
+                        if((ret = leaf_search_simd(key)) != NULL) {
+                            continue;
+                        }
+#endif
+                        if((k = load_acquire(records[0].key.ikey)) == key) {
+                            if((t = load_acquire(records[0].ptr)) != NULL) {
+                                if(k == load_acquire(records[0].key.ikey)) {
                                     ret = t;
                                     continue;
                                 }
                             }
                         }
 
-                        for(i=1; records[i].ptr != NULL; ++i) {
-                            if((k = records[i].key.ikey) == key) {
-                                if(records[i-1].ptr != (t = records[i].ptr)) {
-                                    if(k == records[i].key.ikey) {
+                        for(i=1; load_acquire(records[i].ptr) != NULL; ++i) {
+                            if((k = load_acquire(records[i].key.ikey)) == key) {
+                                if(load_acquire(records[i-1].ptr) != (t = load_acquire(records[i].ptr))) {
+                                    if(k == load_acquire(records[i].key.ikey)) {
                                         ret = t;
                                         break;
                                     }
@@ -1406,9 +1622,9 @@ class page{
                     }
                     else { // search from right to left
                         for(i = count() - 1; i > 0; --i) {
-                            if((k = records[i].key.ikey) == key) {
-                                if(records[i - 1].ptr != (t = records[i].ptr) && t) {
-                                    if(k == records[i].key.ikey) {
+                            if((k = load_acquire(records[i].key.ikey)) == key) {
+                                if(load_acquire(records[i - 1].ptr) != (t = load_acquire(records[i].ptr)) && t) {
+                                    if(k == load_acquire(records[i].key.ikey)) {
                                         ret = t;
                                         break;
                                     }
@@ -1417,9 +1633,9 @@ class page{
                         }
 
                         if(!ret) {
-                            if((k = records[0].key.ikey) == key) {
-                                if(NULL != (t = records[0].ptr) && t) {
-                                    if(k == records[0].key.ikey) {
+                            if((k = load_acquire(records[0].key.ikey)) == key) {
+                                if(NULL != (t = load_acquire(records[0].ptr)) && t) {
+                                    if(k == load_acquire(records[0].key.ikey)) {
                                         ret = t;
                                         continue;
                                     }
@@ -1427,34 +1643,45 @@ class page{
                             }
                         }
                     }
-                } while(IS_FORWARD(hdr.switch_counter) != IS_FORWARD(previous_switch_counter));
+                } while(IS_FORWARD(load_acquire(hdr.switch_counter)) != IS_FORWARD(previous_switch_counter));
 
                 if(ret) {
                     return ret;
                 }
 
-                if((t = (char *)hdr.sibling_ptr) && key >= ((page *)t)->hdr.highest.ikey) {
+                if((t = (char *)load_acquire(hdr.sibling_ptr)) && key >= ((page *)t)->hdr.highest.ikey) {
                     return t;
                 }
 
+                // The entries of the right sibling might have been merged into
+                // this page after it was searched, and the sibling unlinked
+                if(load_acquire(hdr.switch_counter) != previous_switch_counter) {
+                    return linear_search(key);
+                }
+
                 return NULL;
             }
             else { // internal node
                 do {
-                    previous_switch_counter = hdr.switch_counter;
+                    previous_switch_counter = load_acquire(hdr.switch_counter);
                     ret = NULL;
 
                     if(IS_FORWARD(previous_switch_counter)) {
-                        if(key < (k = records[0].key.ikey)) {
-                            if((t = (char *)hdr.leftmost_ptr) != records[0].ptr) {
+#ifdef FASTFAIR_SIMD_SEARCH
+                        if((ret = internal_search_simd(key)) != NULL) {
+                            continue;
+                        }
+#endif
+                        if(key < (k = load_acquire(records[0].key.ikey))) {
+                            if((t = (char *)hdr.leftmost_ptr) != load_acquire(records[0].ptr)) {
                                 ret = t;
                                 continue;
                             }
                         }
 
-                        for(i = 1; records[i].ptr != NULL; ++i) {
-                            if(key < (k = records[i].key.ikey)) {
-                                if((t = records[i-1].ptr) != records[i].ptr) {
+                        for(i = 1; load_acquire(records[i].ptr) != NULL; ++i) {
+                            if(key < (k = load_acquire(records[i].key.ikey))) {
+                                if((t = load_acquire(records[i-1].ptr)) != load_acquire(records[i].ptr)) {
                                     ret = t;
                                     break;
                                 }
@@ -1462,21 +1689,21 @@ class page{
                         }
 
                         if(!ret) {
-                            ret = records[i - 1].ptr;
+                            ret = load_acquire(records[i - 1].ptr);
                             continue;
                         }
                     }
                     else { // search from right to left
                         for(i = count() - 1; i >= 0; --i) {
-                            if(key >= (k = records[i].key.ikey)) {
+                            if(key >= (k = load_acquire(records[i].key.ikey))) {
                                 if(i == 0) {
-                                    if((char *)hdr.leftmost_ptr != (t = records[i].ptr)) {
+                                    if((char *)hdr.leftmost_ptr != (t = load_acquire(records[i].ptr))) {
                                         ret = t;
                                         break;
                                     }
                                 }
                                 else {
-                                    if(records[i - 1].ptr != (t = records[i].ptr)) {
+                                    if(load_acquire(records[i - 1].ptr) != (t = load_acquire(records[i].ptr))) {
                                         ret = t;
                                         break;
                                     }
@@ -1484,9 +1711,9 @@ class page{
                             }
                         }
                     }
-                } while(IS_FORWARD(hdr.switch_counter) != IS_FORWARD(previous_switch_counter));
+                } while(IS_FORWARD(load_acquire(hdr.switch_counter)) != IS_FORWARD(previous_switch_counter));
 
-                if((t = (char *)hdr.sibling_ptr) != NULL) {
+                if((t = (char *)load_acquire(hdr.sibling_ptr)) != NULL) {
                     if(key >= ((page *)t)->hdr.highest.ikey) {
                         return t;
                     }
@@ -1502,7 +1729,7 @@ class page{
             return NULL;
         }
 
-        char *linear_search(btree *bt, key_item *key) __attribute__((optimize(0))) {
+        char *linear_search(btree *bt, key_item *key) {
             int i = 1;
             uint32_t previous_switch_counter;
             char *ret = NULL;
@@ -1511,26 +1738,26 @@ class page{
 
             if(hdr.leftmost_ptr == NULL) { // Search a leaf node
                 do {
-                    previous_switch_counter = hdr.switch_counter;
+                    previous_switch_counter = load_acquire(hdr.switch_counter);
                     ret = NULL;
 
                     // search from left ro right
                     if(IS_FORWARD(previous_switch_counter)) {
-                        k = records[0].key.skey;
+                        k = load_acquire(records[0].key.skey);
                         if(memcmp(k->key, key->key, std::min(k->key_len, key->key_len)) == 0) {
-                            if((t = records[0].ptr) != NULL) {
-                                if(memcmp(k->key, records[0].key.skey->key, std::min(k->key_len, records[0].key.skey->key_len)) == 0) {
+                            if((t = load_acquire(records[0].ptr)) != NULL) {
+                                if(memcmp(k->key, load_acquire(records[0].key.skey)->key, std::min(k->key_len, load_acquire(records[0].key.skey)->key_len)) == 0) {
                                     ret = t;
                                     continue;
                                 }
                             }
                         }
 
-                        for(i=1; records[i].ptr != NULL; ++i) {
-                            k = records[i].key.skey;
+                        for(i=1; load_acquire(records[i].ptr) != NULL; ++i) {
+                            k = load_acquire(records[i].key.skey);
                             if(memcmp(k->key, key->key, std::min(k->key_len, key->key_len)) == 0) {
-                                if(records[i-1].ptr != (t = records[i].ptr)) {
-                                    if(memcmp(k->key, records[i].key.skey->key, std::min(k->key_len, records[i].key.skey->key_len)) == 0) {
+                                if(load_acquire(records[i-1].ptr) != (t = load_acquire(records[i].ptr))) {
+                                    if(memcmp(k->key, load_acquire(records[i].key.skey)->key, std::min(k->key_len, load_acquire(records[i].key.skey)->key_len)) == 0) {
                                         ret = t;
                                         break;
                                     }
@@ -1540,10 +1767,10 @@ class page{
                     }
                     else { // search from right to left
                         for(i = count() - 1; i > 0; --i) {
-                            k = records[i].key.skey;
+                            k = load_acquire(records[i].key.skey);
                             if(memcmp(k->key, key->key, std::min(k->key_len, key->key_len)) == 0) {
-                                if(records[i - 1].ptr != (t = records[i].ptr) && t) {
-                                    if(memcmp(k->key, records[i].key.skey->key, std::min(k->key_len, records[i].key.skey->key_len)) == 0) {
+                                if(load_acquire(records[i - 1].ptr) != (t = load_acquire(records[i].ptr)) && t) {
+                                    if(memcmp(k->key, load_acquire(records[i].key.skey)->key, std::min(k->key_len, load_acquire(records[i].key.skey)->key_len)) == 0) {
                                         ret = t;
                                         break;
                                     }
@@ -1552,10 +1779,10 @@ class page{
                         }
 
                         if(!ret) {
-                            k = records[0].key.skey;
+                            k = load_acquire(records[0].key.skey);
                             if(memcmp(k->key, key->key, std::min(k->key_len, key->key_len)) == 0) {
-                                if(NULL != (t = records[0].ptr) && t) {
-                                    if(memcmp(k->key, records[0].key.skey->key, std::min(k->key_len, records[0].key.skey->key_len)) == 0) {
+                                if(NULL != (t = load_acquire(records[0].ptr)) && t) {
+                                    if(memcmp(k->key, load_acquire(records[0].key.skey)->key, std::min(k->key_len, load_acquire(records[0].key.skey)->key_len)) == 0) {
                                         ret = t;
                                         continue;
                                     }
@@ -1563,18 +1790,18 @@ class page{
                             }
                         }
                     }
-                } while(IS_FORWARD(hdr.switch_counter) != IS_FORWARD(previous_switch_counter));
+                } while(IS_FORWARD(load_acquire(hdr.switch_counter)) != IS_FORWARD(previous_switch_counter));
 
                 if(ret) {
                     return ret;
                 }
 
-                if((t = (char *)hdr.sibling_ptr) && memcmp(key->key, ((page *)t)->hdr.highest.skey->key, std::min(key->key_len, ((page *)t)->hdr.highest.skey->key_len)) >= 0) {
+                if((t = (char *)load_acquire(hdr.sibling_ptr)) && memcmp(key->key, ((page *)t)->hdr.highest.skey->key, std::min(key->key_len, ((page *)t)->hdr.highest.skey->key_len)) >= 0) {
                     hdr.mtx->lock();
-                    hdr.sibling_ptr->hdr.mtx->lock();
-                    bt->btree_insert_internal((char *)this, hdr.sibling_ptr->hdr.highest.skey,
-                            (char *)hdr.sibling_ptr, hdr.level + 1);
-                    hdr.sibling_ptr->hdr.mtx->unlock();
+                    load_acquire(hdr.sibling_ptr)->hdr.mtx->lock();
+                    bt->btree_insert_internal((char *)this, load_acquire(hdr.sibling_ptr)->hdr.highest.skey,
+                            (char *)load_acquire(hdr.sibling_ptr), hdr.level + 1);
+                    load_acquire(hdr.sibling_ptr)->hdr.mtx->unlock();
                     hdr.mtx->unlock();
                     return t;
                 }
@@ -1583,22 +1810,22 @@ class page{
             }
             else { // internal node
                 do {
-                    previous_switch_counter = hdr.switch_counter;
+                    previous_switch_counter = load_acquire(hdr.switch_counter);
                     ret = NULL;
 
                     if(IS_FORWARD(previous_switch_counter)) {
-                        k = records[0].key.skey;
+                        k = load_acquire(records[0].key.skey);
                         if(memcmp(key->key, k->key, std::min(key->key_len, k->key_len)) < 0) {
-                            if((t = (char *)hdr.leftmost_ptr) != records[0].ptr) {
+                            if((t = (char *)hdr.leftmost_ptr) != load_acquire(records[0].ptr)) {
                                 ret = t;
                                 continue;
                             }
                         }
 
-                        for(i = 1; records[i].ptr != NULL; ++i) {
-                            k = records[i].key.skey;
+                        for(i = 1; load_acquire(records[i].ptr) != NULL; ++i) {
+                            k = load_acquire(records[i].key.skey);
                             if(memcmp(key->key, k->key, std::min(key->key_len, k->key_len)) < 0) {
-                                if((t = records[i-1].ptr) != records[i].ptr) {
+                                if((t = load_acquire(records[i-1].ptr)) != load_acquire(records[i].ptr)) {
                                     ret = t;
                                     break;
                                 }
@@ -1606,22 +1833,22 @@ class page{
                         }
 
                         if(!ret) {
-                            ret = records[i - 1].ptr;
+                            ret = load_acquire(records[i - 1].ptr);
                             continue;
                         }
                     }
                     else { // search from right to left
                         for(i = count() - 1; i >= 0; --i) {
-                            k = records[i].key.skey;
+                            k = load_acquire(records[i].key.skey);
                             if(memcmp(key->key, k->key, std::min(key->key_len, k->key_len)) >= 0) {
                                 if(i == 0) {
-                                    if((char *)hdr.leftmost_ptr != (t = records[i].ptr)) {
+                                    if((char *)hdr.leftmost_ptr != (t = load_acquire(records[i].ptr))) {
                                         ret = t;
                                         break;
                                     }
                                 }
                                 else {
-                                    if(records[i - 1].ptr != (t = records[i].ptr)) {
+                                    if(load_acquire(records[i - 1].ptr) != (t = load_acquire(records[i].ptr))) {
                                         ret = t;
                                         break;
                                     }
@@ -1629,15 +1856,15 @@ class page{
                             }
                         }
                     }
-                } while(IS_FORWARD(hdr.switch_counter) != IS_FORWARD(previous_switch_counter));
+                } while(IS_FORWARD(load_acquire(hdr.switch_counter)) != IS_FORWARD(previous_switch_counter));
 
-                if((t = (char *)hdr.sibling_ptr) != NULL) {
+                if((t = (char *)load_acquire(hdr.sibling_ptr)) != NULL) {
                     if(memcmp(key->key, ((page *)t)->hdr.highest.skey->key, std::min(key->key_len, ((page *)t)->hdr.highest.skey->key_len)) >= 0) {
                         hdr.mtx->lock();
-                        hdr.sibling_ptr->hdr.mtx->lock();
-                        bt->btree_insert_internal((char *)this, hdr.sibling_ptr->hdr.highest.skey,
-                                (char *)hdr.sibling_ptr, hdr.level + 1);
-                        hdr.sibling_ptr->hdr.mtx->unlock();
+                        load_acquire(hdr.sibling_ptr)->hdr.mtx->lock();
+                        bt->btree_insert_internal((char *)this, load_acquire(hdr.sibling_ptr)->hdr.highest.skey,
+                                (char *)load_acquire(hdr.sibling_ptr), hdr.level + 1);
+                        load_acquire(hdr.sibling_ptr)->hdr.mtx->unlock();
                         hdr.mtx->unlock();
                         return t;
                     }
@@ -1653,7 +1880,7 @@ class page{
             return NULL;
         }
 
-        char *linear_search(key_item *key) __attribute__((optimize(0))) {
+        char *linear_search(key_item *key) {
             int i = 1;
             uint32_t previous_switch_counter;
             char *ret = NULL;
@@ -1662,26 +1889,26 @@ class page{
 
             if(hdr.leftmost_ptr == NULL) { // Search a leaf node
                 do {
-                    previous_switch_counter = hdr.switch_counter;
+                    previous_switch_counter = load_acquire(hdr.switch_counter);
                     ret = NULL;
 
                     // search from left ro right
                     if(IS_FORWARD(previous_switch_counter)) {
-                        k = records[0].key.skey;
+                        k = load_acquire(records[0].key.skey);
                         if(memcmp(k->key, key->key, std::min(k->key_len, key->key_len)) == 0) {
-                            if((t = records[0].ptr) != NULL) {
-                                if(memcmp(k->key, records[0].key.skey->key, std::min(k->key_len, records[0].key.skey->key_len)) == 0) {
+                            if((t = load_acquire(records[0].ptr)) != NULL) {
+                                if(memcmp(k->key, load_acquire(records[0].key.skey)->key, std::min(k->key_len, load_acquire(records[0].key.skey)->key_len)) == 0) {
                                     ret = t;
                                     continue;
                                 }
                             }
                         }
 
-                        for(i=1; records[i].ptr != NULL; ++i) {
-                            k = records[i].key.skey;
+                        for(i=1; load_acquire(records[i].ptr) != NULL; ++i) {
+                            k = load_acquire(records[i].key.skey);
                             if(memcmp(k->key, key->key, std::min(k->key_len, key->key_len)) == 0) {
-                                if(records[i-1].ptr != (t = records[i].ptr)) {
-                                    if(memcmp(k->key, records[i].key.skey->key, std::min(k->key_len, records[i].key.skey->key_len)) == 0) {
+                                if(load_acquire(records[i-1].ptr) != (t = load_acquire(records[i].ptr))) {
+                                    if(memcmp(k->key, load_acquire(records[i].key.skey)->key, std::min(k->key_len, load_acquire(records[i].key.skey)->key_len)) == 0) {
                                         ret = t;
                                         break;
                                     }
@@ -1691,10 +1918,10 @@ class page{
                     }
                     else { // search from right to left
                         for(i = count() - 1; i > 0; --i) {
-                            k = records[i].key.skey;
+                            k = load_acquire(records[i].key.skey);
                             if(memcmp(k->key, key->key, std::min(k->key_len, key->key_len)) == 0) {
-                                if(records[i - 1].ptr != (t = records[i].ptr) && t) {
-                                    if(memcmp(k->key, records[i].key.skey->key, std::min(k->key_len, records[i].key.skey->key_len)) == 0) {
+                                if(load_acquire(records[i - 1].ptr) != (t = load_acquire(records[i].ptr)) && t) {
+                                    if(memcmp(k->key, load_acquire(records[i].key.skey)->key, std::min(k->key_len, load_acquire(records[i].key.skey)->key_len)) == 0) {
                                         ret = t;
                                         break;
                                     }
@@ -1703,10 +1930,10 @@ class page{
                         }
 
                         if(!ret) {
-                            k = records[0].key.skey;
+                            k = load_acquire(records[0].key.skey);
                             if(memcmp(k->key, key->key, std::min(k->key_len, key->key_len)) == 0) {
-                                if(NULL != (t = records[0].ptr) && t) {
-                                    if(memcmp(k->key, records[0].key.skey->key, std::min(k->key_len, records[0].key.skey->key_len)) == 0) {
+                                if(NULL != (t = load_acquire(records[0].ptr)) && t) {
+                                    if(memcmp(k->key, load_acquire(records[0].key.skey)->key, std::min(k->key_len, load_acquire(records[0].key.skey)->key_len)) == 0) {
                                         ret = t;
                                         continue;
                                     }
@@ -1714,36 +1941,42 @@ class page{
                             }
                         }
                     }
-                } while(IS_FORWARD(hdr.switch_counter) != IS_FORWARD(previous_switch_counter));
+                } while(IS_FORWARD(load_acquire(hdr.switch_counter)) != IS_FORWARD(previous_switch_counter));
 
                 if(ret) {
                     return ret;
                 }
 
-                if((t = (char *)hdr.sibling_ptr) && memcmp(key->key, ((page *)t)->hdr.highest.skey->key, std::min(key->key_len, ((page *)t)->hdr.highest.skey->key_len)) >= 0) {
+                if((t = (char *)load_acquire(hdr.sibling_ptr)) && memcmp(key->key, ((page *)t)->hdr.highest.skey->key, std::min(key->key_len, ((page *)t)->hdr.highest.skey->key_len)) >= 0) {
                     return t;
                 }
 
+                // The entries of the right sibling might have been merged into
+                // this page after it was searched, and the sibling unlinked
+                if(load_acquire(hdr.switch_counter) != previous_switch_counter) {
+                    return linear_search(key);
+                }
+
                 return NULL;
             }
             else { // internal node
                 do {
-                    previous_switch_counter = hdr.switch_counter;
+                    previous_switch_counter = load_acquire(hdr.switch_counter);
                     ret = NULL;
 
                     if(IS_FORWARD(previous_switch_counter)) {
-                        k = records[0].key.skey;
+                        k = load_acquire(records[0].key.skey);
                         if(memcmp(key->key, k->key, std::min(key->key_len, k->key_len)) < 0) {
-                            if((t = (char *)hdr.leftmost_ptr) != records[0].ptr) {
+                            if((t = (char *)hdr.leftmost_ptr) != load_acquire(records[0].ptr)) {
                                 ret = t;
                                 continue;
                             }
                         }
 
-                        for(i = 1; records[i].ptr != NULL; ++i) {
-                            k = records[i].key.skey;
+                        for(i = 1; load_acquire(records[i].ptr) != NULL; ++i) {
+                            k = load_acquire(records[i].key.skey);
                             if(memcmp(key->key, k->key, std::min(key->key_len, k->key_len)) < 0) {
-                                if((t = records[i-1].ptr) != records[i].ptr) {
+                                if((t = load_acquire(records[i-1].ptr)) != load_acquire(records[i].ptr)) {
                                     ret = t;
                                     break;
                                 }
@@ -1751,22 +1984,22 @@ class page{
                         }
 
                         if(!ret) {
-                            ret = records[i - 1].ptr;
+                            ret = load_acquire(records[i - 1].ptr);
                             continue;
                         }
                     }
                     else { // search from right to left
                         for(i = count() - 1; i >= 0; --i) {
-                            k = records[i].key.skey;
+                            k = load_acquire(records[i].key.skey);
                             if(memcmp(key->key, k->key, std::min(key->key_len, k->key_len)) >= 0) {
                                 if(i == 0) {
-                                    if((char *)hdr.leftmost_ptr != (t = records[i].ptr)) {
+                                    if((char *)hdr.leftmost_ptr != (t = load_acquire(records[i].ptr))) {
                                         ret = t;
                                         break;
                                     }
                                 }
                                 else {
-                                    if(records[i - 1].ptr != (t = records[i].ptr)) {
+                                    if(load_acquire(records[i - 1].ptr) != (t = load_acquire(records[i].ptr))) {
                                         ret = t;
                                         break;
                                     }
@@ -1774,9 +2007,9 @@ class page{
                             }
                         }
                     }
-                } while(IS_FORWARD(hdr.switch_counter) != IS_FORWARD(previous_switch_counter));
+                } while(IS_FORWARD(load_acquire(hdr.switch_counter)) != IS_FORWARD(previous_switch_counter));
 
-                if((t = (char *)hdr.sibling_ptr) != NULL) {
+                if((t = (char *)load_acquire(hdr.sibling_ptr)) != NULL) {
                     if(memcmp(key->key, ((page *)t)->hdr.highest.skey->key, std::min(key->key_len, ((page *)t)->hdr.highest.skey->key_len)) >= 0) {
                         return t;
                     }
@@ -1800,11 +2033,20 @@ btree::btree() {
     root = (char*)new page();
     clflush((char *)root, sizeof(page));
     height = 1;
+    compaction_on = false;
+    compaction_stop = true;
+    compaction_thread = NULL;
     clflush((char*)this, sizeof(btree));
 }
 
+btree::~btree() {
+    stop_compaction();
+    for(page *p : retired_pages)
+        delete p;
+}
+
 void btree::setNewRoot(char *new_root) {
-    this->root = (char*)new_root;
+    store_release(this->root, new_root);
     clflush((char *)&this->root, sizeof(char *));
     ++height;
 }
@@ -1824,46 +2066,54 @@ key_item *btree::make_key_item(char *key, size_t key_len, bool flush)
 }
 
 char *btree::btree_search(uint64_t key) {
-    page* p = (page*)root;
+    page* p = (page*)load_acquire(root);
 
     while(p->hdr.leftmost_ptr != NULL) {
         p = (page *)p->linear_search(key);
     }
 
     page *t;
-    while((t = (page *)p->linear_search(key)) == p->hdr.sibling_ptr) {
+    while((t = (page *)p->linear_search(key)) == load_acquire(p->hdr.sibling_ptr)) {
         p = t;
         if(!p) {
             break;
         }
     }
 
+    // The leaf was merged into its left sibling, which has the current value
+    if(p && load_acquire(p->hdr.is_deleted))
+        return btree_search(key);
+
     return (char *)t;
 }
 
 char *btree::btree_search(char *key) {
-    page* p = (page*)root;
+    page *p, *t;
 
     key_item *new_item = make_key_item(key, strlen(key) + 1, false);
 
-    while(p->hdr.leftmost_ptr != NULL) {
-        p = (page *)p->linear_search(new_item);
-    }
+    // The leaf was merged into its left sibling, which has the current value
+    do {
+        p = (page*)load_acquire(root);
 
-    page *t;
-    while((t = (page *)p->linear_search(new_item)) == p->hdr.sibling_ptr) {
-        p = t;
-        if(!p) {
-            break;
+        while(p->hdr.leftmost_ptr != NULL) {
+            p = (page *)p->linear_search(new_item);
         }
-    }
+
+        while((t = (page *)p->linear_search(new_item)) == load_acquire(p->hdr.sibling_ptr)) {
+            p = t;
+            if(!p) {
+                break;
+            }
+        }
+    } while(p && load_acquire(p->hdr.is_deleted));
 
     return (char *)t;
 }
 
 // insert the key in the leaf node
 void btree::btree_insert(uint64_t key, char* right) { //need to be string
-    page* p = (page*)root;
+    page* p = (page*)load_acquire(root);
 
     while(p->hdr.leftmost_ptr != NULL) {
         p = (page*)p->linear_search(this, key);
@@ -1876,7 +2126,7 @@ void btree::btree_insert(uint64_t key, char* right) { //need to be string
 
 // insert the key in the leaf node
 void btree::btree_insert(char *key, char* right) { //need to be string
-    page* p = (page*)root;
+    page* p = (page*)load_acquire(root);
 
     key_item *new_item = make_key_item(key, strlen(key) + 1, true);
 
@@ -1892,10 +2142,10 @@ void btree::btree_insert(char *key, char* right) { //need to be string
 // store the integer key into the node at the given level
 void btree::btree_insert_internal
 (char *left, uint64_t key, char *right, uint32_t level) {
-    if(level > ((page *)root)->hdr.level)
+    if(level > ((page *)load_acquire(root))->hdr.level)
         return;
 
-    page *p = (page *)this->root;
+    page *p = (page *)load_acquire(this->root);
 
     while(p->hdr.level > level)
         p = (page *)p->linear_search(key);
@@ -1908,10 +2158,10 @@ void btree::btree_insert_internal
 // store the string key into the node at the given level
 void btree::btree_insert_internal
 (char *left, key_item *key, char *right, uint32_t level) {
-    if(level > ((page *)root)->hdr.level)
+    if(level > ((page *)load_acquire(root))->hdr.level)
         return;
 
-    page *p = (page *)this->root;
+    page *p = (page *)load_acquire(this->root);
 
     while(p->hdr.level > level)
         p = (page *)p->linear_search(key);
@@ -1922,14 +2172,14 @@ void btree::btree_insert_internal
 }
 
 void btree::btree_delete(uint64_t key) {
-    page* p = (page*)root;
+    page* p = (page*)load_acquire(root);
 
     while(p->hdr.leftmost_ptr != NULL){
         p = (page*) p->linear_search(key);
     }
 
     page *t;
-    while((t = (page *)p->linear_search(key)) == p->hdr.sibling_ptr) {
+    while((t = (page *)p->linear_search(key)) == load_acquire(p->hdr.sibling_ptr)) {
         p = t;
         if(!p)
             break;
@@ -1944,14 +2194,153 @@ void btree::btree_delete(uint64_t key) {
         printf("not found the key to delete %lu\n", key);
     }
 }
+
+// Starts a thread that merges leaves left underfull by deletes into a
+// sibling, so that the tree shrinks again under delete-heavy workloads.
+// Deletes only queue the leaf; only leaves with the same parent are merged
+// and internal pages are left as they are. Works for integer keys only.
+void btree::start_compaction() {
+    std::lock_guard<std::mutex> guard(compaction_mtx);
+    if(compaction_thread != NULL)
+        return;
+
+    compaction_stop = false;
+    compaction_thread = new std::thread(&btree::compaction_run, this);
+    compaction_on = true;
+}
+
+void btree::stop_compaction() {
+    std::thread *thread;
+    {
+        std::lock_guard<std::mutex> guard(compaction_mtx);
+        if(compaction_thread == NULL)
+            return;
+
+        compaction_on = false;
+        compaction_stop = true;
+        thread = compaction_thread;
+        compaction_thread = NULL;
+    }
+    compaction_cv.notify_one();
+    thread->join();
+    delete thread;
+
+    std::lock_guard<std::mutex> guard(compaction_mtx);
+    for(page *p : compaction_queue)
+        p->hdr.queued = false;
+    compaction_queue.clear();
+}
+
+void btree::compaction_enqueue(page *p) {
+    std::lock_guard<std::mutex> guard(compaction_mtx);
+    if(compaction_stop || p->hdr.queued)
+        return;
+
+    p->hdr.queued = true;
+    compaction_queue.push_back(p);
+    compaction_cv.notify_one();
+}
+
+void btree::compaction_run() {
+    std::unique_lock<std::mutex> guard(compaction_mtx);
+    while(true) {
+        compaction_cv.wait(guard, [this] { return compaction_stop || !compaction_queue.empty(); });
+        if(compaction_stop)
+            break;
+
+        page *p = compaction_queue.back();
+        compaction_queue.pop_back();
+        p->hdr.queued = false;
+        guard.unlock();
+
+        // Merge the right sibling into the leaf, otherwise the leaf into
+        // its left sibling (the first leaf has no left sibling)
+        page *right = load_acquire(p->hdr.sibling_ptr);
+        if(!(right != NULL && merge_with_left(right)) && p->hdr.highest.ikey != 0)
+            merge_with_left(p);
+
+        guard.lock();
+    }
+}
+
+// Merges the leaf right into its left sibling, in the same order as
+// remove_rebalancing(): right is marked as deleted, its key is removed from
+// the parent, its entries are inserted into the left sibling and last the
+// left sibling is linked to the right sibling of right. right itself is not
+// changed, readers that end on it search again from the root. The pages are
+// locked from left to right and then the parent, like splits do.
+bool btree::merge_with_left(page *right) {
+    uint64_t key = right->hdr.highest.ikey;
+    page *p = (page *)load_acquire(root);
+    if(key == 0 || p->hdr.level == 0)
+        return false;
+
+    while(p->hdr.level > 1)
+        p = (page *)p->linear_search(key);
+
+    page *left = p->child_before(key, right);
+    if(left == NULL)
+        return false;
+
+    left->hdr.mtx->lock();
+    right->hdr.mtx->lock();
+    p->hdr.mtx->lock();
+
+    // The parent might have been split in the meantime
+    page *next;
+    while((next = p->hdr.sibling_ptr) != NULL && key >= next->hdr.highest.ikey) {
+        next->hdr.mtx->lock();
+        p->hdr.mtx->unlock();
+        p = next;
+    }
+
+    int num_entries = left->count();
+    int num_right = right->count();
+
+    // The parent keeps at least one entry
+    bool valid = !left->hdr.is_deleted && !right->hdr.is_deleted && !p->hdr.is_deleted &&
+        left->hdr.sibling_ptr == right && p->child_before(key, right) == left &&
+        p->count() > 1 && num_entries + num_right <= merge_limit;
+
+    if(valid) {
+        store_release(right->hdr.is_deleted, 1);
+        clflush((char *)&right->hdr, sizeof(header));
+
+        p->remove_key(key);
+
+        for(int i = 0; i < num_right; ++i)
+            left->insert_key(right->records[i].key.ikey, right->records[i].ptr, &num_entries);
+
+        store_release(left->hdr.sibling_ptr, right->hdr.sibling_ptr);
+        clflush((char *)&left->hdr.sibling_ptr, sizeof(page *));
+    }
+
+    p->hdr.mtx->unlock();
+    right->hdr.mtx->unlock();
+    left->hdr.mtx->unlock();
+
+    if(!valid)
+        return false;
+
+    {
+        // Readers might still be on the page, it is freed with the tree
+        std::lock_guard<std::mutex> guard(compaction_mtx);
+        retired_pages.push_back(right);
+    }
+
+    if(num_entries < merge_threshold)
+        compaction_enqueue(left);
+
+    return true;
+}
 #if 0
 void btree::btree_delete_internal
 (entry_key_t key, char *ptr, uint32_t level, entry_key_t *deleted_key,
  bool *is_leftmost_node, page **left_sibling) {
-    if(level > ((page *)this->root)->hdr.level)
+    if(level > ((page *)load_acquire(this->root))->hdr.level)
         return;
 
-    page *p = (page *)this->root;
+    page *p = (page *)load_acquire(this->root);
 
     while(p->hdr.level > level) {
         p = (page *)p->linear_search(key);
@@ -1993,7 +2382,7 @@ void btree::btree_delete_internal
 #endif
 // Function to search integer keys from "min" to "max"
 void btree::btree_search_range (uint64_t min, uint64_t max, unsigned long *buf, int num, int &off) {
-    page *p = (page *)root;
+    page *p = (page *)load_acquire(root);
 
     while(p) {
         if(p->hdr.leftmost_ptr != NULL) {
@@ -2002,6 +2391,11 @@ void btree::btree_search_range (uint64_t min, uint64_t max, unsigned long *buf,
         }
         else {
             // Found a leaf
+            if(load_acquire(p->hdr.is_deleted)) {
+                p = (page *)load_acquire(root);
+                continue;
+            }
+
             p->linear_search_range(min, max, buf, num, off);
 
             break;
@@ -2011,7 +2405,7 @@ void btree::btree_search_range (uint64_t min, uint64_t max, unsigned long *buf,
 
 // Function to search string keys from "min" to "max"
 void btree::btree_search_range (char *min, char *max, unsigned long *buf, int num, int &off) {
-    page *p = (page *)root;
+    page *p = (page *)load_acquire(root);
     key_item *min_item = make_key_item(min, strlen(min) + 1, false);
     key_item *max_item = make_key_item(max, strlen(max) + 1, false);
 
@@ -2022,6 +2416,11 @@ void btree::btree_search_range (char *min, char *max, unsigned long *buf, int nu
         }
         else {
             // Found a leaf
+            if(load_acquire(p->hdr.is_deleted)) {
+                p = (page *)load_acquire(root);
+                continue;
+            }
+
             p->linear_search_range(min_item, max_item, buf, num, off);
 
             break;
@@ -5,28 +5,17 @@
 #include <vector>
 #include <fstream>
 #include <iostream>
+#include <thread>
+#include <atomic>
 #include <stdlib.h>
 #include "tbb/tbb.h"
 
 using namespace std;
 
-#include "P-ART/Tree.h"
-#include "third-party/FAST_FAIR/btree.h"
-#include "third-party/CCEH/src/Level_hashing.h"
-#include "third-party/CCEH/src/CCEH.h"
-#include "third-party/WOART/woart.h"
-#include "masstree.h"
-#include "P-BwTree/src/bwtree.h"
-#include "clht.h"
-#include "ssmem.h"
-
-#ifdef HOT
-#include <hot/rowex/HOTRowex.hpp>
-#include <idx/contenthelpers/IdentityKeyExtractor.hpp>
-#include <idx/contenthelpers/OptionalValue.hpp>
-#endif
-
-using namespace wangziqi2013::bwtree;
+#include "ycsb_adapter.h"
+#include "ycsb_workload.h"
+#include "ycsb_latency.h"
+#include "ycsb_trace.h"
 
 // index types
 enum {
@@ -41,160 +30,12 @@ enum {
     TYPE_WOART,
 };
 
-enum {
-    OP_INSERT,
-    OP_UPDATE,
-    OP_READ,
-    OP_SCAN,
-    OP_DELETE,
-};
-
-enum {
-    WORKLOAD_A,
-    WORKLOAD_B,
-    WORKLOAD_C,
-    WORKLOAD_D,
-    WORKLOAD_E,
-};
-
 enum {
     RANDINT_KEY,
     STRING_KEY,
 };
 
-enum {
-    UNIFORM,
-    ZIPFIAN,
-};
-
-namespace Dummy {
-    inline void mfence() {asm volatile("mfence":::"memory");}
-
-    inline void clflush(char *data, int len, bool front, bool back)
-    {
-        if (front)
-            mfence();
-        volatile char *ptr = (char *)((unsigned long)data & ~(64 - 1));
-        for (; ptr < data+len; ptr += 64){
-#ifdef CLFLUSH
-            asm volatile("clflush %0" : "+m" (*(volatile char *)ptr));
-#elif CLFLUSH_OPT
-            asm volatile(".byte 0x66; clflush %0" : "+m" (*(volatile char *)(ptr)));
-#elif CLWB
-            asm volatile(".byte 0x66; xsaveopt %0" : "+m" (*(volatile char *)(ptr)));
-#endif
-        }
-        if (back)
-            mfence();
-    }
-}
-
-
-////////////////////////Helper functions for P-BwTree/////////////////////////////
-/*
- * class KeyComparator - Test whether BwTree supports context
- *                       sensitive key comparator
- *
- * If a context-sensitive KeyComparator object is being used
- * then it should follow rules like:
- *   1. There could be no default constructor
- *   2. There MUST be a copy constructor
- *   3. operator() must be const
- *
- */
-class KeyComparator {
- public:
-  inline bool operator()(const long int k1, const long int k2) const {
-    return k1 < k2;
-  }
-
-  inline bool operator()(const uint64_t k1, const uint64_t k2) const {
-      return k1 < k2;
-  }
-
-  inline bool operator()(const char *k1, const char *k2) const {
-      return memcmp(k1, k2, strlen(k1) > strlen(k2) ? strlen(k1) : strlen(k2)) < 0;
-  }
-
-  KeyComparator(int dummy) {
-    (void)dummy;
-
-    return;
-  }
-
-  KeyComparator() = delete;
-  //KeyComparator(const KeyComparator &p_key_cmp_obj) = delete;
-};
-
-/*
- * class KeyEqualityChecker - Tests context sensitive key equality
- *                            checker inside BwTree
- *
- * NOTE: This class is only used in KeyEqual() function, and is not
- * used as STL template argument, it is not necessary to provide
- * the object everytime a container is initialized
- */
-class KeyEqualityChecker {
- public:
-  inline bool operator()(const long int k1, const long int k2) const {
-    return k1 == k2;
-  }
-
-  inline bool operator()(uint64_t k1, uint64_t k2) const {
-      return k1 == k2;
-  }
-
-  inline bool operator()(const char *k1, const char *k2) const {
-      if (strlen(k1) != strlen(k2))
-          return false;
-      else
-          return memcmp(k1, k2, strlen(k1)) == 0;
-  }
-
-  KeyEqualityChecker(int dummy) {
-    (void)dummy;
-
-    return;
-  }
-
-  KeyEqualityChecker() = delete;
-  //KeyEqualityChecker(const KeyEqualityChecker &p_key_eq_obj) = delete;
-};
-/////////////////////////////////////////////////////////////////////////////////
-
-////////////////////////Helper functions for P-HOT/////////////////////////////
-typedef struct IntKeyVal {
-    uint64_t key;
-    uintptr_t value;
-} IntKeyVal;
-
-template<typename ValueType = IntKeyVal *>
-class IntKeyExtractor {
-    public:
-    typedef uint64_t KeyType;
-
-    inline KeyType operator()(ValueType const &value) const {
-        return value->key;
-    }
-};
-
-template<typename ValueType = Key *>
-class KeyExtractor {
-    public:
-    typedef char const * KeyType;
-
-    inline KeyType operator()(ValueType const &value) const {
-        return (char const *)value->fkey;
-    }
-};
-/////////////////////////////////////////////////////////////////////////////////
-
-////////////////////////Helper functions for P-CLHT/////////////////////////////
-typedef struct thread_data {
-    uint32_t id;
-    clht_t *ht;
-} thread_data_t;
-
+////////////////////////Helper functions for worker threads/////////////////////
 typedef struct barrier {
     pthread_cond_t complete;
     pthread_mutex_t mutex;
@@ -221,43 +62,147 @@ void barrier_cross(barrier_t *b) {
     pthread_mutex_unlock(&b->mutex);
 }
 
-barrier_t barrier;
 /////////////////////////////////////////////////////////////////////////////////
 
 static uint64_t LOAD_SIZE = 64000000;
 static uint64_t RUN_SIZE = 64000000;
 
-void loadKey(TID tid, Key &key) {
-    return ;
+static latency::Recorder latency_recorder;
+
+/*
+ * run_phase() - Runs the load (LOAD = true, inserts only) or the run phase of
+ *               a workload on num_thread worker threads
+ *
+ * Thread i executes operations [size * i / num_thread, size * (i+1) / num_thread)
+ * in order. All threads enter the index and cross a barrier before the first
+ * operation, so per-thread setup (e.g. GC registration) is not interleaved
+ * with the operations of other threads.
+ */
+template <bool LOAD, typename Adapter, typename KeyType>
+void run_phase(Adapter &index, int num_thread, uint64_t size,
+        KeyType *keys, int *ranges, int *ops)
+{
+    barrier_t barrier;
+    barrier_init(&barrier, num_thread);
+    index.phase_begin(num_thread);
+
+    auto starttime = std::chrono::system_clock::now();
+    auto func = [&](int thread_id) {
+        uint64_t start_key = size * thread_id / num_thread;
+        uint64_t end_key = size * (thread_id + 1) / num_thread;
+
+        auto t = index.thread_enter(thread_id);
+        auto &lat = latency_recorder.local();
+        barrier_cross(&barrier);
+
+        for (uint64_t i = start_key; i < end_key; i++) {
+            int op = LOAD ? OP_INSERT : ops[i];
+            uint64_t lat_start = lat.start();
+            if (op == OP_INSERT) {
+                index.insert(t, keys[i]);
+            } else if (op == OP_READ) {
+                index.read(t, keys[i]);
+            } else if (op == OP_SCAN) {
+                index.scan(t, keys[i], ranges[i]);
+            } else if (op == OP_UPDATE) {
+                index.update(t, keys[i]);
+            } else if (op == OP_DELETE) {
+                index.remove(t, keys[i]);
+            }
+            lat.stop(op, lat_start);
+        }
+        index.thread_exit(t, thread_id);
+    };
+
+    std::vector<std::thread> thread_group;
+
+    for (int i = 0; i < num_thread; i++)
+        thread_group.push_back(std::thread{func, i});
+
+    for (int i = 0; i < num_thread; i++)
+        thread_group[i].join();
+    index.phase_end();
+    auto duration = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::system_clock::now() - starttime);
+    printf("Throughput: %s, %f ,ops/us\n", LOAD ? "load" : "run", (size * 1.0) / duration.count());
+    latency_recorder.report(LOAD ? "load" : "run");
+}
+
+template <typename Adapter, typename KeyType>
+void ycsb_load_run(Adapter &index, int num_thread,
+        KeyType *init_keys, KeyType *keys, int *ranges, int *ops)
+{
+    run_phase<true>(index, num_thread, LOAD_SIZE, init_keys, ranges, ops);
+    run_phase<false>(index, num_thread, RUN_SIZE, keys, ranges, ops);
+}
+
+/*
+ * ycsb_run_index() - Instantiates the index for the key type and runs the
+ *                    workload on it; hash tables other than P-CLHT only
+ *                    support integer keys
+ *
+ * The workload arrays either come from the vectors filled by
+ * ycsb_load_run_randint/string or directly from a mapped trace.
+ */
+template <typename KeyType>
+void ycsb_run_index(int index_type, int ap, int num_thread,
+        KeyType *init_keys, KeyType *keys, int *ranges, int *ops)
+{
+    constexpr bool int_keys = std::is_same<KeyType, uint64_t>::value;
+
+    if (index_type == TYPE_ART) {
+        ArtAdapter index;
+        ycsb_load_run(index, num_thread, init_keys, keys, ranges, ops);
+#ifdef HOT
+    } else if (index_type == TYPE_HOT) {
+        HotAdapter<KeyType> index;
+        ycsb_load_run(index, num_thread, init_keys, keys, ranges, ops);
+#endif
+    } else if (index_type == TYPE_BWTREE) {
+        BwTreeAdapter<KeyType> index;
+        ycsb_load_run(index, num_thread, init_keys, keys, ranges, ops);
+    } else if (index_type == TYPE_MASSTREE) {
+        MasstreeAdapter index(ap == UNIFORM);
+        ycsb_load_run(index, num_thread, init_keys, keys, ranges, ops);
+    } else if (index_type == TYPE_FASTFAIR) {
+        FastFairAdapter index;
+        ycsb_load_run(index, num_thread, init_keys, keys, ranges, ops);
+    } else if (index_type == TYPE_WOART) {
+#ifdef STRING_TYPE
+        if constexpr (!int_keys) {
+#else
+        if constexpr (int_keys) {
+#endif
+            WoartAdapter index;
+            ycsb_load_run(index, num_thread, init_keys, keys, ranges, ops);
+        }
+    } else if (index_type == TYPE_CLHT) {
+        ClhtAdapter index(!int_keys);
+        ycsb_load_run(index, num_thread, init_keys, keys, ranges, ops);
+    } else if constexpr (int_keys) {
+        if (index_type == TYPE_LEVELHASH) {
+            LevelHashAdapter index;
+            ycsb_load_run(index, num_thread, init_keys, keys, ranges, ops);
+        } else if (index_type == TYPE_CCEH) {
+            CCEHAdapter index;
+            ycsb_load_run(index, num_thread, init_keys, keys, ranges, ops);
+        }
+    }
 }
 
 void ycsb_load_run_string(int index_type, int wl, int kt, int ap, int num_thread,
+        workload::WorkloadSpec *gen_spec, const char *dump_file,
         std::vector<Key *> &init_keys,
         std::vector<Key *> &keys,
         std::vector<int> &ranges,
         std::vector<int> &ops)
 {
-    std::string init_file;
-    std::string txn_file;
+    std::string maxKey("z");
+
+    if (gen_spec == NULL) {
+        std::string init_file;
+        std::string txn_file;
 
-    if (ap == UNIFORM) {
-        if (kt == STRING_KEY && wl == WORKLOAD_A) {
-            init_file = "./index-microbench/workloads/ycsbkey_load_workloada";
-            txn_file = "./index-microbench/workloads/ycsbkey_run_workloada";
-        } else if (kt == STRING_KEY && wl == WORKLOAD_B) {
-            init_file = "./index-microbench/workloads/ycsbkey_load_workloadb";
-            txn_file = "./index-microbench/workloads/ycsbkey_run_workloadb";
-        } else if (kt == STRING_KEY && wl == WORKLOAD_C) {
-            init_file = "./index-microbench/workloads/ycsbkey_load_workloadc";
-            txn_file = "./index-microbench/workloads/ycsbkey_run_workloadc";
-        } else if (kt == STRING_KEY && wl == WORKLOAD_D) {
-            init_file = "./index-microbench/workloads/ycsbkey_load_workloadd";
-            txn_file = "./index-microbench/workloads/ycsbkey_run_workloadd";
-        } else if (kt == STRING_KEY && wl == WORKLOAD_E) {
-            init_file = "./index-microbench/workloads/ycsbkey_load_workloade";
-            txn_file = "./index-microbench/workloads/ycsbkey_run_workloade";
-        }
-    } else {
         if (kt == STRING_KEY && wl == WORKLOAD_A) {
             init_file = "./index-microbench/workloads/ycsbkey_load_workloada";
             txn_file = "./index-microbench/workloads/ycsbkey_run_workloada";
@@ -274,430 +219,91 @@ void ycsb_load_run_string(int index_type, int wl, int kt, int ap, int num_thread
             init_file = "./index-microbench/workloads/ycsbkey_load_workloade";
             txn_file = "./index-microbench/workloads/ycsbkey_run_workloade";
         }
-    }
 
-    std::ifstream infile_load(init_file);
+        std::ifstream infile_load(init_file);
 
-    std::string op;
-    std::string key;
-    int range;
+        std::string op;
+        std::string key;
+        int range;
 
-    std::string insert("INSERT");
-    std::string update("UPDATE");
-    std::string read("READ");
-    std::string scan("SCAN");
-    std::string maxKey("z");
+        std::string insert("INSERT");
+        std::string update("UPDATE");
+        std::string read("READ");
+        std::string scan("SCAN");
 
-    int count = 0;
-    uint64_t val;
-    while ((count < LOAD_SIZE) && infile_load.good()) {
-        infile_load >> op >> key;
-        if (op.compare(insert) != 0) {
-            std::cout << "READING LOAD FILE FAIL!\n";
-            return ;
-        }
-        val = std::stoul(key.substr(4, key.size()));
-        init_keys.push_back(init_keys[count]->make_leaf((char *)key.c_str(), key.size()+1, val));
-        count++;
-    }
-
-    fprintf(stderr, "Loaded %d keys\n", count);
-
-    std::ifstream infile_txn(txn_file);
-
-    count = 0;
-    while ((count < RUN_SIZE) && infile_txn.good()) {
-        infile_txn >> op >> key;
-        if (op.compare(insert) == 0) {
-            ops.push_back(OP_INSERT);
-            val = std::stoul(key.substr(4, key.size()));
-            keys.push_back(keys[count]->make_leaf((char *)key.c_str(), key.size()+1, val));
-            ranges.push_back(1);
-        } else if (op.compare(update) == 0) {
-            ops.push_back(OP_UPDATE);
+        int count = 0;
+        uint64_t val;
+        while ((count < LOAD_SIZE) && infile_load.good()) {
+            infile_load >> op >> key;
+            if (op.compare(insert) != 0) {
+                std::cout << "READING LOAD FILE FAIL!\n";
+                return ;
+            }
             val = std::stoul(key.substr(4, key.size()));
-            keys.push_back(keys[count]->make_leaf((char *)key.c_str(), key.size()+1, val));
-            ranges.push_back(1);
-        } else if (op.compare(read) == 0) {
-            ops.push_back(OP_READ);
-            val = std::stoul(key.substr(4, key.size()));
-            keys.push_back(keys[count]->make_leaf((char *)key.c_str(), key.size()+1, val));
-            ranges.push_back(1);
-        } else if (op.compare(scan) == 0) {
-            infile_txn >> range;
-            ops.push_back(OP_SCAN);
-            keys.push_back(keys[count]->make_leaf((char *)key.c_str(), key.size()+1, 0));
-            ranges.push_back(range);
-        } else {
-            std::cout << "UNRECOGNIZED CMD!\n";
-            return;
-        }
-        count++;
-    }
-
-    if (index_type == TYPE_ART) {
-        ART_ROWEX::Tree tree(loadKey);
-
-        {
-            // Load
-            auto starttime = std::chrono::system_clock::now();
-            tbb::parallel_for(tbb::blocked_range<uint64_t>(0, LOAD_SIZE), [&](const tbb::blocked_range<uint64_t> &scope) {
-                auto t = tree.getThreadInfo();
-                for (uint64_t i = scope.begin(); i != scope.end(); i++) {
-                    Key *key = key->make_leaf((char *)init_keys[i]->fkey, init_keys[i]->key_len, init_keys[i]->value);
-                    tree.insert(key, t);
-                }
-            });
-            auto duration = std::chrono::duration_cast<std::chrono::microseconds>(
-                    std::chrono::system_clock::now() - starttime);
-            printf("Throughput: load, %f ,ops/us\n", (LOAD_SIZE * 1.0) / duration.count());
-        }
-
-        {
-            // Run
-            Key *end = end->make_leaf((char *)maxKey.c_str(), maxKey.size()+1, 0);
-            auto starttime = std::chrono::system_clock::now();
-            tbb::parallel_for(tbb::blocked_range<uint64_t>(0, RUN_SIZE), [&](const tbb::blocked_range<uint64_t> &scope) {
-                auto t = tree.getThreadInfo();
-                for (uint64_t i = scope.begin(); i != scope.end(); i++) {
-                    Key *key;
-                    if (ops[i] == OP_INSERT) {
-                        key = key->make_leaf((char *)keys[i]->fkey, keys[i]->key_len, keys[i]->value);
-                        tree.insert(key, t);
-                    } else if (ops[i] == OP_READ) {
-                        key = key->make_leaf((char *)keys[i]->fkey, keys[i]->key_len, keys[i]->value);
-                        Key *val = reinterpret_cast<Key *>(tree.lookup(key, t));
-                        if (val->value != keys[i]->value) {
-                            std::cout << "[ART] wrong key read: " << val->value << " expected:" << keys[i]->value << std::endl;
-                            throw;
-                        }
-                    } else if (ops[i] == OP_SCAN) {
-                        Key *results[200];
-                        Key *continueKey = NULL;
-                        size_t resultsFound = 0;
-                        size_t resultsSize = ranges[i];
-                        Key *start = start->make_leaf((char *)keys[i]->fkey, keys[i]->key_len, keys[i]->value);
-                        tree.lookupRange(start, end, continueKey, results, resultsSize, resultsFound, t);
-                    } else if (ops[i] == OP_UPDATE) {
-                        std::cout << "NOT SUPPORTED CMD!\n";
-                        exit(0);
-                    }
-                }
-            });
-            auto duration = std::chrono::duration_cast<std::chrono::microseconds>(
-                    std::chrono::system_clock::now() - starttime);
-            printf("Throughput: run, %f ,ops/us\n", (RUN_SIZE * 1.0) / duration.count());
-        }
-#ifdef HOT
-    } else if (index_type == TYPE_HOT) {
-        hot::rowex::HOTRowex<Key *, KeyExtractor> mTrie;
-
-        {
-            // Load
-            auto starttime = std::chrono::system_clock::now();
-            tbb::parallel_for(tbb::blocked_range<uint64_t>(0, LOAD_SIZE), [&](const tbb::blocked_range<uint64_t> &scope) {
-                for (uint64_t i = scope.begin(); i != scope.end(); i++) {
-                    Key *key = key->make_leaf((char *)init_keys[i]->fkey, init_keys[i]->key_len, init_keys[i]->value);
-                    Dummy::clflush((char *)key, sizeof(Key) + key->key_len, true, true);
-                    if (!(mTrie.insert(key))) {
-                        fprintf(stderr, "[HOT] load insert fail\n");
-                        exit(1);
-                    }
-                }
-            });
-            auto duration = std::chrono::duration_cast<std::chrono::microseconds>(
-                    std::chrono::system_clock::now() - starttime);
-            printf("Throughput: load, %f ,ops/us\n", (LOAD_SIZE * 1.0) / duration.count());
-        }
-
-        {
-            // Run
-            auto starttime = std::chrono::system_clock::now();
-            tbb::parallel_for(tbb::blocked_range<uint64_t>(0, RUN_SIZE), [&](const tbb::blocked_range<uint64_t> &scope) {
-                for (uint64_t i = scope.begin(); i != scope.end(); i++) {
-                    if (ops[i] == OP_INSERT) {
-                        Key *key = key->make_leaf((char *)keys[i]->fkey, keys[i]->key_len, keys[i]->value);
-                        Dummy::clflush((char *)key, sizeof(Key) + key->key_len, true, true);
-                        if (!(mTrie.insert(key))) {
-                            fprintf(stderr, "[HOT] run insert fail\n");
-                            exit(1);
-                        }
-                    } else if (ops[i] == OP_READ) {
-                        idx::contenthelpers::OptionalValue<Key *> result = mTrie.lookup((char const *)keys[i]->fkey);
-                        if (!result.mIsValid || result.mValue->value != keys[i]->value) {
-                            printf("mIsValid = %d\n", result.mIsValid);
-                            printf("Return value = %lu, Correct value = %lu\n", result.mValue->value, keys[i]->value);
-                            exit(1);
-                        }
-                    } else if (ops[i] == OP_SCAN) {
-                        idx::contenthelpers::OptionalValue<Key *> result = mTrie.scan((char const *)keys[i]->fkey, ranges[i]);
-                    } else if (ops[i] == OP_UPDATE) {
-                        std::cout << "NOT SUPPORTED CMD!\n";
-                        exit(0);
-                    }
-                }
-            });
-            auto duration = std::chrono::duration_cast<std::chrono::microseconds>(
-                    std::chrono::system_clock::now() - starttime);
-            printf("Throughput: run, %f ,ops/us\n", (RUN_SIZE * 1.0) / duration.count());
-        }
-#endif
-    } else if (index_type == TYPE_BWTREE) {
-        auto t = new BwTree<char *, uint64_t, KeyComparator, KeyEqualityChecker>{true, KeyComparator{1}, KeyEqualityChecker{1}};
-        t->UpdateThreadLocal(1);
-        t->AssignGCID(0);
-        std::atomic<int> next_thread_id;
-
-        {
-            // Load
-            auto starttime = std::chrono::system_clock::now();
-            next_thread_id.store(0);
-            t->UpdateThreadLocal(num_thread);
-            auto func = [&]() {
-                int thread_id = next_thread_id.fetch_add(1);
-                uint64_t start_key = LOAD_SIZE / num_thread * (uint64_t)thread_id;
-                uint64_t end_key = start_key + LOAD_SIZE / num_thread;
-
-                t->AssignGCID(thread_id);
-                for (uint64_t i = start_key; i < end_key; i++) {
-                    Dummy::clflush((char *)init_keys[i]->fkey, init_keys[i]->key_len, true, true);
-                    t->Insert((char *)init_keys[i]->fkey, init_keys[i]->value);
-                }
-                t->UnregisterThread(thread_id);
-            };
-
-            std::vector<std::thread> thread_group;
-
-            for (int i = 0; i < num_thread; i++)
-                thread_group.push_back(std::thread{func});
-
-            for (int i = 0; i < num_thread; i++)
-                thread_group[i].join();
-            t->UpdateThreadLocal(1);
-            auto duration = std::chrono::duration_cast<std::chrono::microseconds>(
-                    std::chrono::system_clock::now() - starttime);
-            printf("Throughput: load, %f ,ops/us\n", (LOAD_SIZE * 1.0) / duration.count());
-        }
-
-        {
-            // Run
-            auto starttime = std::chrono::system_clock::now();
-            next_thread_id.store(0);
-            t->UpdateThreadLocal(num_thread);
-            auto func = [&]() {
-                std::vector<uint64_t> v{};
-                v.reserve(1);
-                int thread_id = next_thread_id.fetch_add(1);
-                uint64_t start_key = RUN_SIZE / num_thread * (uint64_t)thread_id;
-                uint64_t end_key = start_key + RUN_SIZE / num_thread;
-
-                t->AssignGCID(thread_id);
-                for (uint64_t i = start_key; i < end_key; i++) {
-                    if (ops[i] == OP_INSERT) {
-                        Dummy::clflush((char *)keys[i]->fkey, keys[i]->key_len, true, true);
-                        t->Insert((char *)keys[i]->fkey, keys[i]->value);
-                    } else if (ops[i] == OP_READ) {
-                        v.clear();
-                        t->GetValue((char *)keys[i]->fkey, v);
-                        if (v[0] != keys[i]->value) {
-                            std::cout << "[BWTREE] wrong key read: " << v[0] << " expected:" << keys[i]->value << std::endl;
-                        }
-                    } else if (ops[i] == OP_SCAN) {
-                        uint64_t buf[200];
-                        auto it = t->Begin((char *)keys[i]->fkey);
-
-                        int resultsFound = 0;
-                        while (it.IsEnd() != true && resultsFound != ranges[i]) {
-                            buf[resultsFound] = it->second;
-                            resultsFound++;
-                            it++;
-                        }
-                    } else if (ops[i] == OP_UPDATE) {
-                        std::cout << "NOT SUPPORTED CMD!\n";
-                        exit(0);
-                    }
-                }
-                t->UnregisterThread(thread_id);
-            };
-
-            std::vector<std::thread> thread_group;
-
-            for (int i = 0; i < num_thread; i++)
-                thread_group.push_back(std::thread{func});
-
-            for (int i = 0; i < num_thread; i++)
-                thread_group[i].join();
-            t->UpdateThreadLocal(1);
-            auto duration = std::chrono::duration_cast<std::chrono::microseconds>(
-                    std::chrono::system_clock::now() - starttime);
-            printf("Throughput: run, %f ,ops/us\n", (RUN_SIZE * 1.0) / duration.count());
-        }
-    } else if (index_type == TYPE_MASSTREE) {
-        masstree::masstree *tree = new masstree::masstree();
-
-        {
-            // Load
-            auto starttime = std::chrono::system_clock::now();
-            tbb::parallel_for(tbb::blocked_range<uint64_t>(0, LOAD_SIZE), [&](const tbb::blocked_range<uint64_t> &scope) {
-                auto t = tree->getThreadInfo();
-                for (uint64_t i = scope.begin(); i != scope.end(); i++) {
-                    tree->put((char *)init_keys[i]->fkey, init_keys[i]->value, t);
-                }
-            });
-            auto duration = std::chrono::duration_cast<std::chrono::microseconds>(
-                    std::chrono::system_clock::now() - starttime);
-            printf("Throughput: load, %f ,ops/us\n", (LOAD_SIZE * 1.0) / duration.count());
-        }
-
-        {
-            // Run
-            auto starttime = std::chrono::system_clock::now();
-            tbb::parallel_for(tbb::blocked_range<uint64_t>(0, RUN_SIZE), [&](const tbb::blocked_range<uint64_t> &scope) {
-                auto t = tree->getThreadInfo();
-                for (uint64_t i = scope.begin(); i != scope.end(); i++) {
-                    if (ops[i] == OP_INSERT) {
-                        tree->put((char *)keys[i]->fkey, keys[i]->value, t);
-                    } else if (ops[i] == OP_READ) {
-                        uint64_t *ret = reinterpret_cast<uint64_t *> (tree->get((char *)keys[i]->fkey, t));
-                        if (ap == UNIFORM && (uint64_t) ret != keys[i]->value) {
-                            printf("[MASS] search key = %lu, search value = %lu\n", keys[i]->value, ret);
-                            exit(1);
-                        }
-                    } else if (ops[i] == OP_SCAN) {
-                        int resultsFound;
-                        uint64_t results[200];
-                        resultsFound = tree->scan((char *)keys[i]->fkey, ranges[i], results, t);
-                    } else if (ops[i] == OP_DELETE) {
-                        tree->del((char *)keys[i]->fkey, t);
-                    } else if (ops[i] == OP_UPDATE) {
-                        tree->put((char *)keys[i]->fkey, keys[i]->value, t);
-                    }
+            init_keys.push_back(init_keys[count]->make_leaf((char *)key.c_str(), key.size()+1, val));
+            count++;
+        }
+
+        fprintf(stderr, "Loaded %d keys\n", count);
+
+        std::ifstream infile_txn(txn_file);
+
+        count = 0;
+        while ((count < RUN_SIZE) && infile_txn.good()) {
+            infile_txn >> op >> key;
+            if (op.compare(insert) == 0) {
+                ops.push_back(OP_INSERT);
+                val = std::stoul(key.substr(4, key.size()));
+                keys.push_back(keys[count]->make_leaf((char *)key.c_str(), key.size()+1, val));
+                ranges.push_back(1);
+            } else if (op.compare(update) == 0) {
+                ops.push_back(OP_UPDATE);
+                val = std::stoul(key.substr(4, key.size()));
+                keys.push_back(keys[count]->make_leaf((char *)key.c_str(), key.size()+1, val));
+                ranges.push_back(1);
+            } else if (op.compare(read) == 0) {
+                ops.push_back(OP_READ);
+                val = std::stoul(key.substr(4, key.size()));
+                keys.push_back(keys[count]->make_leaf((char *)key.c_str(), key.size()+1, val));
+                ranges.push_back(1);
+            } else if (op.compare(scan) == 0) {
+                infile_txn >> range;
+                if (range < 0 || range > MAX_SCAN_LENGTH) {
+                    std::cout << "SCAN LENGTH OUT OF RANGE!\n";
+                    return;
                 }
-            });
-            auto duration = std::chrono::duration_cast<std::chrono::microseconds>(
-                    std::chrono::system_clock::now() - starttime);
-            printf("Throughput: run, %f ,ops/us\n", (RUN_SIZE * 1.0) / duration.count());
+                ops.push_back(OP_SCAN);
+                keys.push_back(keys[count]->make_leaf((char *)key.c_str(), key.size()+1, 0));
+                ranges.push_back(range);
+            } else {
+                std::cout << "UNRECOGNIZED CMD!\n";
+                return;
+            }
+            count++;
         }
-    } else if (index_type == TYPE_FASTFAIR) {
-        fastfair::btree *bt = new fastfair::btree();
-
-        {
-            // Load
-            auto starttime = std::chrono::system_clock::now();
-            tbb::parallel_for(tbb::blocked_range<uint64_t>(0, LOAD_SIZE), [&](const tbb::blocked_range<uint64_t> &scope) {
-                for (uint64_t i = scope.begin(); i != scope.end(); i++) {
-                    bt->btree_insert((char *)init_keys[i]->fkey, (char *) &init_keys[i]->value);
-                }
-            });
-            auto duration = std::chrono::duration_cast<std::chrono::microseconds>(
-                    std::chrono::system_clock::now() - starttime);
-            printf("Throughput: load, %f ,ops/us\n", (LOAD_SIZE * 1.0) / duration.count());
-        }
-
-        {
-            // Run
-            auto starttime = std::chrono::system_clock::now();
-            tbb::parallel_for(tbb::blocked_range<uint64_t>(0, RUN_SIZE), [&](const tbb::blocked_range<uint64_t> &scope) {
-                for (uint64_t i = scope.begin(); i != scope.end(); i++) {
-                    if (ops[i] == OP_INSERT) {
-                        bt->btree_insert((char *)keys[i]->fkey, (char *) &keys[i]->value);
-                    } else if (ops[i] == OP_READ) {
-                        uint64_t *ret = reinterpret_cast<uint64_t *> (bt->btree_search((char *)keys[i]->fkey));
-                        if (ret == NULL) {
-                            //printf("Return value is NULL\n");
-                        }else if (*ret != keys[i]->value) {
-                            //printf("[FASTFAIR] wrong value was returned: originally expected %lu\n", keys[i]->value);
-                            //exit(1);
-                        }
-                    } else if (ops[i] == OP_SCAN) {
-                        uint64_t buf[200];
-                        int resultsFound = 0;
-                        bt->btree_search_range ((char *)keys[i]->fkey, (char *)maxKey.c_str(), buf, ranges[i], resultsFound);
-                    } else if (ops[i] == OP_UPDATE) {
-                        std::cout << "NOT SUPPORTED CMD!\n";
-                        exit(0);
-                    }
-                }
-            });
-            auto duration = std::chrono::duration_cast<std::chrono::microseconds>(
-                    std::chrono::system_clock::now() - starttime);
-            printf("Throughput: run, %f ,ops/us\n", (RUN_SIZE * 1.0) / duration.count());
-        }
-    } else if (index_type == TYPE_WOART) {
-#ifdef STRING_TYPE
-        woart_tree *t = (woart_tree *)malloc(sizeof(woart_tree));
-        woart_tree_init(t);
-
-        {
-            // Load
-            auto starttime = std::chrono::system_clock::now();
-            tbb::parallel_for(tbb::blocked_range<uint64_t>(0, LOAD_SIZE), [&](const tbb::blocked_range<uint64_t> &scope) {
-                for (uint64_t i = scope.begin(); i != scope.end(); i++) {
-                    woart_insert(t, init_keys[i]->fkey, init_keys[i]->key_len, &init_keys[i]->value);
-                }
-            });
-            auto duration = std::chrono::duration_cast<std::chrono::microseconds>(
-                    std::chrono::system_clock::now() - starttime);
-            printf("Throughput: load, %f ,ops/us\n", (LOAD_SIZE * 1.0) / duration.count());
-        }
-
-        {
-            // Run
-            auto starttime = std::chrono::system_clock::now();
-            tbb::parallel_for(tbb::blocked_range<uint64_t>(0, RUN_SIZE), [&](const tbb::blocked_range<uint64_t> &scope) {
-                for (uint64_t i = scope.begin(); i != scope.end(); i++) {
-                    if (ops[i] == OP_INSERT) {
-                        woart_insert(t, keys[i]->fkey, keys[i]->key_len, &keys[i]->value);
-                    } else if (ops[i] == OP_READ) {
-                        uint64_t *ret = reinterpret_cast<uint64_t *> (woart_search(t, keys[i]->fkey, keys[i]->key_len));
-                        if (*ret != keys[i]->value) {
-                            printf("[WOART] search key = %lu, search value = %lu\n", keys[i]->value, *ret);
-                            exit(1);
-                        }
-                    } else if (ops[i] == OP_SCAN) {
-                        unsigned long buf[200];
-                        woart_scan(t, keys[i]->fkey, keys[i]->key_len, ranges[i], buf);
-                    } else if (ops[i] == OP_UPDATE) {
-                        std::cout << "NOT SUPPORTED CMD!\n";
-                        exit(0);
-                    }
-                }
-            });
-            auto duration = std::chrono::duration_cast<std::chrono::microseconds>(
-                    std::chrono::system_clock::now() - starttime);
-            printf("Throughput: run, %f ,ops/us\n", (RUN_SIZE * 1.0) / duration.count());
-        }
-#endif
+    } else {
+        workload::generate_string(*gen_spec, LOAD_SIZE, RUN_SIZE, init_keys, keys, ranges, ops);
+        fprintf(stderr, "Generated %lu keys\n", LOAD_SIZE);
     }
+
+    if (dump_file != NULL)
+        workload::write_trace(dump_file, init_keys, keys, ranges, ops,
+                gen_spec != NULL && gen_spec->distribution == LATEST ? num_thread : 0);
+    else
+        ycsb_run_index(index_type, ap, num_thread, init_keys.data(), keys.data(), ranges.data(), ops.data());
 }
 
 void ycsb_load_run_randint(int index_type, int wl, int kt, int ap, int num_thread,
+        workload::WorkloadSpec *gen_spec, const char *dump_file,
         std::vector<uint64_t> &init_keys,
         std::vector<uint64_t> &keys,
         std::vector<int> &ranges,
         std::vector<int> &ops)
 {
-    std::string init_file;
-    std::string txn_file;
+    if (gen_spec == NULL) {
+        std::string init_file;
+        std::string txn_file;
 
-    if (ap == UNIFORM) {
-        if (kt == RANDINT_KEY && wl == WORKLOAD_A) {
-            init_file = "./index-microbench/workloads/loada_unif_int.dat";
-            txn_file = "./index-microbench/workloads/txnsa_unif_int.dat";
-        } else if (kt == RANDINT_KEY && wl == WORKLOAD_B) {
-            init_file = "./index-microbench/workloads/loadb_unif_int.dat";
-            txn_file = "./index-microbench/workloads/txnsb_unif_int.dat";
-        } else if (kt == RANDINT_KEY && wl == WORKLOAD_C) {
-            init_file = "./index-microbench/workloads/loadc_unif_int.dat";
-            txn_file = "./index-microbench/workloads/txnsc_unif_int.dat";
-        } else if (kt == RANDINT_KEY && wl == WORKLOAD_D) {
-            init_file = "./index-microbench/workloads/loadd_unif_int.dat";
-            txn_file = "./index-microbench/workloads/txnsd_unif_int.dat";
-        } else if (kt == RANDINT_KEY && wl == WORKLOAD_E) {
-            init_file = "./index-microbench/workloads/loade_unif_int.dat";
-            txn_file = "./index-microbench/workloads/txnse_unif_int.dat";
-        }
-    } else {
         if (kt == RANDINT_KEY && wl == WORKLOAD_A) {
             init_file = "./index-microbench/workloads/loada_unif_int.dat";
             txn_file = "./index-microbench/workloads/txnsa_unif_int.dat";
@@ -714,583 +320,94 @@ void ycsb_load_run_randint(int index_type, int wl, int kt, int ap, int num_threa
             init_file = "./index-microbench/workloads/loade_unif_int.dat";
             txn_file = "./index-microbench/workloads/txnse_unif_int.dat";
         }
-    }
-
-    std::ifstream infile_load(init_file);
-
-    std::string op;
-    uint64_t key;
-    int range;
-
-    std::string insert("INSERT");
-    std::string update("UPDATE");
-    std::string read("READ");
-    std::string scan("SCAN");
-
-    int count = 0;
-    while ((count < LOAD_SIZE) && infile_load.good()) {
-        infile_load >> op >> key;
-        if (op.compare(insert) != 0) {
-            std::cout << "READING LOAD FILE FAIL!\n";
-            return ;
-        }
-        init_keys.push_back(key);
-        count++;
-    }
-
-    fprintf(stderr, "Loaded %d keys\n", count);
-
-    std::ifstream infile_txn(txn_file);
-
-    count = 0;
-    while ((count < RUN_SIZE) && infile_txn.good()) {
-        infile_txn >> op >> key;
-        if (op.compare(insert) == 0) {
-            ops.push_back(OP_INSERT);
-            keys.push_back(key);
-            ranges.push_back(1);
-        } else if (op.compare(update) == 0) {
-            ops.push_back(OP_UPDATE);
-            keys.push_back(key);
-            ranges.push_back(1);
-        } else if (op.compare(read) == 0) {
-            ops.push_back(OP_READ);
-            keys.push_back(key);
-            ranges.push_back(1);
-        } else if (op.compare(scan) == 0) {
-            infile_txn >> range;
-            ops.push_back(OP_SCAN);
-            keys.push_back(key);
-            ranges.push_back(range);
-        } else {
-            std::cout << "UNRECOGNIZED CMD!\n";
-            return;
-        }
-        count++;
-    }
-
-    std::atomic<int> range_complete, range_incomplete;
-    range_complete.store(0);
-    range_incomplete.store(0);
-
-    if (index_type == TYPE_ART) {
-        ART_ROWEX::Tree tree(loadKey);
-
-        {
-            // Load
-            auto starttime = std::chrono::system_clock::now();
-            tbb::parallel_for(tbb::blocked_range<uint64_t>(0, LOAD_SIZE), [&](const tbb::blocked_range<uint64_t> &scope) {
-                auto t = tree.getThreadInfo();
-                for (uint64_t i = scope.begin(); i != scope.end(); i++) {
-                    Key *key = key->make_leaf(init_keys[i], sizeof(uint64_t), init_keys[i]);
-                    tree.insert(key, t);
-                }
-            });
-            auto duration = std::chrono::duration_cast<std::chrono::microseconds>(
-                    std::chrono::system_clock::now() - starttime);
-            printf("Throughput: load, %f ,ops/us\n", (LOAD_SIZE * 1.0) / duration.count());
-        }
-
-        {
-            // Run
-            Key *end = end->make_leaf(UINT64_MAX, sizeof(uint64_t), 0);
-            auto starttime = std::chrono::system_clock::now();
-            tbb::parallel_for(tbb::blocked_range<uint64_t>(0, RUN_SIZE), [&](const tbb::blocked_range<uint64_t> &scope) {
-                auto t = tree.getThreadInfo();
-                for (uint64_t i = scope.begin(); i != scope.end(); i++) {
-                    if (ops[i] == OP_INSERT) {
-                        Key *key = key->make_leaf(keys[i], sizeof(uint64_t), keys[i]);
-                        tree.insert(key, t);
-                    } else if (ops[i] == OP_READ) {
-                        Key *key = key->make_leaf(keys[i], sizeof(uint64_t), 0);
-                        uint64_t *val = reinterpret_cast<uint64_t *>(tree.lookup(key, t));
-                        if (*val != keys[i]) {
-                            std::cout << "[ART] wrong key read: " << val << " expected:" << keys[i] << std::endl;
-                            exit(1);
-                        }
-                    } else if (ops[i] == OP_SCAN) {
-                        Key *results[200];
-                        Key *continueKey = NULL;
-                        size_t resultsFound = 0;
-                        size_t resultsSize = ranges[i];
-                        Key *start = start->make_leaf(keys[i], sizeof(uint64_t), 0);
-                        tree.lookupRange(start, end, continueKey, results, resultsSize, resultsFound, t);
-                    } else if (ops[i] == OP_UPDATE) {
-                        std::cout << "NOT SUPPORTED CMD!\n";
-                        exit(0);
-                    }
-                }
-            });
-            auto duration = std::chrono::duration_cast<std::chrono::microseconds>(
-                    std::chrono::system_clock::now() - starttime);
-            printf("Throughput: run, %f ,ops/us\n", (RUN_SIZE * 1.0) / duration.count());
-        }
-#ifdef HOT
-    } else if (index_type == TYPE_HOT) {
-        hot::rowex::HOTRowex<IntKeyVal *, IntKeyExtractor> mTrie;
-
-        {
-            // Load
-            auto starttime = std::chrono::system_clock::now();
-            tbb::parallel_for(tbb::blocked_range<uint64_t>(0, LOAD_SIZE), [&](const tbb::blocked_range<uint64_t> &scope) {
-                for (uint64_t i = scope.begin(); i != scope.end(); i++) {
-                    IntKeyVal *key;
-                    posix_memalign((void **)&key, 64, sizeof(IntKeyVal));
-                    key->key = init_keys[i]; key->value = init_keys[i];
-                    Dummy::clflush((char *)key, sizeof(IntKeyVal), true, true);
-                    if (!(mTrie.insert(key))) {
-                        fprintf(stderr, "[HOT] load insert fail\n");
-                        exit(1);
-                    }
-                }
-            });
-            auto duration = std::chrono::duration_cast<std::chrono::microseconds>(
-                    std::chrono::system_clock::now() - starttime);
-            printf("Throughput: load, %f ,ops/us\n", (LOAD_SIZE * 1.0) / duration.count());
-        }
 
-        {
-            // Run
-            auto starttime = std::chrono::system_clock::now();
-            tbb::parallel_for(tbb::blocked_range<uint64_t>(0, RUN_SIZE), [&](const tbb::blocked_range<uint64_t> &scope) {
-                for (uint64_t i = scope.begin(); i != scope.end(); i++) {
-                    if (ops[i] == OP_INSERT) {
-                        IntKeyVal *key;
-                        posix_memalign((void **)&key, 64, sizeof(IntKeyVal));
-                        key->key = keys[i]; key->value = keys[i];
-                        Dummy::clflush((char *)key, sizeof(IntKeyVal), true, true);
-                        if (!(mTrie.insert(key))) {
-                            fprintf(stderr, "[HOT] run insert fail\n");
-                            exit(1);
-                        }
-                    } else if (ops[i] == OP_READ) {
-                        idx::contenthelpers::OptionalValue<IntKeyVal *> result = mTrie.lookup(keys[i]);
-                        if (!result.mIsValid || result.mValue->value != keys[i]) {
-                            printf("mIsValid = %d\n", result.mIsValid);
-                            printf("Return value = %lu, Correct value = %lu\n", result.mValue->value, keys[i]);
-                            exit(1);
-                        }
-                    } else if (ops[i] == OP_SCAN) {
-                        idx::contenthelpers::OptionalValue<IntKeyVal *> result = mTrie.scan(keys[i], ranges[i]);
-                    } else if (ops[i] == OP_UPDATE) {
-                        std::cout << "NOT SUPPORTED CMD!\n";
-                        exit(0);
-                    }
+        std::ifstream infile_load(init_file);
+
+        std::string op;
+        uint64_t key;
+        int range;
+
+        std::string insert("INSERT");
+        std::string update("UPDATE");
+        std::string read("READ");
+        std::string scan("SCAN");
+
+        int count = 0;
+        while ((count < LOAD_SIZE) && infile_load.good()) {
+            infile_load >> op >> key;
+            if (op.compare(insert) != 0) {
+                std::cout << "READING LOAD FILE FAIL!\n";
+                return ;
+            }
+            init_keys.push_back(key);
+            count++;
+        }
+
+        fprintf(stderr, "Loaded %d keys\n", count);
+
+        std::ifstream infile_txn(txn_file);
+
+        count = 0;
+        while ((count < RUN_SIZE) && infile_txn.good()) {
+            infile_txn >> op >> key;
+            if (op.compare(insert) == 0) {
+                ops.push_back(OP_INSERT);
+                keys.push_back(key);
+                ranges.push_back(1);
+            } else if (op.compare(update) == 0) {
+                ops.push_back(OP_UPDATE);
+                keys.push_back(key);
+                ranges.push_back(1);
+            } else if (op.compare(read) == 0) {
+                ops.push_back(OP_READ);
+                keys.push_back(key);
+                ranges.push_back(1);
+            } else if (op.compare(scan) == 0) {
+                infile_txn >> range;
+                if (range < 0 || range > MAX_SCAN_LENGTH) {
+                    std::cout << "SCAN LENGTH OUT OF RANGE!\n";
+                    return;
                 }
-            });
-            auto duration = std::chrono::duration_cast<std::chrono::microseconds>(
-                    std::chrono::system_clock::now() - starttime);
-            printf("Throughput: run, %f ,ops/us\n", (RUN_SIZE * 1.0) / duration.count());
+                ops.push_back(OP_SCAN);
+                keys.push_back(key);
+                ranges.push_back(range);
+            } else {
+                std::cout << "UNRECOGNIZED CMD!\n";
+                return;
+            }
+            count++;
         }
-#endif
-    } else if (index_type == TYPE_BWTREE) {
-        auto t = new BwTree<uint64_t, uint64_t, KeyComparator, KeyEqualityChecker>{true, KeyComparator{1}, KeyEqualityChecker{1}};
-        t->UpdateThreadLocal(1);
-        t->AssignGCID(0);
-        std::atomic<int> next_thread_id;
-
-        {
-            // Load
-            auto starttime = std::chrono::system_clock::now();
-            next_thread_id.store(0);
-            t->UpdateThreadLocal(num_thread);
-            auto func = [&]() {
-                int thread_id = next_thread_id.fetch_add(1);
-                uint64_t start_key = LOAD_SIZE / num_thread * (uint64_t)thread_id;
-                uint64_t end_key = start_key + LOAD_SIZE / num_thread;
-
-                t->AssignGCID(thread_id);
-                for (uint64_t i = start_key; i < end_key; i++) {
-                    t->Insert(init_keys[i], init_keys[i]);
-                }
-                t->UnregisterThread(thread_id);
-            };
-
-            std::vector<std::thread> thread_group;
-
-            for (int i = 0; i < num_thread; i++)
-                thread_group.push_back(std::thread{func});
-
-            for (int i = 0; i < num_thread; i++)
-                thread_group[i].join();
-            t->UpdateThreadLocal(1);
-            auto duration = std::chrono::duration_cast<std::chrono::microseconds>(
-                    std::chrono::system_clock::now() - starttime);
-            printf("Throughput: load, %f ,ops/us\n", (LOAD_SIZE * 1.0) / duration.count());
-        }
-
-        {
-            // Run
-            auto starttime = std::chrono::system_clock::now();
-            next_thread_id.store(0);
-            t->UpdateThreadLocal(num_thread);
-            auto func = [&]() {
-                std::vector<uint64_t> v{};
-                v.reserve(1);
-                int thread_id = next_thread_id.fetch_add(1);
-                uint64_t start_key = RUN_SIZE / num_thread * (uint64_t)thread_id;
-                uint64_t end_key = start_key + RUN_SIZE / num_thread;
-
-                t->AssignGCID(thread_id);
-                for (uint64_t i = start_key; i < end_key; i++) {
-                    if (ops[i] == OP_INSERT) {
-                        t->Insert(keys[i], keys[i]);
-                    } else if (ops[i] == OP_READ) {
-                        v.clear();
-                        t->GetValue(keys[i], v);
-                        if (v[0] != keys[i]) {
-                            std::cout << "[BWTREE] wrong key read: " << v[0] << " expected:" << keys[i] << std::endl;
-                        }
-                    } else if (ops[i] == OP_SCAN) {
-                        uint64_t buf[200];
-                        auto it = t->Begin(keys[i]);
-
-                        int resultsFound = 0;
-                        while (it.IsEnd() != true && resultsFound != ranges[i]) {
-                            buf[resultsFound] = it->second;
-                            resultsFound++;
-                            it++;
-                        }
-                    } else if (ops[i] == OP_UPDATE) {
-                        std::cout << "NOT SUPPORTED CMD!\n";
-                        exit(0);
-                    }
-                }
-                t->UnregisterThread(thread_id);
-            };
-
-            std::vector<std::thread> thread_group;
-
-            for (int i = 0; i < num_thread; i++)
-                thread_group.push_back(std::thread{func});
-
-            for (int i = 0; i < num_thread; i++)
-                thread_group[i].join();
-            t->UpdateThreadLocal(1);
-            auto duration = std::chrono::duration_cast<std::chrono::microseconds>(
-                    std::chrono::system_clock::now() - starttime);
-            printf("Throughput: run, %f ,ops/us\n", (RUN_SIZE * 1.0) / duration.count());
-        }
-    } else if (index_type == TYPE_MASSTREE) {
-        masstree::masstree *tree = new masstree::masstree();
-
-        {
-            // Load
-            auto starttime = std::chrono::system_clock::now();
-            tbb::parallel_for(tbb::blocked_range<uint64_t>(0, LOAD_SIZE), [&](const tbb::blocked_range<uint64_t> &scope) {
-                auto t = tree->getThreadInfo();
-                for (uint64_t i = scope.begin(); i != scope.end(); i++) {
-                    tree->put(init_keys[i], &init_keys[i], t);
-                }
-            });
-            auto duration = std::chrono::duration_cast<std::chrono::microseconds>(
-                    std::chrono::system_clock::now() - starttime);
-            printf("Throughput: load, %f ,ops/us\n", (LOAD_SIZE * 1.0) / duration.count());
-        }
-
-        {
-            // Run
-            auto starttime = std::chrono::system_clock::now();
-            tbb::parallel_for(tbb::blocked_range<uint64_t>(0, RUN_SIZE), [&](const tbb::blocked_range<uint64_t> &scope) {
-                auto t = tree->getThreadInfo();
-                for (uint64_t i = scope.begin(); i != scope.end(); i++) {
-                    if (ops[i] == OP_INSERT) {
-                        tree->put(keys[i], &keys[i], t);
-                    } else if (ops[i] == OP_READ) {
-                        uint64_t *ret = reinterpret_cast<uint64_t *> (tree->get(keys[i], t));
-                        if (ap == UNIFORM && *ret != keys[i]) {
-                            printf("[MASS] search key = %lu, search value = %lu\n", keys[i], *ret);
-                            exit(1);
-                        }
-                    } else if (ops[i] == OP_SCAN) {
-                        uint64_t buf[200];
-                        int ret = tree->scan(keys[i], ranges[i], buf, t);
-                    } else if (ops[i] == OP_DELETE) {
-                        tree->del(keys[i], t);
-                    } else if (ops[i] == OP_UPDATE) {
-                        tree->put(keys[i], &keys[i], t);
-                    }
-                }
-            });
-            auto duration = std::chrono::duration_cast<std::chrono::microseconds>(
-                    std::chrono::system_clock::now() - starttime);
-            printf("Throughput: run, %f ,ops/us\n", (RUN_SIZE * 1.0) / duration.count());
-        }
-    } else if (index_type == TYPE_CLHT) {
-        clht_t *hashtable = clht_create(512);
-
-        barrier_init(&barrier, num_thread);
-
-        thread_data_t *tds = (thread_data_t *) malloc(num_thread * sizeof(thread_data_t));
-
-        std::atomic<int> next_thread_id;
-
-        {
-            // Load
-            auto starttime = std::chrono::system_clock::now();
-            next_thread_id.store(0);
-            auto func = [&]() {
-                int thread_id = next_thread_id.fetch_add(1);
-                tds[thread_id].id = thread_id;
-                tds[thread_id].ht = hashtable;
-
-                uint64_t start_key = LOAD_SIZE / num_thread * (uint64_t)thread_id;
-                uint64_t end_key = start_key + LOAD_SIZE / num_thread;
-
-                clht_gc_thread_init(tds[thread_id].ht, tds[thread_id].id);
-                barrier_cross(&barrier);
-
-                for (uint64_t i = start_key; i < end_key; i++) {
-                    clht_put(tds[thread_id].ht, init_keys[i], init_keys[i]);
-                }
-            };
-
-            std::vector<std::thread> thread_group;
-
-            for (int i = 0; i < num_thread; i++)
-                thread_group.push_back(std::thread{func});
-
-            for (int i = 0; i < num_thread; i++)
-                thread_group[i].join();
-            auto duration = std::chrono::duration_cast<std::chrono::microseconds>(
-                    std::chrono::system_clock::now() - starttime);
-            printf("Throughput: load, %f ,ops/us\n", (LOAD_SIZE * 1.0) / duration.count());
-        }
-
-        barrier.crossing = 0;
-
-        {
-            // Run
-            auto starttime = std::chrono::system_clock::now();
-            next_thread_id.store(0);
-            auto func = [&]() {
-                int thread_id = next_thread_id.fetch_add(1);
-                tds[thread_id].id = thread_id;
-                tds[thread_id].ht = hashtable;
-
-                uint64_t start_key = RUN_SIZE / num_thread * (uint64_t)thread_id;
-                uint64_t end_key = start_key + RUN_SIZE / num_thread;
-
-                clht_gc_thread_init(tds[thread_id].ht, tds[thread_id].id);
-                barrier_cross(&barrier);
-
-                for (uint64_t i = start_key; i < end_key; i++) {
-                    if (ops[i] == OP_INSERT) {
-                        clht_put(tds[thread_id].ht, keys[i], keys[i]);
-                    } else if (ops[i] == OP_READ) {
-                        uintptr_t val = clht_get(tds[thread_id].ht->ht, keys[i]);
-                        if (val != keys[i]) {
-                            std::cout << "[CLHT] wrong key read: " << val << "expected: " << keys[i] << std::endl;
-                            exit(1);
-                        }
-                    } else if (ops[i] == OP_SCAN) {
-                        std::cout << "NOT SUPPORTED CMD!\n";
-                        exit(0);
-                    } else if (ops[i] == OP_UPDATE) {
-                        std::cout << "NOT SUPPORTED CMD!\n";
-                        exit(0);
-                    }
-                }
-            };
-
-            std::vector<std::thread> thread_group;
-
-            for (int i = 0; i < num_thread; i++)
-                thread_group.push_back(std::thread{func});
-
-            for (int i = 0; i < num_thread; i++)
-                thread_group[i].join();
-            auto duration = std::chrono::duration_cast<std::chrono::microseconds>(
-                    std::chrono::system_clock::now() - starttime);
-            printf("Throughput: run, %f ,ops/us\n", (RUN_SIZE * 1.0) / duration.count());
-        }
-        clht_gc_destroy(hashtable);
-    } else if (index_type == TYPE_FASTFAIR) {
-        fastfair::btree *bt = new fastfair::btree();
-
-        {
-            // Load
-            auto starttime = std::chrono::system_clock::now();
-            tbb::parallel_for(tbb::blocked_range<uint64_t>(0, LOAD_SIZE), [&](const tbb::blocked_range<uint64_t> &scope) {
-                for (uint64_t i = scope.begin(); i != scope.end(); i++) {
-                    bt->btree_insert(init_keys[i], (char *) &init_keys[i]);
-                }
-            });
-            auto duration = std::chrono::duration_cast<std::chrono::microseconds>(
-                    std::chrono::system_clock::now() - starttime);
-            printf("Throughput: load, %f ,ops/us\n", (LOAD_SIZE * 1.0) / duration.count());
-        }
-
-        {
-            // Run
-            auto starttime = std::chrono::system_clock::now();
-            tbb::parallel_for(tbb::blocked_range<uint64_t>(0, RUN_SIZE), [&](const tbb::blocked_range<uint64_t> &scope) {
-                for (uint64_t i = scope.begin(); i != scope.end(); i++) {
-                    if (ops[i] == OP_INSERT) {
-                        bt->btree_insert(keys[i], (char *) &keys[i]);
-                    } else if (ops[i] == OP_READ) {
-                        uint64_t *ret = reinterpret_cast<uint64_t *>(bt->btree_search(keys[i]));
-                        if (ret == NULL) {
-                            //printf("NULL is found\n");
-                        } else if (*ret != keys[i]) {
-                            //printf("[FASTFAIR] wrong value is returned: <expected> %lu\n", keys[i]);
-                            //exit(1);
-                        }
-                    } else if (ops[i] == OP_SCAN) {
-                        uint64_t buf[200];
-                        int resultsFound = 0;
-                        bt->btree_search_range (keys[i], UINT64_MAX, buf, ranges[i], resultsFound);
-                    } else if (ops[i] == OP_UPDATE) {
-                        std::cout << "NOT SUPPORTED CMD!\n";
-                        exit(0);
-                    }
-                }
-            });
-            auto duration = std::chrono::duration_cast<std::chrono::microseconds>(
-                    std::chrono::system_clock::now() - starttime);
-            printf("Throughput: run, %f ,ops/us\n", (RUN_SIZE * 1.0) / duration.count());
-        }
-    } else if (index_type == TYPE_LEVELHASH) {
-        Hash *table = new LevelHashing(10);
-
-        {
-            // Load
-            auto starttime = std::chrono::system_clock::now();
-            tbb::parallel_for(tbb::blocked_range<uint64_t>(0, LOAD_SIZE), [&](const tbb::blocked_range<uint64_t> &scope) {
-                for (uint64_t i = scope.begin(); i != scope.end(); i++) {
-                    table->Insert(init_keys[i], reinterpret_cast<const char*>(&init_keys[i]));
-                }
-            });
-            auto duration = std::chrono::duration_cast<std::chrono::microseconds>(
-                    std::chrono::system_clock::now() - starttime);
-            printf("Throughput: load, %f ,ops/us\n", (LOAD_SIZE * 1.0) / duration.count());
-        }
-
-        {
-            // Run
-            auto starttime = std::chrono::system_clock::now();
-            tbb::parallel_for(tbb::blocked_range<uint64_t>(0, RUN_SIZE), [&](const tbb::blocked_range<uint64_t> &scope) {
-                for (uint64_t i = scope.begin(); i != scope.end(); i++) {
-                    if (ops[i] == OP_INSERT) {
-                        table->Insert(keys[i], reinterpret_cast<const char*>(&keys[i]));
-                    } else if (ops[i] == OP_READ) {
-                        auto val = table->Get(keys[i]);
-                        if (val == NONE) {
-                            std::cout << "[Level Hashing] wrong key read: " << *(uint64_t *)val << " expected: " << keys[i] << std::endl;
-                            exit(1);
-                        }
-                    } else if (ops[i] == OP_SCAN) {
-                        std::cout << "NOT SUPPORTED CMD!\n";
-                        exit(0);
-                    } else if (ops[i] == OP_UPDATE) {
-                        std::cout << "NOT SUPPORTED CMD!\n";
-                        exit(0);
-                    }
-                }
-            });
-            auto duration = std::chrono::duration_cast<std::chrono::microseconds>(
-                    std::chrono::system_clock::now() - starttime);
-            printf("Throughput: run, %f ,ops/us\n", (RUN_SIZE * 1.0) / duration.count());
-        }
-    } else if (index_type == TYPE_CCEH) {
-        Hash *table = new CCEH(2);
-
-        {
-            // Load
-            auto starttime = std::chrono::system_clock::now();
-            tbb::parallel_for(tbb::blocked_range<uint64_t>(0, LOAD_SIZE), [&](const tbb::blocked_range<uint64_t> &scope) {
-                for (uint64_t i = scope.begin(); i != scope.end(); i++) {
-                    table->Insert(init_keys[i], reinterpret_cast<const char*>(&init_keys[i]));
-                }
-            });
-            auto duration = std::chrono::duration_cast<std::chrono::microseconds>(
-                    std::chrono::system_clock::now() - starttime);
-            printf("Throughput: load, %f ,ops/us\n", (LOAD_SIZE * 1.0) / duration.count());
-        }
-
-        {
-            // Run
-            auto starttime = std::chrono::system_clock::now();
-            tbb::parallel_for(tbb::blocked_range<uint64_t>(0, RUN_SIZE), [&](const tbb::blocked_range<uint64_t> &scope) {
-                for (uint64_t i = scope.begin(); i != scope.end(); i++) {
-                    if (ops[i] == OP_INSERT) {
-                        table->Insert(keys[i], reinterpret_cast<const char*>(&keys[i]));
-                    } else if (ops[i] == OP_READ) {
-                        uint64_t *val = reinterpret_cast<uint64_t *>(const_cast<char *>(table->Get(keys[i])));
-                        if (val == NULL) {
-                            //std::cout << "[CCEH] wrong value is read <expected:> " << keys[i] << std::endl;
-                            //exit(1);
-                        }
-                    } else if (ops[i] == OP_SCAN) {
-                        std::cout << "NOT SUPPORTED CMD!\n";
-                        exit(0);
-                    } else if (ops[i] == OP_UPDATE) {
-                        std::cout << "NOT SUPPORTED CMD!\n";
-                        exit(0);
-                    }
-                }
-            });
-            auto duration = std::chrono::duration_cast<std::chrono::microseconds>(
-                    std::chrono::system_clock::now() - starttime);
-            printf("Throughput: run, %f ,ops/us\n", (RUN_SIZE * 1.0) / duration.count());
-        }
-    } else if (index_type == TYPE_WOART) {
-#ifndef STRING_TYPE
-        woart_tree *t = (woart_tree *)malloc(sizeof(woart_tree));
-        woart_tree_init(t);
-
-        {
-            // Load
-            auto starttime = std::chrono::system_clock::now();
-            tbb::parallel_for(tbb::blocked_range<uint64_t>(0, LOAD_SIZE), [&](const tbb::blocked_range<uint64_t> &scope) {
-                for (uint64_t i = scope.begin(); i != scope.end(); i++) {
-                    woart_insert(t, init_keys[i], sizeof(uint64_t), &init_keys[i]);
-                }
-            });
-            auto duration = std::chrono::duration_cast<std::chrono::microseconds>(
-                    std::chrono::system_clock::now() - starttime);
-            printf("Throughput: load, %f ,ops/us\n", (LOAD_SIZE * 1.0) / duration.count());
-        }
-
-        {
-            // Run
-            auto starttime = std::chrono::system_clock::now();
-            tbb::parallel_for(tbb::blocked_range<uint64_t>(0, RUN_SIZE), [&](const tbb::blocked_range<uint64_t> &scope) {
-                for (uint64_t i = scope.begin(); i != scope.end(); i++) {
-                    if (ops[i] == OP_INSERT) {
-                        woart_insert(t, keys[i], sizeof(uint64_t), &keys[i]);
-                    } else if (ops[i] == OP_READ) {
-                        uint64_t *ret = reinterpret_cast<uint64_t *> (woart_search(t, keys[i], sizeof(uint64_t)));
-                        if (*ret != keys[i]) {
-                            printf("[WOART] expected = %lu, search value = %lu\n", keys[i], *ret);
-                            exit(1);
-                        }
-                    } else if (ops[i] == OP_SCAN) {
-                        unsigned long buf[200];
-                        woart_scan(t, keys[i], ranges[i], buf);
-                    } else if (ops[i] == OP_UPDATE) {
-                        std::cout << "NOT SUPPORTED CMD!\n";
-                        exit(0);
-                    }
-                }
-            });
-            auto duration = std::chrono::duration_cast<std::chrono::microseconds>(
-                    std::chrono::system_clock::now() - starttime);
-            printf("Throughput: run, %f ,ops/us\n", (RUN_SIZE * 1.0) / duration.count());
-        }
-#endif
+    } else {
+        workload::generate_randint(*gen_spec, LOAD_SIZE, RUN_SIZE, init_keys, keys, ranges, ops);
+        fprintf(stderr, "Generated %lu keys\n", LOAD_SIZE);
     }
+
+    if (dump_file != NULL)
+        workload::write_trace(dump_file, init_keys, keys, ranges, ops,
+                gen_spec != NULL && gen_spec->distribution == LATEST ? num_thread : 0);
+    else
+        ycsb_run_index(index_type, ap, num_thread, init_keys.data(), keys.data(), ranges.data(), ops.data());
 }
 
 int main(int argc, char **argv) {
-    if (argc != 6) {
-        std::cout << "Usage: ./ycsb [index type] [ycsb workload type] [key distribution] [access pattern] [number of threads]\n";
+    if (argc < 6) {
+        std::cout << "Usage: ./ycsb [index type] [ycsb workload type] [key distribution] [access pattern] [number of threads] [options]\n";
         std::cout << "1. index type: art hot bwtree masstree clht\n";
         std::cout << "               fastfair levelhash cceh woart\n";
         std::cout << "2. ycsb workload type: a, b, c, e\n";
         std::cout << "3. key distribution: randint, string\n";
-        std::cout << "4. access pattern: uniform, zipfian\n";
+        std::cout << "4. access pattern: uniform, zipfian, latest, hotspot\n";
         std::cout << "5. number of threads (integer)\n";
+        std::cout << "options: --gen           generate the workload in memory (always on except for uniform)\n";
+        std::cout << "         --theta=<f>     zipfian constant for zipfian/latest (default 0.99)\n";
+        std::cout << "         --hotset=<f>    fraction of records in the hot set for hotspot (default 0.2)\n";
+        std::cout << "         --hotopn=<f>    fraction of operations on the hot set for hotspot (default 0.8)\n";
+        std::cout << "         --seed=<n>      seed of the workload generator\n";
+        std::cout << "         --load=<n>      number of records to load (default 64000000)\n";
+        std::cout << "         --run=<n>       number of operations to run (default 64000000)\n";
+        std::cout << "         --latency=<csv|json>  report per-operation latency percentiles\n";
+        std::cout << "         --dump=<file>   write the workload as a binary trace and exit\n";
+        std::cout << "         --trace=<file>  run the workload of a binary trace (written by --dump)\n";
         return 1;
     }
 
@@ -1355,6 +472,10 @@ int main(int argc, char **argv) {
         ap = UNIFORM;
     } else if (strcmp(argv[4], "zipfian") == 0) {
         ap = ZIPFIAN;
+    } else if (strcmp(argv[4], "latest") == 0) {
+        ap = LATEST;
+    } else if (strcmp(argv[4], "hotspot") == 0) {
+        ap = HOTSPOT;
     } else {
         fprintf(stderr, "Unknown access pattern: %s\n", argv[4]);
         exit(1);
@@ -1363,7 +484,72 @@ int main(int argc, char **argv) {
     int num_thread = atoi(argv[5]);
     tbb::task_scheduler_init init(num_thread);
 
-    if (kt != STRING_KEY) {
+    // Only uniform workloads are pre-generated by index-microbench
+    bool gen = (ap != UNIFORM);
+    const char *dump_file = NULL;
+    const char *trace_file = NULL;
+    workload::WorkloadSpec spec = workload::workload_spec(wl);
+    spec.distribution = ap;
+    spec.threads = num_thread;
+
+    for (int i = 6; i < argc; i++) {
+        if (strcmp(argv[i], "--gen") == 0) {
+            gen = true;
+        } else if (strncmp(argv[i], "--theta=", 8) == 0) {
+            spec.zipfian_theta = atof(argv[i] + 8);
+        } else if (strncmp(argv[i], "--hotset=", 9) == 0) {
+            spec.hotset_fraction = atof(argv[i] + 9);
+        } else if (strncmp(argv[i], "--hotopn=", 9) == 0) {
+            spec.hot_opn_fraction = atof(argv[i] + 9);
+        } else if (strncmp(argv[i], "--seed=", 7) == 0) {
+            spec.seed = strtoull(argv[i] + 7, NULL, 0);
+        } else if (strncmp(argv[i], "--load=", 7) == 0) {
+            LOAD_SIZE = strtoull(argv[i] + 7, NULL, 0);
+        } else if (strncmp(argv[i], "--run=", 6) == 0) {
+            RUN_SIZE = strtoull(argv[i] + 6, NULL, 0);
+        } else if (strcmp(argv[i], "--latency=csv") == 0) {
+            latency_recorder.set_format(latency::FORMAT_CSV);
+        } else if (strcmp(argv[i], "--latency=json") == 0) {
+            latency_recorder.set_format(latency::FORMAT_JSON);
+        } else if (strncmp(argv[i], "--dump=", 7) == 0) {
+            dump_file = argv[i] + 7;
+        } else if (strncmp(argv[i], "--trace=", 8) == 0) {
+            trace_file = argv[i] + 8;
+        } else {
+            fprintf(stderr, "Unknown option: %s\n", argv[i]);
+            exit(1);
+        }
+    }
+
+    if (spec.zipfian_theta <= 0 || spec.zipfian_theta >= 1) {
+        fprintf(stderr, "Zipfian constant must be in (0, 1): %f\n", spec.zipfian_theta);
+        exit(1);
+    }
+    if (spec.hotset_fraction < 0 || spec.hotset_fraction > 1 || spec.hot_opn_fraction < 0 || spec.hot_opn_fraction > 1) {
+        fprintf(stderr, "Hotspot fractions must be in [0, 1]\n");
+        exit(1);
+    }
+
+    if (trace_file != NULL) {
+        workload::Trace trace(trace_file);
+
+        if (trace.key_type() != (kt == STRING_KEY ? workload::TRACE_STRING : workload::TRACE_RANDINT)) {
+            fprintf(stderr, "Key type of %s does not match %s\n", trace_file, argv[3]);
+            exit(1);
+        }
+        if (trace.threads() != 0 && trace.threads() != (uint64_t)num_thread) {
+            fprintf(stderr, "%s was generated for %lu threads\n", trace_file, trace.threads());
+            exit(1);
+        }
+        LOAD_SIZE = trace.load_size();
+        RUN_SIZE = trace.run_size();
+        fprintf(stderr, "Mapped %lu keys\n", LOAD_SIZE);
+
+        if (kt != STRING_KEY)
+            ycsb_run_index(index_type, ap, num_thread, trace.load_keys<uint64_t>(), trace.run_keys<uint64_t>(), trace.ranges(), trace.ops());
+        else
+            ycsb_run_index(index_type, ap, num_thread, trace.load_keys<Key *>(), trace.run_keys<Key *>(), trace.ranges(), trace.ops());
+    } else if (kt != STRING_KEY) {
         std::vector<uint64_t> init_keys;
         std::vector<uint64_t> keys;
         std::vector<int> ranges;
@@ -1379,7 +565,7 @@ int main(int argc, char **argv) {
         memset(&ranges[0], 0x00, RUN_SIZE * sizeof(int));
         memset(&ops[0], 0x00, RUN_SIZE * sizeof(int));
 
-        ycsb_load_run_randint(index_type, wl, kt, ap, num_thread, init_keys, keys, ranges, ops);
+        ycsb_load_run_randint(index_type, wl, kt, ap, num_thread, gen ? &spec : NULL, dump_file, init_keys, keys, ranges, ops);
     } else {
         std::vector<Key *> init_keys;
         std::vector<Key *> keys;
@@ -1396,7 +582,7 @@ int main(int argc, char **argv) {
         memset(&ranges[0], 0x00, RUN_SIZE * sizeof(int));
         memset(&ops[0], 0x00, RUN_SIZE * sizeof(int));
 
-        ycsb_load_run_string(index_type, wl, kt, ap, num_thread, init_keys, keys, ranges, ops);
+        ycsb_load_run_string(index_type, wl, kt, ap, num_thread, gen ? &spec : NULL, dump_file, init_keys, keys, ranges, ops);
     }
 
     return 0;
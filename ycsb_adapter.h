@@ -0,0 +1,706 @@
+#ifndef YCSB_ADAPTER_H
+#define YCSB_ADAPTER_H
+
+#include <iostream>
+#include <cstring>
+#include <vector>
+#include <stdlib.h>
+
+#include "ycsb_workload.h"
+#include "P-ART/Tree.h"
+#include "third-party/FAST_FAIR/btree.h"
+#include "third-party/CCEH/src/Level_hashing.h"
+#include "third-party/CCEH/src/CCEH.h"
+#include "third-party/WOART/woart.h"
+#include "masstree.h"
+#include "P-BwTree/src/bwtree.h"
+#include "clht.h"
+#include "ssmem.h"
+
+#ifdef HOT
+#include <hot/rowex/HOTRowex.hpp>
+#include <idx/contenthelpers/IdentityKeyExtractor.hpp>
+#include <idx/contenthelpers/OptionalValue.hpp>
+#endif
+
+using namespace wangziqi2013::bwtree;
+
+namespace Dummy {
+    inline void mfence() {asm volatile("mfence":::"memory");}
+
+    inline void clflush(char *data, int len, bool front, bool back)
+    {
+        if (front)
+            mfence();
+        volatile char *ptr = (char *)((unsigned long)data & ~(64 - 1));
+        for (; ptr < data+len; ptr += 64){
+#ifdef CLFLUSH
+            asm volatile("clflush %0" : "+m" (*(volatile char *)ptr));
+#elif CLFLUSH_OPT
+            asm volatile(".byte 0x66; clflush %0" : "+m" (*(volatile char *)(ptr)));
+#elif CLWB
+            asm volatile(".byte 0x66; xsaveopt %0" : "+m" (*(volatile char *)(ptr)));
+#endif
+        }
+        if (back)
+            mfence();
+    }
+}
+
+
+////////////////////////Helper functions for P-BwTree/////////////////////////////
+/*
+ * class KeyComparator - Test whether BwTree supports context
+ *                       sensitive key comparator
+ *
+ * If a context-sensitive KeyComparator object is being used
+ * then it should follow rules like:
+ *   1. There could be no default constructor
+ *   2. There MUST be a copy constructor
+ *   3. operator() must be const
+ *
+ */
+class KeyComparator {
+ public:
+  inline bool operator()(const long int k1, const long int k2) const {
+    return k1 < k2;
+  }
+
+  inline bool operator()(const uint64_t k1, const uint64_t k2) const {
+      return k1 < k2;
+  }
+
+  inline bool operator()(const char *k1, const char *k2) const {
+      return memcmp(k1, k2, strlen(k1) > strlen(k2) ? strlen(k1) : strlen(k2)) < 0;
+  }
+
+  KeyComparator(int dummy) {
+    (void)dummy;
+
+    return;
+  }
+
+  KeyComparator() = delete;
+  //KeyComparator(const KeyComparator &p_key_cmp_obj) = delete;
+};
+
+/*
+ * class KeyEqualityChecker - Tests context sensitive key equality
+ *                            checker inside BwTree
+ *
+ * NOTE: This class is only used in KeyEqual() function, and is not
+ * used as STL template argument, it is not necessary to provide
+ * the object everytime a container is initialized
+ */
+class KeyEqualityChecker {
+ public:
+  inline bool operator()(const long int k1, const long int k2) const {
+    return k1 == k2;
+  }
+
+  inline bool operator()(uint64_t k1, uint64_t k2) const {
+      return k1 == k2;
+  }
+
+  inline bool operator()(const char *k1, const char *k2) const {
+      if (strlen(k1) != strlen(k2))
+          return false;
+      else
+          return memcmp(k1, k2, strlen(k1)) == 0;
+  }
+
+  KeyEqualityChecker(int dummy) {
+    (void)dummy;
+
+    return;
+  }
+
+  KeyEqualityChecker() = delete;
+  //KeyEqualityChecker(const KeyEqualityChecker &p_key_eq_obj) = delete;
+};
+/////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////Helper functions for P-HOT/////////////////////////////
+typedef struct IntKeyVal {
+    uint64_t key;
+    uintptr_t value;
+} IntKeyVal;
+
+template<typename ValueType = IntKeyVal *>
+class IntKeyExtractor {
+    public:
+    typedef uint64_t KeyType;
+
+    inline KeyType operator()(ValueType const &value) const {
+        return value->key;
+    }
+};
+
+template<typename ValueType = Key *>
+class KeyExtractor {
+    public:
+    typedef char const * KeyType;
+
+    inline KeyType operator()(ValueType const &value) const {
+        return (char const *)value->fkey;
+    }
+};
+/////////////////////////////////////////////////////////////////////////////////
+
+inline void loadKey(TID, Key &) {
+    return ;
+}
+
+/*
+ * Index adapters for the YCSB driver
+ *
+ * Every index is wrapped in an adapter with the same compile-time interface,
+ * and the driver's run loop is a template over the adapter type, so all
+ * indexes are driven by the identical harness and every call is resolved
+ * (and inlined) statically:
+ *
+ *   ThreadContext                  per-thread state (epoch info, buffers, ...)
+ *   phase_begin(num_thread)        before the worker threads of a phase start
+ *   phase_end()                    after they have all been joined
+ *   thread_enter(thread_id)        on each worker thread, returns its context
+ *   thread_exit(t, thread_id)      on each worker thread, after its last op
+ *   insert/read/update/remove(t, key)
+ *   scan(t, key, range)
+ *
+ * Keys are uint64_t for randint and Key * for string workloads, and are
+ * passed as references to the workload vectors because some indexes store a
+ * pointer to the key as value. IndexAdapter provides the defaults; adapters
+ * only define what their index supports (name hiding, no virtual calls).
+ */
+class IndexAdapter {
+    public:
+        struct ThreadContext {};
+
+        void phase_begin(int) {}
+
+        void phase_end() {}
+
+        ThreadContext thread_enter(int) {
+            return ThreadContext();
+        }
+
+        void thread_exit(ThreadContext &, int) {}
+
+        template <typename Context, typename KeyType>
+        void update(Context &, KeyType &) {
+            not_supported();
+        }
+
+        template <typename Context, typename KeyType>
+        void remove(Context &, KeyType &) {
+            not_supported();
+        }
+
+        template <typename Context, typename KeyType>
+        void scan(Context &, KeyType &, int) {
+            not_supported();
+        }
+
+    protected:
+        static void not_supported() {
+            std::cout << "NOT SUPPORTED CMD!\n";
+            exit(0);
+        }
+};
+
+class ArtAdapter : public IndexAdapter {
+    private:
+        ART_ROWEX::Tree tree;
+        Key *end_int;
+        Key *end_str;
+
+    public:
+        typedef ThreadInfo ThreadContext;
+
+        ArtAdapter() : tree(loadKey) {
+            std::string maxKey("z");
+            end_int = end_int->make_leaf(UINT64_MAX, sizeof(uint64_t), 0);
+            end_str = end_str->make_leaf((char *)maxKey.c_str(), maxKey.size()+1, 0);
+        }
+
+        ThreadContext thread_enter(int) {
+            return tree.getThreadInfo();
+        }
+
+        void thread_exit(ThreadContext &, int) {}
+
+        inline void insert(ThreadContext &t, uint64_t &key) {
+#ifdef ART_INLINE_LEAVES
+            // integer keys are stored inline in the tree, they do not need a leaf
+            ART_ROWEX::InlineKey k(key, key);
+            tree.insert(k.get(), t);
+#else
+            Key *k = k->make_leaf(key, sizeof(uint64_t), key);
+            tree.insert(k, t);
+#endif
+        }
+
+        inline void insert(ThreadContext &t, Key *&key) {
+            Key *k = k->make_leaf((char *)key->fkey, key->key_len, key->value);
+            tree.insert(k, t);
+        }
+
+        inline void update(ThreadContext &t, uint64_t &key) {
+#ifdef ART_INLINE_LEAVES
+            ART_ROWEX::InlineKey k(key, key);
+            tree.upsert(k.get(), t);
+#else
+            Key *k = k->make_leaf(key, sizeof(uint64_t), key);
+            Key *old;
+            tree.upsert(k, t, &old);
+            if (old != nullptr) tree.retireLeaf(old, t);
+#endif
+        }
+
+        inline void update(ThreadContext &t, Key *&key) {
+            Key *k = k->make_leaf((char *)key->fkey, key->key_len, key->value);
+            Key *old;
+            tree.upsert(k, t, &old);
+            if (old != nullptr) tree.retireLeaf(old, t);
+        }
+
+        inline void read(ThreadContext &t, uint64_t &key) {
+            ART_ROWEX::InlineKey k(key, 0);
+            uint64_t *val = reinterpret_cast<uint64_t *>(tree.lookup(k.get(), t));
+            if (*val != key) {
+                std::cout << "[ART] wrong key read: " << val << " expected:" << key << std::endl;
+                exit(1);
+            }
+        }
+
+        inline void read(ThreadContext &t, Key *&key) {
+            Key *k = k->make_leaf((char *)key->fkey, key->key_len, key->value);
+            Key *val = reinterpret_cast<Key *>(tree.lookup(k, t));
+            if (val->value != key->value) {
+                std::cout << "[ART] wrong key read: " << val->value << " expected:" << key->value << std::endl;
+                throw;
+            }
+        }
+
+        inline void scan(ThreadContext &t, uint64_t &key, int range) {
+            size_t resultsFound = 0;
+            size_t resultsSize = range;
+            ART_ROWEX::InlineKey start(key, 0);
+#ifdef ART_INLINE_LEAVES
+            TID results[MAX_SCAN_LENGTH];
+            tree.lookupRangeValues(start.get(), end_int, results, resultsSize, resultsFound, t);
+#else
+            Key *results[MAX_SCAN_LENGTH];
+            Key *continueKey = NULL;
+            tree.lookupRange(start.get(), end_int, continueKey, results, resultsSize, resultsFound, t);
+#endif
+        }
+
+        inline void scan(ThreadContext &t, Key *&key, int range) {
+            size_t resultsFound = 0;
+            size_t resultsSize = range;
+            Key *start = start->make_leaf((char *)key->fkey, key->key_len, key->value);
+#ifdef ART_INLINE_LEAVES
+            TID results[MAX_SCAN_LENGTH];
+            tree.lookupRangeValues(start, end_str, results, resultsSize, resultsFound, t);
+#else
+            Key *results[MAX_SCAN_LENGTH];
+            Key *continueKey = NULL;
+            tree.lookupRange(start, end_str, continueKey, results, resultsSize, resultsFound, t);
+#endif
+        }
+};
+
+#ifdef HOT
+template <typename KeyType>
+class HotAdapter;
+
+template <>
+class HotAdapter<uint64_t> : public IndexAdapter {
+    private:
+        hot::rowex::HOTRowex<IntKeyVal *, IntKeyExtractor> mTrie;
+
+    public:
+        inline void insert(ThreadContext &, uint64_t &key) {
+            IntKeyVal *kv;
+            posix_memalign((void **)&kv, 64, sizeof(IntKeyVal));
+            kv->key = key; kv->value = key;
+            Dummy::clflush((char *)kv, sizeof(IntKeyVal), true, true);
+            if (!(mTrie.insert(kv))) {
+                fprintf(stderr, "[HOT] insert fail\n");
+                exit(1);
+            }
+        }
+
+        inline void read(ThreadContext &, uint64_t &key) {
+            // a miss is not an error, the key may have been removed
+            idx::contenthelpers::OptionalValue<IntKeyVal *> result = mTrie.lookup(key);
+            if (result.mIsValid && result.mValue->value != key) {
+                printf("Return value = %lu, Correct value = %lu\n", result.mValue->value, key);
+                exit(1);
+            }
+        }
+
+        // The removed value is not freed, concurrent readers may still use it
+        inline void remove(ThreadContext &, uint64_t &key) {
+            mTrie.remove(key);
+        }
+
+        inline void scan(ThreadContext &, uint64_t &key, int range) {
+            IntKeyVal *results[MAX_SCAN_LENGTH];
+            mTrie.scan(key, range, results);
+        }
+};
+
+template <>
+class HotAdapter<Key *> : public IndexAdapter {
+    private:
+        hot::rowex::HOTRowex<Key *, KeyExtractor> mTrie;
+
+    public:
+        inline void insert(ThreadContext &, Key *&key) {
+            Key *k = k->make_leaf((char *)key->fkey, key->key_len, key->value);
+            Dummy::clflush((char *)k, sizeof(Key) + k->key_len, true, true);
+            if (!(mTrie.insert(k))) {
+                fprintf(stderr, "[HOT] insert fail\n");
+                exit(1);
+            }
+        }
+
+        inline void read(ThreadContext &, Key *&key) {
+            idx::contenthelpers::OptionalValue<Key *> result = mTrie.lookup((char const *)key->fkey);
+            if (result.mIsValid && result.mValue->value != key->value) {
+                printf("Return value = %lu, Correct value = %lu\n", result.mValue->value, key->value);
+                exit(1);
+            }
+        }
+
+        inline void remove(ThreadContext &, Key *&key) {
+            mTrie.remove((char const *)key->fkey);
+        }
+
+        inline void scan(ThreadContext &, Key *&key, int range) {
+            Key *results[MAX_SCAN_LENGTH];
+            mTrie.scan((char const *)key->fkey, range, results);
+        }
+};
+#endif
+
+template <typename KeyType>
+class BwTreeAdapter : public IndexAdapter {
+    private:
+        typedef typename std::conditional<std::is_same<KeyType, uint64_t>::value, uint64_t, char *>::type TreeKey;
+
+        BwTree<TreeKey, uint64_t, KeyComparator, KeyEqualityChecker> *t;
+
+        static inline TreeKey tree_key(uint64_t key) { return key; }
+        static inline TreeKey tree_key(Key *key) { return (TreeKey)key->fkey; }
+        static inline uint64_t tree_value(uint64_t key) { return key; }
+        static inline uint64_t tree_value(Key *key) { return key->value; }
+
+    public:
+        struct ThreadContext {};
+
+        BwTreeAdapter() {
+            t = new BwTree<TreeKey, uint64_t, KeyComparator, KeyEqualityChecker>{true, KeyComparator{1}, KeyEqualityChecker{1}};
+            t->UpdateThreadLocal(1);
+            t->AssignGCID(0);
+        }
+
+        void phase_begin(int num_thread) {
+            t->UpdateThreadLocal(num_thread);
+        }
+
+        void phase_end() {
+            t->UpdateThreadLocal(1);
+        }
+
+        ThreadContext thread_enter(int thread_id) {
+            t->AssignGCID(thread_id);
+            return ThreadContext{};
+        }
+
+        void thread_exit(ThreadContext &, int thread_id) {
+            t->UnregisterThread(thread_id);
+        }
+
+        inline void insert(ThreadContext &, KeyType &key) {
+            if constexpr (std::is_same<KeyType, Key *>::value)
+                Dummy::clflush((char *)tree_key(key), key->key_len, true, true);
+            t->Insert(tree_key(key), tree_value(key));
+        }
+
+        inline void read(ThreadContext &, KeyType &key) {
+            uint64_t v = 0;
+            if (!t->GetValueSingle(tree_key(key), v) || v != tree_value(key)) {
+                std::cout << "[BWTREE] wrong key read: " << v << " expected:" << tree_value(key) << std::endl;
+            }
+        }
+
+        inline void scan(ThreadContext &, KeyType &key, int range) {
+            auto it = t->Begin(tree_key(key));
+
+            int resultsFound = 0;
+            while (it.IsEnd() != true && resultsFound != range) {
+                resultsFound++;
+                it++;
+            }
+        }
+};
+
+class MasstreeAdapter : public IndexAdapter {
+    private:
+        masstree::masstree *tree;
+        bool check_reads;
+
+    public:
+        typedef MASS::ThreadInfo ThreadContext;
+
+        // Values of reads are only checked for uniform workloads
+        MasstreeAdapter(bool check_reads) : check_reads(check_reads) {
+            tree = new masstree::masstree();
+        }
+
+        ThreadContext thread_enter(int) {
+            return tree->getThreadInfo();
+        }
+
+        void thread_exit(ThreadContext &, int) {}
+
+        inline void insert(ThreadContext &t, uint64_t &key) {
+            tree->put(key, &key, t);
+        }
+
+        inline void insert(ThreadContext &t, Key *&key) {
+            // key_len counts the terminating zero byte
+            tree->put((char *)key->fkey, key->key_len - 1, key->value, t);
+        }
+
+        inline void read(ThreadContext &t, uint64_t &key) {
+            uint64_t *ret = reinterpret_cast<uint64_t *> (tree->get(key, t));
+            if (check_reads && *ret != key) {
+                printf("[MASS] search key = %lu, search value = %lu\n", key, *ret);
+                exit(1);
+            }
+        }
+
+        inline void read(ThreadContext &t, Key *&key) {
+            uint64_t *ret = reinterpret_cast<uint64_t *> (tree->get((char *)key->fkey, key->key_len - 1, t));
+            if (check_reads && (uint64_t) ret != key->value) {
+                printf("[MASS] search key = %lu, search value = %lu\n", key->value, (uint64_t) ret);
+                exit(1);
+            }
+        }
+
+        template <typename KeyType>
+        inline void update(ThreadContext &t, KeyType &key) {
+            insert(t, key);
+        }
+
+        inline void remove(ThreadContext &t, uint64_t &key) {
+            tree->del(key, t);
+        }
+
+        inline void remove(ThreadContext &t, Key *&key) {
+            tree->del((char *)key->fkey, key->key_len - 1, t);
+        }
+
+        inline void scan(ThreadContext &t, uint64_t &key, int range) {
+            uint64_t buf[MAX_SCAN_LENGTH];
+            tree->scan(key, range, buf, t);
+        }
+
+        inline void scan(ThreadContext &t, Key *&key, int range) {
+            uint64_t results[MAX_SCAN_LENGTH];
+            tree->scan((char *)key->fkey, key->key_len - 1, range, results, t);
+        }
+};
+
+class ClhtAdapter : public IndexAdapter {
+    private:
+        clht_t *hashtable;
+
+    public:
+        ClhtAdapter(bool string_keys) {
+            hashtable = string_keys ? clht_str_create(512) : clht_create(512);
+        }
+
+        ~ClhtAdapter() {
+            clht_gc_destroy(hashtable);
+        }
+
+        ThreadContext thread_enter(int thread_id) {
+            clht_gc_thread_init(hashtable, thread_id);
+            return ThreadContext();
+        }
+
+        inline void insert(ThreadContext &, uint64_t &key) {
+            clht_put(hashtable, key, key);
+        }
+
+        inline void read(ThreadContext &, uint64_t &key) {
+            uintptr_t val = clht_get(hashtable->ht, key);
+            if (val != key) {
+                std::cout << "[CLHT] wrong key read: " << val << "expected: " << key << std::endl;
+                exit(1);
+            }
+        }
+
+        inline void insert(ThreadContext &, Key *&key) {
+            clht_str_put(hashtable, (char *)key->fkey, key->key_len, key->value);
+        }
+
+        inline void read(ThreadContext &, Key *&key) {
+            uintptr_t val = clht_str_get(hashtable->ht, (char *)key->fkey, key->key_len);
+            if (val != key->value) {
+                std::cout << "[CLHT] wrong key read: " << val << "expected: " << key->value << std::endl;
+                exit(1);
+            }
+        }
+};
+
+class FastFairAdapter : public IndexAdapter {
+    private:
+        fastfair::btree *bt;
+        std::string maxKey;
+
+    public:
+        FastFairAdapter() : maxKey("z") {
+            bt = new fastfair::btree();
+        }
+
+        inline void insert(ThreadContext &, uint64_t &key) {
+            bt->btree_insert(key, (char *) &key);
+        }
+
+        inline void insert(ThreadContext &, Key *&key) {
+            bt->btree_insert((char *)key->fkey, (char *) &key->value);
+        }
+
+        inline void read(ThreadContext &, uint64_t &key) {
+            uint64_t *ret = reinterpret_cast<uint64_t *>(bt->btree_search(key));
+            if (ret == NULL) {
+                //printf("NULL is found\n");
+            } else if (*ret != key) {
+                //printf("[FASTFAIR] wrong value is returned: <expected> %lu\n", key);
+                //exit(1);
+            }
+        }
+
+        inline void read(ThreadContext &, Key *&key) {
+            uint64_t *ret = reinterpret_cast<uint64_t *> (bt->btree_search((char *)key->fkey));
+            if (ret == NULL) {
+                //printf("Return value is NULL\n");
+            } else if (*ret != key->value) {
+                //printf("[FASTFAIR] wrong value was returned: originally expected %lu\n", key->value);
+                //exit(1);
+            }
+        }
+
+        inline void scan(ThreadContext &, uint64_t &key, int range) {
+            uint64_t buf[MAX_SCAN_LENGTH];
+            int resultsFound = 0;
+            bt->btree_search_range (key, UINT64_MAX, buf, range, resultsFound);
+        }
+
+        inline void scan(ThreadContext &, Key *&key, int range) {
+            uint64_t buf[MAX_SCAN_LENGTH];
+            int resultsFound = 0;
+            bt->btree_search_range ((char *)key->fkey, (char *)maxKey.c_str(), buf, range, resultsFound);
+        }
+};
+
+// Calls are qualified with the table type to bypass the virtual Hash interface
+class LevelHashAdapter : public IndexAdapter {
+    private:
+        LevelHashing *table;
+
+    public:
+        LevelHashAdapter() {
+            table = new LevelHashing(10);
+        }
+
+        inline void insert(ThreadContext &, uint64_t &key) {
+            table->LevelHashing::Insert(key, reinterpret_cast<const char*>(&key));
+        }
+
+        inline void read(ThreadContext &, uint64_t &key) {
+            auto val = table->LevelHashing::Get(key);
+            if (val == NONE) {
+                std::cout << "[Level Hashing] wrong key read: " << *(uint64_t *)val << " expected: " << key << std::endl;
+                exit(1);
+            }
+        }
+};
+
+class CCEHAdapter : public IndexAdapter {
+    private:
+        CCEH *table;
+
+    public:
+        CCEHAdapter() {
+            table = new CCEH(2);
+        }
+
+        inline void insert(ThreadContext &, uint64_t &key) {
+            table->CCEH::Insert(key, reinterpret_cast<const char*>(&key));
+        }
+
+        inline void read(ThreadContext &, uint64_t &key) {
+            uint64_t *val = reinterpret_cast<uint64_t *>(const_cast<char *>(table->CCEH::Get(key)));
+            if (val == NULL) {
+                //std::cout << "[CCEH] wrong value is read <expected:> " << key << std::endl;
+                //exit(1);
+            }
+        }
+};
+
+// WOART is built for either integer or string keys (STRING_TYPE)
+class WoartAdapter : public IndexAdapter {
+    private:
+        woart_tree *t;
+
+    public:
+        WoartAdapter() {
+            t = (woart_tree *)malloc(sizeof(woart_tree));
+            woart_tree_init(t);
+        }
+
+#ifndef STRING_TYPE
+        inline void insert(ThreadContext &, uint64_t &key) {
+            woart_insert(t, key, sizeof(uint64_t), &key);
+        }
+
+        inline void read(ThreadContext &, uint64_t &key) {
+            uint64_t *ret = reinterpret_cast<uint64_t *> (woart_search(t, key, sizeof(uint64_t)));
+            if (*ret != key) {
+                printf("[WOART] expected = %lu, search value = %lu\n", key, *ret);
+                exit(1);
+            }
+        }
+
+        inline void scan(ThreadContext &, uint64_t &key, int range) {
+            unsigned long buf[MAX_SCAN_LENGTH];
+            woart_scan(t, key, range, buf);
+        }
+#else
+        inline void insert(ThreadContext &, Key *&key) {
+            woart_insert(t, key->fkey, key->key_len, &key->value);
+        }
+
+        inline void read(ThreadContext &, Key *&key) {
+            uint64_t *ret = reinterpret_cast<uint64_t *> (woart_search(t, key->fkey, key->key_len));
+            if (*ret != key->value) {
+                printf("[WOART] search key = %lu, search value = %lu\n", key->value, *ret);
+                exit(1);
+            }
+        }
+
+        inline void scan(ThreadContext &, Key *&key, int range) {
+            unsigned long buf[MAX_SCAN_LENGTH];
+            woart_scan(t, key->fkey, key->key_len, range, buf);
+        }
+#endif
+};
+
+#endif // YCSB_ADAPTER_H
@@ -0,0 +1,203 @@
+#ifndef YCSB_LATENCY_H
+#define YCSB_LATENCY_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <cstring>
+#include <chrono>
+#include <thread>
+#include <x86intrin.h>
+#include "tbb/enumerable_thread_specific.h"
+
+#include "ycsb_workload.h"
+
+/*
+ * Per-operation latency recording for the YCSB driver
+ *
+ * Every worker thread records into its own set of histograms (one per
+ * operation type) through tbb::enumerable_thread_specific, so recording is a
+ * plain increment on thread-local memory. The histograms are merged when a
+ * phase is reported, after all workers have finished.
+ *
+ * The histogram is HDR-style log-linear over TSC ticks: values below
+ * 2 * SUB_BUCKETS are exact and larger values fall into SUB_BUCKETS buckets
+ * per power of two, i.e. within ~3% of the recorded value.
+ */
+namespace latency {
+
+enum {
+    FORMAT_NONE,
+    FORMAT_CSV,
+    FORMAT_JSON,
+};
+
+static constexpr int NUM_OP_TYPES = OP_DELETE + 1;
+static constexpr int SUB_BUCKET_BITS = 5;
+static constexpr uint64_t SUB_BUCKETS = 1ULL << SUB_BUCKET_BITS;
+static constexpr int NUM_BUCKETS = (64 - SUB_BUCKET_BITS) * SUB_BUCKETS + SUB_BUCKETS;
+
+static const char *op_names[NUM_OP_TYPES] = {"insert", "update", "read", "scan", "delete"};
+
+class Histogram {
+    private:
+        uint64_t counts[NUM_BUCKETS];
+        uint64_t total;
+        uint64_t sum;
+        uint64_t max;
+
+        static inline int bucket_of(uint64_t v) {
+            if (v < 2 * SUB_BUCKETS)
+                return (int)v;
+            int shift = 63 - __builtin_clzll(v) - SUB_BUCKET_BITS;
+            return shift * SUB_BUCKETS + (int)(v >> shift);
+        }
+
+        // highest value that falls into the bucket
+        static inline uint64_t bucket_value(int b) {
+            if (b < (int)(2 * SUB_BUCKETS))
+                return b;
+            int shift = b / SUB_BUCKETS - 1;
+            return ((uint64_t)(b - shift * SUB_BUCKETS + 1) << shift) - 1;
+        }
+
+    public:
+        Histogram() {
+            clear();
+        }
+
+        void clear() {
+            memset(counts, 0, sizeof(counts));
+            total = sum = max = 0;
+        }
+
+        inline void record(uint64_t v) {
+            counts[bucket_of(v)]++;
+            total++;
+            sum += v;
+            if (v > max)
+                max = v;
+        }
+
+        void merge(const Histogram &h) {
+            for (int b = 0; b < NUM_BUCKETS; b++)
+                counts[b] += h.counts[b];
+            total += h.total;
+            sum += h.sum;
+            if (h.max > max)
+                max = h.max;
+        }
+
+        uint64_t count() const { return total; }
+
+        double mean() const { return total ? (double)sum / total : 0; }
+
+        uint64_t maximum() const { return max; }
+
+        uint64_t percentile(double p) const {
+            uint64_t rank = (uint64_t)(p / 100.0 * total + 0.5);
+            uint64_t seen = 0;
+
+            if (rank == 0)
+                rank = 1;
+            for (int b = 0; b < NUM_BUCKETS; b++) {
+                seen += counts[b];
+                if (seen >= rank)
+                    return bucket_value(b) < max ? bucket_value(b) : max;
+            }
+            return max;
+        }
+};
+
+struct ThreadHistograms {
+    Histogram hist[NUM_OP_TYPES];
+    bool enabled;
+
+    ThreadHistograms(bool enabled) : enabled(enabled) {}
+
+    inline uint64_t start() const {
+        if (!enabled)
+            return 0;
+        _mm_lfence();
+        return __rdtsc();
+    }
+
+    inline void stop(int op, uint64_t start_tick) {
+        if (!enabled)
+            return;
+        unsigned int aux;
+        hist[op].record(__rdtscp(&aux) - start_tick);
+    }
+};
+
+class Recorder {
+    private:
+        int format;
+        double ns_per_tick;
+        tbb::enumerable_thread_specific<ThreadHistograms> local_hist;
+
+        static double calibrate() {
+            auto t0 = std::chrono::steady_clock::now();
+            uint64_t c0 = __rdtsc();
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            uint64_t c1 = __rdtsc();
+            auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now() - t0);
+            return (double)ns.count() / (c1 - c0);
+        }
+
+    public:
+        Recorder() : format(FORMAT_NONE), ns_per_tick(1.0), local_hist(false) {}
+
+        void set_format(int f) {
+            format = f;
+            if (format != FORMAT_NONE)
+                ns_per_tick = calibrate();
+            local_hist.clear();
+            local_hist = tbb::enumerable_thread_specific<ThreadHistograms>(format != FORMAT_NONE);
+        }
+
+        inline ThreadHistograms &local() {
+            return local_hist.local();
+        }
+
+        // Merges and prints the histograms of the phase, then resets them
+        void report(const char *phase) {
+            if (format == FORMAT_NONE)
+                return;
+
+            Histogram merged[NUM_OP_TYPES];
+            local_hist.combine_each([&](ThreadHistograms &h) {
+                for (int op = 0; op < NUM_OP_TYPES; op++) {
+                    merged[op].merge(h.hist[op]);
+                    h.hist[op].clear();
+                }
+            });
+
+            for (int op = 0; op < NUM_OP_TYPES; op++) {
+                const Histogram &h = merged[op];
+                if (h.count() == 0)
+                    continue;
+
+                double mean = h.mean() * ns_per_tick;
+                double p50 = h.percentile(50) * ns_per_tick;
+                double p90 = h.percentile(90) * ns_per_tick;
+                double p99 = h.percentile(99) * ns_per_tick;
+                double p999 = h.percentile(99.9) * ns_per_tick;
+                double p9999 = h.percentile(99.99) * ns_per_tick;
+                double max = h.maximum() * ns_per_tick;
+
+                if (format == FORMAT_CSV) {
+                    printf("Latency: %s, %s, %lu, %.0f, %.0f, %.0f, %.0f, %.0f, %.0f, %.0f ,ns (count, mean, p50, p90, p99, p99.9, p99.99, max)\n",
+                            phase, op_names[op], h.count(), mean, p50, p90, p99, p999, p9999, max);
+                } else {
+                    printf("{\"phase\": \"%s\", \"op\": \"%s\", \"count\": %lu, \"mean_ns\": %.0f, \"p50_ns\": %.0f, "
+                            "\"p90_ns\": %.0f, \"p99_ns\": %.0f, \"p99.9_ns\": %.0f, \"p99.99_ns\": %.0f, \"max_ns\": %.0f}\n",
+                            phase, op_names[op], h.count(), mean, p50, p90, p99, p999, p9999, max);
+                }
+            }
+        }
+};
+
+}
+
+#endif // YCSB_LATENCY_H
@@ -0,0 +1,301 @@
+#ifndef YCSB_TRACE_H
+#define YCSB_TRACE_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <cstring>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "tbb/tbb.h"
+
+#include "Key.h"
+#include "ycsb_workload.h"
+
+/*
+ * Binary workload trace
+ *
+ * A trace holds a whole load/run workload in the layout the YCSB driver
+ * consumes, so it can be mmap()ed and handed to the worker threads without
+ * parsing or per-key allocation:
+ *
+ *   TraceHeader
+ *   load keys   uint64_t[load_size]
+ *   run keys    uint64_t[run_size]
+ *   ops         int32_t[run_size]      (OP_INSERT, OP_READ, ...)
+ *   ranges      int32_t[run_size]
+ *   arena       string keys only
+ *
+ * Every section starts at a TRACE_ALIGN boundary. For integer keys the key
+ * arrays hold the keys themselves. For string keys they hold offsets into the
+ * arena, which stores each key as a Key record (value, key_len, fkey) at an
+ * 8-byte boundary; the offsets are relocated to Key pointers in place once
+ * the file is mapped (the mapping is private, the file is never modified).
+ * Every section, every Key record and every scan length (at most
+ * MAX_SCAN_LENGTH) is checked against the file before the trace is used.
+ *
+ * A run phase whose targets depend on how run_phase() splits the operations
+ * between threads (LATEST, see KeyChooser) records the number of threads and
+ * can only be run with that many; otherwise threads is 0.
+ */
+namespace workload {
+
+static constexpr uint64_t TRACE_MAGIC = 0x3143525442534359ULL;  // "YCSBTRC1"
+static constexpr uint32_t TRACE_VERSION = 2;
+static constexpr uint64_t TRACE_ALIGN = 4096;
+
+enum {
+    TRACE_RANDINT,
+    TRACE_STRING,
+};
+
+struct TraceHeader {
+    uint64_t magic;
+    uint32_t version;
+    uint32_t key_type;
+    uint64_t load_size;
+    uint64_t run_size;
+    uint64_t load_keys_off;
+    uint64_t run_keys_off;
+    uint64_t ops_off;
+    uint64_t ranges_off;
+    uint64_t arena_off;
+    uint64_t arena_size;
+    uint64_t threads;
+};
+
+static_assert(sizeof(int) == sizeof(int32_t), "trace ops/ranges are stored as the driver's int");
+
+inline uint64_t trace_align(uint64_t off, uint64_t align = TRACE_ALIGN) {
+    return (off + align - 1) & ~(align - 1);
+}
+
+inline uint64_t key_record_size(const Key *k) {
+    return trace_align(sizeof(Key) + k->key_len, 8);
+}
+
+inline void trace_write_at(FILE *fp, uint64_t off, const void *data, uint64_t len) {
+    if (fseeko(fp, off, SEEK_SET) != 0 || (len && fwrite(data, 1, len, fp) != len)) {
+        perror("trace write");
+        exit(1);
+    }
+}
+
+inline TraceHeader trace_layout(uint32_t key_type, uint64_t load_size, uint64_t run_size, uint64_t arena_size,
+        uint64_t threads) {
+    TraceHeader h;
+
+    memset(&h, 0, sizeof(h));
+    h.magic = TRACE_MAGIC;
+    h.version = TRACE_VERSION;
+    h.key_type = key_type;
+    h.load_size = load_size;
+    h.run_size = run_size;
+    h.load_keys_off = trace_align(sizeof(TraceHeader));
+    h.run_keys_off = trace_align(h.load_keys_off + load_size * sizeof(uint64_t));
+    h.ops_off = trace_align(h.run_keys_off + run_size * sizeof(uint64_t));
+    h.ranges_off = trace_align(h.ops_off + run_size * sizeof(int32_t));
+    h.arena_off = trace_align(h.ranges_off + run_size * sizeof(int32_t));
+    h.arena_size = arena_size;
+    h.threads = threads;
+
+    return h;
+}
+
+inline void write_trace(const char *path,
+        std::vector<uint64_t> &init_keys,
+        std::vector<uint64_t> &keys,
+        std::vector<int> &ranges,
+        std::vector<int> &ops,
+        uint64_t threads)
+{
+    FILE *fp = fopen(path, "wb");
+    if (fp == NULL) {
+        perror(path);
+        exit(1);
+    }
+
+    TraceHeader h = trace_layout(TRACE_RANDINT, init_keys.size(), keys.size(), 0, threads);
+    trace_write_at(fp, 0, &h, sizeof(h));
+    trace_write_at(fp, h.load_keys_off, init_keys.data(), h.load_size * sizeof(uint64_t));
+    trace_write_at(fp, h.run_keys_off, keys.data(), h.run_size * sizeof(uint64_t));
+    trace_write_at(fp, h.ops_off, ops.data(), h.run_size * sizeof(int32_t));
+    trace_write_at(fp, h.ranges_off, ranges.data(), h.run_size * sizeof(int32_t));
+    fclose(fp);
+
+    fprintf(stderr, "Wrote %lu load and %lu run operations to %s\n", h.load_size, h.run_size, path);
+}
+
+inline void write_trace(const char *path,
+        std::vector<Key *> &init_keys,
+        std::vector<Key *> &keys,
+        std::vector<int> &ranges,
+        std::vector<int> &ops,
+        uint64_t threads)
+{
+    FILE *fp = fopen(path, "wb");
+    if (fp == NULL) {
+        perror(path);
+        exit(1);
+    }
+
+    std::vector<uint64_t> load_offs(init_keys.size());
+    std::vector<uint64_t> run_offs(keys.size());
+    uint64_t arena_size = 0;
+
+    for (uint64_t i = 0; i < init_keys.size(); i++) {
+        load_offs[i] = arena_size;
+        arena_size += key_record_size(init_keys[i]);
+    }
+    for (uint64_t i = 0; i < keys.size(); i++) {
+        run_offs[i] = arena_size;
+        arena_size += key_record_size(keys[i]);
+    }
+
+    TraceHeader h = trace_layout(TRACE_STRING, init_keys.size(), keys.size(), arena_size, threads);
+    trace_write_at(fp, 0, &h, sizeof(h));
+    trace_write_at(fp, h.load_keys_off, load_offs.data(), h.load_size * sizeof(uint64_t));
+    trace_write_at(fp, h.run_keys_off, run_offs.data(), h.run_size * sizeof(uint64_t));
+    trace_write_at(fp, h.ops_off, ops.data(), h.run_size * sizeof(int32_t));
+    trace_write_at(fp, h.ranges_off, ranges.data(), h.run_size * sizeof(int32_t));
+
+    // Key records are written back to back, padded to 8 bytes
+    static const char zeros[8] = {0};
+    trace_write_at(fp, h.arena_off, NULL, 0);
+    for (int phase = 0; phase < 2; phase++) {
+        std::vector<Key *> &v = phase == 0 ? init_keys : keys;
+        for (uint64_t i = 0; i < v.size(); i++) {
+            uint64_t len = sizeof(Key) + v[i]->key_len;
+            if (fwrite(v[i], 1, len, fp) != len ||
+                    fwrite(zeros, 1, key_record_size(v[i]) - len, fp) != key_record_size(v[i]) - len) {
+                perror("trace write");
+                exit(1);
+            }
+        }
+    }
+    fclose(fp);
+
+    fprintf(stderr, "Wrote %lu load and %lu run operations to %s\n", h.load_size, h.run_size, path);
+}
+
+class Trace {
+    private:
+        char *base;
+        uint64_t length;
+        TraceHeader *header;
+
+        // Touches every page from all TBB workers instead of faulting them in one by one on first use
+        void prefault() {
+            tbb::parallel_for(tbb::blocked_range<uint64_t>(0, length, 1 << 24), [&](const tbb::blocked_range<uint64_t> &scope) {
+                volatile char sum = 0;
+                for (uint64_t off = scope.begin(); off < scope.end(); off += 4096)
+                    sum += base[off];
+            });
+        }
+
+        // A section of count elements of size bytes each at off must lie within the file
+        bool section_fits(uint64_t off, uint64_t count, uint64_t size) const {
+            return off % 8 == 0 && off <= length && count <= (length - off) / size;
+        }
+
+        void relocate(uint64_t *offs, uint64_t n) {
+            char *arena = base + header->arena_off;
+            uint64_t arena_size = header->arena_size;
+            tbb::parallel_for(tbb::blocked_range<uint64_t>(0, n), [&](const tbb::blocked_range<uint64_t> &scope) {
+                for (uint64_t i = scope.begin(); i != scope.end(); i++) {
+                    // the Key record header first, then the key bytes it announces
+                    uint64_t off = offs[i];
+                    if (off % 8 != 0 || arena_size < sizeof(Key) || off > arena_size - sizeof(Key) ||
+                            reinterpret_cast<Key *>(arena + off)->key_len > arena_size - sizeof(Key) - off) {
+                        fprintf(stderr, "Corrupted trace: key offset %lu out of range\n", off);
+                        exit(1);
+                    }
+                    offs[i] = (uint64_t)(arena + off);
+                }
+            });
+        }
+
+        void check_ranges() {
+            int *ops = reinterpret_cast<int *>(base + header->ops_off);
+            int *ranges = reinterpret_cast<int *>(base + header->ranges_off);
+            for (uint64_t i = 0; i < header->run_size; i++) {
+                if (ops[i] == OP_SCAN && (ranges[i] < 0 || ranges[i] > MAX_SCAN_LENGTH)) {
+                    fprintf(stderr, "Corrupted trace: scan length %d out of range [0, %d]\n", ranges[i], MAX_SCAN_LENGTH);
+                    exit(1);
+                }
+            }
+        }
+
+    public:
+        Trace(const char *path) {
+            int fd = open(path, O_RDONLY);
+            struct stat st;
+
+            if (fd < 0 || fstat(fd, &st) != 0) {
+                perror(path);
+                exit(1);
+            }
+            length = st.st_size;
+            if (length < sizeof(TraceHeader)) {
+                fprintf(stderr, "%s is not a workload trace\n", path);
+                exit(1);
+            }
+
+            base = (char *)mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+            close(fd);
+            if (base == MAP_FAILED) {
+                perror("mmap");
+                exit(1);
+            }
+            madvise(base, length, MADV_WILLNEED);
+
+            header = reinterpret_cast<TraceHeader *>(base);
+            if (header->magic != TRACE_MAGIC || header->version != TRACE_VERSION ||
+                    (header->key_type != TRACE_RANDINT && header->key_type != TRACE_STRING) ||
+                    !section_fits(header->load_keys_off, header->load_size, sizeof(uint64_t)) ||
+                    !section_fits(header->run_keys_off, header->run_size, sizeof(uint64_t)) ||
+                    !section_fits(header->ops_off, header->run_size, sizeof(int32_t)) ||
+                    !section_fits(header->ranges_off, header->run_size, sizeof(int32_t)) ||
+                    (header->arena_size && !section_fits(header->arena_off, header->arena_size, 1))) {
+                fprintf(stderr, "%s is not a valid workload trace\n", path);
+                exit(1);
+            }
+
+            prefault();
+            check_ranges();
+            if (header->key_type == TRACE_STRING) {
+                relocate(reinterpret_cast<uint64_t *>(base + header->load_keys_off), header->load_size);
+                relocate(reinterpret_cast<uint64_t *>(base + header->run_keys_off), header->run_size);
+            }
+        }
+
+        ~Trace() {
+            munmap(base, length);
+        }
+
+        uint32_t key_type() const { return header->key_type; }
+
+        uint64_t load_size() const { return header->load_size; }
+
+        uint64_t run_size() const { return header->run_size; }
+
+        uint64_t threads() const { return header->threads; }
+
+        // KeyType is uint64_t for TRACE_RANDINT and Key * for TRACE_STRING traces
+        template <typename KeyType>
+        KeyType *load_keys() { return reinterpret_cast<KeyType *>(base + header->load_keys_off); }
+
+        template <typename KeyType>
+        KeyType *run_keys() { return reinterpret_cast<KeyType *>(base + header->run_keys_off); }
+
+        int *ops() { return reinterpret_cast<int *>(base + header->ops_off); }
+
+        int *ranges() { return reinterpret_cast<int *>(base + header->ranges_off); }
+};
+
+}
+
+#endif // YCSB_TRACE_H
@@ -0,0 +1,399 @@
+#ifndef YCSB_WORKLOAD_H
+#define YCSB_WORKLOAD_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <math.h>
+#include <cstring>
+#include <vector>
+#include <algorithm>
+#include "tbb/tbb.h"
+
+#include "Key.h"
+
+// YCSB operation types
+enum {
+    OP_INSERT,
+    OP_UPDATE,
+    OP_READ,
+    OP_SCAN,
+    OP_DELETE,
+};
+
+// longest scan an operation may ask for, the adapters' scan buffers hold this many results
+static constexpr int MAX_SCAN_LENGTH = 200;
+
+enum {
+    WORKLOAD_A,
+    WORKLOAD_B,
+    WORKLOAD_C,
+    WORKLOAD_D,
+    WORKLOAD_E,
+};
+
+// request (access pattern) distributions
+enum {
+    UNIFORM,
+    ZIPFIAN,
+    LATEST,
+    HOTSPOT,
+};
+
+/*
+ * In-process YCSB workload generator
+ *
+ * Synthesizes the same load/run streams as index-microbench/gen_workload.py
+ * (CoreWorkload with insertorder=hashed) directly into memory, so skewed
+ * workloads can be run without the Java YCSB pipeline and without parsing
+ * multi-GB text files. The i-th record is identified by its key number i,
+ * and its key is fnvhash64(i) (randint) or "user" + fnvhash64(i) (string),
+ * exactly like YCSB does.
+ *
+ * Generation is split into fixed-size chunks, each seeded from the workload
+ * seed and its chunk index, so the output only depends on the seed and not on
+ * the number of TBB worker threads.
+ */
+namespace workload {
+
+struct WorkloadSpec {
+    double read_proportion;
+    double update_proportion;
+    double scan_proportion;
+    double insert_proportion;
+    int max_scan_length;
+
+    int distribution;
+    double zipfian_theta;
+    double hotset_fraction;
+    double hot_opn_fraction;
+    uint64_t seed;
+
+    // number of threads the run phase is split into (see KeyChooser)
+    int threads;
+};
+
+static constexpr uint64_t CHUNK_SIZE = 1ULL << 16;
+
+static constexpr uint64_t FNV_OFFSET_BASIS_64 = 0xCBF29CE484222325ULL;
+static constexpr uint64_t FNV_PRIME_64 = 1099511628211ULL;
+
+// Same hash YCSB uses to turn a key number into a key
+inline uint64_t fnvhash64(uint64_t val) {
+    uint64_t hashval = FNV_OFFSET_BASIS_64;
+
+    for (int i = 0; i < 8; i++) {
+        uint64_t octet = val & 0x00ff;
+        val = val >> 8;
+
+        hashval = hashval ^ octet;
+        hashval = hashval * FNV_PRIME_64;
+    }
+    // YCSB returns Math.abs() of the signed hash
+    return (int64_t)hashval < 0 ? -hashval : hashval;
+}
+
+// xorshift64* seeded through splitmix64, one instance per chunk
+class Random {
+    private:
+        uint64_t state;
+
+    public:
+        Random(uint64_t seed) {
+            uint64_t z = seed + 0x9E3779B97F4A7C15ULL;
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+            state = (z ^ (z >> 31)) | 1;
+        }
+
+        inline uint64_t next() {
+            state ^= state >> 12;
+            state ^= state << 25;
+            state ^= state >> 27;
+            return state * 0x2545F4914F6CDD1DULL;
+        }
+
+        // uniform in [0, 1)
+        inline double next_double() {
+            return (next() >> 11) * (1.0 / 9007199254740992.0);
+        }
+
+        // uniform in [0, n)
+        inline uint64_t next_uint(uint64_t n) {
+            return (uint64_t)(((unsigned __int128)next() * n) >> 64);
+        }
+};
+
+/*
+ * Zipfian over [0, items) following Gray et al., "Quickly generating
+ * billion-record synthetic databases" (the algorithm YCSB uses). Item 0 is
+ * the most popular one. zeta(n) is computed once, in parallel.
+ */
+class ZipfianGenerator {
+    private:
+        uint64_t items;
+        double theta;
+        double alpha;
+        double zetan;
+        double eta;
+        double half_pow_theta;
+
+        static double zeta(uint64_t n, double theta) {
+            return tbb::parallel_reduce(tbb::blocked_range<uint64_t>(0, n), 0.0,
+                    [&](const tbb::blocked_range<uint64_t> &scope, double sum) {
+                        for (uint64_t i = scope.begin(); i != scope.end(); i++)
+                            sum += 1.0 / pow((double)(i + 1), theta);
+                        return sum;
+                    }, std::plus<double>());
+        }
+
+    public:
+        ZipfianGenerator(uint64_t items, double theta) : items(items), theta(theta) {
+            double zeta2theta = zeta(2, theta);
+
+            alpha = 1.0 / (1.0 - theta);
+            zetan = zeta(items, theta);
+            eta = (1 - pow(2.0 / items, 1 - theta)) / (1 - zeta2theta / zetan);
+            half_pow_theta = 1.0 + pow(0.5, theta);
+        }
+
+        inline uint64_t next(Random &rnd) const {
+            double u = rnd.next_double();
+            double uz = u * zetan;
+
+            if (uz < 1.0)
+                return 0;
+            if (uz < half_pow_theta)
+                return 1;
+
+            uint64_t ret = (uint64_t)(items * pow(eta * u - eta + 1, alpha));
+            return ret < items ? ret : items - 1;
+        }
+};
+
+/*
+ * Picks the key number of the record a read/update/scan targets.
+ *
+ * LATEST draws the zipfian rank over the load-phase record count and counts
+ * it backwards from the newest record inserted so far; records inserted
+ * during the run phase only shift the window, which is what YCSB's
+ * SkewedLatestGenerator does without recomputing zeta for every insert.
+ * run_phase() runs each thread's range of operations concurrently with the
+ * others, so only the load records and the records the thread itself
+ * inserted before the operation are counted: the newest are the thread's own
+ * inserts, followed by the load records from the last one down.
+ */
+class KeyChooser {
+    private:
+        int distribution;
+        uint64_t records;
+        uint64_t hot_interval;
+        uint64_t cold_interval;
+        double hot_opn_fraction;
+        ZipfianGenerator *zipf;
+
+    public:
+        KeyChooser(const WorkloadSpec &spec, uint64_t records)
+            : distribution(spec.distribution), records(records), zipf(NULL) {
+            hot_interval = (uint64_t)(records * spec.hotset_fraction);
+            cold_interval = records - hot_interval;
+            hot_opn_fraction = spec.hot_opn_fraction;
+
+            if (distribution == ZIPFIAN || distribution == LATEST)
+                zipf = new ZipfianGenerator(records, spec.zipfian_theta);
+        }
+
+        ~KeyChooser() {
+            delete zipf;
+        }
+
+        // [first, inserted): records the thread of this operation inserted before it
+        inline uint64_t next(Random &rnd, uint64_t first, uint64_t inserted) const {
+            switch (distribution) {
+                case ZIPFIAN:
+                    // scrambled zipfian, spreads popular items over the key space
+                    return fnvhash64(zipf->next(rnd)) % records;
+                case LATEST: {
+                    uint64_t rank = zipf->next(rnd);
+                    if (rank < inserted - first)
+                        return inserted - 1 - rank;
+                    return records - 1 - (rank - (inserted - first));
+                }
+                case HOTSPOT:
+                    if (cold_interval == 0 || (hot_interval != 0 && rnd.next_double() < hot_opn_fraction))
+                        return rnd.next_uint(hot_interval);
+                    return hot_interval + rnd.next_uint(cold_interval);
+                default:
+                    return rnd.next_uint(records);
+            }
+        }
+};
+
+// Operation mix of index-microbench/workload_spec/workload[a-e]
+inline WorkloadSpec workload_spec(int wl) {
+    WorkloadSpec spec;
+
+    spec.read_proportion = 0;
+    spec.update_proportion = 0;
+    spec.scan_proportion = 0;
+    spec.insert_proportion = 0;
+    spec.max_scan_length = 100;
+    spec.distribution = UNIFORM;
+    spec.zipfian_theta = 0.99;
+    spec.hotset_fraction = 0.2;
+    spec.hot_opn_fraction = 0.8;
+    spec.seed = 0x5EED;
+    spec.threads = 1;
+
+    if (wl == WORKLOAD_A) {
+        spec.read_proportion = 0.5;
+        spec.insert_proportion = 0.5;
+    } else if (wl == WORKLOAD_B || wl == WORKLOAD_D) {
+        spec.read_proportion = 0.95;
+        spec.insert_proportion = 0.05;
+    } else if (wl == WORKLOAD_C) {
+        spec.read_proportion = 1.0;
+    } else if (wl == WORKLOAD_E) {
+        spec.scan_proportion = 0.95;
+        spec.insert_proportion = 0.05;
+    }
+
+    return spec;
+}
+
+/*
+ * Core of the generator: fills ops/ranges for run_size operations and calls
+ * emit(i, keynum) for each of them, where keynum is the key number of the
+ * target record (load_size + n for the n-th run-phase insert). Operation i
+ * belongs to the thread t with run_size * t / threads <= i, as in run_phase().
+ */
+template <typename EmitFunction>
+void generate_run(const WorkloadSpec &spec, uint64_t load_size, uint64_t run_size,
+        std::vector<int> &ranges, std::vector<int> &ops, EmitFunction emit)
+{
+    uint64_t num_chunks = (run_size + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    std::vector<uint64_t> chunk_inserts(num_chunks + 1, 0);
+
+    double read_bound = spec.read_proportion;
+    double update_bound = read_bound + spec.update_proportion;
+    double scan_bound = update_bound + spec.scan_proportion;
+
+    ops.resize(run_size);
+    ranges.resize(run_size);
+
+    // Pass 1: operation types and scan lengths
+    tbb::parallel_for(tbb::blocked_range<uint64_t>(0, num_chunks), [&](const tbb::blocked_range<uint64_t> &scope) {
+        for (uint64_t c = scope.begin(); c != scope.end(); c++) {
+            Random rnd(spec.seed ^ (c << 1));
+            uint64_t end = std::min(run_size, (c + 1) * CHUNK_SIZE);
+            uint64_t inserts = 0;
+
+            for (uint64_t i = c * CHUNK_SIZE; i < end; i++) {
+                double p = rnd.next_double();
+                ranges[i] = 1;
+                if (p < read_bound) {
+                    ops[i] = OP_READ;
+                } else if (p < update_bound) {
+                    ops[i] = OP_UPDATE;
+                } else if (p < scan_bound) {
+                    ops[i] = OP_SCAN;
+                    ranges[i] = 1 + (int)rnd.next_uint(spec.max_scan_length);
+                } else {
+                    ops[i] = OP_INSERT;
+                    inserts++;
+                }
+            }
+            chunk_inserts[c + 1] = inserts;
+        }
+    });
+
+    for (uint64_t c = 0; c < num_chunks; c++)
+        chunk_inserts[c + 1] += chunk_inserts[c];
+
+    // First operation and key number of the first run-phase insert of each thread
+    uint64_t threads = std::max(spec.threads, 1);
+    std::vector<uint64_t> thread_start(threads + 1);
+    std::vector<uint64_t> thread_first(threads);
+    for (uint64_t t = 0; t <= threads; t++)
+        thread_start[t] = run_size * t / threads;
+    for (uint64_t t = 0; t < threads; t++) {
+        uint64_t start = thread_start[t];
+        uint64_t inserted = load_size + chunk_inserts[start / CHUNK_SIZE];
+        for (uint64_t i = start / CHUNK_SIZE * CHUNK_SIZE; i < start; i++)
+            inserted += ops[i] == OP_INSERT;
+        thread_first[t] = inserted;
+    }
+
+    KeyChooser chooser(spec, load_size);
+
+    // Pass 2: target records
+    tbb::parallel_for(tbb::blocked_range<uint64_t>(0, num_chunks), [&](const tbb::blocked_range<uint64_t> &scope) {
+        for (uint64_t c = scope.begin(); c != scope.end(); c++) {
+            Random rnd(spec.seed ^ ((c << 1) | 1));
+            uint64_t end = std::min(run_size, (c + 1) * CHUNK_SIZE);
+            uint64_t inserted = load_size + chunk_inserts[c];
+            uint64_t t = std::upper_bound(thread_start.begin(), thread_start.end(), c * CHUNK_SIZE)
+                    - thread_start.begin() - 1;
+
+            for (uint64_t i = c * CHUNK_SIZE; i < end; i++) {
+                while (i == thread_start[t + 1])
+                    t++;
+                if (ops[i] == OP_INSERT)
+                    emit(i, inserted++);
+                else
+                    emit(i, chooser.next(rnd, thread_first[t], inserted));
+            }
+        }
+    });
+}
+
+inline void generate_randint(const WorkloadSpec &spec, uint64_t load_size, uint64_t run_size,
+        std::vector<uint64_t> &init_keys,
+        std::vector<uint64_t> &keys,
+        std::vector<int> &ranges,
+        std::vector<int> &ops)
+{
+    init_keys.resize(load_size);
+    keys.resize(run_size);
+
+    tbb::parallel_for(tbb::blocked_range<uint64_t>(0, load_size), [&](const tbb::blocked_range<uint64_t> &scope) {
+        for (uint64_t i = scope.begin(); i != scope.end(); i++)
+            init_keys[i] = fnvhash64(i);
+    });
+
+    generate_run(spec, load_size, run_size, ranges, ops, [&](uint64_t i, uint64_t keynum) {
+        keys[i] = fnvhash64(keynum);
+    });
+}
+
+// String keys are "user" + decimal hash, with the hash as value (see ycsb_load_run_string)
+inline Key *make_string_key(uint64_t keynum, bool with_value) {
+    char buf[32];
+    uint64_t hash = fnvhash64(keynum);
+    int len = snprintf(buf, sizeof(buf), "user%lu", hash);
+    Key *k = k->make_leaf(buf, len + 1, with_value ? hash : 0);
+
+    return k;
+}
+
+inline void generate_string(const WorkloadSpec &spec, uint64_t load_size, uint64_t run_size,
+        std::vector<Key *> &init_keys,
+        std::vector<Key *> &keys,
+        std::vector<int> &ranges,
+        std::vector<int> &ops)
+{
+    init_keys.resize(load_size);
+    keys.resize(run_size);
+
+    tbb::parallel_for(tbb::blocked_range<uint64_t>(0, load_size), [&](const tbb::blocked_range<uint64_t> &scope) {
+        for (uint64_t i = scope.begin(); i != scope.end(); i++)
+            init_keys[i] = make_string_key(i, true);
+    });
+
+    generate_run(spec, load_size, run_size, ranges, ops, [&](uint64_t i, uint64_t keynum) {
+        keys[i] = make_string_key(keynum, ops[i] != OP_SCAN);
+    });
+}
+
+}
+
+#endif // YCSB_WORKLOAD_H